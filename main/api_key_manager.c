@@ -4,27 +4,174 @@
  */
 
 #include "api_key_manager.h"
-#include "esp_log.h"
+#include "app_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_random.h"
+#include "esp_timer.h"
+#include "mbedtls/sha256.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <time.h>
 
 static const char *TAG = "API_KEY_MGR";
 
-// NVS namespace for API keys
+// NVS namespace for API keys: one blob per key slot plus the salt
 #define NVS_NAMESPACE "api_keys"
-#define NVS_KEY_COUNT "key_count"
+#define NVS_KEY_COUNT "key_count"       // Legacy format only (plaintext keys, rewritten as a set)
 #define NVS_KEY_PREFIX "key_"
+#define NVS_KEY_SALT "salt"
 
-// In-memory cache of API keys
-static api_key_t s_api_keys[API_KEY_MAX_COUNT];
+#define KEY_RECORD_VERSION 1
+#define KEY_INDEX_SIZE 32               // Open-addressed hash index, power of two >= 2 * API_KEY_MAX_COUNT
+
+_Static_assert(KEY_INDEX_SIZE >= 2 * API_KEY_MAX_COUNT && (KEY_INDEX_SIZE & (KEY_INDEX_SIZE - 1)) == 0,
+               "KEY_INDEX_SIZE must be a power of two with room for every key");
+
+/**
+ * @brief Stored key record (NVS blob "key_<slot>")
+ */
+typedef struct {
+    uint8_t version;
+    uint8_t type;                               // api_key_type_t
+    uint8_t enabled;
+    uint8_t reserved;
+    char name[API_KEY_NAME_MAX_LENGTH];
+    uint8_t hash[API_KEY_HASH_LEN];             // SHA-256(salt || key)
+    char secret[API_KEY_MAX_LENGTH];            // Plaintext, cloud server keys only
+    uint32_t created_timestamp;
+    uint32_t last_used_timestamp;
+    uint32_t use_count;
+} stored_key_t;
+
+/**
+ * @brief Record layout before hashing (same as the old api_key_t)
+ */
+typedef struct {
+    char name[API_KEY_NAME_MAX_LENGTH];
+    char key[API_KEY_MAX_LENGTH];
+    api_key_type_t type;
+    bool enabled;
+    uint32_t created_timestamp;
+    uint32_t last_used_timestamp;
+    uint32_t use_count;
+} legacy_key_t;
+
+_Static_assert(sizeof(stored_key_t) != sizeof(legacy_key_t), "Record formats must differ in size");
+
+// In-memory copy of the key slots, guarded by s_lock
+static stored_key_t s_keys[API_KEY_MAX_COUNT];
+static bool s_used[API_KEY_MAX_COUNT];
+static int64_t s_stats_saved_us[API_KEY_MAX_COUNT];     // When each slot's usage stats last reached NVS
+static uint8_t s_index[KEY_INDEX_SIZE];                 // Slot + 1, 0 = empty
+static uint8_t s_salt[API_KEY_SALT_LEN];
 static size_t s_key_count = 0;
+static SemaphoreHandle_t s_lock = NULL;
 static bool s_initialized = false;
 
-// Helper function to save keys to NVS
-static esp_err_t save_keys_to_nvs(void)
+/**
+ * @brief Overwrite a buffer holding key material (not optimised away)
+ */
+static void secure_wipe(void *buf, size_t len)
+{
+    volatile uint8_t *p = buf;
+    while (len--) {
+        *p++ = 0;
+    }
+}
+
+/**
+ * @brief Salted SHA-256 of a key
+ */
+static void hash_key(const char *key, uint8_t hash[API_KEY_HASH_LEN])
+{
+    uint8_t input[API_KEY_SALT_LEN + API_KEY_MAX_LENGTH];
+    size_t key_len = strnlen(key, API_KEY_MAX_LENGTH - 1);
+    
+    memcpy(input, s_salt, API_KEY_SALT_LEN);
+    memcpy(input + API_KEY_SALT_LEN, key, key_len);
+    mbedtls_sha256(input, API_KEY_SALT_LEN + key_len, hash, 0);
+    secure_wipe(input, sizeof(input));
+}
+
+/**
+ * @brief Compare two hashes in time independent of their contents
+ */
+static bool hash_equal(const uint8_t *a, const uint8_t *b)
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < API_KEY_HASH_LEN; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+static uint32_t index_bucket(const uint8_t *hash)
+{
+    // The hash is uniformly distributed, so its first bytes make a good bucket
+    return ((uint32_t)hash[0] | ((uint32_t)hash[1] << 8)) & (KEY_INDEX_SIZE - 1);
+}
+
+static void index_insert(size_t slot)
+{
+    uint32_t b = index_bucket(s_keys[slot].hash);
+    while (s_index[b] != 0) {
+        b = (b + 1) & (KEY_INDEX_SIZE - 1);
+    }
+    s_index[b] = (uint8_t)(slot + 1);
+}
+
+/**
+ * @brief Rebuild the index (after a delete; linear probing has no cheap removal)
+ */
+static void index_rebuild(void)
+{
+    memset(s_index, 0, sizeof(s_index));
+    for (size_t i = 0; i < API_KEY_MAX_COUNT; i++) {
+        if (s_used[i]) {
+            index_insert(i);
+        }
+    }
+}
+
+/**
+ * @brief Find the slot holding a key hash
+ *
+ * @return int Slot, -1 if no key has this hash
+ */
+static int index_find(const uint8_t *hash)
+{
+    uint32_t b = index_bucket(hash);
+    for (int probe = 0; probe < KEY_INDEX_SIZE && s_index[b] != 0; probe++) {
+        int slot = s_index[b] - 1;
+        if (hash_equal(s_keys[slot].hash, hash)) {
+            return slot;
+        }
+        b = (b + 1) & (KEY_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+static int find_by_name(const char *name)
+{
+    for (size_t i = 0; i < API_KEY_MAX_COUNT; i++) {
+        if (s_used[i] && strncmp(s_keys[i].name, name, API_KEY_NAME_MAX_LENGTH - 1) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void slot_blob_name(size_t slot, char *out, size_t size)
+{
+    snprintf(out, size, "%s%d", NVS_KEY_PREFIX, (int)slot);
+}
+
+/**
+ * @brief Write one key slot to NVS
+ */
+static esp_err_t save_key_to_nvs(size_t slot)
 {
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
@@ -33,84 +180,190 @@ static esp_err_t save_keys_to_nvs(void)
         return err;
     }
     
-    // Save key count
-    err = nvs_set_u32(nvs_handle, NVS_KEY_COUNT, s_key_count);
+    char blob_name[16];
+    slot_blob_name(slot, blob_name, sizeof(blob_name));
+    err = nvs_set_blob(nvs_handle, blob_name, &s_keys[slot], sizeof(stored_key_t));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save key count: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
+        ESP_LOGE(TAG, "Failed to save key slot %u: %s", (unsigned)slot, esp_err_to_name(err));
+    } else {
+        s_stats_saved_us[slot] = esp_timer_get_time();
+    }
+    return err;
+}
+
+/**
+ * @brief Remove one key slot from NVS
+ */
+static esp_err_t erase_key_from_nvs(size_t slot)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
         return err;
     }
     
-    // Save each key
-    for (size_t i = 0; i < s_key_count; i++) {
-        char key_name[16];
-        snprintf(key_name, sizeof(key_name), "%s%d", NVS_KEY_PREFIX, (int)i);
-        
-        err = nvs_set_blob(nvs_handle, key_name, &s_api_keys[i], sizeof(api_key_t));
+    char blob_name[16];
+    slot_blob_name(slot, blob_name, sizeof(blob_name));
+    err = nvs_erase_key(nvs_handle, blob_name);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * @brief Load the device salt, creating it on first use
+ *
+ * A new salt invalidates every stored key hash, so it is only created when
+ * none is stored. Any other read failure is returned and fails init.
+ */
+static esp_err_t load_salt(nvs_handle_t nvs_handle)
+{
+    size_t size = sizeof(s_salt);
+    esp_err_t err = nvs_get_blob(nvs_handle, NVS_KEY_SALT, s_salt, &size);
+    if (err == ESP_OK && size != sizeof(s_salt)) {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err != ESP_ERR_NVS_NOT_FOUND) {
         if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to save key %zu: %s", i, esp_err_to_name(err));
-            nvs_close(nvs_handle);
-            return err;
+            ESP_LOGE(TAG, "Failed to read key salt: %s", esp_err_to_name(err));
         }
+        return err;
     }
     
-    // Commit changes
-    err = nvs_commit(nvs_handle);
-    nvs_close(nvs_handle);
-    
+    esp_fill_random(s_salt, sizeof(s_salt));
+    err = nvs_set_blob(nvs_handle, NVS_KEY_SALT, s_salt, sizeof(s_salt));
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "Saved %zu API keys to NVS", s_key_count);
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store key salt: %s", esp_err_to_name(err));
     }
-    
     return err;
 }
 
-// Helper function to load keys from NVS
+/**
+ * @brief Fill a slot from a key record of the old plaintext format
+ */
+static void convert_legacy_key(size_t slot, const legacy_key_t *legacy)
+{
+    stored_key_t *record = &s_keys[slot];
+    memset(record, 0, sizeof(*record));
+    record->version = KEY_RECORD_VERSION;
+    record->type = (uint8_t)legacy->type;
+    record->enabled = legacy->enabled;
+    memcpy(record->name, legacy->name, API_KEY_NAME_MAX_LENGTH - 1);
+    hash_key(legacy->key, record->hash);
+    if (legacy->type == API_KEY_TYPE_CLOUD_SERVER) {
+        memcpy(record->secret, legacy->key, API_KEY_MAX_LENGTH - 1);
+    }
+    record->created_timestamp = legacy->created_timestamp;
+    record->last_used_timestamp = legacy->last_used_timestamp;
+    record->use_count = legacy->use_count;
+}
+
+/**
+ * @brief Load all key slots, migrating plaintext records to hashed ones
+ */
 static esp_err_t load_keys_from_nvs(void)
 {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGI(TAG, "No stored API keys found");
-        s_key_count = 0;
-        return ESP_OK;
-    } else if (err != ESP_OK) {
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
         return err;
     }
     
-    // Load key count
-    uint32_t count = 0;
-    err = nvs_get_u32(nvs_handle, NVS_KEY_COUNT, &count);
-    if (err == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGI(TAG, "No stored API keys found");
-        s_key_count = 0;
-        nvs_close(nvs_handle);
-        return ESP_OK;
-    } else if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to load key count: %s", esp_err_to_name(err));
+    err = load_salt(nvs_handle);
+    if (err != ESP_OK) {
         nvs_close(nvs_handle);
         return err;
     }
     
-    s_key_count = count > API_KEY_MAX_COUNT ? API_KEY_MAX_COUNT : count;
+    // The old format kept key_count plus key_0..key_<count-1>; later blobs are stale
+    uint32_t legacy_count = 0;
+    bool legacy = (nvs_get_u32(nvs_handle, NVS_KEY_COUNT, &legacy_count) == ESP_OK);
+    size_t migrated = 0;
     
-    // Load each key
-    for (size_t i = 0; i < s_key_count; i++) {
-        char key_name[16];
-        snprintf(key_name, sizeof(key_name), "%s%d", NVS_KEY_PREFIX, (int)i);
-        
-        size_t required_size = sizeof(api_key_t);
-        err = nvs_get_blob(nvs_handle, key_name, &s_api_keys[i], &required_size);
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to load key %zu: %s", i, esp_err_to_name(err));
+    for (size_t slot = 0; slot < API_KEY_MAX_COUNT; slot++) {
+        char blob_name[16];
+        slot_blob_name(slot, blob_name, sizeof(blob_name));
+    
+        size_t size = 0;
+        if (nvs_get_blob(nvs_handle, blob_name, NULL, &size) != ESP_OK) {
+            continue;
+        }
+    
+        if (size == sizeof(stored_key_t)) {
+            size_t required_size = sizeof(stored_key_t);
+            if (nvs_get_blob(nvs_handle, blob_name, &s_keys[slot], &required_size) == ESP_OK &&
+                s_keys[slot].version == KEY_RECORD_VERSION) {
+                s_keys[slot].name[API_KEY_NAME_MAX_LENGTH - 1] = '\0';
+                s_keys[slot].secret[API_KEY_MAX_LENGTH - 1] = '\0';
+                s_used[slot] = true;
+            } else {
+                ESP_LOGW(TAG, "Ignoring unreadable key slot %u", (unsigned)slot);
+            }
+        } else if (legacy && size == sizeof(legacy_key_t) && slot < legacy_count) {
+            legacy_key_t old;
+            size_t required_size = sizeof(old);
+            if (nvs_get_blob(nvs_handle, blob_name, &old, &required_size) == ESP_OK && old.key[0] != '\0') {
+                old.key[API_KEY_MAX_LENGTH - 1] = '\0';
+                convert_legacy_key(slot, &old);
+                if (nvs_set_blob(nvs_handle, blob_name, &s_keys[slot], sizeof(stored_key_t)) == ESP_OK) {
+                    s_used[slot] = true;
+                    migrated++;
+                }
+            }
+            secure_wipe(&old, sizeof(old));
+        } else {
+            ESP_LOGW(TAG, "Dropping stale key slot %u", (unsigned)slot);
+            nvs_erase_key(nvs_handle, blob_name);
+        }
+    
+        if (s_used[slot]) {
+            s_key_count++;
+        } else {
+            secure_wipe(&s_keys[slot], sizeof(stored_key_t));
         }
     }
     
+    if (legacy) {
+        nvs_erase_key(nvs_handle, NVS_KEY_COUNT);
+        ESP_LOGI(TAG, "Migrated %u plaintext API keys to salted hashes", (unsigned)migrated);
+    }
+    err = nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
-    ESP_LOGI(TAG, "Loaded %zu API keys from NVS", s_key_count);
     
-    return ESP_OK;
+    index_rebuild();
+    ESP_LOGI(TAG, "Loaded %zu API keys from NVS", s_key_count);
+    return err;
+}
+
+/**
+ * @brief Public view of a slot (no hash; plaintext only for cloud keys)
+ */
+static void slot_to_public(size_t slot, api_key_t *out)
+{
+    const stored_key_t *record = &s_keys[slot];
+    memset(out, 0, sizeof(*out));
+    memcpy(out->name, record->name, API_KEY_NAME_MAX_LENGTH);
+    memcpy(out->key, record->secret, API_KEY_MAX_LENGTH);
+    out->type = (api_key_type_t)record->type;
+    out->enabled = record->enabled;
+    out->created_timestamp = record->created_timestamp;
+    out->last_used_timestamp = record->last_used_timestamp;
+    out->use_count = record->use_count;
 }
 
 esp_err_t api_key_manager_init(void)
@@ -122,8 +375,17 @@ esp_err_t api_key_manager_init(void)
     
     ESP_LOGI(TAG, "Initializing API key manager");
     
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
     // Clear in-memory keys
-    memset(s_api_keys, 0, sizeof(s_api_keys));
+    memset(s_keys, 0, sizeof(s_keys));
+    memset(s_used, 0, sizeof(s_used));
+    memset(s_stats_saved_us, 0, sizeof(s_stats_saved_us));
     s_key_count = 0;
     
     // Load keys from NVS
@@ -146,43 +408,63 @@ esp_err_t api_key_manager_add(const char *name, const char *key, api_key_type_t
         return ESP_ERR_INVALID_STATE;
     }
     
-    if (name == NULL || key == NULL) {
+    // Only the hash is kept, so a truncated key could never validate
+    if (name == NULL || key == NULL || key[0] == '\0' || strlen(key) >= API_KEY_MAX_LENGTH) {
         return ESP_ERR_INVALID_ARG;
     }
     
+    uint8_t hash[API_KEY_HASH_LEN];
+    hash_key(key, hash);
+    
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    
     if (s_key_count >= API_KEY_MAX_COUNT) {
+        xSemaphoreGive(s_lock);
         ESP_LOGE(TAG, "Maximum API key count reached");
         return ESP_ERR_NO_MEM;
     }
     
-    // Check if key name already exists
-    for (size_t i = 0; i < s_key_count; i++) {
-        if (strcmp(s_api_keys[i].name, name) == 0) {
-            ESP_LOGW(TAG, "API key with name '%s' already exists", name);
-            return ESP_ERR_INVALID_ARG;
-        }
+    if (find_by_name(name) >= 0) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "API key with name '%s' already exists", name);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (index_find(hash) >= 0) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "API key '%s' duplicates an existing key", name);
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    size_t slot = 0;
+    while (s_used[slot]) {
+        slot++;
     }
     
     // Create new key
-    api_key_t new_key = {0};
-    strncpy(new_key.name, name, API_KEY_NAME_MAX_LENGTH - 1);
-    strncpy(new_key.key, key, API_KEY_MAX_LENGTH - 1);
-    new_key.type = type;
-    new_key.enabled = true;
-    new_key.created_timestamp = (uint32_t)time(NULL);
-    new_key.last_used_timestamp = 0;
-    new_key.use_count = 0;
-    
-    // Add to array
-    s_api_keys[s_key_count] = new_key;
-    s_key_count++;
-    
-    // Save to NVS
-    esp_err_t err = save_keys_to_nvs();
+    stored_key_t *record = &s_keys[slot];
+    memset(record, 0, sizeof(*record));
+    record->version = KEY_RECORD_VERSION;
+    record->type = (uint8_t)type;
+    record->enabled = true;
+    strncpy(record->name, name, API_KEY_NAME_MAX_LENGTH - 1);
+    memcpy(record->hash, hash, API_KEY_HASH_LEN);
+    if (type == API_KEY_TYPE_CLOUD_SERVER) {
+        strncpy(record->secret, key, API_KEY_MAX_LENGTH - 1);
+    }
+    record->created_timestamp = (uint32_t)time(NULL);
+    
+    // Save to NVS (this slot only)
+    esp_err_t err = save_key_to_nvs(slot);
     if (err == ESP_OK) {
+        s_used[slot] = true;
+        s_key_count++;
+        index_insert(slot);
         ESP_LOGI(TAG, "Added API key '%s' (type: %d)", name, type);
+    } else {
+        secure_wipe(record, sizeof(*record));
     }
     
+    xSemaphoreGive(s_lock);
     return err;
 }
 
@@ -196,36 +478,27 @@ esp_err_t api_key_manager_delete(const char *name)
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Find key by name
-    int found_index = -1;
-    for (size_t i = 0; i < s_key_count; i++) {
-        if (strcmp(s_api_keys[i].name, name) == 0) {
-            found_index = i;
-            break;
-        }
-    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
     
-    if (found_index == -1) {
+    int slot = find_by_name(name);
+    if (slot < 0) {
+        xSemaphoreGive(s_lock);
         ESP_LOGW(TAG, "API key '%s' not found", name);
         return ESP_ERR_NOT_FOUND;
     }
     
-    // Shift remaining keys
-    for (size_t i = found_index; i < s_key_count - 1; i++) {
-        s_api_keys[i] = s_api_keys[i + 1];
-    }
-    
-    s_key_count--;
-    
-    // Clear last slot
-    memset(&s_api_keys[s_key_count], 0, sizeof(api_key_t));
-    
-    // Save to NVS
-    esp_err_t err = save_keys_to_nvs();
+    esp_err_t err = erase_key_from_nvs(slot);
     if (err == ESP_OK) {
+        secure_wipe(&s_keys[slot], sizeof(stored_key_t));
+        s_used[slot] = false;
+        s_key_count--;
+        index_rebuild();
         ESP_LOGI(TAG, "Deleted API key '%s'", name);
+    } else {
+        ESP_LOGE(TAG, "Failed to delete API key '%s': %s", name, esp_err_to_name(err));
     }
     
+    xSemaphoreGive(s_lock);
     return err;
 }
 
@@ -239,20 +512,23 @@ esp_err_t api_key_manager_set_enabled(const char *name, bool enabled)
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Find key by name
-    for (size_t i = 0; i < s_key_count; i++) {
-        if (strcmp(s_api_keys[i].name, name) == 0) {
-            s_api_keys[i].enabled = enabled;
-            esp_err_t err = save_keys_to_nvs();
-            if (err == ESP_OK) {
-                ESP_LOGI(TAG, "API key '%s' %s", name, enabled ? "enabled" : "disabled");
-            }
-            return err;
-        }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    
+    int slot = find_by_name(name);
+    if (slot < 0) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "API key '%s' not found", name);
+        return ESP_ERR_NOT_FOUND;
     }
     
-    ESP_LOGW(TAG, "API key '%s' not found", name);
-    return ESP_ERR_NOT_FOUND;
+    s_keys[slot].enabled = enabled;
+    esp_err_t err = save_key_to_nvs(slot);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "API key '%s' %s", name, enabled ? "enabled" : "disabled");
+    }
+    
+    xSemaphoreGive(s_lock);
+    return err;
 }
 
 bool api_key_manager_validate(const char *key, api_key_type_t type)
@@ -261,34 +537,32 @@ bool api_key_manager_validate(const char *key, api_key_type_t type)
         return false;
     }
     
-    // Check against all keys
-    for (size_t i = 0; i < s_key_count; i++) {
-        // Skip disabled keys
-        if (!s_api_keys[i].enabled) {
-            continue;
-        }
-        
-        // Check type if specified (type == -1 means check all types)
-        if (type != -1 && s_api_keys[i].type != type) {
-            continue;
-        }
-        
-        // Compare keys
-        if (strcmp(s_api_keys[i].key, key) == 0) {
-            // Update usage stats
-            s_api_keys[i].last_used_timestamp = (uint32_t)time(NULL);
-            s_api_keys[i].use_count++;
-            
-            // Save updated stats (non-blocking, don't check error)
-            save_keys_to_nvs();
-            
-            ESP_LOGI(TAG, "API key '%s' validated successfully", s_api_keys[i].name);
-            return true;
+    // Hash outside the lock; the index lookup is then a handful of compares
+    uint8_t hash[API_KEY_HASH_LEN];
+    hash_key(key, hash);
+    
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    
+    int slot = index_find(hash);
+    bool valid = slot >= 0 && s_keys[slot].enabled &&
+                 ((int)type == -1 || s_keys[slot].type == (uint8_t)type);   // -1 = any type
+    
+    if (valid) {
+        // Update usage stats; flash only sees them once per API_KEY_STATS_PERSIST_SEC
+        s_keys[slot].last_used_timestamp = (uint32_t)time(NULL);
+        s_keys[slot].use_count++;
+        if (esp_timer_get_time() - s_stats_saved_us[slot] >= (int64_t)API_KEY_STATS_PERSIST_SEC * 1000000) {
+            save_key_to_nvs(slot);
         }
+        ESP_LOGD(TAG, "API key '%s' validated successfully", s_keys[slot].name);
     }
     
-    ESP_LOGW(TAG, "Invalid API key provided");
-    return false;
+    xSemaphoreGive(s_lock);
+    
+    if (!valid) {
+        APP_LOGW_RATE_LIMITED(TAG, 10000, "Invalid API key provided");
+    }
+    return valid;
 }
 
 esp_err_t api_key_manager_get(const char *name, api_key_t *key_out)
@@ -297,14 +571,14 @@ esp_err_t api_key_manager_get(const char *name, api_key_t *key_out)
         return ESP_ERR_INVALID_ARG;
     }
     
-    for (size_t i = 0; i < s_key_count; i++) {
-        if (strcmp(s_api_keys[i].name, name) == 0) {
-            *key_out = s_api_keys[i];
-            return ESP_OK;
-        }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int slot = find_by_name(name);
+    if (slot >= 0) {
+        slot_to_public(slot, key_out);
     }
+    xSemaphoreGive(s_lock);
     
-    return ESP_ERR_NOT_FOUND;
+    return slot >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
 esp_err_t api_key_manager_get_all(api_key_t *keys, size_t *count)
@@ -313,8 +587,15 @@ esp_err_t api_key_manager_get_all(api_key_t *keys, size_t *count)
         return ESP_ERR_INVALID_ARG;
     }
     
-    memcpy(keys, s_api_keys, sizeof(api_key_t) * s_key_count);
-    *count = s_key_count;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    size_t n = 0;
+    for (size_t i = 0; i < API_KEY_MAX_COUNT; i++) {
+        if (s_used[i]) {
+            slot_to_public(i, &keys[n++]);
+        }
+    }
+    *count = n;
+    xSemaphoreGive(s_lock);
     
     return ESP_OK;
 }
@@ -325,14 +606,18 @@ esp_err_t api_key_manager_get_by_type(api_key_type_t type, api_key_t *key_out)
         return ESP_ERR_INVALID_ARG;
     }
     
-    for (size_t i = 0; i < s_key_count; i++) {
-        if (s_api_keys[i].type == type && s_api_keys[i].enabled) {
-            *key_out = s_api_keys[i];
-            return ESP_OK;
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (size_t i = 0; i < API_KEY_MAX_COUNT; i++) {
+        if (s_used[i] && s_keys[i].type == (uint8_t)type && s_keys[i].enabled) {
+            slot_to_public(i, key_out);
+            err = ESP_OK;
+            break;
         }
     }
+    xSemaphoreGive(s_lock);
     
-    return ESP_ERR_NOT_FOUND;
+    return err;
 }
 
 esp_err_t api_key_manager_generate(char *key_out, size_t length)
@@ -364,14 +649,19 @@ esp_err_t api_key_manager_clear_all(void)
     
     ESP_LOGW(TAG, "Clearing all API keys");
     
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    
     // Clear in-memory keys
-    memset(s_api_keys, 0, sizeof(s_api_keys));
+    secure_wipe(s_keys, sizeof(s_keys));
+    memset(s_used, 0, sizeof(s_used));
+    memset(s_index, 0, sizeof(s_index));
     s_key_count = 0;
     
-    // Clear NVS
+    // Clear NVS, then start over with a fresh salt
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err != ESP_OK) {
+        xSemaphoreGive(s_lock);
         return err;
     }
     
@@ -379,8 +669,12 @@ esp_err_t api_key_manager_clear_all(void)
     if (err == ESP_OK) {
         err = nvs_commit(nvs_handle);
     }
+    if (err == ESP_OK) {
+        err = load_salt(nvs_handle);
+    }
     
     nvs_close(nvs_handle);
+    xSemaphoreGive(s_lock);
     
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "All API keys cleared");
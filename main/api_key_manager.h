@@ -6,6 +6,12 @@
  * - Local dashboard authentication
  * - Cloud server authentication (sensors.kannacloud.com)
  * - Future API integrations
+ *
+ * Keys are stored as salted SHA-256 hashes (one device-wide random salt) and
+ * found through a small open-addressed index on the hash, so validation costs
+ * one hash plus a constant-time compare regardless of the key count. Only
+ * cloud server keys keep their plaintext, because the device has to present
+ * them. Each key is its own NVS blob, so a change rewrites only that key.
  */
 
 #ifndef API_KEY_MANAGER_H
@@ -23,6 +29,9 @@ extern "C" {
 #define API_KEY_MAX_LENGTH 64
 #define API_KEY_NAME_MAX_LENGTH 32
 #define API_KEY_MAX_COUNT 10
+#define API_KEY_HASH_LEN 32                     // SHA-256
+#define API_KEY_SALT_LEN 16
+#define API_KEY_STATS_PERSIST_SEC 3600          // Usage stats reach NVS at most this often per key
 
 /**
  * @brief API key types
@@ -38,7 +47,7 @@ typedef enum {
  */
 typedef struct {
     char name[API_KEY_NAME_MAX_LENGTH];     // Friendly name (e.g., "Dashboard Key", "Cloud Upload Key")
-    char key[API_KEY_MAX_LENGTH];           // The actual API key
+    char key[API_KEY_MAX_LENGTH];           // Plaintext, cloud server keys only (empty for others)
     api_key_type_t type;                    // Key type
     bool enabled;                           // Whether key is active
     uint32_t created_timestamp;             // Unix timestamp when created
@@ -59,9 +68,10 @@ esp_err_t api_key_manager_init(void);
  * @brief Add a new API key
  * 
  * @param name Friendly name for the key (e.g., "Dashboard Key")
- * @param key The API key string
+ * @param key The API key string (only its salted hash is stored, except for cloud server keys)
  * @param type Type of API key
- * @return ESP_OK on success, ESP_ERR_NO_MEM if max keys reached, error code otherwise
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if max keys reached,
+ *         ESP_ERR_INVALID_ARG if the name or key is already in use, error code otherwise
  */
 esp_err_t api_key_manager_add(const char *name, const char *key, api_key_type_t type);
 
@@ -86,7 +96,9 @@ esp_err_t api_key_manager_set_enabled(const char *name, bool enabled);
  * @brief Validate an API key
  * 
  * Checks if the provided key exists, is enabled, and matches a stored key.
- * Updates last_used_timestamp and use_count on successful validation.
+ * The lookup hashes the key once and compares hashes in constant time.
+ * Updates last_used_timestamp and use_count on successful validation; these
+ * are written to NVS at most every API_KEY_STATS_PERSIST_SEC per key.
  * 
  * @param key The API key to validate
  * @param type Optional: validate against specific key type (use -1 to check all types)
@@ -0,0 +1,162 @@
+/**
+ * @file app_log.c
+ * @brief In-RAM payload trace ring buffer
+ */
+
+#include "app_log.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "APP_LOG";
+
+#define TRACE_WRITE_WAIT_MS     5       // Writers drop the entry rather than wait longer
+
+// Ring of s_size bytes (a power of two). Positions are absolute byte counts
+// that wrap at 2^32; the ring index is the low bits.
+static char *s_ring = NULL;
+static uint32_t s_size = 0;
+static uint32_t s_written = 0;          // Bytes ever written
+static uint32_t s_base = 0;             // Position of the last clear
+static SemaphoreHandle_t s_lock = NULL;
+
+esp_err_t app_log_trace_init(void) {
+#if CONFIG_APP_LOG_TRACE_SIZE > 0
+    if (s_ring != NULL) {
+        return ESP_OK;
+    }
+
+    uint32_t size = 1;
+    while (size * 2 <= CONFIG_APP_LOG_TRACE_SIZE) {
+        size *= 2;
+    }
+
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    char *ring = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (ring == NULL) {
+        ring = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (ring == NULL) {
+        ESP_LOGE(TAG, "No memory for %lu byte trace buffer", (unsigned long)size);
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_size = size;
+    s_ring = ring;
+    ESP_LOGI(TAG, "Payload trace buffer: %lu bytes", (unsigned long)size);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Copy bytes into the ring at the write position (caller holds s_lock)
+ */
+static void trace_put(const char *data, size_t len) {
+    while (len > 0) {
+        uint32_t offset = s_written & (s_size - 1);
+        size_t chunk = s_size - offset;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(s_ring + offset, data, chunk);
+        s_written += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+void app_log_trace_write(const char *tag, const char *data, size_t len) {
+    if (s_ring == NULL || data == NULL) {
+        return;
+    }
+
+    char header[40];
+    int header_len = snprintf(header, sizeof(header), "%lu %s: ",
+                              (unsigned long)(esp_timer_get_time() / 1000), tag != NULL ? tag : "-");
+    if (header_len < 0) {
+        return;
+    }
+    if ((size_t)header_len >= sizeof(header)) {
+        header_len = sizeof(header) - 1;
+    }
+
+    // One entry never takes more than half the ring
+    size_t max_len = s_size / 2 - header_len - 1;
+    if (len > max_len) {
+        len = max_len;
+    }
+
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(TRACE_WRITE_WAIT_MS)) != pdTRUE) {
+        return;
+    }
+    trace_put(header, header_len);
+    trace_put(data, len);
+    trace_put("\n", 1);
+    xSemaphoreGive(s_lock);
+}
+
+size_t app_log_trace_read(uint32_t *cursor, char *buf, size_t size) {
+    if (s_ring == NULL || cursor == NULL || buf == NULL || size == 0) {
+        return 0;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    uint32_t retained = s_written - s_base;
+    bool truncated = false;
+    if (retained > s_size) {
+        retained = s_size;
+        truncated = true;
+    }
+
+    uint32_t pending = s_written - *cursor;
+    if (pending > retained) {
+        // Behind the retained window (or a stale cursor): restart at its oldest entry
+        *cursor = s_written - retained;
+        pending = retained;
+        if (truncated) {
+            while (pending > 0 && s_ring[*cursor & (s_size - 1)] != '\n') {
+                (*cursor)++;
+                pending--;
+            }
+            if (pending > 0) {
+                (*cursor)++;
+                pending--;
+            }
+        }
+    }
+
+    size_t copied = pending < size ? pending : size;
+    for (size_t done = 0; done < copied;) {
+        uint32_t offset = (*cursor + done) & (s_size - 1);
+        size_t chunk = s_size - offset;
+        if (chunk > copied - done) {
+            chunk = copied - done;
+        }
+        memcpy(buf + done, s_ring + offset, chunk);
+        done += chunk;
+    }
+    *cursor += copied;
+
+    xSemaphoreGive(s_lock);
+    return copied;
+}
+
+void app_log_trace_clear(void) {
+    if (s_ring == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_base = s_written;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,151 @@
+/**
+ * @file app_log.h
+ * @brief Per-subsystem log levels, rate-limited logging and payload trace
+ *
+ * A source file selects its subsystem level before including this header:
+ *
+ *     #define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_MQTT
+ *     #include "app_log.h"
+ *
+ * Every ESP_LOGx in that file above the level is then dropped at compile
+ * time, format string included, on top of CONFIG_LOG_MAXIMUM_LEVEL.
+ *
+ * Hot paths use the rate-limited (at most one line per interval, with a
+ * count of the suppressed ones) or sampled (one line in every N) macros.
+ * Payload dumps go to an in-RAM trace ring buffer instead of the UART.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Defaults when the project Kconfig menu has not been processed
+#ifndef CONFIG_APP_LOG_LEVEL_SENSOR
+#define CONFIG_APP_LOG_LEVEL_SENSOR     CONFIG_LOG_MAXIMUM_LEVEL
+#endif
+#ifndef CONFIG_APP_LOG_LEVEL_MQTT
+#define CONFIG_APP_LOG_LEVEL_MQTT       CONFIG_LOG_MAXIMUM_LEVEL
+#endif
+#ifndef CONFIG_APP_LOG_LEVEL_HTTP
+#define CONFIG_APP_LOG_LEVEL_HTTP       CONFIG_LOG_MAXIMUM_LEVEL
+#endif
+#ifndef CONFIG_APP_LOG_TRACE_SIZE
+#define CONFIG_APP_LOG_TRACE_SIZE       0
+#endif
+
+// ESP_LOGx test LOG_LOCAL_LEVEL where they expand, so this applies to the whole file
+#ifdef APP_LOG_LEVEL
+#undef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ((APP_LOG_LEVEL) < CONFIG_LOG_MAXIMUM_LEVEL ? (APP_LOG_LEVEL) : CONFIG_LOG_MAXIMUM_LEVEL)
+#endif
+
+/**
+ * @brief Log at most once per interval_ms from this call site
+ *
+ * The next line that gets through reports how many were suppressed. The
+ * per-site state is not locked; concurrent callers may let an extra line
+ * through.
+ */
+#define APP_LOG_RATE_LIMITED(level, log_macro, tag, interval_ms, format, ...) do {                  \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                                           \
+            static int64_t s_app_log_last_us;                                                       \
+            static uint32_t s_app_log_suppressed;                                                   \
+            int64_t app_log_now_us = esp_timer_get_time();                                          \
+            if (s_app_log_last_us == 0 ||                                                           \
+                app_log_now_us - s_app_log_last_us >= (int64_t)(interval_ms) * 1000) {              \
+                s_app_log_last_us = app_log_now_us;                                                 \
+                if (s_app_log_suppressed > 0) {                                                     \
+                    log_macro(tag, format " (%lu similar suppressed)", ##__VA_ARGS__,               \
+                              (unsigned long)s_app_log_suppressed);                                 \
+                    s_app_log_suppressed = 0;                                                       \
+                } else {                                                                            \
+                    log_macro(tag, format, ##__VA_ARGS__);                                          \
+                }                                                                                   \
+            } else {                                                                                \
+                s_app_log_suppressed++;                                                             \
+            }                                                                                       \
+        }                                                                                           \
+    } while (0)
+
+/**
+ * @brief Log the first and then every n-th call from this call site
+ */
+#define APP_LOG_SAMPLED(level, log_macro, tag, n, format, ...) do {                                 \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                                           \
+            static uint32_t s_app_log_calls;                                                        \
+            if (s_app_log_calls++ % (n) == 0) {                                                     \
+                log_macro(tag, format, ##__VA_ARGS__);                                              \
+            }                                                                                       \
+        }                                                                                           \
+    } while (0)
+
+#define APP_LOGW_RATE_LIMITED(tag, interval_ms, format, ...) \
+    APP_LOG_RATE_LIMITED(ESP_LOG_WARN, ESP_LOGW, tag, interval_ms, format, ##__VA_ARGS__)
+#define APP_LOGI_RATE_LIMITED(tag, interval_ms, format, ...) \
+    APP_LOG_RATE_LIMITED(ESP_LOG_INFO, ESP_LOGI, tag, interval_ms, format, ##__VA_ARGS__)
+#define APP_LOGI_SAMPLED(tag, n, format, ...) \
+    APP_LOG_SAMPLED(ESP_LOG_INFO, ESP_LOGI, tag, n, format, ##__VA_ARGS__)
+#define APP_LOGD_SAMPLED(tag, n, format, ...) \
+    APP_LOG_SAMPLED(ESP_LOG_DEBUG, ESP_LOGD, tag, n, format, ##__VA_ARGS__)
+
+/**
+ * @brief Record a payload in the trace ring buffer (compiled out when it is disabled)
+ */
+#if CONFIG_APP_LOG_TRACE_SIZE > 0
+#define APP_LOG_TRACE(tag, data, len) app_log_trace_write((tag), (data), (len))
+#else
+#define APP_LOG_TRACE(tag, data, len) do { (void)(tag); (void)(data); (void)(len); } while (0)
+#endif
+
+/**
+ * @brief Allocate the trace ring buffer (PSRAM if available)
+ *
+ * Trace writes before this are dropped.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if tracing is
+ *         disabled, ESP_ERR_NO_MEM if allocation fails
+ */
+esp_err_t app_log_trace_init(void);
+
+/**
+ * @brief Append one trace entry ("<uptime ms> <tag>: <data>\n")
+ *
+ * Overwrites the oldest entries when full. Never blocks for long: the entry
+ * is dropped if a reader holds the buffer.
+ *
+ * @param tag Subsystem tag
+ * @param data Payload (need not be NUL terminated)
+ * @param len Payload length in bytes
+ */
+void app_log_trace_write(const char *tag, const char *data, size_t len);
+
+/**
+ * @brief Copy trace text from a read cursor
+ *
+ * Start with *cursor = 0. A cursor that fell behind the overwritten region
+ * skips ahead to the oldest complete entry.
+ *
+ * @param cursor Read position, advanced past the returned bytes
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return size_t Bytes copied (0 when there is nothing newer)
+ */
+size_t app_log_trace_read(uint32_t *cursor, char *buf, size_t size);
+
+/**
+ * @brief Drop all trace entries
+ */
+void app_log_trace_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
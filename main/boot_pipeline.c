@@ -0,0 +1,185 @@
+/**
+ * @file boot_pipeline.c
+ * @brief Dependency-driven startup stage runner
+ */
+
+#include "boot_pipeline.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include <string.h>
+
+static const char *TAG = "BOOT";
+
+// Event group layout: bit i = stage i finished, bit (i + MAX_STAGES) = stage i succeeded
+#define FINISHED_BIT(i)     (1UL << (i))
+#define OK_BIT(i)           (1UL << ((i) + BOOT_PIPELINE_MAX_STAGES))
+#define STAGE_MASK(count)   ((1UL << (count)) - 1)
+#define DEFAULT_STACK_SIZE  4096
+#define STAGE_TASK_PRIO     5
+
+typedef struct {
+    const boot_stage_t *stage;
+    uint8_t index;
+    int64_t started_us;
+    int64_t duration_us;
+    esp_err_t ret;
+} boot_worker_t;
+
+// Workers outlive a timed-out run, so their state is static rather than on the caller's stack
+static EventGroupHandle_t s_group = NULL;
+static boot_worker_t s_workers[BOOT_PIPELINE_MAX_STAGES];
+static uint32_t s_running = 0;
+
+static void boot_stage_task(void *arg)
+{
+    boot_worker_t *w = (boot_worker_t *)arg;
+    
+    int64_t start = esp_timer_get_time();
+    w->ret = w->stage->run();
+    w->duration_us = esp_timer_get_time() - start;
+    
+    xEventGroupSetBits(s_group, FINISHED_BIT(w->index) | (w->ret == ESP_OK ? OK_BIT(w->index) : 0));
+    vTaskDelete(NULL);
+}
+
+esp_err_t boot_pipeline_run(const boot_stage_t *stages, size_t count, TickType_t timeout,
+                            boot_pipeline_result_t *result)
+{
+    if (stages == NULL || count == 0 || count > BOOT_PIPELINE_MAX_STAGES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_group == NULL) {
+        s_group = xEventGroupCreate();
+        if (s_group == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (s_running != 0) {
+        return ESP_ERR_INVALID_STATE;  // Tasks from a timed-out run are still going
+    }
+    
+    xEventGroupClearBits(s_group, STAGE_MASK(count) | (STAGE_MASK(count) << BOOT_PIPELINE_MAX_STAGES));
+    memset(s_workers, 0, sizeof(s_workers));
+    
+    const uint32_t all = STAGE_MASK(count);
+    const int64_t t0 = esp_timer_get_time();
+    const TickType_t deadline = xTaskGetTickCount() + timeout;
+    uint32_t started = 0;
+    uint32_t finished = 0;
+    uint32_t ok = 0;
+    uint32_t skipped = 0;
+    
+    while (finished != all) {
+        // Start every stage whose dependencies have all finished; skipping one
+        // can unblock others, so repeat until nothing changes
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (uint8_t i = 0; i < count; i++) {
+                const boot_stage_t *stage = &stages[i];
+                uint32_t deps = stage->depends_on & all;
+                if ((started & BOOT_STAGE_BIT(i)) || (deps & ~finished) != 0) {
+                    continue;
+                }
+                
+                started |= BOOT_STAGE_BIT(i);
+                progress = true;
+                s_workers[i].stage = stage;
+                s_workers[i].index = i;
+                s_workers[i].started_us = esp_timer_get_time() - t0;
+                
+                if ((deps & ~ok) != 0) {
+                    ESP_LOGW(TAG, "%-10s skipped (dependency failed)", stage->name);
+                    s_workers[i].ret = ESP_ERR_INVALID_STATE;
+                    finished |= BOOT_STAGE_BIT(i);
+                    continue;
+                }
+                if (stage->is_done != NULL && stage->is_done()) {
+                    ESP_LOGI(TAG, "%-10s already done, skipped", stage->name);
+                    finished |= BOOT_STAGE_BIT(i);
+                    ok |= BOOT_STAGE_BIT(i);
+                    skipped |= BOOT_STAGE_BIT(i);
+                    continue;
+                }
+                
+                ESP_LOGI(TAG, "%-10s started at +%lu ms", stage->name, (unsigned long)(s_workers[i].started_us / 1000));
+                uint32_t stack = stage->stack_size ? stage->stack_size : DEFAULT_STACK_SIZE;
+                if (xTaskCreate(boot_stage_task, stage->name, stack, &s_workers[i], STAGE_TASK_PRIO, NULL) != pdPASS) {
+                    ESP_LOGE(TAG, "%-10s could not create task", stage->name);
+                    s_workers[i].ret = ESP_ERR_NO_MEM;
+                    finished |= BOOT_STAGE_BIT(i);
+                    continue;
+                }
+                s_running |= BOOT_STAGE_BIT(i);
+            }
+        }
+        
+        if (finished == all) {
+            break;
+        }
+        if (s_running == 0) {
+            // Nothing can start and nothing is running: the rest wait on a cycle
+            for (uint8_t i = 0; i < count; i++) {
+                if (!(finished & BOOT_STAGE_BIT(i))) {
+                    ESP_LOGE(TAG, "%-10s never started (dependency cycle)", stages[i].name);
+                    s_workers[i].ret = ESP_ERR_INVALID_STATE;
+                }
+            }
+            finished = all;
+            break;
+        }
+        
+        // Sleep until any running stage finishes
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = (timeout == portMAX_DELAY) ? portMAX_DELAY :
+                          ((int32_t)(deadline - now) > 0 ? deadline - now : 0);
+        EventBits_t bits = xEventGroupWaitBits(s_group, s_running, pdFALSE, pdFALSE, wait);
+        uint32_t done_now = bits & s_running;
+        if (done_now == 0) {
+            ESP_LOGE(TAG, "Boot pipeline timed out with stages still running (mask 0x%03lx)",
+                     (unsigned long)s_running);
+            if (result != NULL) {
+                result->ok = ok;
+                result->skipped = skipped;
+                result->total_us = esp_timer_get_time() - t0;
+            }
+            return ESP_ERR_TIMEOUT;
+        }
+        
+        for (uint8_t i = 0; i < count; i++) {
+            if (done_now & BOOT_STAGE_BIT(i)) {
+                if (bits & OK_BIT(i)) {
+                    ok |= BOOT_STAGE_BIT(i);
+                    ESP_LOGI(TAG, "%-10s done in %lu ms", stages[i].name, (unsigned long)(s_workers[i].duration_us / 1000));
+                } else {
+                    ESP_LOGW(TAG, "%-10s failed after %lu ms: %s", stages[i].name,
+                             (unsigned long)(s_workers[i].duration_us / 1000), esp_err_to_name(s_workers[i].ret));
+                }
+            }
+        }
+        finished |= done_now;
+        s_running &= ~done_now;
+    }
+    
+    int64_t total_us = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "Boot pipeline finished in %lu ms (%d ok, %d skipped, %d failed)", (unsigned long)(total_us / 1000),
+             __builtin_popcount(ok), __builtin_popcount(skipped), __builtin_popcount(all & ~ok));
+    for (uint8_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "  %-10s +%6lu ms %6lu ms  %s", stages[i].name, (unsigned long)(s_workers[i].started_us / 1000),
+                 (unsigned long)(s_workers[i].duration_us / 1000),
+                 (skipped & BOOT_STAGE_BIT(i)) ? "skipped" : (ok & BOOT_STAGE_BIT(i)) ? "ok" : "FAILED");
+    }
+    
+    if (result != NULL) {
+        result->ok = ok;
+        result->skipped = skipped;
+        for (uint8_t i = 0; i < count; i++) {
+            result->start_us[i] = s_workers[i].started_us;
+            result->duration_us[i] = s_workers[i].duration_us;
+        }
+        result->total_us = total_us;
+    }
+    return (ok == all) ? ESP_OK : ESP_FAIL;
+}
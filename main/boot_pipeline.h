@@ -0,0 +1,67 @@
+/**
+ * @file boot_pipeline.h
+ * @brief Dependency-driven startup stage runner
+ *
+ * Each stage names the stages it depends on. A stage starts in its own task
+ * as soon as all of its dependencies have finished, so independent work
+ * (e.g. sensor init and Wi-Fi association) overlaps. Stages whose result is
+ * already in place (is_done() returns true) are skipped without a task, and
+ * stages with a failed dependency are skipped as failed.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_PIPELINE_MAX_STAGES    12      // Two event-group bits per stage (24 available)
+#define BOOT_STAGE_BIT(index)       (1UL << (index))
+
+/**
+ * @brief One startup stage
+ */
+typedef struct {
+    const char *name;
+    esp_err_t (*run)(void);     // Runs in its own task; ESP_OK lets dependents start
+    bool (*is_done)(void);      // Optional: true if the stage's artifacts already exist
+    uint32_t depends_on;        // BOOT_STAGE_BIT() mask of stage indices
+    uint32_t stack_size;        // Task stack in bytes, 0 = 4096
+} boot_stage_t;
+
+/**
+ * @brief Outcome of a pipeline run
+ */
+typedef struct {
+    uint32_t ok;                                    // Stages that succeeded or were already done
+    uint32_t skipped;                               // Subset of ok: already done, not run
+    int64_t start_us[BOOT_PIPELINE_MAX_STAGES];     // Start offset from the pipeline start
+    int64_t duration_us[BOOT_PIPELINE_MAX_STAGES];  // Run time (0 when skipped)
+    int64_t total_us;
+} boot_pipeline_result_t;
+
+/**
+ * @brief Run the stages and wait for all of them to finish
+ *
+ * Logs each stage's start offset and duration, then a summary.
+ *
+ * @param stages Stage table; depends_on bits are indices into it
+ * @param count Number of stages (at most BOOT_PIPELINE_MAX_STAGES)
+ * @param timeout Maximum time to wait for the whole pipeline
+ * @param result Optional outcome
+ * @return esp_err_t ESP_OK if every stage succeeded, ESP_FAIL if any failed,
+ *         ESP_ERR_TIMEOUT if stages were still running (they keep running),
+ *         ESP_ERR_INVALID_STATE if a previous run has not finished
+ */
+esp_err_t boot_pipeline_run(const boot_stage_t *stages, size_t count, TickType_t timeout,
+                            boot_pipeline_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
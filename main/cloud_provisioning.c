@@ -4,6 +4,8 @@
  */
 
 #include "cloud_provisioning.h"
+#include "config_cache.h"
+#include "mem_policy.h"
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
@@ -11,7 +13,12 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_mac.h"
+#include "time_sync.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/sha256.h"
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 
 static const char *TAG = "CLOUD_PROV";
 
@@ -22,32 +29,259 @@ static const char *TAG = "CLOUD_PROV";
 #define NVS_KEY_PRIVATE "device_key"
 #define NVS_KEY_CERT_ID "cert_id"
 #define NVS_KEY_MQTT_CA "mqtt_ca_cert"
+#define NVS_KEY_CA "ca_cert"
+#define NVS_KEY_CERT_EXP "cert_expiry"
+#define NVS_KEY_MQTT_CA_EXP "mqtt_ca_expiry"
+#define NVS_KEY_MQTT_CA_SHA "mqtt_ca_sha256"
+#define NVS_KEY_CERT_SLOT "cert_slot"
+#define NVS_KEY_MQTT_CA_RETRY "mqtt_ca_retry"
+
+// The server still had the same expiring MQTT CA: ask again after this long
+#define MQTT_CA_RECHECK_SEC (24 * 3600)
+
+/**
+ * @brief NVS keys of one device credential slot
+ * 
+ * The key, certificate, ID and expiry are written to the inactive slot and
+ * only take effect when NVS_KEY_CERT_SLOT flips to it, so an interrupted or
+ * failed renewal leaves the previous pair in use. Slot 0 uses the original
+ * key names, so devices provisioned before slots existed keep working.
+ */
+typedef struct {
+    const char *cert;
+    const char *key;
+    const char *cert_id;
+    const char *cert_exp;
+} cert_slot_keys_t;
+
+static const cert_slot_keys_t s_cert_slots[2] = {
+    { NVS_KEY_CERT, NVS_KEY_PRIVATE, NVS_KEY_CERT_ID, NVS_KEY_CERT_EXP },
+    { "device_cert_b", "device_key_b", "cert_id_b", "cert_expiry_b" },
+};
+
+// The /create reply is a small JSON object carrying the certificate ID
+#define CREATE_RESPONSE_MAX 1024
+// Initial buffer for chunked replies without Content-Length
+#define CHUNKED_INITIAL_SIZE 1024
 
 // Callback
 static cloud_prov_callback_t s_callback = NULL;
 
-// Buffers for HTTP responses
-static char s_response_buffer[4096];
-static size_t s_response_len = 0;
-
 /**
- * @brief HTTP event handler
+ * @brief Run an opened request and read the body into an exact-size buffer
+ * 
+ * The buffer is sized from Content-Length, or grown in steps for chunked
+ * replies, so there is no fixed staging buffer between the socket and NVS.
+ * 
+ * @param client Configured HTTP client (method, URL and headers set)
+ * @param post_data Request body or NULL
+ * @param body_out Set to a NUL-terminated heap buffer; caller frees it
+ * @param len_out Set to the body length
+ * @param max_len Largest accepted body
  */
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+static esp_err_t http_fetch(esp_http_client_handle_t client, const char *post_data,
+                            char **body_out, size_t *len_out, size_t max_len)
 {
-    switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (s_response_len + evt->data_len < sizeof(s_response_buffer)) {
-                memcpy(s_response_buffer + s_response_len, evt->data, evt->data_len);
-                s_response_len += evt->data_len;
+    *body_out = NULL;
+    *len_out = 0;
+    
+    int post_len = post_data ? (int)strlen(post_data) : 0;
+    esp_err_t err = esp_http_client_open(client, post_len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (post_len > 0 && esp_http_client_write(client, post_data, post_len) != post_len) {
+        ESP_LOGE(TAG, "Failed to send request body");
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    
+    int64_t content_length = esp_http_client_fetch_headers(client);
+    int status_code = esp_http_client_get_status_code(client);
+    if (status_code != 200) {
+        ESP_LOGE(TAG, "Server returned status: %d", status_code);
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    if (content_length > (int64_t)max_len) {
+        ESP_LOGE(TAG, "Response too large (%lu bytes)", (unsigned long)content_length);
+        esp_http_client_close(client);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    size_t capacity = content_length > 0 ? (size_t)content_length : CHUNKED_INITIAL_SIZE;
+    if (capacity > max_len) {
+        capacity = max_len;
+    }
+    char *body = mem_policy_alloc_large(capacity + 1);
+    if (body == NULL) {
+        esp_http_client_close(client);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    size_t len = 0;
+    while (content_length <= 0 || len < (size_t)content_length) {
+        if (len == capacity) {
+            if (capacity >= max_len) {
+                ESP_LOGE(TAG, "Response too large (> %u bytes)", (unsigned)max_len);
+                err = ESP_ERR_NO_MEM;
+                break;
             }
+            size_t grown = capacity * 2 < max_len ? capacity * 2 : max_len;
+            char *bigger = mem_policy_realloc_large(body, grown + 1);
+            if (bigger == NULL) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            body = bigger;
+            capacity = grown;
+        }
+        int n = esp_http_client_read(client, body + len, (int)(capacity - len));
+        if (n < 0) {
+            ESP_LOGE(TAG, "Failed to read response");
+            err = ESP_FAIL;
             break;
-        default:
+        }
+        if (n == 0) {
             break;
+        }
+        len += n;
+    }
+    esp_http_client_close(client);
+    
+    if (err == ESP_OK && len == 0) {
+        ESP_LOGE(TAG, "Empty response");
+        err = ESP_FAIL;
     }
+    if (err != ESP_OK) {
+        free(body);
+        return err;
+    }
+    
+    body[len] = '\0';
+    *body_out = body;
+    *len_out = len;
     return ESP_OK;
 }
 
+/**
+ * @brief Convert an X.509 UTC time to Unix time
+ */
+static uint64_t x509_time_to_unix(const mbedtls_x509_time *t)
+{
+    // Days since 1970-01-01 in the proleptic Gregorian calendar (no timegm() in newlib)
+    int year = t->year - (t->mon <= 2 ? 1 : 0);
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (t->mon + (t->mon > 2 ? -3 : 9)) + 2) / 5 + t->day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    
+    return (uint64_t)(days * 86400 + t->hour * 3600 + t->min * 60 + t->sec);
+}
+
+/**
+ * @brief Get the notAfter time of the first certificate in a PEM string
+ * 
+ * @return Expiry as Unix time, 0 if the PEM could not be parsed
+ */
+static uint64_t pem_not_after(const char *pem, size_t len)
+{
+    mbedtls_x509_crt crt;
+    mbedtls_x509_crt_init(&crt);
+    
+    uint64_t not_after = 0;
+    // PEM input must include the terminating NUL in its length
+    if (mbedtls_x509_crt_parse(&crt, (const unsigned char *)pem, len + 1) == 0) {
+        not_after = x509_time_to_unix(&crt.valid_to);
+    } else {
+        ESP_LOGW(TAG, "Could not parse certificate expiry");
+    }
+    
+    mbedtls_x509_crt_free(&crt);
+    return not_after;
+}
+
+/**
+ * @brief Check whether a certificate is inside the renewal window
+ */
+static bool expires_soon(uint64_t not_after)
+{
+    // Before SNTP the clock reads 1970, which would make every certificate look fresh
+    // and tells us nothing, so only a synced clock can trigger renewal
+    if (not_after == 0 || !time_sync_is_synced()) {
+        return false;
+    }
+    return (uint64_t)time(NULL) + CLOUD_PROV_RENEW_BEFORE_SEC >= not_after;
+}
+
+/**
+ * @brief Read a certificate's stored expiry
+ * 
+ * Certificates stored before expiry tracking have no expiry key; their PEM is
+ * parsed once and the result saved, so later boots only read eight bytes.
+ */
+static uint64_t get_stored_expiry(const char *pem_key, const char *exp_key)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open_from_partition(NVS_PARTITION, NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+        return 0;
+    }
+    
+    uint64_t not_after = 0;
+    if (nvs_get_u64(nvs_handle, exp_key, &not_after) == ESP_ERR_NVS_NOT_FOUND) {
+        size_t size = 0;
+        if (nvs_get_str(nvs_handle, pem_key, NULL, &size) == ESP_OK && size > 1) {
+            char *pem = malloc(size);
+            if (pem != NULL && nvs_get_str(nvs_handle, pem_key, pem, &size) == ESP_OK) {
+                not_after = pem_not_after(pem, size - 1);
+                if (not_after != 0 && nvs_set_u64(nvs_handle, exp_key, not_after) == ESP_OK) {
+                    nvs_commit(nvs_handle);
+                }
+            }
+            free(pem);
+        }
+    }
+    
+    nvs_close(nvs_handle);
+    return not_after;
+}
+
+/**
+ * @brief Active credential slot of an open handle (0 if never switched)
+ */
+static uint8_t get_cert_slot(nvs_handle_t nvs_handle)
+{
+    uint8_t slot = 0;
+    if (nvs_get_u8(nvs_handle, NVS_KEY_CERT_SLOT, &slot) != ESP_OK || slot > 1) {
+        slot = 0;
+    }
+    return slot;
+}
+
+/**
+ * @brief Keys of the active credential slot
+ */
+static const cert_slot_keys_t *active_cert_slot(void)
+{
+    nvs_handle_t nvs_handle;
+    uint8_t slot = 0;
+    if (nvs_open_from_partition(NVS_PARTITION, NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK) {
+        slot = get_cert_slot(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+    return &s_cert_slots[slot];
+}
+
+static void erase_cert_slot(nvs_handle_t nvs_handle, const cert_slot_keys_t *slot)
+{
+    nvs_erase_key(nvs_handle, slot->cert);
+    nvs_erase_key(nvs_handle, slot->key);
+    nvs_erase_key(nvs_handle, slot->cert_id);
+    nvs_erase_key(nvs_handle, slot->cert_exp);
+}
+
 /**
  * @brief Get MAC address as device ID
  */
@@ -96,12 +330,26 @@ bool cloud_prov_has_certificates(void)
     
     // Check if certificate exists
     size_t required_size = 0;
-    err = nvs_get_str(nvs_handle, NVS_KEY_CERT, NULL, &required_size);
+    err = nvs_get_str(nvs_handle, s_cert_slots[get_cert_slot(nvs_handle)].cert, NULL, &required_size);
     nvs_close(nvs_handle);
     
     return (err == ESP_OK && required_size > 0);
 }
 
+bool cloud_prov_is_provisioned(void)
+{
+    if (!cloud_prov_has_certificates()) {
+        return false;
+    }
+    const cert_slot_keys_t *slot = active_cert_slot();
+    if (expires_soon(get_stored_expiry(slot->cert, slot->cert_exp))) {
+        ESP_LOGW(TAG, "Device certificate expires within %d days, renewing",
+                 CLOUD_PROV_RENEW_BEFORE_SEC / (24 * 3600));
+        return false;
+    }
+    return true;
+}
+
 esp_err_t cloud_prov_get_certificate(char *cert_out, size_t *cert_len)
 {
     if (cert_out == NULL || cert_len == NULL) {
@@ -115,7 +363,7 @@ esp_err_t cloud_prov_get_certificate(char *cert_out, size_t *cert_len)
     }
     
     size_t required_size = CLOUD_PROV_MAX_CERT_SIZE;
-    err = nvs_get_str(nvs_handle, NVS_KEY_CERT, cert_out, &required_size);
+    err = nvs_get_str(nvs_handle, s_cert_slots[get_cert_slot(nvs_handle)].cert, cert_out, &required_size);
     nvs_close(nvs_handle);
     
     if (err == ESP_OK) {
@@ -140,7 +388,7 @@ esp_err_t cloud_prov_get_private_key(char *key_out, size_t *key_len)
     }
     
     size_t required_size = CLOUD_PROV_MAX_KEY_SIZE;
-    err = nvs_get_str(nvs_handle, NVS_KEY_PRIVATE, key_out, &required_size);
+    err = nvs_get_str(nvs_handle, s_cert_slots[get_cert_slot(nvs_handle)].key, key_out, &required_size);
     nvs_close(nvs_handle);
     
     if (err == ESP_OK) {
@@ -162,31 +410,57 @@ esp_err_t cloud_prov_clear_certificates(void)
         return err;
     }
     
-    nvs_erase_key(nvs_handle, NVS_KEY_CERT);
-    nvs_erase_key(nvs_handle, NVS_KEY_PRIVATE);
-    nvs_erase_key(nvs_handle, NVS_KEY_CERT_ID);
+    erase_cert_slot(nvs_handle, &s_cert_slots[0]);
+    erase_cert_slot(nvs_handle, &s_cert_slots[1]);
+    nvs_erase_key(nvs_handle, NVS_KEY_CERT_SLOT);
     nvs_erase_key(nvs_handle, NVS_KEY_MQTT_CA);
+    nvs_erase_key(nvs_handle, NVS_KEY_CA);
+    nvs_erase_key(nvs_handle, NVS_KEY_MQTT_CA_EXP);
+    nvs_erase_key(nvs_handle, NVS_KEY_MQTT_CA_SHA);
+    nvs_erase_key(nvs_handle, NVS_KEY_MQTT_CA_RETRY);
     
     err = nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
+    config_cache_invalidate(CONFIG_CACHE_CERTS);
     
     return err;
 }
 
-esp_err_t cloud_prov_download_mqtt_ca_cert(void)
+bool cloud_prov_has_mqtt_ca_cert(void)
 {
-    // Check if certificate already exists
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open_from_partition(NVS_PARTITION, NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err == ESP_OK) {
-        size_t required_size = 0;
-        err = nvs_get_str(nvs_handle, NVS_KEY_MQTT_CA, NULL, &required_size);
-        nvs_close(nvs_handle);
-        
-        if (err == ESP_OK && required_size > 0) {
-            ESP_LOGI(TAG, "MQTT CA certificate already exists (%zu bytes), skipping download", required_size);
-            return ESP_OK;
+    if (err != ESP_OK) {
+        return false;
+    }
+    
+    size_t required_size = 0;
+    err = nvs_get_str(nvs_handle, NVS_KEY_MQTT_CA, NULL, &required_size);
+    uint64_t retry_after = 0;
+    nvs_get_u64(nvs_handle, NVS_KEY_MQTT_CA_RETRY, &retry_after);
+    nvs_close(nvs_handle);
+    
+    if (err != ESP_OK || required_size == 0) {
+        return false;
+    }
+    if (expires_soon(get_stored_expiry(NVS_KEY_MQTT_CA, NVS_KEY_MQTT_CA_EXP))) {
+        if ((uint64_t)time(NULL) < retry_after) {
+            // The last fetch returned this same certificate; don't download it on every boot
+            ESP_LOGW(TAG, "MQTT CA certificate expires soon, no newer one published yet");
+            return true;
         }
+        ESP_LOGW(TAG, "MQTT CA certificate expires soon, fetching a fresh copy");
+        return false;
+    }
+    return true;
+}
+
+esp_err_t cloud_prov_download_mqtt_ca_cert(void)
+{
+    // Check if certificate already exists
+    if (cloud_prov_has_mqtt_ca_cert()) {
+        ESP_LOGI(TAG, "MQTT CA certificate already exists, skipping download");
+        return ESP_OK;
     }
     
     ESP_LOGI(TAG, "Downloading MQTT CA certificate from sensors.kannacloud.com...");
@@ -194,7 +468,6 @@ esp_err_t cloud_prov_download_mqtt_ca_cert(void)
     esp_http_client_config_t config = {
         .url = "https://sensors.kannacloud.com/static/ca.crt",
         .method = HTTP_METHOD_GET,
-        .event_handler = http_event_handler,
         .crt_bundle_attach = esp_crt_bundle_attach,
         .timeout_ms = 10000,
     };
@@ -205,48 +478,62 @@ esp_err_t cloud_prov_download_mqtt_ca_cert(void)
         return ESP_FAIL;
     }
     
-    // Reset response buffer
-    s_response_len = 0;
-    memset(s_response_buffer, 0, sizeof(s_response_buffer));
-    
-    err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    
+    char *ca_cert = NULL;
+    size_t ca_len = 0;
+    // Getters copy into CLOUD_PROV_MAX_CERT_SIZE buffers, so leave room for the NUL
+    esp_err_t err = http_fetch(client, NULL, &ca_cert, &ca_len, CLOUD_PROV_MAX_CERT_SIZE - 1);
     esp_http_client_cleanup(client);
-    
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
         return err;
     }
     
-    if (status_code != 200) {
-        ESP_LOGE(TAG, "Server returned status: %d", status_code);
-        return ESP_FAIL;
-    }
-    
-    if (s_response_len == 0 || s_response_len >= CLOUD_PROV_MAX_CERT_SIZE) {
-        ESP_LOGE(TAG, "Invalid certificate size: %zu bytes", s_response_len);
-        return ESP_FAIL;
-    }
+    ESP_LOGI(TAG, "Downloaded MQTT CA certificate (%u bytes)", (unsigned)ca_len);
     
-    // Null-terminate the certificate
-    s_response_buffer[s_response_len] = '\0';
-    
-    ESP_LOGI(TAG, "Downloaded MQTT CA certificate (%zu bytes)", s_response_len);
+    uint8_t hash[32];
+    mbedtls_sha256((const unsigned char *)ca_cert, ca_len, hash, 0);
+    uint64_t not_after = pem_not_after(ca_cert, ca_len);
     
     // Store in NVS
+    nvs_handle_t nvs_handle;
     err = nvs_open_from_partition(NVS_PARTITION, NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open NVS partition: %s", esp_err_to_name(err));
+        free(ca_cert);
         return err;
     }
     
-    err = nvs_set_str(nvs_handle, NVS_KEY_MQTT_CA, s_response_buffer);
-    if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle);
+    // Same CA as before (only the renewal window triggered the fetch): skip the flash write
+    uint8_t stored_hash[32];
+    size_t hash_len = sizeof(stored_hash);
+    bool unchanged = nvs_get_blob(nvs_handle, NVS_KEY_MQTT_CA_SHA, stored_hash, &hash_len) == ESP_OK &&
+                     hash_len == sizeof(stored_hash) && memcmp(hash, stored_hash, sizeof(hash)) == 0;
+    if (unchanged) {
+        // Refresh the expiry and back off, or every boot would fetch it again
+        ESP_LOGW(TAG, "Server still publishes the same MQTT CA certificate, checking again in %d h",
+                 MQTT_CA_RECHECK_SEC / 3600);
+        err = nvs_set_u64(nvs_handle, NVS_KEY_MQTT_CA_EXP, not_after);
+        if (err == ESP_OK) {
+            err = nvs_set_u64(nvs_handle, NVS_KEY_MQTT_CA_RETRY, (uint64_t)time(NULL) + MQTT_CA_RECHECK_SEC);
+        }
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
+    } else {
+        nvs_erase_key(nvs_handle, NVS_KEY_MQTT_CA_RETRY);
+        err = nvs_set_str(nvs_handle, NVS_KEY_MQTT_CA, ca_cert);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(nvs_handle, NVS_KEY_MQTT_CA_SHA, hash, sizeof(hash));
+        }
+        if (err == ESP_OK) {
+            err = nvs_set_u64(nvs_handle, NVS_KEY_MQTT_CA_EXP, not_after);
+        }
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
     }
     
     nvs_close(nvs_handle);
+    free(ca_cert);
     
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "MQTT CA certificate stored successfully");
@@ -280,6 +567,56 @@ esp_err_t cloud_prov_get_mqtt_ca_cert(char *cert_out, size_t *cert_len)
     return err;
 }
 
+esp_err_t cloud_prov_get_ca_cert(char *cert_out, size_t *cert_len)
+{
+    if (cert_out == NULL || cert_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open_from_partition(NVS_PARTITION, NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    size_t required_size = CLOUD_PROV_MAX_CERT_SIZE;
+    err = nvs_get_str(nvs_handle, NVS_KEY_CA, cert_out, &required_size);
+    nvs_close(nvs_handle);
+    
+    if (err == ESP_OK) {
+        *cert_len = strlen(cert_out);
+    }
+    
+    return err;
+}
+
+esp_err_t cloud_prov_get_cert_info(cloud_prov_cert_info_t *info)
+{
+    if (info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(info, 0, sizeof(*info));
+    
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open_from_partition(NVS_PARTITION, NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    
+    const cert_slot_keys_t *slot = &s_cert_slots[get_cert_slot(nvs_handle)];
+    size_t id_len = sizeof(info->cert_id);
+    err = nvs_get_str(nvs_handle, slot->cert_id, info->cert_id, &id_len);
+    size_t hash_len = sizeof(info->mqtt_ca_sha256);
+    info->has_mqtt_ca_sha256 = nvs_get_blob(nvs_handle, NVS_KEY_MQTT_CA_SHA, info->mqtt_ca_sha256, &hash_len) == ESP_OK &&
+                               hash_len == sizeof(info->mqtt_ca_sha256);
+    nvs_close(nvs_handle);
+    
+    info->not_after = get_stored_expiry(slot->cert, slot->cert_exp);
+    info->mqtt_ca_not_after = get_stored_expiry(NVS_KEY_MQTT_CA, NVS_KEY_MQTT_CA_EXP);
+    
+    return err;
+}
+
 /**
  * @brief Request certificate generation from SSL Manager
  */
@@ -287,9 +624,6 @@ static esp_err_t request_certificate_generation(char *cert_id_out, size_t cert_i
 {
     ESP_LOGI(TAG, "Requesting certificate generation from %s", CLOUD_PROV_SSL_MANAGER_URL);
     
-    char device_id[32];
-    cloud_prov_get_device_id(device_id, sizeof(device_id));
-    
     // Build POST data (note: %% escapes the % in URL encoding %20 for spaces)
     char post_data[512];
     snprintf(post_data, sizeof(post_data),
@@ -301,7 +635,6 @@ static esp_err_t request_certificate_generation(char *cert_id_out, size_t cert_i
     esp_http_client_config_t config = {
         .url = CLOUD_PROV_SSL_MANAGER_URL "/create",
         .method = HTTP_METHOD_POST,
-        .event_handler = http_event_handler,
         .crt_bundle_attach = esp_crt_bundle_attach,
         .timeout_ms = 10000,
     };
@@ -316,32 +649,19 @@ static esp_err_t request_certificate_generation(char *cert_id_out, size_t cert_i
     esp_http_client_set_header(client, "X-API-Key", CLOUD_PROV_API_KEY);
     esp_http_client_set_header(client, "Accept", "application/json");
     esp_http_client_set_header(client, "Content-Type", "application/x-www-form-urlencoded");
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
-    
-    // Reset response buffer
-    s_response_len = 0;
-    memset(s_response_buffer, 0, sizeof(s_response_buffer));
     
     // Perform request
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    
+    char *response = NULL;
+    size_t response_len = 0;
+    esp_err_t err = http_fetch(client, post_data, &response, &response_len, CREATE_RESPONSE_MAX);
     esp_http_client_cleanup(client);
-    
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
         return err;
     }
     
-    if (status_code != 200) {
-        ESP_LOGE(TAG, "Server returned status: %d", status_code);
-        ESP_LOGE(TAG, "Response: %.*s", (int)s_response_len, s_response_buffer);
-        return ESP_FAIL;
-    }
-    
     // Parse JSON response
-    s_response_buffer[s_response_len] = '\0';
-    cJSON *json = cJSON_Parse(s_response_buffer);
+    cJSON *json = cJSON_Parse(response);
+    free(response);
     if (json == NULL) {
         ESP_LOGE(TAG, "Failed to parse JSON response");
         return ESP_FAIL;
@@ -365,8 +685,10 @@ static esp_err_t request_certificate_generation(char *cert_id_out, size_t cert_i
 
 /**
  * @brief Download file from SSL Manager
+ * 
+ * @param output Set to an exact-size heap buffer holding the file; caller frees it
  */
-static esp_err_t download_file(const char *cert_id, const char *file_type, char *output, size_t output_size)
+static esp_err_t download_file(const char *cert_id, const char *file_type, char **output, size_t max_size)
 {
     char url[256];
     snprintf(url, sizeof(url), "%s/download/%s/%s",
@@ -377,7 +699,6 @@ static esp_err_t download_file(const char *cert_id, const char *file_type, char
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_GET,
-        .event_handler = http_event_handler,
         .crt_bundle_attach = esp_crt_bundle_attach,
         .timeout_ms = 10000,
     };
@@ -389,41 +710,16 @@ static esp_err_t download_file(const char *cert_id, const char *file_type, char
     
     esp_http_client_set_header(client, "X-API-Key", CLOUD_PROV_API_KEY);
     
-    // Reset response buffer
-    s_response_len = 0;
-    memset(s_response_buffer, 0, sizeof(s_response_buffer));
-    
-    esp_err_t err = esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-    
-    ESP_LOGI(TAG, "Download response - Status: %d, Length: %zu bytes", status_code, s_response_len);
-    
-    // Log first 200 chars of response for debugging
-    if (s_response_len > 0) {
-        char preview[201];
-        size_t preview_len = s_response_len < 200 ? s_response_len : 200;
-        memcpy(preview, s_response_buffer, preview_len);
-        preview[preview_len] = '\0';
-        ESP_LOGI(TAG, "Response preview: %.200s", preview);
-    }
-    
+    size_t len = 0;
+    esp_err_t err = http_fetch(client, NULL, output, &len, max_size - 1);
     esp_http_client_cleanup(client);
     
-    if (err != ESP_OK || status_code != 200) {
-        ESP_LOGE(TAG, "Failed to download %s: %s (status: %d)",
-                 file_type, esp_err_to_name(err), status_code);
-        return ESP_FAIL;
-    }
-    
-    if (s_response_len >= output_size) {
-        ESP_LOGE(TAG, "Downloaded %s too large (%zu bytes)", file_type, s_response_len);
-        return ESP_ERR_NO_MEM;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to download %s: %s", file_type, esp_err_to_name(err));
+        return err;
     }
     
-    memcpy(output, s_response_buffer, s_response_len);
-    output[s_response_len] = '\0';
-    
-    ESP_LOGI(TAG, "Downloaded %s (%zu bytes)", file_type, s_response_len);
+    ESP_LOGI(TAG, "Downloaded %s (%u bytes)", file_type, (unsigned)len);
     
     return ESP_OK;
 }
@@ -434,8 +730,8 @@ esp_err_t cloud_prov_provision_device(void)
     ESP_LOGI(TAG, "Starting automatic device provisioning");
     ESP_LOGI(TAG, "===========================================");
     
-    // Check if already provisioned
-    if (cloud_prov_has_certificates()) {
+    // Check if already provisioned (certificates present and not close to expiry)
+    if (cloud_prov_is_provisioned()) {
         ESP_LOGI(TAG, "Device already has certificates");
         if (s_callback) {
             s_callback(true, "Already provisioned");
@@ -454,60 +750,28 @@ esp_err_t cloud_prov_provision_device(void)
         return err;
     }
     
-    // Step 2: Download private key
-    char *private_key = malloc(CLOUD_PROV_MAX_KEY_SIZE);
-    if (private_key == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for private key");
-        return ESP_ERR_NO_MEM;
-    }
-    
-    err = download_file(cert_id, "key", private_key, CLOUD_PROV_MAX_KEY_SIZE);
+    // Step 2: Download private key and certificate. Both are held until stored so a
+    // failed renewal never leaves a new key next to the old certificate.
+    char *private_key = NULL;
+    err = download_file(cert_id, "key", &private_key, CLOUD_PROV_MAX_KEY_SIZE);
     if (err != ESP_OK) {
-        free(private_key);
         if (s_callback) {
             s_callback(false, "Private key download failed");
         }
         return err;
     }
     
-    // Step 3: Download certificate
-    char *certificate = malloc(CLOUD_PROV_MAX_CERT_SIZE);
-    if (certificate == NULL) {
-        free(private_key);
-        ESP_LOGE(TAG, "Failed to allocate memory for certificate");
-        return ESP_ERR_NO_MEM;
-    }
-    
-    err = download_file(cert_id, "cert", certificate, CLOUD_PROV_MAX_CERT_SIZE);
+    char *certificate = NULL;
+    err = download_file(cert_id, "cert", &certificate, CLOUD_PROV_MAX_CERT_SIZE);
     if (err != ESP_OK) {
         free(private_key);
-        free(certificate);
         if (s_callback) {
             s_callback(false, "Certificate download failed");
         }
         return err;
     }
     
-    // Step 3.5: Download CA certificate
-    char *ca_certificate = malloc(CLOUD_PROV_MAX_CERT_SIZE);
-    if (ca_certificate == NULL) {
-        free(private_key);
-        free(certificate);
-        ESP_LOGE(TAG, "Failed to allocate memory for CA certificate");
-        return ESP_ERR_NO_MEM;
-    }
-    
-    err = download_file(cert_id, "ca", ca_certificate, CLOUD_PROV_MAX_CERT_SIZE);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "CA certificate download failed (optional): %s", esp_err_to_name(err));
-        // CA cert is optional, don't fail provisioning
-        free(ca_certificate);
-        ca_certificate = NULL;
-    } else {
-        ESP_LOGI(TAG, "CA certificate downloaded successfully");
-    }
-    
-    // Step 4: Initialize NVS partition and store certificates
+    // Step 3: Initialize NVS partition and store certificates
     ESP_LOGI(TAG, "Initializing certificate NVS partition");
     err = nvs_flash_init_partition(NVS_PARTITION);
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -532,33 +796,69 @@ esp_err_t cloud_prov_provision_device(void)
         return err;
     }
     
-    // Store certificate ID
-    nvs_set_str(nvs_handle, NVS_KEY_CERT_ID, cert_id);
+    // Stage the new pair in the inactive slot; the active one stays in use until the flip
+    uint8_t active = get_cert_slot(nvs_handle);
+    const cert_slot_keys_t *staging = &s_cert_slots[active ^ 1];
+    erase_cert_slot(nvs_handle, staging);   // Leftovers of an earlier failed attempt
+    
+    err = nvs_set_str(nvs_handle, staging->key, private_key);
+    if (err == ESP_OK) {
+        err = nvs_set_str(nvs_handle, staging->cert, certificate);
+    }
+    if (err == ESP_OK) {
+        // Expiry stored with the certificate, so later boots can decide without parsing
+        err = nvs_set_u64(nvs_handle, staging->cert_exp, pem_not_after(certificate, strlen(certificate)));
+    }
+    if (err == ESP_OK) {
+        err = nvs_set_str(nvs_handle, staging->cert_id, cert_id);
+    }
+    free(private_key);
+    free(certificate);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
     
-    // Store private key
-    err = nvs_set_str(nvs_handle, NVS_KEY_PRIVATE, private_key);
+    // Switch to the new pair only once all of it is stored
+    if (err == ESP_OK) {
+        err = nvs_set_u8(nvs_handle, NVS_KEY_CERT_SLOT, active ^ 1);
+    }
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to store private key: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to store certificates: %s", esp_err_to_name(err));
+        erase_cert_slot(nvs_handle, staging);
+        nvs_commit(nvs_handle);
         nvs_close(nvs_handle);
-        free(private_key);
-        free(certificate);
+        if (s_callback) {
+            s_callback(false, "NVS storage failed");
+        }
         return err;
     }
     
-    // Store certificate
-    err = nvs_set_str(nvs_handle, NVS_KEY_CERT, certificate);
+    // The previous pair is no longer referenced. Commit before the CA download below,
+    // which can take seconds: the switch must not wait on the network.
+    erase_cert_slot(nvs_handle, &s_cert_slots[active]);
+    err = nvs_commit(nvs_handle);
+    config_cache_invalidate(CONFIG_CACHE_CERTS);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to store certificate: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to commit certificates to NVS: %s", esp_err_to_name(err));
         nvs_close(nvs_handle);
-        free(private_key);
-        free(certificate);
-        if (ca_certificate) free(ca_certificate);
+        if (s_callback) {
+            s_callback(false, "NVS storage failed");
+        }
         return err;
     }
     
-    // Store CA certificate if available
-    if (ca_certificate != NULL) {
-        err = nvs_set_str(nvs_handle, "ca_cert", ca_certificate);
+    // Step 4: Download and store CA certificate (optional)
+    char *ca_certificate = NULL;
+    err = download_file(cert_id, "ca", &ca_certificate, CLOUD_PROV_MAX_CERT_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "CA certificate download failed (optional): %s", esp_err_to_name(err));
+        // CA cert is optional, don't fail provisioning
+    } else {
+        err = nvs_set_str(nvs_handle, NVS_KEY_CA, ca_certificate);
+        free(ca_certificate);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
         if (err != ESP_OK) {
             ESP_LOGW(TAG, "Failed to store CA certificate: %s", esp_err_to_name(err));
             // Don't fail provisioning if CA cert storage fails
@@ -567,28 +867,16 @@ esp_err_t cloud_prov_provision_device(void)
         }
     }
     
-    err = nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
+    config_cache_invalidate(CONFIG_CACHE_CERTS);
     
-    // Clean up
-    free(private_key);
-    free(certificate);
-    if (ca_certificate) free(ca_certificate);
+    ESP_LOGI(TAG, "===========================================");
+    ESP_LOGI(TAG, "✓ Device provisioning completed successfully!");
+    ESP_LOGI(TAG, "===========================================");
     
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "===========================================");
-        ESP_LOGI(TAG, "✓ Device provisioning completed successfully!");
-        ESP_LOGI(TAG, "===========================================");
-        
-        if (s_callback) {
-            s_callback(true, "Provisioning completed");
-        }
-    } else {
-        ESP_LOGE(TAG, "Failed to commit certificates to NVS");
-        if (s_callback) {
-            s_callback(false, "NVS storage failed");
-        }
+    if (s_callback) {
+        s_callback(true, "Provisioning completed");
     }
     
-    return err;
+    return ESP_OK;
 }
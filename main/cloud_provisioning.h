@@ -13,6 +13,7 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +27,20 @@ extern "C" {
 #define CLOUD_PROV_MAX_CERT_SIZE (4096)
 #define CLOUD_PROV_MAX_KEY_SIZE (4096)
 
+// Certificates are renewed once they are this close to expiry
+#define CLOUD_PROV_RENEW_BEFORE_SEC (14 * 24 * 3600)
+
+/**
+ * @brief Locally stored certificate metadata
+ */
+typedef struct {
+    char cert_id[64];               ///< SSL Manager certificate ID
+    uint64_t not_after;             ///< Device certificate expiry (Unix time), 0 if unknown
+    uint64_t mqtt_ca_not_after;     ///< MQTT CA expiry (Unix time), 0 if unknown
+    uint8_t mqtt_ca_sha256[32];     ///< SHA-256 of the stored MQTT CA PEM
+    bool has_mqtt_ca_sha256;
+} cloud_prov_cert_info_t;
+
 /**
  * @brief Provisioning status callback
  * 
@@ -48,7 +63,7 @@ esp_err_t cloud_prov_init(cloud_prov_callback_t callback);
  * @brief Start automatic device provisioning
  * 
  * This will:
- * 1. Check if device already has certificates
+ * 1. Check if device already has certificates that are not close to expiry
  * 2. If not, request new certificates from ssl.kannacloud.com
  * 3. Download private key and certificate
  * 4. Store them in NVS for future use
@@ -65,6 +80,24 @@ esp_err_t cloud_prov_provision_device(void);
  */
 bool cloud_prov_has_certificates(void);
 
+/**
+ * @brief Check if provisioning has nothing to do
+ * 
+ * Certificates exist and, once time is synced, are more than
+ * CLOUD_PROV_RENEW_BEFORE_SEC away from expiry. Uses stored metadata only.
+ * 
+ * @return true if cloud_prov_provision_device() would skip the network
+ */
+bool cloud_prov_is_provisioned(void);
+
+/**
+ * @brief Get stored certificate metadata
+ * 
+ * @param info Output metadata
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not provisioned
+ */
+esp_err_t cloud_prov_get_cert_info(cloud_prov_cert_info_t *info);
+
 /**
  * @brief Get device certificate
  * 
@@ -109,6 +142,15 @@ esp_err_t cloud_prov_clear_certificates(void);
  */
 esp_err_t cloud_prov_download_mqtt_ca_cert(void);
 
+/**
+ * @brief Check if the MQTT CA certificate is stored
+ * 
+ * A stored CA inside the renewal window counts as missing.
+ * 
+ * @return true if cloud_prov_download_mqtt_ca_cert() has nothing to do
+ */
+bool cloud_prov_has_mqtt_ca_cert(void);
+
 /**
  * @brief Get MQTT CA certificate
  * 
@@ -118,6 +160,18 @@ esp_err_t cloud_prov_download_mqtt_ca_cert(void);
  */
 esp_err_t cloud_prov_get_mqtt_ca_cert(char *cert_out, size_t *cert_len);
 
+/**
+ * @brief Get the CA certificate that signed the device certificate
+ * 
+ * Stored during provisioning and offered to browsers at /ca.crt. Reads NVS;
+ * hot paths should use config_cache_acquire_ca_cert() instead.
+ * 
+ * @param cert_out Buffer to store CA certificate (must be CLOUD_PROV_MAX_CERT_SIZE bytes)
+ * @param cert_len Pointer to store actual certificate length
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if no certificate
+ */
+esp_err_t cloud_prov_get_ca_cert(char *cert_out, size_t *cert_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,151 @@
+/**
+ * @file config_cache.c
+ * @brief Read-mostly RAM copy of NVS-backed identity and certificate data
+ */
+
+#include "config_cache.h"
+#include "cloud_provisioning.h"
+#include "wifi_manager.h"
+#include "esp_log.h"
+#include "mem_policy.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "CONFIG_CACHE";
+
+static SemaphoreHandle_t s_lock = NULL;
+static atomic_uint s_stale = CONFIG_CACHE_ALL;  // Items to reload on next access
+
+static char s_device_id[32] = "";
+static char s_wifi_ssid[33];
+static bool s_wifi_valid = false;
+static char *s_ca_cert = NULL;                  // CLOUD_PROV_MAX_CERT_SIZE bytes, PSRAM when available
+static size_t s_ca_cert_len = 0;
+static uint8_t s_ca_cert_readers = 0;           // Borrowers sending s_ca_cert (lock not held)
+
+/**
+ * @brief Reload the stale items (called with s_lock held)
+ */
+static void config_cache_reload(void)
+{
+    uint32_t stale = atomic_exchange(&s_stale, 0);
+    
+    if (stale & CONFIG_CACHE_WIFI) {
+        // The password is only needed by the reader's signature; wipe it at once
+        char password[64];
+        s_wifi_valid = (wifi_manager_get_stored_credentials(s_wifi_ssid, password) == ESP_OK);
+        memset(password, 0, sizeof(password));
+        if (!s_wifi_valid) {
+            s_wifi_ssid[0] = '\0';
+        }
+        ESP_LOGD(TAG, "Wi-Fi SSID %s", s_wifi_valid ? "cached" : "not stored");
+    }
+    
+    if ((stale & CONFIG_CACHE_CERTS) && s_ca_cert_readers > 0) {
+        // Still being sent; reload once the last borrower is done
+        atomic_fetch_or(&s_stale, CONFIG_CACHE_CERTS);
+    } else if (stale & CONFIG_CACHE_CERTS) {
+        s_ca_cert_len = 0;
+        if (cloud_prov_has_certificates() &&
+            cloud_prov_get_ca_cert(s_ca_cert, &s_ca_cert_len) != ESP_OK) {
+            s_ca_cert_len = 0;
+        }
+        ESP_LOGD(TAG, "CA certificate %s (%zu bytes)", s_ca_cert_len ? "cached" : "not stored", s_ca_cert_len);
+    }
+}
+
+esp_err_t config_cache_init(void)
+{
+    if (s_lock != NULL) {
+        return ESP_OK;
+    }
+    
+    s_ca_cert = mem_policy_alloc_large(CLOUD_PROV_MAX_CERT_SIZE);
+    s_lock = xSemaphoreCreateMutex();
+    if (s_ca_cert == NULL || s_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate config cache");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    cloud_prov_get_device_id(s_device_id, sizeof(s_device_id));
+    
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    config_cache_reload();
+    xSemaphoreGive(s_lock);
+    
+    ESP_LOGI(TAG, "Config cache loaded: device %s, Wi-Fi %s, CA cert %zu bytes",
+             s_device_id, s_wifi_valid ? "stored" : "none", s_ca_cert_len);
+    return ESP_OK;
+}
+
+void config_cache_invalidate(uint32_t items)
+{
+    atomic_fetch_or(&s_stale, items & CONFIG_CACHE_ALL);
+}
+
+const char *config_cache_get_device_id(void)
+{
+    return s_device_id;
+}
+
+/**
+ * @brief Take the lock and bring stale items up to date
+ */
+static bool config_cache_lock(void)
+{
+    if (s_lock == NULL) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (atomic_load(&s_stale) != 0) {
+        config_cache_reload();
+    }
+    return true;
+}
+
+esp_err_t config_cache_get_wifi_ssid(char *ssid, size_t size)
+{
+    if (ssid == NULL || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!config_cache_lock()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    if (s_wifi_valid) {
+        snprintf(ssid, size, "%s", s_wifi_ssid);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+const char *config_cache_acquire_ca_cert(size_t *len)
+{
+    if (len == NULL || !config_cache_lock()) {
+        return NULL;
+    }
+    const char *cert = NULL;
+    if (s_ca_cert_len > 0) {
+        s_ca_cert_readers++;
+        *len = s_ca_cert_len;
+        cert = s_ca_cert;
+    }
+    xSemaphoreGive(s_lock);
+    return cert;
+}
+
+void config_cache_release_ca_cert(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_ca_cert_readers > 0) {
+        s_ca_cert_readers--;
+    }
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file config_cache.h
+ * @brief Read-mostly RAM copy of NVS-backed identity and certificate data
+ *
+ * Loaded once at boot and reloaded lazily after the owning module writes NVS,
+ * so API handlers can read the device ID, stored SSID and the downloadable CA
+ * certificate without flash I/O or allocation. The Wi-Fi password and private
+ * key are never cached.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Cached item groups, used as a bit mask for invalidation
+ */
+typedef enum {
+    CONFIG_CACHE_WIFI  = (1 << 0),      // Stored SSID (wifi_config namespace)
+    CONFIG_CACHE_CERTS = (1 << 1),      // CA certificate for /ca.crt (nvs_certs partition)
+    CONFIG_CACHE_ALL   = CONFIG_CACHE_WIFI | CONFIG_CACHE_CERTS,
+} config_cache_item_t;
+
+/**
+ * @brief Create the cache and load every item
+ *
+ * Call once NVS is initialized (after security_init()).
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the buffers could not be allocated
+ */
+esp_err_t config_cache_init(void);
+
+/**
+ * @brief Mark items stale after their NVS keys were written or erased
+ *
+ * Cheap and safe from any task; the next getter reloads from NVS.
+ *
+ * @param items Mask of config_cache_item_t
+ */
+void config_cache_invalidate(uint32_t items);
+
+/**
+ * @brief Device ID ("esp32-<mac>"), fixed for the lifetime of the firmware
+ *
+ * @return const char* NUL-terminated ID (empty before config_cache_init())
+ */
+const char *config_cache_get_device_id(void);
+
+/**
+ * @brief Copy the stored Wi-Fi SSID
+ *
+ * @param ssid Output buffer
+ * @param size Buffer size (33 bytes holds any SSID)
+ * @return esp_err_t ESP_OK if credentials are stored, ESP_ERR_NVS_NOT_FOUND if not
+ */
+esp_err_t config_cache_get_wifi_ssid(char *ssid, size_t size);
+
+/**
+ * @brief Borrow the cached CA certificate
+ *
+ * The lock is not held while the caller sends the data: a reload of the
+ * certificate waits until config_cache_release_ca_cert(), while the other
+ * items stay readable in the meantime.
+ *
+ * @param len Output: PEM length without the NUL terminator
+ * @return const char* PEM text, or NULL if none is stored (nothing to release then)
+ */
+const char *config_cache_acquire_ca_cert(size_t *len);
+
+/**
+ * @brief Release the certificate returned by config_cache_acquire_ca_cert()
+ */
+void config_cache_release_ca_cert(void);
+
+#ifdef __cplusplus
+}
+#endif
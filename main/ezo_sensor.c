@@ -7,12 +7,218 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ezo_sensor.h"
-#include "esp_log.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_SENSOR
+#include "app_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char *TAG = "EZO_SENSOR";
 
+/**
+ * @brief Per-type timing used by adaptive waits
+ */
+typedef struct {
+    const char *type;
+    uint32_t read_ms;           // Typical "R" conversion time
+    uint32_t read_timeout_ms;   // Give up on "R" after this long
+    uint32_t cal_ms;            // Typical calibration time
+} ezo_type_timing_t;
+
+static const ezo_type_timing_t s_type_timing[] = {
+    { EZO_TYPE_RTD, EZO_READ_TIME_RTD_MS, 1500, 600 },
+    { EZO_TYPE_PH,  EZO_READ_TIME_PH_MS,  2000, 900 },
+    { EZO_TYPE_EC,  EZO_READ_TIME_EC_MS,  1500, 600 },
+    { EZO_TYPE_DO,  EZO_READ_TIME_DO_MS,  1500, 600 },
+    { EZO_TYPE_ORP, EZO_READ_TIME_ORP_MS, 2000, 900 },
+    { EZO_TYPE_HUM, EZO_READ_TIME_HUM_MS, 1000, 300 },
+};
+
+/**
+ * @brief Command classes with their own adaptive timing
+ */
+typedef enum {
+    EZO_CMD_CLASS_QUERY,        // "?"-style queries and "i"
+    EZO_CMD_CLASS_CONFIG,       // Setters (Name, L, Plock, O, K, ...)
+    EZO_CMD_CLASS_READ,         // "R" - uses per-type read timing
+    EZO_CMD_CLASS_CAL,          // "Cal,..." - uses per-type calibration timing
+} ezo_cmd_class_t;
+
+typedef struct {
+    uint32_t min_ms;            // Wait at least this long before the first poll
+    uint32_t timeout_ms;        // Stop polling after this long
+} ezo_cmd_timing_t;
+
+static const ezo_cmd_timing_t s_cmd_timing[] = {
+    [EZO_CMD_CLASS_QUERY]  = { 50, 600 },
+    [EZO_CMD_CLASS_CONFIG] = { 50, 600 },
+    [EZO_CMD_CLASS_READ]   = { 0, 0 },        // Filled in from s_type_timing
+    [EZO_CMD_CLASS_CAL]    = { 0, 0 },        // Filled in from s_type_timing
+};
+
+static const ezo_type_timing_t *ezo_sensor_type_timing(const ezo_sensor_t *sensor) {
+    for (size_t i = 0; i < sizeof(s_type_timing) / sizeof(s_type_timing[0]); i++) {
+        if (strcmp(sensor->config.type, s_type_timing[i].type) == 0) {
+            return &s_type_timing[i];
+        }
+    }
+    return NULL;
+}
+
+static ezo_cmd_class_t ezo_sensor_classify_command(const char *command) {
+    size_t len = strlen(command);
+
+    if (strcmp(command, "R") == 0) {
+        return EZO_CMD_CLASS_READ;
+    }
+    if (strcmp(command, "i") == 0 || (len >= 2 && strcmp(command + len - 2, ",?") == 0)) {
+        return EZO_CMD_CLASS_QUERY;
+    }
+    if (strncmp(command, "Cal", 3) == 0) {
+        return EZO_CMD_CLASS_CAL;
+    }
+    return EZO_CMD_CLASS_CONFIG;
+}
+
+/**
+ * @brief Resolve adaptive timing for a command on this sensor
+ */
+static ezo_cmd_timing_t ezo_sensor_command_timing(const ezo_sensor_t *sensor, const char *command) {
+    ezo_cmd_class_t cmd_class = ezo_sensor_classify_command(command);
+    const ezo_type_timing_t *type_timing = ezo_sensor_type_timing(sensor);
+    ezo_cmd_timing_t timing = s_cmd_timing[cmd_class];
+
+    if (cmd_class == EZO_CMD_CLASS_READ) {
+        timing.min_ms = type_timing ? type_timing->read_ms : EZO_SHORT_WAIT_MS;
+        timing.timeout_ms = type_timing ? type_timing->read_timeout_ms : EZO_LONG_WAIT_MS;
+    } else if (cmd_class == EZO_CMD_CLASS_CAL) {
+        timing.min_ms = type_timing ? type_timing->cal_ms : EZO_SHORT_WAIT_MS;
+        timing.timeout_ms = timing.min_ms * 3;
+    }
+
+    return timing;
+}
+
+/**
+ * @brief Timed I2C write to the sensor (feeds the per-sensor metrics)
+ */
+static esp_err_t ezo_sensor_i2c_transmit(ezo_sensor_t *sensor, const uint8_t *data, size_t len) {
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit(sensor->dev_handle, data, len, EZO_RESPONSE_TIMEOUT_MS);
+    metrics_hist_record(&sensor->i2c_time, (uint32_t)(esp_timer_get_time() - start_us));
+    if (ret != ESP_OK) {
+        atomic_fetch_add_explicit(&sensor->i2c_errors, 1, memory_order_relaxed);
+    }
+    return ret;
+}
+
+/**
+ * @brief Timed I2C read from the sensor (feeds the per-sensor metrics)
+ */
+static esp_err_t ezo_sensor_i2c_receive(ezo_sensor_t *sensor, uint8_t *data, size_t len) {
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_master_receive(sensor->dev_handle, data, len, EZO_RESPONSE_TIMEOUT_MS);
+    metrics_hist_record(&sensor->i2c_time, (uint32_t)(esp_timer_get_time() - start_us));
+    if (ret != ESP_OK) {
+        atomic_fetch_add_explicit(&sensor->i2c_errors, 1, memory_order_relaxed);
+    }
+    return ret;
+}
+
+/**
+ * @brief Read a response frame and strip the status byte
+ */
+static esp_err_t ezo_sensor_receive_response(ezo_sensor_t *sensor, char *response, size_t response_size) {
+    uint8_t buffer[EZO_LARGEST_STRING] = {0};
+    
+    esp_err_t ret = ezo_sensor_i2c_receive(sensor, buffer, EZO_LARGEST_STRING);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read response: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Check response code
+    uint8_t status = buffer[0];
+    
+    if (status == EZO_RESP_SUCCESS) {
+        // Copy response, skipping the status byte
+        size_t copy_len = (response_size - 1 < EZO_LARGEST_STRING - 1) ? 
+                         response_size - 1 : EZO_LARGEST_STRING - 1;
+        
+        // Copy and remove null terminators
+        size_t j = 0;
+        for (size_t i = 1; i < EZO_LARGEST_STRING && j < copy_len && buffer[i] != 0; i++) {
+            response[j++] = (char)buffer[i];
+        }
+        response[j] = '\0';
+        
+        ESP_LOGD(TAG, "Response: %s", response);
+        return ESP_OK;
+        
+    } else if (status == EZO_RESP_SYNTAX_ERROR) {
+        ESP_LOGE(TAG, "Syntax error in command");
+        return ESP_ERR_INVALID_ARG;
+        
+    } else if (status == EZO_RESP_NOT_READY) {
+        ESP_LOGD(TAG, "Sensor not ready, still processing");
+        return ESP_ERR_NOT_FINISHED;
+        
+    } else if (status == EZO_RESP_NO_DATA) {
+        ESP_LOGW(TAG, "No data available");
+        return ESP_ERR_NOT_FOUND;
+        
+    } else {
+        ESP_LOGE(TAG, "Unknown response code: 0x%02X", status);
+        return ESP_FAIL;
+    }
+}
+
+/**
+ * @brief Poll the status byte on a backoff until the sensor is no longer busy
+ * 
+ * The first poll happens after min_ms. While the sensor answers 0xFE the poll
+ * interval doubles from EZO_POLL_MIN_MS up to EZO_POLL_MAX_MS, until timeout_ms
+ * (measured from the call) has elapsed.
+ */
+static esp_err_t ezo_sensor_poll_response(ezo_sensor_t *sensor, char *response, size_t response_size,
+                                          uint32_t min_ms, uint32_t timeout_ms) {
+    char scratch[EZO_LARGEST_STRING];
+    if (response == NULL || response_size == 0) {
+        // Caller does not want the payload, but still needs the status
+        response = scratch;
+        response_size = sizeof(scratch);
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    uint32_t interval_ms = EZO_POLL_MIN_MS;
+
+    if (min_ms > 0) {
+        vTaskDelay(pdMS_TO_TICKS(min_ms));
+    }
+
+    while (1) {
+        esp_err_t ret = ezo_sensor_receive_response(sensor, response, response_size);
+        if (ret != ESP_ERR_NOT_FINISHED) {
+            return ret;
+        }
+
+        uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        if (elapsed_ms >= timeout_ms) {
+            ESP_LOGW(TAG, "Sensor 0x%02X still busy after %lu ms",
+                     sensor->config.i2c_address, (unsigned long)elapsed_ms);
+            return ESP_ERR_NOT_FINISHED;
+        }
+
+        uint32_t remaining_ms = timeout_ms - elapsed_ms;
+        vTaskDelay(pdMS_TO_TICKS(interval_ms < remaining_ms ? interval_ms : remaining_ms));
+
+        interval_ms *= 2;
+        if (interval_ms > EZO_POLL_MAX_MS) {
+            interval_ms = EZO_POLL_MAX_MS;
+        }
+    }
+}
+
 /**
  * @brief Send command and read response from EZO sensor
  */
@@ -22,11 +228,10 @@ esp_err_t ezo_sensor_send_command(ezo_sensor_t *sensor, const char *command,
         return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "Sending command to 0x%02X: %s", sensor->config.i2c_address, command);
+    ESP_LOGD(TAG, "Sending command to 0x%02X: %s", sensor->config.i2c_address, command);
 
     // Send command
-    esp_err_t ret = i2c_master_transmit(sensor->dev_handle, (const uint8_t *)command, 
-                                        strlen(command), EZO_RESPONSE_TIMEOUT_MS);
+    esp_err_t ret = ezo_sensor_i2c_transmit(sensor, (const uint8_t *)command, strlen(command));
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send command: %s", esp_err_to_name(ret));
         return ret;
@@ -38,73 +243,118 @@ esp_err_t ezo_sensor_send_command(ezo_sensor_t *sensor, const char *command,
         return ESP_OK;
     }
 
+    // Poll until the sensor has finished processing the command
+    if (delay_ms == EZO_WAIT_ADAPTIVE) {
+        ezo_cmd_timing_t timing = ezo_sensor_command_timing(sensor, command);
+        return ezo_sensor_poll_response(sensor, response, response_size,
+                                        timing.min_ms, timing.timeout_ms);
+    }
+
     // Wait for sensor to process command
     vTaskDelay(pdMS_TO_TICKS(delay_ms));
 
     // Read response if buffer provided
     if (response != NULL && response_size > 0) {
-        uint8_t buffer[EZO_LARGEST_STRING] = {0};
-        
-        ret = i2c_master_receive(sensor->dev_handle, buffer, EZO_LARGEST_STRING, 
-                                EZO_RESPONSE_TIMEOUT_MS);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read response: %s", esp_err_to_name(ret));
-            return ret;
-        }
+        return ezo_sensor_receive_response(sensor, response, response_size);
+    }
 
-        // Check response code
-        uint8_t status = buffer[0];
-        
-        if (status == EZO_RESP_SUCCESS) {
-            // Copy response, skipping the status byte
-            size_t copy_len = (response_size - 1 < EZO_LARGEST_STRING - 1) ? 
-                             response_size - 1 : EZO_LARGEST_STRING - 1;
-            
-            // Copy and remove null terminators
-            size_t j = 0;
-            for (size_t i = 1; i < EZO_LARGEST_STRING && j < copy_len && buffer[i] != 0; i++) {
-                response[j++] = (char)buffer[i];
-            }
-            response[j] = '\0';
-            
-            ESP_LOGI(TAG, "Response: %s", response);
-            return ESP_OK;
-            
-        } else if (status == EZO_RESP_SYNTAX_ERROR) {
-            ESP_LOGE(TAG, "Syntax error in command");
-            return ESP_ERR_INVALID_ARG;
-            
-        } else if (status == EZO_RESP_NOT_READY) {
-            ESP_LOGW(TAG, "Sensor not ready, still processing");
-            return ESP_ERR_NOT_FINISHED;
-            
-        } else if (status == EZO_RESP_NO_DATA) {
-            ESP_LOGW(TAG, "No data available");
-            return ESP_ERR_NOT_FOUND;
-            
-        } else {
-            ESP_LOGE(TAG, "Unknown response code: 0x%02X", status);
-            return ESP_FAIL;
-        }
+    return ESP_OK;
+}
+
+/**
+ * @brief Send a command without waiting for the response
+ */
+esp_err_t ezo_sensor_start_command(ezo_sensor_t *sensor, const char *command,
+                                   uint32_t *ready_ms, uint32_t *timeout_ms) {
+    if (sensor == NULL || command == NULL || ready_ms == NULL || timeout_ms == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGD(TAG, "Starting command on 0x%02X: %s", sensor->config.i2c_address, command);
+
+    esp_err_t ret = ezo_sensor_i2c_transmit(sensor, (const uint8_t *)command, strlen(command));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send command: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // The device reboots on an address change and never answers
+    if (strncmp(command, "I2C,", 4) == 0) {
+        *ready_ms = 0;
+        *timeout_ms = 0;
+        return ESP_OK;
     }
 
+    ezo_cmd_timing_t timing = ezo_sensor_command_timing(sensor, command);
+    *ready_ms = timing.min_ms;
+    *timeout_ms = timing.timeout_ms;
     return ESP_OK;
 }
 
 /**
- * @brief Initialize EZO sensor
+ * @brief One status check for a command sent with ezo_sensor_start_command()
  */
-esp_err_t ezo_sensor_init(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_handle, uint8_t i2c_address) {
-    if (sensor == NULL || bus_handle == NULL) {
+esp_err_t ezo_sensor_fetch_response(ezo_sensor_t *sensor, char *response, size_t response_size) {
+    if (sensor == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "Initializing EZO sensor at address 0x%02X", i2c_address);
+    char scratch[EZO_LARGEST_STRING];
+    if (response == NULL || response_size == 0) {
+        response = scratch;
+        response_size = sizeof(scratch);
+    }
+    return ezo_sensor_receive_response(sensor, response, response_size);
+}
 
-    // Initialize configuration
-    memset(&sensor->config, 0, sizeof(ezo_sensor_config_t));
+/**
+ * @brief Keep the cached configuration in step with a setter the sensor accepted
+ */
+bool ezo_sensor_command_applied(ezo_sensor_t *sensor, const char *command) {
+    if (sensor == NULL || command == NULL) {
+        return false;
+    }
+
+    if (strncmp(command, "L,", 2) == 0 && command[2] != '?') {
+        sensor->config.led_control = (atoi(command + 2) == 1);
+    } else if (strncmp(command, "Name,", 5) == 0 && command[5] != '?') {
+        strncpy(sensor->config.name, command + 5, EZO_MAX_SENSOR_NAME - 1);
+        sensor->config.name[EZO_MAX_SENSOR_NAME - 1] = '\0';
+    } else if (strncmp(command, "Plock,", 6) == 0 && command[6] != '?') {
+        sensor->config.protocol_lock = (atoi(command + 6) == 1);
+    } else if (strncmp(command, "S,", 2) == 0 && command[2] != '?' && command[2] != '\0') {
+        sensor->config.rtd.temperature_scale = command[2];
+    } else if (strncmp(command, "pHext,", 6) == 0 && command[6] != '?') {
+        sensor->config.ph.extended_scale = (atoi(command + 6) == 1);
+    } else if (strncmp(command, "K,", 2) == 0 && command[2] != '?') {
+        sensor->config.ec.probe_type = (float)atof(command + 2);
+    } else if (strncmp(command, "TDS,", 4) == 0 && command[4] != '?') {
+        sensor->config.ec.tds_conversion_factor = (float)atof(command + 4);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Send a setter and record its effect on the configuration
+ */
+static esp_err_t ezo_sensor_send_setter(ezo_sensor_t *sensor, const char *command) {
+    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
+    if (ret == ESP_OK) {
+        ezo_sensor_command_applied(sensor, command);
+    }
+    return ret;
+}
+
+/**
+ * @brief Attach the I2C device handle for a sensor
+ */
+static esp_err_t ezo_sensor_add_device(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_handle, uint8_t i2c_address) {
     sensor->config.i2c_address = i2c_address;
     sensor->bus_handle = bus_handle;
+    metrics_hist_reset(&sensor->i2c_time);
+    atomic_store(&sensor->i2c_errors, 0);
 
     // Create I2C device handle
     i2c_device_config_t dev_cfg = {
@@ -116,6 +366,44 @@ esp_err_t ezo_sensor_init(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_hand
     esp_err_t ret = i2c_master_bus_add_device(bus_handle, &dev_cfg, &sensor->dev_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add I2C device: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+/**
+ * @brief Initialize EZO sensor from a known configuration
+ */
+esp_err_t ezo_sensor_init_from_config(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_handle,
+                                      const ezo_sensor_config_t *config) {
+    if (sensor == NULL || bus_handle == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(&sensor->config, config, sizeof(ezo_sensor_config_t));
+    esp_err_t ret = ezo_sensor_add_device(sensor, bus_handle, config->i2c_address);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "EZO sensor restored at 0x%02X: Type=%s, FW=%s",
+             config->i2c_address, sensor->config.type, sensor->config.firmware_version);
+    return ESP_OK;
+}
+
+/**
+ * @brief Initialize EZO sensor
+ */
+esp_err_t ezo_sensor_init(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_handle, uint8_t i2c_address) {
+    if (sensor == NULL || bus_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Initializing EZO sensor at address 0x%02X", i2c_address);
+
+    // Initialize configuration
+    memset(&sensor->config, 0, sizeof(ezo_sensor_config_t));
+    esp_err_t ret = ezo_sensor_add_device(sensor, bus_handle, i2c_address);
+    if (ret != ESP_OK) {
         return ret;
     }
 
@@ -171,7 +459,7 @@ esp_err_t ezo_sensor_get_device_info(ezo_sensor_t *sensor) {
     char response[EZO_LARGEST_STRING] = {0};
     
     // Send info command
-    esp_err_t ret = ezo_sensor_send_command(sensor, "i", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "i", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -225,7 +513,7 @@ esp_err_t ezo_sensor_get_device_info(ezo_sensor_t *sensor) {
     } else if (strcmp(sensor->config.type, EZO_TYPE_HUM) == 0) {
         // Query which output parameters are enabled
         char param_response[EZO_LARGEST_STRING] = {0};
-        ret = ezo_sensor_send_command(sensor, "O,?", param_response, sizeof(param_response), EZO_SHORT_WAIT_MS);
+        ret = ezo_sensor_send_command(sensor, "O,?", param_response, sizeof(param_response), EZO_WAIT_ADAPTIVE);
         if (ret == ESP_OK) {
             // Parse response: ?O,HUM,T,Dew or ?O,HUM,Dew etc.
             // Reset counts
@@ -276,21 +564,39 @@ esp_err_t ezo_sensor_read(ezo_sensor_t *sensor, float *value) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    char response[EZO_LARGEST_STRING] = {0};
+    float values[4] = {0};
+    uint8_t count = 0;
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "R", response, sizeof(response), EZO_LONG_WAIT_MS);
+    esp_err_t ret = ezo_sensor_read_all(sensor, values, &count);
     if (ret != ESP_OK) {
         return ret;
     }
+    if (count == 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
 
-    // Parse the numeric response
-    *value = atof(response);
-    
-    ESP_LOGI(TAG, "Sensor 0x%02X read: %.2f", sensor->config.i2c_address, *value);
+    // First field is the primary measurement
+    *value = values[0];
     
     return ESP_OK;
 }
 
+/**
+ * @brief Parse a comma-separated reading into floats (skips non-numeric fields)
+ */
+static void ezo_sensor_parse_values(char *response, float values[4], uint8_t *count) {
+    *count = 0;
+    char *token = strtok(response, ",");
+    while (token != NULL && *count < 4) {
+        // Check if token is numeric (starts with digit, '-', or '.')
+        if (token[0] == '-' || token[0] == '.' || (token[0] >= '0' && token[0] <= '9')) {
+            values[*count] = atof(token);
+            (*count)++;
+        }
+        token = strtok(NULL, ",");
+    }
+}
+
 /**
  * @brief Read all sensor values (for multi-value sensors like HUM)
  */
@@ -299,32 +605,141 @@ esp_err_t ezo_sensor_read_all(ezo_sensor_t *sensor, float values[4], uint8_t *co
         return ESP_ERR_INVALID_ARG;
     }
 
+    esp_err_t ret = ezo_sensor_start_read(sensor);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint32_t read_time_ms = ezo_sensor_get_read_time_ms(sensor);
+    vTaskDelay(pdMS_TO_TICKS(read_time_ms));
+
+    return ezo_sensor_poll_read(sensor, values, count,
+                                ezo_sensor_get_read_timeout_ms(sensor) - read_time_ms);
+}
+
+/**
+ * @brief Start a reading without waiting for the result
+ */
+esp_err_t ezo_sensor_start_read(ezo_sensor_t *sensor) {
+    if (sensor == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGD(TAG, "Starting read on 0x%02X", sensor->config.i2c_address);
+
+    esp_err_t ret = ezo_sensor_i2c_transmit(sensor, (const uint8_t *)"R", 1);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start read on 0x%02X: %s",
+                 sensor->config.i2c_address, esp_err_to_name(ret));
+    }
+
+    return ret;
+}
+
+bool ezo_sensor_supports_compensation(const ezo_sensor_t *sensor) {
+    return sensor != NULL &&
+           (strcmp(sensor->config.type, EZO_TYPE_PH) == 0 ||
+            strcmp(sensor->config.type, EZO_TYPE_EC) == 0 ||
+            strcmp(sensor->config.type, EZO_TYPE_DO) == 0);
+}
+
+esp_err_t ezo_sensor_start_compensated_read(ezo_sensor_t *sensor, float temperature_c) {
+    if (sensor == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ezo_sensor_supports_compensation(sensor)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    char command[16];
+    int len = snprintf(command, sizeof(command), "RT,%.2f", temperature_c);
+    ESP_LOGD(TAG, "Starting compensated read on 0x%02X: %s", sensor->config.i2c_address, command);
+
+    esp_err_t ret = ezo_sensor_i2c_transmit(sensor, (const uint8_t *)command, len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start compensated read on 0x%02X: %s",
+                 sensor->config.i2c_address, esp_err_to_name(ret));
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Fetch the result of a previously started reading
+ */
+esp_err_t ezo_sensor_fetch_read(ezo_sensor_t *sensor, float values[4], uint8_t *count) {
+    if (sensor == NULL || values == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Single status check: the caller decides when to try again
     char response[EZO_LARGEST_STRING] = {0};
-    
-    esp_err_t ret = ezo_sensor_send_command(sensor, "R", response, sizeof(response), EZO_LONG_WAIT_MS);
+    esp_err_t ret = ezo_sensor_receive_response(sensor, response, sizeof(response));
     if (ret != ESP_OK) {
         return ret;
     }
 
-    // Parse comma-separated values (skip non-numeric strings)
-    *count = 0;
-    char *token = strtok(response, ",");
-    while (token != NULL && *count < 4) {
-        // Check if token is numeric (starts with digit, '-', or '.')
-        if (token[0] == '-' || token[0] == '.' || (token[0] >= '0' && token[0] <= '9')) {
-            values[*count] = atof(token);
-            (*count)++;
-        }
-        token = strtok(NULL, ",");
+    ezo_sensor_parse_values(response, values, count);
+    
+    ESP_LOGD(TAG, "Sensor 0x%02X read %d values: %.2f%s", 
+             sensor->config.i2c_address, *count, values[0],
+             *count > 1 ? ",..." : "");
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Fetch a started reading, polling while the sensor is converting
+ */
+esp_err_t ezo_sensor_poll_read(ezo_sensor_t *sensor, float values[4], uint8_t *count, uint32_t timeout_ms) {
+    if (sensor == NULL || values == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char response[EZO_LARGEST_STRING] = {0};
+    
+    esp_err_t ret = ezo_sensor_poll_response(sensor, response, sizeof(response), 0, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
     }
+
+    ezo_sensor_parse_values(response, values, count);
     
-    ESP_LOGI(TAG, "Sensor 0x%02X read %d values: %.2f%s", 
+    ESP_LOGD(TAG, "Sensor 0x%02X read %d values: %.2f%s", 
              sensor->config.i2c_address, *count, values[0],
              *count > 1 ? ",..." : "");
     
     return ESP_OK;
 }
 
+/**
+ * @brief Get conversion time for this sensor type
+ */
+uint32_t ezo_sensor_get_read_time_ms(const ezo_sensor_t *sensor) {
+    if (sensor == NULL) {
+        return EZO_LONG_WAIT_MS;
+    }
+
+    const ezo_type_timing_t *timing = ezo_sensor_type_timing(sensor);
+
+    // Unknown type - start polling early, the timeout covers slow sensors
+    return timing ? timing->read_ms : EZO_SHORT_WAIT_MS;
+}
+
+/**
+ * @brief Get read timeout for this sensor type
+ */
+uint32_t ezo_sensor_get_read_timeout_ms(const ezo_sensor_t *sensor) {
+    if (sensor == NULL) {
+        return EZO_LONG_WAIT_MS;
+    }
+
+    const ezo_type_timing_t *timing = ezo_sensor_type_timing(sensor);
+
+    // Unknown type - keep the old conservative worst case
+    return timing ? timing->read_timeout_ms : EZO_LONG_WAIT_MS;
+}
+
 /**
  * @brief Get sensor name
  */
@@ -335,7 +750,7 @@ esp_err_t ezo_sensor_get_name(ezo_sensor_t *sensor, char *name, size_t name_size
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "Name,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "Name,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -364,12 +779,7 @@ esp_err_t ezo_sensor_set_name(ezo_sensor_t *sensor, const char *name) {
     char command[32];
     snprintf(command, sizeof(command), "Name,%s", name);
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        strncpy(sensor->config.name, name, EZO_MAX_SENSOR_NAME - 1);
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, command);
 }
 
 /**
@@ -382,7 +792,7 @@ esp_err_t ezo_sensor_get_led(ezo_sensor_t *sensor, bool *enabled) {
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "L,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "L,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -407,14 +817,7 @@ esp_err_t ezo_sensor_set_led(ezo_sensor_t *sensor, bool enabled) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    const char *command = enabled ? "L,1" : "L,0";
-    
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        sensor->config.led_control = enabled;
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, enabled ? "L,1" : "L,0");
 }
 
 /**
@@ -427,7 +830,7 @@ esp_err_t ezo_sensor_get_plock(ezo_sensor_t *sensor, bool *locked) {
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "Plock,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "Plock,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -452,14 +855,7 @@ esp_err_t ezo_sensor_set_plock(ezo_sensor_t *sensor, bool locked) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    const char *command = locked ? "Plock,1" : "Plock,0";
-    
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        sensor->config.protocol_lock = locked;
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, locked ? "Plock,1" : "Plock,0");
 }
 
 /**
@@ -500,7 +896,7 @@ esp_err_t ezo_ec_get_probe_type(ezo_sensor_t *sensor, float *probe_type) {
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "K,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "K,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -525,12 +921,7 @@ esp_err_t ezo_ec_set_probe_type(ezo_sensor_t *sensor, float probe_type) {
     char command[16];
     snprintf(command, sizeof(command), "K,%.2f", probe_type);
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        sensor->config.ec.probe_type = probe_type;
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, command);
 }
 
 esp_err_t ezo_ec_get_tds_factor(ezo_sensor_t *sensor, float *factor) {
@@ -540,7 +931,7 @@ esp_err_t ezo_ec_get_tds_factor(ezo_sensor_t *sensor, float *factor) {
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "TDS,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "TDS,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -565,12 +956,7 @@ esp_err_t ezo_ec_set_tds_factor(ezo_sensor_t *sensor, float factor) {
     char command[16];
     snprintf(command, sizeof(command), "TDS,%.2f", factor);
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        sensor->config.ec.tds_conversion_factor = factor;
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, command);
 }
 
 esp_err_t ezo_ec_set_output_parameter(ezo_sensor_t *sensor, const char *param, bool enabled) {
@@ -581,7 +967,7 @@ esp_err_t ezo_ec_set_output_parameter(ezo_sensor_t *sensor, const char *param, b
     char command[16];
     snprintf(command, sizeof(command), "O,%s,%d", param, enabled ? 1 : 0);
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 // RTD-specific functions
@@ -592,7 +978,7 @@ esp_err_t ezo_rtd_get_scale(ezo_sensor_t *sensor, char *scale) {
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "S,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "S,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -617,12 +1003,7 @@ esp_err_t ezo_rtd_set_scale(ezo_sensor_t *sensor, char scale) {
     char command[8];
     snprintf(command, sizeof(command), "S,%c", scale);
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        sensor->config.rtd.temperature_scale = scale;
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, command);
 }
 
 // pH-specific functions
@@ -633,7 +1014,7 @@ esp_err_t ezo_ph_get_extended_scale(ezo_sensor_t *sensor, bool *enabled) {
 
     char response[EZO_LARGEST_STRING] = {0};
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, "pHext,?", response, sizeof(response), EZO_SHORT_WAIT_MS);
+    esp_err_t ret = ezo_sensor_send_command(sensor, "pHext,?", response, sizeof(response), EZO_WAIT_ADAPTIVE);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -658,35 +1039,84 @@ esp_err_t ezo_ph_set_extended_scale(ezo_sensor_t *sensor, bool enabled) {
     char command[16];
     snprintf(command, sizeof(command), "pHext,%d", enabled ? 1 : 0);
     
-    esp_err_t ret = ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
-    if (ret == ESP_OK) {
-        sensor->config.ph.extended_scale = enabled;
-    }
-    
-    return ret;
+    return ezo_sensor_send_setter(sensor, command);
 }
 
-// Calibration functions
-esp_err_t ezo_ph_calibrate(ezo_sensor_t *sensor, const char *point, float value) {
-    if (sensor == NULL || point == NULL) {
+// Calibration functions. Each type's command is built by a formatter shared
+// with ezo_sensor_format_calibration(), for callers that send it themselves.
+static esp_err_t ezo_ph_cal_command(const char *point, float value, char *command, size_t size) {
+    if (strcmp(point, "clear") == 0) {
+        snprintf(command, size, "Cal,clear");
+    } else if (strcmp(point, "mid") == 0) {
+        snprintf(command, size, "Cal,mid,%.2f", value);
+    } else if (strcmp(point, "low") == 0) {
+        snprintf(command, size, "Cal,low,%.2f", value);
+    } else if (strcmp(point, "high") == 0) {
+        snprintf(command, size, "Cal,high,%.2f", value);
+    } else {
         return ESP_ERR_INVALID_ARG;
     }
+    return ESP_OK;
+}
 
-    char command[32];
-    
+static esp_err_t ezo_rtd_cal_command(float temperature, char *command, size_t size) {
+    if (temperature <= -999.0f) {
+        snprintf(command, size, "Cal,clear");
+    } else {
+        snprintf(command, size, "Cal,%.2f", temperature);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ezo_ec_cal_command(const char *point, uint32_t value, char *command, size_t size) {
     if (strcmp(point, "clear") == 0) {
-        snprintf(command, sizeof(command), "Cal,clear");
-    } else if (strcmp(point, "mid") == 0) {
-        snprintf(command, sizeof(command), "Cal,mid,%.2f", value);
+        snprintf(command, size, "Cal,clear");
+    } else if (strcmp(point, "dry") == 0) {
+        snprintf(command, size, "Cal,dry");
     } else if (strcmp(point, "low") == 0) {
-        snprintf(command, sizeof(command), "Cal,low,%.2f", value);
+        snprintf(command, size, "Cal,low,%lu", (unsigned long)value);
     } else if (strcmp(point, "high") == 0) {
-        snprintf(command, sizeof(command), "Cal,high,%.2f", value);
+        snprintf(command, size, "Cal,high,%lu", (unsigned long)value);
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ezo_do_cal_command(const char *point, char *command, size_t size) {
+    if (strcmp(point, "clear") == 0) {
+        snprintf(command, size, "Cal,clear");
+    } else if (strcmp(point, "atm") == 0) {
+        snprintf(command, size, "Cal");
+    } else if (strcmp(point, "0") == 0) {
+        snprintf(command, size, "Cal,0");
     } else {
         return ESP_ERR_INVALID_ARG;
     }
+    return ESP_OK;
+}
+
+static esp_err_t ezo_orp_cal_command(float value, char *command, size_t size) {
+    if (value <= -999.0f) {
+        snprintf(command, size, "Cal,clear");
+    } else {
+        snprintf(command, size, "Cal,%.0f", value);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ezo_ph_calibrate(ezo_sensor_t *sensor, const char *point, float value) {
+    if (sensor == NULL || point == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char command[32];
+    esp_err_t ret = ezo_ph_cal_command(point, value, command, sizeof(command));
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_rtd_calibrate(ezo_sensor_t *sensor, float temperature) {
@@ -695,14 +1125,9 @@ esp_err_t ezo_rtd_calibrate(ezo_sensor_t *sensor, float temperature) {
     }
 
     char command[32];
+    ezo_rtd_cal_command(temperature, command, sizeof(command));
     
-    if (temperature <= -999.0f) {
-        snprintf(command, sizeof(command), "Cal,clear");
-    } else {
-        snprintf(command, sizeof(command), "Cal,%.2f", temperature);
-    }
-    
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_ec_calibrate(ezo_sensor_t *sensor, const char *point, uint32_t value) {
@@ -711,20 +1136,12 @@ esp_err_t ezo_ec_calibrate(ezo_sensor_t *sensor, const char *point, uint32_t val
     }
 
     char command[32];
-    
-    if (strcmp(point, "clear") == 0) {
-        snprintf(command, sizeof(command), "Cal,clear");
-    } else if (strcmp(point, "dry") == 0) {
-        snprintf(command, sizeof(command), "Cal,dry");
-    } else if (strcmp(point, "low") == 0) {
-        snprintf(command, sizeof(command), "Cal,low,%lu", (unsigned long)value);
-    } else if (strcmp(point, "high") == 0) {
-        snprintf(command, sizeof(command), "Cal,high,%lu", (unsigned long)value);
-    } else {
-        return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = ezo_ec_cal_command(point, value, command, sizeof(command));
+    if (ret != ESP_OK) {
+        return ret;
     }
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_do_calibrate(ezo_sensor_t *sensor, const char *point) {
@@ -733,18 +1150,12 @@ esp_err_t ezo_do_calibrate(ezo_sensor_t *sensor, const char *point) {
     }
 
     char command[32];
-    
-    if (strcmp(point, "clear") == 0) {
-        snprintf(command, sizeof(command), "Cal,clear");
-    } else if (strcmp(point, "atm") == 0) {
-        snprintf(command, sizeof(command), "Cal");
-    } else if (strcmp(point, "0") == 0) {
-        snprintf(command, sizeof(command), "Cal,0");
-    } else {
-        return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = ezo_do_cal_command(point, command, sizeof(command));
+    if (ret != ESP_OK) {
+        return ret;
     }
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_orp_calibrate(ezo_sensor_t *sensor, float value) {
@@ -753,14 +1164,34 @@ esp_err_t ezo_orp_calibrate(ezo_sensor_t *sensor, float value) {
     }
 
     char command[32];
+    ezo_orp_cal_command(value, command, sizeof(command));
     
-    if (value <= -999.0f) {
-        snprintf(command, sizeof(command), "Cal,clear");
-    } else {
-        snprintf(command, sizeof(command), "Cal,%.0f", value);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
+}
+
+esp_err_t ezo_sensor_format_calibration(const ezo_sensor_t *sensor, const char *point, float value,
+                                        char *command, size_t command_size) {
+    if (sensor == NULL || point == NULL || command == NULL || command_size == 0) {
+        return ESP_ERR_INVALID_ARG;
     }
-    
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+
+    const char *type = sensor->config.type;
+    if (strcmp(type, EZO_TYPE_PH) == 0) {
+        return ezo_ph_cal_command(point, value, command, command_size);
+    }
+    if (strcmp(type, EZO_TYPE_EC) == 0) {
+        return ezo_ec_cal_command(point, (uint32_t)value, command, command_size);
+    }
+    if (strcmp(type, EZO_TYPE_DO) == 0) {
+        return ezo_do_cal_command(point, command, command_size);
+    }
+    if (strcmp(type, EZO_TYPE_ORP) == 0) {
+        return ezo_orp_cal_command(value, command, command_size);
+    }
+    if (strcmp(type, EZO_TYPE_RTD) == 0) {
+        return ezo_rtd_cal_command(value, command, command_size);
+    }
+    return ESP_ERR_NOT_SUPPORTED;
 }
 
 esp_err_t ezo_sensor_get_calibration_status(ezo_sensor_t *sensor, char *status, size_t status_size) {
@@ -768,7 +1199,7 @@ esp_err_t ezo_sensor_get_calibration_status(ezo_sensor_t *sensor, char *status,
         return ESP_ERR_INVALID_ARG;
     }
     
-    return ezo_sensor_send_command(sensor, "Cal,?", status, status_size, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, "Cal,?", status, status_size, EZO_WAIT_ADAPTIVE);
 }
 
 // Output string control functions
@@ -780,7 +1211,7 @@ esp_err_t ezo_rtd_set_output_parameter(ezo_sensor_t *sensor, const char *param,
     char command[32];
     snprintf(command, sizeof(command), "O,%s,%d", param, enabled ? 1 : 0);
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_hum_set_output_parameter(ezo_sensor_t *sensor, const char *param, bool enabled) {
@@ -791,7 +1222,7 @@ esp_err_t ezo_hum_set_output_parameter(ezo_sensor_t *sensor, const char *param,
     char command[32];
     snprintf(command, sizeof(command), "O,%s,%d", param, enabled ? 1 : 0);
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_ph_set_output_parameter(ezo_sensor_t *sensor, const char *param, bool enabled) {
@@ -802,7 +1233,7 @@ esp_err_t ezo_ph_set_output_parameter(ezo_sensor_t *sensor, const char *param, b
     char command[32];
     snprintf(command, sizeof(command), "O,%s,%d", param, enabled ? 1 : 0);
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_do_set_output_parameter(ezo_sensor_t *sensor, const char *param, bool enabled) {
@@ -813,7 +1244,7 @@ esp_err_t ezo_do_set_output_parameter(ezo_sensor_t *sensor, const char *param, b
     char command[32];
     snprintf(command, sizeof(command), "O,%s,%d", param, enabled ? 1 : 0);
     
-    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, command, NULL, 0, EZO_WAIT_ADAPTIVE);
 }
 
 esp_err_t ezo_sensor_get_output_config(ezo_sensor_t *sensor, char *config, size_t config_size) {
@@ -821,5 +1252,5 @@ esp_err_t ezo_sensor_get_output_config(ezo_sensor_t *sensor, char *config, size_
         return ESP_ERR_INVALID_ARG;
     }
     
-    return ezo_sensor_send_command(sensor, "O,?", config, config_size, EZO_SHORT_WAIT_MS);
+    return ezo_sensor_send_command(sensor, "O,?", config, config_size, EZO_WAIT_ADAPTIVE);
 }
@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include "esp_err.h"
 #include "driver/i2c_master.h"
+#include "metrics.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +33,17 @@ extern "C" {
 #define EZO_SHORT_WAIT_MS       300     // Short delay for simple commands
 #define EZO_LONG_WAIT_MS        5000    // Long delay for readings
 #define EZO_RESPONSE_TIMEOUT_MS 1000    // Timeout for I2C operations
+#define EZO_WAIT_ADAPTIVE       UINT32_MAX  // delay_ms value: poll status until ready
+#define EZO_POLL_MIN_MS         20      // First poll interval in adaptive mode
+#define EZO_POLL_MAX_MS         100     // Poll interval cap in adaptive mode
+
+// Typical "R" conversion times per sensor type (in milliseconds)
+#define EZO_READ_TIME_RTD_MS    600
+#define EZO_READ_TIME_PH_MS     900
+#define EZO_READ_TIME_EC_MS     600
+#define EZO_READ_TIME_DO_MS     600
+#define EZO_READ_TIME_ORP_MS    900
+#define EZO_READ_TIME_HUM_MS    300
 
 // Buffer sizes
 #define EZO_LARGEST_STRING      24      // Maximum response size
@@ -88,6 +100,8 @@ typedef struct {
     i2c_master_bus_handle_t bus_handle;         // I2C bus handle
     i2c_master_dev_handle_t dev_handle;         // I2C device handle
     ezo_sensor_config_t config;                 // Sensor configuration
+    metrics_histogram_t i2c_time;               // Duration of each I2C transfer
+    atomic_uint i2c_errors;                     // Failed I2C transfers
 } ezo_sensor_t;
 
 /**
@@ -100,6 +114,20 @@ typedef struct {
  */
 esp_err_t ezo_sensor_init(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_handle, uint8_t i2c_address);
 
+/**
+ * @brief Initialize an EZO sensor from a previously queried configuration
+ * 
+ * Only attaches the I2C device; no commands are sent, so this skips the
+ * info/name/LED/parameter queries that ezo_sensor_init() runs.
+ * 
+ * @param sensor Pointer to EZO sensor handle
+ * @param bus_handle I2C bus handle
+ * @param config Configuration saved from an earlier ezo_sensor_init()
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t ezo_sensor_init_from_config(ezo_sensor_t *sensor, i2c_master_bus_handle_t bus_handle,
+                                      const ezo_sensor_config_t *config);
+
 /**
  * @brief Deinitialize an EZO sensor
  * 
@@ -123,12 +151,56 @@ esp_err_t ezo_sensor_get_device_info(ezo_sensor_t *sensor);
  * @param command Command string to send
  * @param response Buffer to store response (can be NULL)
  * @param response_size Size of response buffer
- * @param delay_ms Delay in milliseconds before reading response
- * @return esp_err_t ESP_OK on success
+ * @param delay_ms Delay in milliseconds before reading response, or EZO_WAIT_ADAPTIVE
+ *                 to poll the status byte until the sensor is ready (the expected
+ *                 and maximum times are looked up per command and sensor type)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FINISHED if the sensor
+ *         was still busy when the timeout expired
  */
 esp_err_t ezo_sensor_send_command(ezo_sensor_t *sensor, const char *command, 
                                    char *response, size_t response_size, uint32_t delay_ms);
 
+/**
+ * @brief Send a command without waiting for the response
+ * 
+ * Non-blocking half of ezo_sensor_send_command(), for callers that must not
+ * hold the bus while the circuit processes (bus jobs). Check for the
+ * response with ezo_sensor_fetch_response() once ready_ms has passed, and
+ * give up when timeout_ms has.
+ * 
+ * @param sensor Pointer to EZO sensor handle
+ * @param command Command string to send
+ * @param ready_ms Typical processing time of this command on this sensor type
+ * @param timeout_ms When to stop waiting for the response; 0 if the sensor
+ *                   will not answer (address change)
+ * @return esp_err_t ESP_OK if the command was sent
+ */
+esp_err_t ezo_sensor_start_command(ezo_sensor_t *sensor, const char *command,
+                                   uint32_t *ready_ms, uint32_t *timeout_ms);
+
+/**
+ * @brief One status check for a command sent with ezo_sensor_start_command()
+ * 
+ * @param sensor Pointer to EZO sensor handle
+ * @param response Buffer to store the response (can be NULL)
+ * @param response_size Size of response buffer
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FINISHED while still
+ *         processing, ESP_ERR_INVALID_ARG if the sensor rejected the command
+ */
+esp_err_t ezo_sensor_fetch_response(ezo_sensor_t *sensor, char *response, size_t response_size);
+
+/**
+ * @brief Update the cached configuration for a setter the sensor accepted
+ * 
+ * The setter helpers below do this themselves; callers that send setters
+ * with ezo_sensor_start_command() call it once the response is ESP_OK.
+ * 
+ * @param sensor Pointer to EZO sensor handle
+ * @param command The accepted command (e.g. "L,1", "Name,tank", "K,1.00")
+ * @return true if the command is a setter that changed the configuration
+ */
+bool ezo_sensor_command_applied(ezo_sensor_t *sensor, const char *command);
+
 /**
  * @brief Read sensor value
  * 
@@ -148,6 +220,75 @@ esp_err_t ezo_sensor_read(ezo_sensor_t *sensor, float *value);
  */
 esp_err_t ezo_sensor_read_all(ezo_sensor_t *sensor, float values[4], uint8_t *count);
 
+/**
+ * @brief Start a reading without waiting for the result
+ * 
+ * Sends "R" and returns immediately. Collect the result with
+ * ezo_sensor_fetch_read() once ezo_sensor_get_read_time_ms() has elapsed.
+ * This lets several sensors convert in parallel on the same bus.
+ * 
+ * @param sensor Pointer to sensor handle
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t ezo_sensor_start_read(ezo_sensor_t *sensor);
+
+/**
+ * @brief Start a temperature-compensated reading without waiting for the result
+ * 
+ * Sends "RT,<temp>", which sets the compensation temperature and takes a
+ * reading in one command (pH, EC and DO circuits). Collect the result with
+ * ezo_sensor_fetch_read() as for ezo_sensor_start_read(). Firmware without
+ * "RT" answers the fetch with a syntax error (ESP_ERR_INVALID_ARG).
+ * 
+ * @param sensor Pointer to sensor handle
+ * @param temperature_c Compensation temperature in °C
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED for other sensor types
+ */
+esp_err_t ezo_sensor_start_compensated_read(ezo_sensor_t *sensor, float temperature_c);
+
+/**
+ * @brief Whether the sensor type takes a compensation temperature (pH, EC, DO)
+ */
+bool ezo_sensor_supports_compensation(const ezo_sensor_t *sensor);
+
+/**
+ * @brief Fetch the result of a reading started with ezo_sensor_start_read()
+ *        or ezo_sensor_start_compensated_read()
+ * 
+ * @param sensor Pointer to sensor handle
+ * @param values Array to store readings (up to 4 values)
+ * @param count Pointer to store number of values read
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FINISHED if still converting
+ */
+esp_err_t ezo_sensor_fetch_read(ezo_sensor_t *sensor, float values[4], uint8_t *count);
+
+/**
+ * @brief Fetch a started reading, polling on a short backoff while it converts
+ * 
+ * @param sensor Pointer to sensor handle
+ * @param values Array to store readings (up to 4 values)
+ * @param count Pointer to store number of values read
+ * @param timeout_ms How long to keep polling while the sensor reports 0xFE
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FINISHED on timeout
+ */
+esp_err_t ezo_sensor_poll_read(ezo_sensor_t *sensor, float values[4], uint8_t *count, uint32_t timeout_ms);
+
+/**
+ * @brief Get the typical time a reading takes to convert for this sensor type
+ * 
+ * @param sensor Pointer to sensor handle
+ * @return uint32_t Conversion time in milliseconds
+ */
+uint32_t ezo_sensor_get_read_time_ms(const ezo_sensor_t *sensor);
+
+/**
+ * @brief Get the longest time a reading may take before it is treated as failed
+ * 
+ * @param sensor Pointer to sensor handle
+ * @return uint32_t Read timeout in milliseconds, measured from ezo_sensor_start_read()
+ */
+uint32_t ezo_sensor_get_read_timeout_ms(const ezo_sensor_t *sensor);
+
 /**
  * @brief Get sensor name
  * 
@@ -353,6 +494,23 @@ esp_err_t ezo_do_calibrate(ezo_sensor_t *sensor, const char *point);
  */
 esp_err_t ezo_orp_calibrate(ezo_sensor_t *sensor, float value);
 
+/**
+ * @brief Build the calibration command for the sensor's type without sending it
+ * 
+ * Takes the same points and values as ezo_ph_calibrate(), ezo_ec_calibrate(),
+ * ezo_do_calibrate(), ezo_orp_calibrate() and ezo_rtd_calibrate().
+ * 
+ * @param sensor Pointer to EZO sensor handle
+ * @param point Calibration point (ignored by ORP and RTD)
+ * @param value Calibration value (ignored by DO)
+ * @param command Buffer for the command
+ * @param command_size Size of command buffer
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for an unknown
+ *         point, ESP_ERR_NOT_SUPPORTED for types without calibration
+ */
+esp_err_t ezo_sensor_format_calibration(const ezo_sensor_t *sensor, const char *point, float value,
+                                        char *command, size_t command_size);
+
 /**
  * @brief Query calibration status
  * 
@@ -8,19 +8,71 @@
 #include "wifi_manager.h"
 #include "time_sync.h"
 #include "api_key_manager.h"
-#include "esp_log.h"
+#include "config_cache.h"
+#include "metrics.h"
+#include "mem_policy.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_HTTP
+#include "app_log.h"
 #include "esp_https_server.h"
+#include "mbedtls/ssl_ticket.h"
 #include "esp_timer.h"
 #include "esp_wifi.h"
 #include "cJSON.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "sdkconfig.h"
 #include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <time.h>
 
 static const char *TAG = "HTTP_SERVER";
 
 static httpd_handle_t s_server = NULL;
 
+#define HTTP_STR_(x) #x
+#define HTTP_STR(x) HTTP_STR_(x)
+
+// TLS session counters (metrics.h). Full and resumed handshakes both end in
+// the HTTPD_SSL_USER_CB_SESS_CREATE callback. Resumption is counted by
+// wrapping mbedTLS's ticket parser at link time (-Wl,--wrap in
+// CMakeLists.txt): it only succeeds when a client presents a valid ticket.
+
+#if CONFIG_ESP_TLS_SERVER_SESSION_TICKETS
+int __real_mbedtls_ssl_ticket_parse(void *p_ticket, mbedtls_ssl_session *session, unsigned char *buf, size_t len);
+
+int __wrap_mbedtls_ssl_ticket_parse(void *p_ticket, mbedtls_ssl_session *session, unsigned char *buf, size_t len)
+{
+    int ret = __real_mbedtls_ssl_ticket_parse(p_ticket, session, buf, len);
+    if (ret == 0) {
+        metrics_count(METRIC_TLS_RESUMED);
+    }
+    return ret;
+}
+#endif
+
+static void http_server_tls_user_cb(esp_https_server_user_cb_arg_t *user_cb)
+{
+    if (user_cb->user_cb_state == HTTPD_SSL_USER_CB_SESS_CREATE) {
+        metrics_count(METRIC_TLS_HANDSHAKES);
+    }
+}
+
+/**
+ * @brief Content type and keep-alive headers for JSON API responses
+ *
+ * API handlers also return ESP_OK after sending an error reply: returning an
+ * error makes the server drop the socket, and the dashboard's next fetch would
+ * pay for a new TLS session.
+ */
+static void http_set_json_headers(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Connection", "keep-alive");
+    httpd_resp_set_hdr(req, "Keep-Alive", "timeout=" HTTP_STR(HTTP_SERVER_KEEPALIVE_SEC));
+}
+
 // External sensor reading functions from mqtt_telemetry.c
 extern float read_temperature(void);
 extern float read_humidity(void);
@@ -34,10 +86,15 @@ extern float read_battery_level(void);
 #include "ezo_sensor.h"
 #include "max17048.h"
 #include "mqtt_telemetry.h"  // For MAX_SENSOR_VALUES
+#include "telemetry_format.h"
+#include "sensor_history.h"
 
-// Declare embedded web files (generated by CMake)
-extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t index_html_end[]   asm("_binary_index_html_end");
+// Packed dashboard (minified + gzipped by web/pack_assets.py, embedded by CMake)
+#include "web_assets.h"
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[]   asm("_binary_index_html_gz_end");
+extern const uint8_t index_min_html_start[] asm("_binary_index_min_html_start");
+extern const uint8_t index_min_html_end[]   asm("_binary_index_min_html_end");
 
 /**
  * @brief Favicon handler - return 204 No Content to avoid 404 errors
@@ -51,17 +108,37 @@ static esp_err_t favicon_handler(httpd_req_t *req)
 
 /**
  * @brief Root handler - serve dashboard
+ *
+ * The page only changes with the firmware, so its content hash is the ETag.
+ * "no-cache" makes the browser revalidate on each load, which costs one
+ * empty 304 instead of the whole page.
  */
 static esp_err_t root_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "text/html");
     httpd_resp_set_hdr(req, "Connection", "keep-alive");
+    httpd_resp_set_hdr(req, "ETag", WEB_INDEX_ETAG);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    
+    char if_none_match[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, WEB_INDEX_ETAG) != NULL) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
     
-    // Calculate size of embedded HTML file
-    const size_t html_size = index_html_end - index_html_start;
+    // Browsers get the gzipped copy; clients without gzip (curl, some proxies) the plain one
+    httpd_resp_set_type(req, "text/html");
+    char accept_encoding[64];
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept_encoding, sizeof(accept_encoding)) != ESP_OK ||
+        strstr(accept_encoding, "gzip") == NULL) {
+        httpd_resp_send(req, (const char *)index_min_html_start, index_min_html_end - index_min_html_start);
+        return ESP_OK;
+    }
     
-    // Send embedded HTML from flash
-    httpd_resp_send(req, (const char *)index_html_start, html_size);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_send(req, (const char *)index_html_gz_start, index_html_gz_end - index_html_gz_start);
     return ESP_OK;
 }
 
@@ -70,107 +147,322 @@ static esp_err_t root_handler(httpd_req_t *req)
  */
 static esp_err_t api_status_handler(httpd_req_t *req)
 {
-    cJSON *root = cJSON_CreateObject();
+    // Handlers run one at a time on the server task, so a static buffer is safe
+    static char s_status_buf[TELEMETRY_JSON_MAX_LEN + 512];
+    json_writer_t w;
+    json_writer_init(&w, s_status_buf, sizeof(s_status_buf));
+    json_begin_object(&w, NULL);
     
-    // Device ID
-    char device_id[32];
-    cloud_prov_get_device_id(device_id, sizeof(device_id));
-    cJSON_AddStringToObject(root, "device_id", device_id);
+    // Device ID and SSID come from the RAM config cache (no NVS access)
+    json_add_string(&w, "device_id", config_cache_get_device_id());
     
-    // WiFi SSID
     char ssid[33];
-    char password[64];
-    if (wifi_manager_get_stored_credentials(ssid, password) == ESP_OK) {
-        cJSON_AddStringToObject(root, "wifi_ssid", ssid);
-        memset(password, 0, sizeof(password)); // Clear password
+    if (config_cache_get_wifi_ssid(ssid, sizeof(ssid)) == ESP_OK) {
+        json_add_string(&w, "wifi_ssid", ssid);
     } else {
-        cJSON_AddStringToObject(root, "wifi_ssid", "Not configured");
+        json_add_string(&w, "wifi_ssid", "Not configured");
     }
     
     // IP Address
     if (wifi_manager_is_connected()) {
         // TODO: Get actual IP address from WiFi manager
-        cJSON_AddStringToObject(root, "ip_address", "Connected");
+        json_add_string(&w, "ip_address", "Connected");
     } else {
-        cJSON_AddStringToObject(root, "ip_address", "Disconnected");
+        json_add_string(&w, "ip_address", "Disconnected");
     }
     
     // WiFi RSSI
     if (wifi_manager_is_connected()) {
         wifi_ap_record_t ap_info;
         if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
-            cJSON_AddNumberToObject(root, "rssi", ap_info.rssi);
+            json_add_int(&w, "rssi", ap_info.rssi);
         }
     }
     
     // Uptime
-    cJSON_AddNumberToObject(root, "uptime", esp_timer_get_time() / 1000000);
+    json_add_int(&w, "uptime", esp_timer_get_time() / 1000000);
     
     // Current time
     char time_str[64];
     if (time_sync_get_time_string(time_str, sizeof(time_str), NULL) == ESP_OK) {
-        cJSON_AddStringToObject(root, "current_time", time_str);
+        json_add_string(&w, "current_time", time_str);
     } else {
-        cJSON_AddStringToObject(root, "current_time", "Not synced");
+        json_add_string(&w, "current_time", "Not synced");
     }
     
     // Free heap
-    cJSON_AddNumberToObject(root, "free_heap", esp_get_free_heap_size());
+    json_add_int(&w, "free_heap", esp_get_free_heap_size());
+    
+    // CPU usage from FreeRTOS run-time stats (idle task share); omitted when stats are off
+    int cpu_usage = metrics_get_cpu_usage();
+    if (cpu_usage >= 0) {
+        json_add_int(&w, "cpu_usage", cpu_usage);
+    }
     
-    // CPU usage (simplified estimate based on idle task)
-    // TODO: Implement more accurate CPU monitoring
-    cJSON_AddNumberToObject(root, "cpu_usage", 25);
+    // TLS sessions: full handshakes vs ticket resumptions
+    json_begin_object(&w, "tls");
+    json_add_int(&w, "handshakes", metrics_get_counter(METRIC_TLS_HANDSHAKES));
+    json_add_int(&w, "resumed", metrics_get_counter(METRIC_TLS_RESUMED));
+    json_end_object(&w);
     
     // Get cached sensor data from sensor_manager (non-blocking, no I2C operations)
     sensor_cache_t cache;
     if (sensor_manager_get_cached_data(&cache) == ESP_OK) {
-        cJSON *sensors = cJSON_CreateObject();
-        
         // Add battery if available
         if (cache.battery_valid) {
-            cJSON_AddNumberToObject(root, "battery", cache.battery_percentage);
+            json_add_float(&w, "battery", cache.battery_percentage);
+            json_add_float(&w, "battery_rate", cache.battery_rate);     // %/hr, negative while discharging
         }
         
-        // Add all cached sensors
-        for (uint8_t i = 0; i < cache.sensor_count && i < 8; i++) {
-            cached_sensor_t *sensor = &cache.sensors[i];
-            if (!sensor->valid) continue;
-            
-            if (sensor->value_count == 1) {
-                // Single value sensor
-                cJSON_AddNumberToObject(sensors, sensor->sensor_type, sensor->values[0]);
-            } else if (sensor->value_count > 1) {
-                // Multi-value sensor
-                cJSON *sensor_obj = cJSON_CreateObject();
-                
-                if (strcmp(sensor->sensor_type, "HUM") == 0) {
-                    if (sensor->value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "humidity", sensor->values[0]);
-                    if (sensor->value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "air_temp", sensor->values[1]);
-                    if (sensor->value_count >= 3) cJSON_AddNumberToObject(sensor_obj, "dew_point", sensor->values[2]);
-                } else if (strcmp(sensor->sensor_type, "EC") == 0) {
-                    if (sensor->value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "conductivity", sensor->values[0]);
-                    if (sensor->value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "tds", sensor->values[1]);
-                    if (sensor->value_count >= 3) cJSON_AddNumberToObject(sensor_obj, "salinity", sensor->values[2]);
-                } else if (strcmp(sensor->sensor_type, "DO") == 0) {
-                    if (sensor->value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "dissolved_oxygen", sensor->values[0]);
-                    if (sensor->value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "saturation", sensor->values[1]);
-                }
-                
-                cJSON_AddItemToObject(sensors, sensor->sensor_type, sensor_obj);
-            }
-        }
-        
-        cJSON_AddItemToObject(root, "sensors", sensors);
+        telemetry_format_sensors(&w, &cache);
     }
     
+    json_end_object(&w);
+    
     // Send JSON response
-    const char *json_str = cJSON_PrintUnformatted(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_str, HTTPD_RESP_USE_STRLEN);
+    const char *json_str = json_writer_finish(&w);
+    if (json_str == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+    http_set_json_headers(req);
+    httpd_resp_send(req, json_str, w.len);
     
-    free((void *)json_str);
-    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+// Live sensor stream (Server-Sent Events)
+//
+// GET /api/stream answers with SSE headers and a full snapshot, then leaves
+// the socket open in s_stream_fds. Every new sensor snapshot queues
+// http_stream_push_work() onto the server task, which sends only the sensors
+// whose values changed since the previous push. All stream state is touched
+// on the server task only (handler, queued work and close_fn).
+#define HTTP_STREAM_MAX_CLIENTS     (HTTP_SERVER_MAX_SOCKETS - 1)   // Keeps a socket for requests
+#define HTTP_STREAM_KEEPALIVE_US    (30 * 1000000LL)        // Comment line that also detects dead clients
+#define HTTP_STREAM_RETRY_MS        "5000"                  // EventSource reconnect delay
+
+static int s_stream_fds[HTTP_STREAM_MAX_CLIENTS];           // -1 = free, set up in http_server_start()
+static atomic_int s_stream_client_count;
+static atomic_bool s_stream_push_queued;
+static sensor_cache_t s_stream_last;                        // Values last pushed to every client
+static int64_t s_stream_last_send_us = 0;
+static char s_stream_buf[TELEMETRY_JSON_MAX_LEN + 64];
+
+/**
+ * @brief Whether a sensor's displayed values differ from the last push
+ */
+static bool http_stream_sensor_changed(const cached_sensor_t *cur, const cached_sensor_t *last)
+{
+    if (!cur->valid) {
+        return false;  // Keep showing the last good value
+    }
+    if (!last->valid || cur->value_count != last->value_count ||
+        cur->kind != last->kind || cur->address != last->address) {
+        return true;
+    }
+    return memcmp(cur->values, last->values, cur->value_count * sizeof(cur->values[0])) != 0;
+}
+
+/**
+ * @brief Format one SSE event into s_stream_buf
+ *
+ * With last == NULL every valid sensor is written ("snapshot"), otherwise
+ * only the ones that changed ("update").
+ *
+ * @return int Event length, 0 if nothing changed, -1 if the buffer overflowed
+ */
+static int http_stream_format(const sensor_cache_t *cache, const sensor_cache_t *last)
+{
+    static const char data_prefix[] = "data: ";
+    const char *event = (last == NULL) ? "event: snapshot\n" : "event: update\n";
+    size_t head = strlen(event) + sizeof(data_prefix) - 1;
+    bool any = false;
+    
+    json_writer_t w;
+    json_writer_init(&w, s_stream_buf + head, sizeof(s_stream_buf) - head - 2);  // Room for "\n\n"
+    json_begin_object(&w, NULL);
+    json_begin_object(&w, "sensors");
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        const cached_sensor_t *cur = &cache->sensors[i];
+        if (last == NULL ? cur->valid : http_stream_sensor_changed(cur, &last->sensors[i])) {
+            telemetry_format_sensor(&w, i, cur);
+            any = true;
+        }
+    }
+    json_end_object(&w);
+    
+    if (cache->battery_valid && (last == NULL || !last->battery_valid ||
+                                 cache->battery_percentage != last->battery_percentage ||
+                                 cache->battery_rate != last->battery_rate)) {
+        json_add_float(&w, "battery", cache->battery_percentage);
+        json_add_float(&w, "battery_rate", cache->battery_rate);
+        any = true;
+    }
+    if (cache->rssi != 0 && (last == NULL || cache->rssi != last->rssi)) {
+        json_add_int(&w, "rssi", cache->rssi);
+        any = true;
+    }
+    json_end_object(&w);
+    
+    if (json_writer_finish(&w) == NULL) {
+        return -1;
+    }
+    if (!any && last != NULL) {
+        return 0;
+    }
     
+    size_t len = head + w.len;
+    memcpy(s_stream_buf, event, strlen(event));
+    memcpy(s_stream_buf + strlen(event), data_prefix, sizeof(data_prefix) - 1);
+    s_stream_buf[len++] = '\n';
+    s_stream_buf[len++] = '\n';
+    return (int)len;
+}
+
+/**
+ * @brief Forget a stream client (its socket is being closed)
+ */
+static void http_stream_remove(int sockfd)
+{
+    for (int n = 0; n < HTTP_STREAM_MAX_CLIENTS; n++) {
+        if (s_stream_fds[n] == sockfd) {
+            s_stream_fds[n] = -1;
+            atomic_fetch_sub(&s_stream_client_count, 1);
+            ESP_LOGI(TAG, "Stream client on socket %d closed", sockfd);
+        }
+    }
+}
+
+/**
+ * @brief Send an event to every stream client, dropping the ones that fail
+ */
+static void http_stream_broadcast(const char *data, size_t len)
+{
+    for (int n = 0; n < HTTP_STREAM_MAX_CLIENTS; n++) {
+        int fd = s_stream_fds[n];
+        if (fd < 0) {
+            continue;
+        }
+        if (httpd_socket_send(s_server, fd, data, len, 0) < 0) {
+            ESP_LOGW(TAG, "Stream send failed on socket %d, closing", fd);
+            http_stream_remove(fd);
+            httpd_sess_trigger_close(s_server, fd);
+        }
+    }
+    s_stream_last_send_us = esp_timer_get_time();
+}
+
+/**
+ * @brief Push the latest snapshot's changes (runs on the server task)
+ */
+static void http_stream_push_work(void *arg)
+{
+    atomic_store(&s_stream_push_queued, false);
+    if (s_server == NULL || atomic_load(&s_stream_client_count) == 0) {
+        return;
+    }
+    
+    sensor_cache_t cache;
+    if (sensor_manager_get_cached_data(&cache) != ESP_OK) {
+        return;
+    }
+    
+    int len = http_stream_format(&cache, &s_stream_last);
+    if (len < 0) {
+        ESP_LOGW(TAG, "Stream event too large, skipped");
+        return;
+    }
+    if (len > 0) {
+        http_stream_broadcast(s_stream_buf, len);
+        s_stream_last = cache;
+    } else if (esp_timer_get_time() - s_stream_last_send_us >= HTTP_STREAM_KEEPALIVE_US) {
+        static const char keepalive[] = ": keepalive\n\n";
+        http_stream_broadcast(keepalive, sizeof(keepalive) - 1);
+    }
+}
+
+/**
+ * @brief Sensor snapshot callback (reading task): hand the push to the server task
+ */
+static void http_stream_on_sensor_update(void)
+{
+    httpd_handle_t server = s_server;
+    if (server == NULL || atomic_load(&s_stream_client_count) == 0 ||
+        atomic_exchange(&s_stream_push_queued, true)) {
+        return;
+    }
+    if (httpd_queue_work(server, http_stream_push_work, NULL) != ESP_OK) {
+        atomic_store(&s_stream_push_queued, false);
+    }
+}
+
+/**
+ * @brief Session close hook: drop stream clients before their socket goes away
+ *
+ * Socket numbers are reused, so a stale entry would push events into an
+ * unrelated connection.
+ */
+static void http_server_close_fn(httpd_handle_t hd, int sockfd)
+{
+    http_stream_remove(sockfd);
+    close(sockfd);
+}
+
+/**
+ * @brief API stream endpoint - live sensor values as Server-Sent Events
+ *
+ * Sends "snapshot" with every sensor first, then "update" events carrying
+ * only the sensors that changed. Replies 503 when all stream slots are taken
+ * so the dashboard falls back to polling /api/status.
+ */
+static esp_err_t api_stream_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    int slot = -1;
+    for (int n = 0; n < HTTP_STREAM_MAX_CLIENTS; n++) {
+        if (s_stream_fds[n] == fd) {
+            slot = n;  // Same socket asked again; reuse its slot
+            break;
+        }
+        if (s_stream_fds[n] < 0 && slot < 0) {
+            slot = n;
+        }
+    }
+    if (slot < 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "30");
+        http_set_json_headers(req);
+        httpd_resp_sendstr(req, "{\"error\":\"Too many stream clients\"}");
+        return ESP_OK;
+    }
+    
+    // Raw headers: the response never ends, so no Content-Length or chunking
+    static const char headers[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "retry: " HTTP_STREAM_RETRY_MS "\n\n";
+    if (httpd_send(req, headers, sizeof(headers) - 1) < 0) {
+        return ESP_FAIL;
+    }
+    
+    sensor_cache_t cache;
+    if (sensor_manager_get_cached_data(&cache) == ESP_OK) {
+        int len = http_stream_format(&cache, NULL);
+        if (len > 0 && httpd_send(req, s_stream_buf, len) < 0) {
+            return ESP_FAIL;
+        }
+    }
+    
+    if (s_stream_fds[slot] != fd) {
+        s_stream_fds[slot] = fd;
+        atomic_fetch_add(&s_stream_client_count, 1);
+    }
+    ESP_LOGI(TAG, "Stream client on socket %d (%d/%d)", fd,
+             atomic_load(&s_stream_client_count), HTTP_STREAM_MAX_CLIENTS);
     return ESP_OK;
 }
 
@@ -185,7 +477,7 @@ static esp_err_t api_clear_wifi_handler(httpd_req_t *req)
     wifi_manager_clear_credentials();
     
     // Send response
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_send(req, "{\"status\":\"success\"}", HTTPD_RESP_USE_STRLEN);
     
     // Restart device after a delay
@@ -203,7 +495,7 @@ static esp_err_t api_reboot_handler(httpd_req_t *req)
     ESP_LOGW(TAG, "Reboot requested via dashboard");
     
     // Send response
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_send(req, "{\"status\":\"rebooting\"}", HTTPD_RESP_USE_STRLEN);
     
     // Restart device after a delay
@@ -224,7 +516,7 @@ static esp_err_t api_test_mqtt_handler(httpd_req_t *req)
     // Note: mqtt_telemetry module doesn't expose connection status yet
     // For now, just return success
     
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_send(req, "{\"status\":\"tested\",\"connected\":true}", HTTPD_RESP_USE_STRLEN);
     
     return ESP_OK;
@@ -235,8 +527,8 @@ static esp_err_t api_test_mqtt_handler(httpd_req_t *req)
  */
 static esp_err_t api_settings_handler(httpd_req_t *req)
 {
-    char content[100];
-    int ret = httpd_req_recv(req, content, sizeof(content));
+    char content[256];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
     if (ret <= 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
         return ESP_FAIL;
@@ -247,7 +539,7 @@ static esp_err_t api_settings_handler(httpd_req_t *req)
     cJSON *root = cJSON_Parse(content);
     if (root == NULL) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
-        return ESP_FAIL;
+        return ESP_OK;
     }
     
     // Get mqtt_interval if present
@@ -259,9 +551,50 @@ static esp_err_t api_settings_handler(httpd_req_t *req)
         // For now, just acknowledge the setting
     }
     
+    // Get telemetry_encoding if present ("json", "cbor" or "both")
+    cJSON *encoding = cJSON_GetObjectItem(root, "telemetry_encoding");
+    if (encoding != NULL && cJSON_IsString(encoding)) {
+        mqtt_encoding_t value;
+        if (mqtt_parse_telemetry_encoding(encoding->valuestring, &value) != ESP_OK) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid telemetry_encoding");
+            return ESP_OK;
+        }
+        ESP_LOGI(TAG, "Settings update: telemetry encoding = %s", encoding->valuestring);
+        mqtt_set_telemetry_encoding(value);
+    }
+    
+    // Get change_publishing / heartbeat_sec if present
+    cJSON *change_pub = cJSON_GetObjectItem(root, "change_publishing");
+    if (change_pub != NULL && cJSON_IsBool(change_pub)) {
+        uint32_t heartbeat_sec;
+        mqtt_get_change_publishing(NULL, &heartbeat_sec);
+        cJSON *heartbeat = cJSON_GetObjectItem(root, "heartbeat_sec");
+        if (heartbeat != NULL && cJSON_IsNumber(heartbeat) && heartbeat->valueint >= 0) {
+            heartbeat_sec = (uint32_t)heartbeat->valueint;
+        }
+        ESP_LOGI(TAG, "Settings update: change publishing = %d, heartbeat = %lu s", cJSON_IsTrue(change_pub), heartbeat_sec);
+        mqtt_set_change_publishing(cJSON_IsTrue(change_pub), heartbeat_sec);
+    }
+    
+    // Get batch_samples / batch_max_age if present
+    cJSON *batch_samples = cJSON_GetObjectItem(root, "batch_samples");
+    if (batch_samples != NULL && cJSON_IsNumber(batch_samples)) {
+        cJSON *batch_age = cJSON_GetObjectItem(root, "batch_max_age");
+        if (batch_samples->valueint < 0 || batch_samples->valueint > MQTT_BATCH_MAX_SAMPLES) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid batch_samples");
+            return ESP_OK;
+        }
+        uint32_t age = (batch_age != NULL && cJSON_IsNumber(batch_age) && batch_age->valueint > 0) ?
+                       (uint32_t)batch_age->valueint : 0;
+        ESP_LOGI(TAG, "Settings update: batching = %d samples / %lu s", batch_samples->valueint, age);
+        mqtt_set_batching((uint8_t)batch_samples->valueint, age);
+    }
+    
     cJSON_Delete(root);
     
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_send(req, "{\"status\":\"saved\"}", HTTPD_RESP_USE_STRLEN);
     
     return ESP_OK;
@@ -273,7 +606,7 @@ static esp_err_t api_settings_handler(httpd_req_t *req)
 static esp_err_t api_sensors_pause_handler(httpd_req_t *req)
 {
     sensor_manager_pause_reading();
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_sendstr(req, "{\"status\":\"paused\"}");
     return ESP_OK;
 }
@@ -284,11 +617,133 @@ static esp_err_t api_sensors_pause_handler(httpd_req_t *req)
 static esp_err_t api_sensors_resume_handler(httpd_req_t *req)
 {
     sensor_manager_resume_reading();
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_sendstr(req, "{\"status\":\"resumed\"}");
     return ESP_OK;
 }
 
+/**
+ * @brief Reply 503 with the error of a failed on-demand read
+ */
+static esp_err_t send_read_error(httpd_req_t *req, esp_err_t err)
+{
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    http_set_json_headers(req);
+    char response[80];
+    snprintf(response, sizeof(response), "{\"status\":\"error\",\"error\":\"%s\"}", esp_err_to_name(err));
+    httpd_resp_sendstr(req, response);
+    return ESP_OK;
+}
+
+/**
+ * @brief POST /api/sensors/read?sensors=pH,EC_2 - Start reading sensors now
+ *
+ * sensors lists telemetry keys or indices; all sensors when omitted. Replies
+ * 202 with a job ID right away; poll GET /api/sensors/read?job=N for the
+ * snapshot (normally ready after a second or two). Concurrent requests from
+ * other clients share one sweep.
+ */
+static esp_err_t api_sensors_read_handler(httpd_req_t *req)
+{
+    char query[128];
+    char list[96];
+    uint32_t mask = SENSOR_READ_ALL;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "sensors", list, sizeof(list)) == ESP_OK) {
+        char *save = NULL;
+        for (char *key = strtok_r(list, ",", &save); key != NULL; key = strtok_r(NULL, ",", &save)) {
+            int index = sensor_manager_find_by_key(key);
+            if (index < 0) {
+                httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+                return ESP_OK;
+            }
+            mask |= 1u << index;
+        }
+    }
+    
+    uint32_t job_id = 0;
+    esp_err_t ret = sensor_manager_start_read(mask, &job_id);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Read now failed: %s", esp_err_to_name(ret));
+        return send_read_error(req, ret);
+    }
+    
+    char response[64];
+    snprintf(response, sizeof(response), "{\"status\":\"queued\",\"job_id\":%lu}", (unsigned long)job_id);
+    httpd_resp_set_status(req, "202 Accepted");
+    http_set_json_headers(req);
+    httpd_resp_sendstr(req, response);
+    return ESP_OK;
+}
+
+/**
+ * @brief GET /api/sensors/read?job=N - Result of a read started with POST
+ *
+ * 202 while the sweep is pending, then the snapshot with status "ok", or
+ * "partial" when some requested sensors kept their old values.
+ */
+static esp_err_t api_sensors_read_job_handler(httpd_req_t *req)
+{
+    char query[32];
+    char id_str[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "job", id_str, sizeof(id_str)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing job");
+        return ESP_OK;
+    }
+    
+    uint32_t job_id = (uint32_t)strtoul(id_str, NULL, 10);
+    esp_err_t ret = ESP_OK;
+    sensor_read_job_state_t state = sensor_manager_get_read_job(job_id, &ret);
+    if (state == SENSOR_READ_JOB_UNKNOWN) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown job");
+        return ESP_OK;
+    }
+    if (state == SENSOR_READ_JOB_PENDING) {
+        char response[64];
+        snprintf(response, sizeof(response), "{\"job_id\":%lu,\"state\":\"pending\"}", (unsigned long)job_id);
+        httpd_resp_set_status(req, "202 Accepted");
+        http_set_json_headers(req);
+        httpd_resp_sendstr(req, response);
+        return ESP_OK;
+    }
+    
+    // The sweep published its snapshot before completing the job
+    sensor_cache_t cache;
+    if (ret == ESP_OK || ret == ESP_ERR_INVALID_RESPONSE) {
+        esp_err_t err = sensor_manager_get_cached_data(&cache);
+        if (err != ESP_OK) {
+            ret = err;
+        }
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_RESPONSE) {
+        return send_read_error(req, ret);
+    }
+    
+    // Handlers run one at a time on the server task, so a static buffer is safe
+    static char s_read_buf[TELEMETRY_JSON_MAX_LEN + 128];
+    json_writer_t w;
+    json_writer_init(&w, s_read_buf, sizeof(s_read_buf));
+    json_begin_object(&w, NULL);
+    json_add_string(&w, "status", ret == ESP_OK ? "ok" : "partial");   // partial: some sensors kept old values
+    json_add_int(&w, "job_id", job_id);
+    json_add_int(&w, "timestamp_ms", cache.timestamp_us / 1000);
+    if (cache.battery_valid) {
+        json_add_float(&w, "battery", cache.battery_percentage);
+    }
+    telemetry_format_sensors(&w, &cache);
+    json_end_object(&w);
+    
+    const char *json_str = json_writer_finish(&w);
+    if (json_str == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+    http_set_json_headers(req);
+    httpd_resp_send(req, json_str, w.len);
+    return ESP_OK;
+}
+
 /**
  * @brief GET /api/sensors - Get list of all sensors with their configurations
  */
@@ -321,14 +776,39 @@ static esp_err_t api_sensors_list_handler(httpd_req_t *req)
             cJSON_AddBoolToObject(ezo, "led", sensor->config.led_control);
             cJSON_AddBoolToObject(ezo, "plock", sensor->config.protocol_lock);
             
+            sensor_schedule_t schedule;
+            if (sensor_manager_get_sensor_schedule(i, &schedule) == ESP_OK) {
+                cJSON_AddNumberToObject(ezo, "period", schedule.period_sec);
+                cJSON_AddNumberToObject(ezo, "phase_ms", schedule.phase_ms);
+                cJSON_AddNumberToObject(ezo, "priority", schedule.priority);
+            }
+            
+            sensor_filter_config_t filter;
+            uint32_t rejected = 0;
+            if (sensor_manager_get_sensor_filter(i, &filter, &rejected) == ESP_OK) {
+                cJSON *filter_json = cJSON_AddObjectToObject(ezo, "filter");
+                cJSON_AddNumberToObject(filter_json, "window", filter.window);
+                cJSON_AddBoolToObject(filter_json, "median", filter.median);
+                cJSON_AddNumberToObject(filter_json, "outlier_k", filter.outlier_k);
+                cJSON_AddNumberToObject(filter_json, "outlier_floor", filter.outlier_floor);
+                cJSON_AddNumberToObject(filter_json, "ewma_alpha", filter.ewma_alpha);
+                cJSON_AddNumberToObject(filter_json, "rejected", rejected);
+            }
+            
             // Add type-specific parameters
-            if (strcmp(sensor->config.type, "RTD") == 0) {
-                cJSON_AddStringToObject(ezo, "scale", (const char[]){sensor->config.rtd.temperature_scale, '\0'});
-            } else if (strcmp(sensor->config.type, "pH") == 0) {
-                cJSON_AddBoolToObject(ezo, "extended_scale", sensor->config.ph.extended_scale);
-            } else if (strcmp(sensor->config.type, "EC") == 0) {
-                cJSON_AddNumberToObject(ezo, "probe_type", sensor->config.ec.probe_type);
-                cJSON_AddNumberToObject(ezo, "tds_factor", sensor->config.ec.tds_conversion_factor);
+            switch (sensor_manager_get_sensor_kind(i)) {
+                case SENSOR_KIND_RTD:
+                    cJSON_AddStringToObject(ezo, "scale", (const char[]){sensor->config.rtd.temperature_scale, '\0'});
+                    break;
+                case SENSOR_KIND_PH:
+                    cJSON_AddBoolToObject(ezo, "extended_scale", sensor->config.ph.extended_scale);
+                    break;
+                case SENSOR_KIND_EC:
+                    cJSON_AddNumberToObject(ezo, "probe_type", sensor->config.ec.probe_type);
+                    cJSON_AddNumberToObject(ezo, "tds_factor", sensor->config.ec.tds_conversion_factor);
+                    break;
+                default:
+                    break;
             }
             
             cJSON_AddItemToArray(sensors, ezo);
@@ -339,7 +819,7 @@ static esp_err_t api_sensors_list_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(root, "count", cJSON_GetArraySize(sensors));
     
     const char *response = cJSON_PrintUnformatted(root);
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_sendstr(req, response);
     
     free((void*)response);
@@ -363,7 +843,7 @@ static esp_err_t api_sensors_rescan_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(root, "ezo_count", sensor_manager_get_ezo_count());
     
     const char *response = cJSON_PrintUnformatted(root);
-    httpd_resp_set_type(req, "application/json");
+    http_set_json_headers(req);
     httpd_resp_sendstr(req, response);
     
     free((void*)response);
@@ -372,9 +852,47 @@ static esp_err_t api_sensors_rescan_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief Tri-state from an optional JSON boolean
+ */
+static int8_t json_get_tristate(const cJSON *root, const char *key)
+{
+    const cJSON *item = cJSON_GetObjectItem(root, key);
+    if (item == NULL || !cJSON_IsBool(item)) {
+        return -1;
+    }
+    return cJSON_IsTrue(item) ? 1 : 0;
+}
+
+/**
+ * @brief Reply 202 with the job ID of a queued sensor command
+ */
+static esp_err_t send_job_accepted(httpd_req_t *req, esp_err_t err, uint32_t job_id)
+{
+    if (err == ESP_ERR_NO_MEM) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Sensor command queue full");
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to queue sensor command");
+        return ESP_OK;
+    }
+    
+    char response[64];
+    snprintf(response, sizeof(response), "{\"status\":\"queued\",\"job_id\":%lu}", (unsigned long)job_id);
+    httpd_resp_set_status(req, "202 Accepted");
+    http_set_json_headers(req);
+    httpd_resp_sendstr(req, response);
+    return ESP_OK;
+}
+
 /**
  * @brief POST /api/sensors/config - Update sensor configuration
- * Body: {"address": 99, "led": 1, "name": "MySensor", "scale": "F", etc}
+ * Body: {"address": 99, "led": 1, "name": "MySensor", "scale": "F", "period": 30, etc}
+ * "period" (seconds, 0 = global interval), "phase_ms" and "priority" set the sampling schedule.
+ * "filter": {"window": 5, "median": true, "outlier_k": 3, "outlier_floor": 10, "ewma_alpha": 0.3}
+ * sets the reading filter; omitted fields are left as they are.
  */
 static esp_err_t api_sensors_config_handler(httpd_req_t *req)
 {
@@ -389,84 +907,435 @@ static esp_err_t api_sensors_config_handler(httpd_req_t *req)
     cJSON *root = cJSON_Parse(content);
     if (root == NULL) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
-        return ESP_FAIL;
+        return ESP_OK;
     }
     
     cJSON *address_json = cJSON_GetObjectItem(root, "address");
     if (address_json == NULL || !cJSON_IsNumber(address_json)) {
         cJSON_Delete(root);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing address");
-        return ESP_FAIL;
+        return ESP_OK;
     }
     
     uint8_t address = (uint8_t)address_json->valueint;
     
     // Find sensor by address
-    ezo_sensor_t *sensor = NULL;
-    uint8_t ezo_count = sensor_manager_get_ezo_count();
-    for (uint8_t i = 0; i < ezo_count; i++) {
-        ezo_sensor_t *s = (ezo_sensor_t*)sensor_manager_get_ezo_sensor(i);
-        if (s != NULL && s->config.i2c_address == address) {
-            sensor = s;
-            break;
-        }
-    }
+    int index = sensor_manager_get_ezo_index(address);
+    ezo_sensor_t *sensor = (index >= 0) ? (ezo_sensor_t*)sensor_manager_get_ezo_sensor(index) : NULL;
     
     if (sensor == NULL) {
         cJSON_Delete(root);
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
-        return ESP_FAIL;
+        return ESP_OK;
     }
     
-    // Update LED
-    cJSON *led = cJSON_GetObjectItem(root, "led");
-    if (led != NULL && cJSON_IsBool(led)) {
-        ezo_sensor_set_led(sensor, cJSON_IsTrue(led));
+    // Update sampling schedule
+    cJSON *period = cJSON_GetObjectItem(root, "period");
+    cJSON *phase = cJSON_GetObjectItem(root, "phase_ms");
+    cJSON *priority = cJSON_GetObjectItem(root, "priority");
+    if ((period != NULL && cJSON_IsNumber(period)) ||
+        (phase != NULL && cJSON_IsNumber(phase)) ||
+        (priority != NULL && cJSON_IsNumber(priority))) {
+        sensor_schedule_t schedule;
+        sensor_manager_get_sensor_schedule(index, &schedule);
+        if (period != NULL && cJSON_IsNumber(period) && period->valueint >= 0) {
+            schedule.period_sec = (uint32_t)period->valueint;
+        }
+        if (phase != NULL && cJSON_IsNumber(phase) && phase->valueint >= 0) {
+            schedule.phase_ms = (uint32_t)phase->valueint;
+        }
+        if (priority != NULL && cJSON_IsNumber(priority) && priority->valueint >= 0) {
+            schedule.priority = (uint8_t)priority->valueint;
+        }
+        sensor_manager_set_sensor_schedule(index, &schedule);
     }
     
-    // Update name
-    cJSON *name = cJSON_GetObjectItem(root, "name");
-    if (name != NULL && cJSON_IsString(name)) {
-        ezo_sensor_set_name(sensor, name->valuestring);
+    // Update reading filter; omitted fields keep their current value
+    cJSON *filter_json = cJSON_GetObjectItem(root, "filter");
+    if (filter_json != NULL && cJSON_IsObject(filter_json)) {
+        sensor_filter_config_t filter;
+        sensor_manager_get_sensor_filter(index, &filter, NULL);
+        cJSON *item = cJSON_GetObjectItem(filter_json, "window");
+        if (item != NULL && cJSON_IsNumber(item)) {
+            filter.window = (item->valueint > 0 && item->valueint <= SENSOR_FILTER_WINDOW_MAX) ? item->valueint : 0;
+        }
+        item = cJSON_GetObjectItem(filter_json, "median");
+        if (item != NULL && cJSON_IsBool(item)) {
+            filter.median = cJSON_IsTrue(item);
+        }
+        item = cJSON_GetObjectItem(filter_json, "outlier_k");
+        if (item != NULL && cJSON_IsNumber(item)) {
+            filter.outlier_k = (float)item->valuedouble;
+        }
+        item = cJSON_GetObjectItem(filter_json, "outlier_floor");
+        if (item != NULL && cJSON_IsNumber(item)) {
+            filter.outlier_floor = (float)item->valuedouble;
+        }
+        item = cJSON_GetObjectItem(filter_json, "ewma_alpha");
+        if (item != NULL && cJSON_IsNumber(item)) {
+            filter.ewma_alpha = (float)item->valuedouble;
+        }
+        if (sensor_manager_set_sensor_filter(index, &filter) != ESP_OK) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid filter");
+            return ESP_OK;
+        }
     }
     
-    // Update protocol lock
-    cJSON *plock = cJSON_GetObjectItem(root, "plock");
-    if (plock != NULL && cJSON_IsBool(plock)) {
-        ezo_sensor_set_plock(sensor, cJSON_IsTrue(plock));
+    // EZO commands are queued on the I2C arbiter; the worker is released right away.
+    // Only plain command strings go along, as the request and its cJSON tree are gone by then.
+    sensor_ezo_commands_t commands = {0};
+    int8_t led = json_get_tristate(root, "led");
+    if (led >= 0) {
+        sensor_ezo_commands_add(&commands, "L,%d", led);
+    }
+    cJSON *name = cJSON_GetObjectItem(root, "name");
+    if (name != NULL && cJSON_IsString(name) && name->valuestring[0] != '\0') {
+        sensor_ezo_commands_add(&commands, "Name,%.16s", name->valuestring);
+    }
+    int8_t plock = json_get_tristate(root, "plock");
+    if (plock >= 0) {
+        sensor_ezo_commands_add(&commands, "Plock,%d", plock);
     }
     
-    // Type-specific updates
-    if (strcmp(sensor->config.type, "RTD") == 0) {
-        cJSON *scale = cJSON_GetObjectItem(root, "scale");
-        if (scale != NULL && cJSON_IsString(scale) && strlen(scale->valuestring) > 0) {
-            ezo_rtd_set_scale(sensor, scale->valuestring[0]);
+    // Type-specific settings
+    switch (sensor_manager_get_sensor_kind((uint8_t)index)) {
+        case SENSOR_KIND_RTD: {
+            cJSON *scale = cJSON_GetObjectItem(root, "scale");
+            if (scale != NULL && cJSON_IsString(scale) && scale->valuestring[0] != '\0') {
+                sensor_ezo_commands_add(&commands, "S,%c", scale->valuestring[0]);
+            }
+            break;
         }
-    } else if (strcmp(sensor->config.type, "pH") == 0) {
-        cJSON *ext_scale = cJSON_GetObjectItem(root, "extended_scale");
-        if (ext_scale != NULL && cJSON_IsBool(ext_scale)) {
-            ezo_ph_set_extended_scale(sensor, cJSON_IsTrue(ext_scale));
+        case SENSOR_KIND_PH: {
+            int8_t extended_scale = json_get_tristate(root, "extended_scale");
+            if (extended_scale >= 0) {
+                sensor_ezo_commands_add(&commands, "pHext,%d", extended_scale);
+            }
+            break;
+        }
+        case SENSOR_KIND_EC: {
+            cJSON *probe = cJSON_GetObjectItem(root, "probe_type");
+            if (probe != NULL && cJSON_IsNumber(probe)) {
+                sensor_ezo_commands_add(&commands, "K,%.2f", probe->valuedouble);
+            }
+            cJSON *tds = cJSON_GetObjectItem(root, "tds_factor");
+            if (tds != NULL && cJSON_IsNumber(tds)) {
+                sensor_ezo_commands_add(&commands, "TDS,%.2f", tds->valuedouble);
+            }
+            break;
         }
-    } else if (strcmp(sensor->config.type, "EC") == 0) {
-        cJSON *probe = cJSON_GetObjectItem(root, "probe_type");
-        if (probe != NULL && cJSON_IsNumber(probe)) {
-            ezo_ec_set_probe_type(sensor, (float)probe->valuedouble);
+        default:
+            break;
+    }
+    cJSON_Delete(root);
+    
+    if (commands.overflow) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many settings");
+        return ESP_OK;
+    }
+    
+    uint32_t job_id = 0;
+    esp_err_t err = sensor_manager_ezo_command((uint8_t)index, I2C_ARBITER_PRIO_CONFIG, &commands, &job_id);
+    return send_job_accepted(req, err, job_id);
+}
+
+/**
+ * @brief POST /api/sensors/calibrate - Queue a calibration command
+ * Body: {"address": 99, "point": "mid", "value": 7.00}
+ * Runs ahead of config changes and periodic reads. Poll /api/sensors/job for the result.
+ */
+static esp_err_t api_sensors_calibrate_handler(httpd_req_t *req)
+{
+    char content[256];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty request");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+    
+    cJSON *root = cJSON_Parse(content);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_OK;
+    }
+    
+    cJSON *address_json = cJSON_GetObjectItem(root, "address");
+    int index = (address_json != NULL && cJSON_IsNumber(address_json)) ?
+                sensor_manager_get_ezo_index((uint8_t)address_json->valueint) : -1;
+    if (index < 0) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+        return ESP_OK;
+    }
+    
+    const char *point = "";
+    cJSON *point_json = cJSON_GetObjectItem(root, "point");
+    if (point_json != NULL && cJSON_IsString(point_json)) {
+        point = point_json->valuestring;
+    }
+    float value = 0.0f;
+    cJSON *value_json = cJSON_GetObjectItem(root, "value");
+    if (value_json != NULL && cJSON_IsNumber(value_json)) {
+        value = (float)value_json->valuedouble;
+    }
+    
+    char command[32];
+    esp_err_t err = ezo_sensor_format_calibration(sensor_manager_get_ezo_sensor(index), point, value,
+                                                  command, sizeof(command));
+    cJSON_Delete(root);
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            err == ESP_ERR_NOT_SUPPORTED ? "Sensor has no calibration" : "Invalid calibration point");
+        return ESP_OK;
+    }
+    
+    sensor_ezo_commands_t commands = {0};
+    sensor_ezo_commands_add(&commands, "%s", command);
+    uint32_t job_id = 0;
+    err = sensor_manager_ezo_command((uint8_t)index, I2C_ARBITER_PRIO_CALIBRATION, &commands, &job_id);
+    return send_job_accepted(req, err, job_id);
+}
+
+/**
+ * @brief GET /api/sensors/job?id=N - State of a queued sensor command
+ */
+static esp_err_t api_sensors_job_handler(httpd_req_t *req)
+{
+    char query[32];
+    char id_str[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "id", id_str, sizeof(id_str)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing id");
+        return ESP_OK;
+    }
+    
+    uint32_t job_id = (uint32_t)strtoul(id_str, NULL, 10);
+    esp_err_t result = ESP_OK;
+    i2c_arbiter_job_state_t state = i2c_arbiter_get_job(job_id, &result);
+    
+    char response[128];
+    if (state == I2C_ARBITER_JOB_DONE) {
+        snprintf(response, sizeof(response), "{\"job_id\":%lu,\"state\":\"done\",\"success\":%s,\"result\":\"%s\"}",
+                 (unsigned long)job_id, result == ESP_OK ? "true" : "false", esp_err_to_name(result));
+    } else {
+        snprintf(response, sizeof(response), "{\"job_id\":%lu,\"state\":\"%s\"}",
+                 (unsigned long)job_id, i2c_arbiter_job_state_name(state));
+    }
+    
+    http_set_json_headers(req);
+    httpd_resp_sendstr(req, response);
+    return ESP_OK;
+}
+
+#define HTTP_HISTORY_BATCH      32      // Points copied out of the store per lock
+
+static char s_history_buf[1024];        // Chunk buffer, httpd task only
+
+/**
+ * @brief Parse a query parameter as a signed decimal number
+ */
+static bool http_query_int(const char *query, const char *key, int64_t *value)
+{
+    char param[24];
+    char *end = NULL;
+    if (httpd_query_key_value(query, key, param, sizeof(param)) != ESP_OK) {
+        return false;
+    }
+    long long parsed = strtoll(param, &end, 10);
+    if (end == param || *end != '\0') {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+/**
+ * @brief GET /api/history?sensor=pH&from=&to=&res=&ch= - Stored readings of one sensor
+ *
+ * sensor is a telemetry key ("pH", "EC_2") or sensor index. from/to are Unix
+ * seconds once the clock is synced and uptime seconds before ("clock" in the
+ * reply says which); the default is the last hour. res is raw, 1m or 15m
+ * (or 0/60/900); by default it follows the span. Points are [time, value]
+ * for raw samples and [time, mean, min, max] for rollups, streamed in chunks.
+ */
+static esp_err_t api_history_handler(httpd_req_t *req)
+{
+    char query[160];
+    char param[24];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "sensor", param, sizeof(param)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing sensor");
+        return ESP_OK;
+    }
+    
+    int index = sensor_manager_find_by_key(param);
+    if (index < 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown sensor");
+        return ESP_OK;
+    }
+    
+    int64_t channel = 0;
+    if (httpd_query_key_value(query, "ch", param, sizeof(param)) == ESP_OK &&
+        (!http_query_int(query, "ch", &channel) || channel < 0 || channel >= MAX_SENSOR_VALUES)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid ch");
+        return ESP_OK;
+    }
+    
+    // The store keeps uptime seconds; shift wall-clock bounds onto that clock
+    int64_t uptime = esp_timer_get_time() / 1000000;
+    bool wall_clock = time_sync_is_synced();
+    int64_t offset = wall_clock ? (int64_t)time(NULL) - uptime : 0;
+    int64_t to = uptime + offset;
+    int64_t from = to - SENSOR_HISTORY_RAW_SEC;
+    bool bad_range = (httpd_query_key_value(query, "from", param, sizeof(param)) == ESP_OK &&
+                      !http_query_int(query, "from", &from)) ||
+                     (httpd_query_key_value(query, "to", param, sizeof(param)) == ESP_OK &&
+                      !http_query_int(query, "to", &to));
+    if (bad_range || from > to) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid from/to");
+        return ESP_OK;
+    }
+    
+    sensor_history_res_t res;
+    int64_t span = to - from;
+    if (httpd_query_key_value(query, "res", param, sizeof(param)) != ESP_OK) {
+        res = (span <= SENSOR_HISTORY_RAW_SEC) ? SENSOR_HISTORY_RAW :
+              (span <= 24 * 3600) ? SENSOR_HISTORY_1MIN : SENSOR_HISTORY_15MIN;
+    } else if (strcmp(param, "raw") == 0 || strcmp(param, "0") == 0) {
+        res = SENSOR_HISTORY_RAW;
+    } else if (strcmp(param, "1m") == 0 || strcmp(param, "60") == 0) {
+        res = SENSOR_HISTORY_1MIN;
+    } else if (strcmp(param, "15m") == 0 || strcmp(param, "900") == 0) {
+        res = SENSOR_HISTORY_15MIN;
+    } else {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "res must be raw, 1m or 15m");
+        return ESP_OK;
+    }
+    
+    int64_t first = from - offset;
+    int64_t last = to - offset;
+    uint32_t cursor = (first < 0) ? 0 : (first > UINT32_MAX) ? UINT32_MAX : (uint32_t)first;
+    uint32_t end = (last < 0) ? 0 : (last > UINT32_MAX) ? UINT32_MAX : (uint32_t)last;
+    uint16_t skip = 0;          // Points at the cursor second already sent
+    
+    http_set_json_headers(req);
+    int len = snprintf(s_history_buf, sizeof(s_history_buf),
+                       "{\"index\":%d,\"type\":\"%s\",\"channel\":%d,\"res\":%d,\"clock\":\"%s\",\"points\":[",
+                       index, sensor_kind_name(sensor_manager_get_sensor_kind((uint8_t)index)), (int)channel,
+                       (int)res, wall_clock ? "unix" : "uptime");
+    
+    sensor_history_point_t points[HTTP_HISTORY_BATCH];
+    bool first_point = true;
+    size_t n;
+    while (last >= 0 &&
+           (n = sensor_history_read((uint8_t)index, (uint8_t)channel, res, cursor, skip, end,
+                                    points, HTTP_HISTORY_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            // Room for the longest row; otherwise flush what we have first
+            if (len > (int)sizeof(s_history_buf) - 96) {
+                if (httpd_resp_send_chunk(req, s_history_buf, len) != ESP_OK) {
+                    return ESP_FAIL;
+                }
+                len = 0;
+            }
+            
+            long long t = (long long)points[i].time + offset;
+            const char *sep = first_point ? "" : ",";
+            if (res == SENSOR_HISTORY_RAW) {
+                len += snprintf(s_history_buf + len, sizeof(s_history_buf) - len, "%s[%lld,%.7g]",
+                                sep, t, points[i].mean);
+            } else {
+                len += snprintf(s_history_buf + len, sizeof(s_history_buf) - len, "%s[%lld,%.7g,%.7g,%.7g]",
+                                sep, t, points[i].mean, points[i].min, points[i].max);
+            }
+            first_point = false;
         }
         
-        cJSON *tds = cJSON_GetObjectItem(root, "tds_factor");
-        if (tds != NULL && cJSON_IsNumber(tds)) {
-            ezo_ec_set_tds_factor(sensor, (float)tds->valuedouble);
+        if (n < HTTP_HISTORY_BATCH) {
+            break;
+        }
+        // Resume at the last second sent, past the samples of it already sent:
+        // several raw samples can share a second
+        uint32_t next = points[n - 1].time;
+        uint16_t same = 0;
+        while (same < n && points[n - 1 - same].time == next) {
+            same++;
         }
+        skip = (next == cursor) ? skip + same : same;
+        cursor = next;
     }
     
-    cJSON_Delete(root);
+    len += snprintf(s_history_buf + len, sizeof(s_history_buf) - len, "]}");
+    if (httpd_resp_send_chunk(req, s_history_buf, len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief API metrics endpoint - counters, latency histograms, heap and CPU (see metrics.h)
+ */
+static esp_err_t api_metrics_handler(httpd_req_t *req)
+{
+    char *buf = mem_policy_pool_alloc(METRICS_JSON_MAX_LEN);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_OK;
+    }
     
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"status\":\"success\"}");
+    int len = metrics_format_json(buf, METRICS_JSON_MAX_LEN);
+    if (len < 0) {
+        mem_policy_pool_free(buf);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Metrics report too large");
+        return ESP_OK;
+    }
     
+    http_set_json_headers(req);
+    httpd_resp_send(req, buf, len);
+    mem_policy_pool_free(buf);
     return ESP_OK;
 }
 
+/**
+ * @brief API trace endpoint - dump the payload trace ring buffer (see app_log.h)
+ *
+ * Plain text, oldest entry first, streamed in chunks. ?clear=1 empties the
+ * buffer after the dump.
+ */
+static esp_err_t api_trace_handler(httpd_req_t *req)
+{
+    if (CONFIG_APP_LOG_TRACE_SIZE == 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Trace buffer disabled");
+        return ESP_OK;
+    }
+    
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_set_hdr(req, "Connection", "keep-alive");
+    httpd_resp_set_hdr(req, "Keep-Alive", "timeout=" HTTP_STR(HTTP_SERVER_KEEPALIVE_SEC));
+    
+    // Bounded by one buffer's worth, so writers appending meanwhile cannot keep the dump going
+    char chunk[512];
+    uint32_t cursor = 0;
+    size_t sent = 0;
+    size_t len;
+    while (sent < CONFIG_APP_LOG_TRACE_SIZE && (len = app_log_trace_read(&cursor, chunk, sizeof(chunk))) > 0) {
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        sent += len;
+    }
+    
+    char query[32];
+    char param[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "clear", param, sizeof(param)) == ESP_OK && strcmp(param, "1") == 0) {
+        app_log_trace_clear();
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 // URI handlers
 static const httpd_uri_t favicon_uri = {
     .uri = "/favicon.ico",
@@ -489,6 +1358,34 @@ static const httpd_uri_t api_status_uri = {
     .user_ctx = NULL
 };
 
+static const httpd_uri_t api_metrics_uri = {
+    .uri = "/api/metrics",
+    .method = HTTP_GET,
+    .handler = api_metrics_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t api_trace_uri = {
+    .uri = "/api/trace",
+    .method = HTTP_GET,
+    .handler = api_trace_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t api_history_uri = {
+    .uri = "/api/history",
+    .method = HTTP_GET,
+    .handler = api_history_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t api_stream_uri = {
+    .uri = "/api/stream",
+    .method = HTTP_GET,
+    .handler = api_stream_handler,
+    .user_ctx = NULL
+};
+
 static const httpd_uri_t api_clear_wifi_uri = {
     .uri = "/api/clear-wifi",
     .method = HTTP_POST,
@@ -531,6 +1428,20 @@ static const httpd_uri_t api_sensors_rescan_uri = {
     .user_ctx = NULL
 };
 
+static const httpd_uri_t api_sensors_read_uri = {
+    .uri = "/api/sensors/read",
+    .method = HTTP_POST,
+    .handler = api_sensors_read_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t api_sensors_read_job_uri = {
+    .uri = "/api/sensors/read",
+    .method = HTTP_GET,
+    .handler = api_sensors_read_job_handler,
+    .user_ctx = NULL
+};
+
 static const httpd_uri_t api_sensors_config_uri = {
     .uri = "/api/sensors/config",
     .method = HTTP_POST,
@@ -538,6 +1449,20 @@ static const httpd_uri_t api_sensors_config_uri = {
     .user_ctx = NULL
 };
 
+static const httpd_uri_t api_sensors_calibrate_uri = {
+    .uri = "/api/sensors/calibrate",
+    .method = HTTP_POST,
+    .handler = api_sensors_calibrate_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t api_sensors_job_uri = {
+    .uri = "/api/sensors/job",
+    .method = HTTP_GET,
+    .handler = api_sensors_job_handler,
+    .user_ctx = NULL
+};
+
 static const httpd_uri_t api_sensors_pause_uri = {
     .uri = "/api/sensors/pause",
     .method = HTTP_POST,
@@ -553,47 +1478,26 @@ static const httpd_uri_t api_sensors_resume_uri = {
 };
 
 /**
- * @brief Handler for CA certificate download
+ * @brief CA certificate download handler
+ *
+ * Served straight from the config cache, so a download does no NVS access
+ * or allocation.
  */
 static esp_err_t ca_cert_handler(httpd_req_t *req)
 {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open_from_partition("https", "https", NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "CA certificate not found");
-        return ESP_FAIL;
-    }
-    
     size_t ca_cert_len = 0;
-    err = nvs_get_str(nvs_handle, "ca_cert", NULL, &ca_cert_len);
-    if (err != ESP_OK || ca_cert_len == 0) {
-        nvs_close(nvs_handle);
-        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "CA certificate not available");
-        return ESP_FAIL;
-    }
-    
-    char *ca_cert = malloc(ca_cert_len);
+    const char *ca_cert = config_cache_acquire_ca_cert(&ca_cert_len);
     if (ca_cert == NULL) {
-        nvs_close(nvs_handle);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
-        return ESP_FAIL;
-    }
-    
-    err = nvs_get_str(nvs_handle, "ca_cert", ca_cert, &ca_cert_len);
-    nvs_close(nvs_handle);
-    
-    if (err != ESP_OK) {
-        free(ca_cert);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read CA certificate");
-        return ESP_FAIL;
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "CA certificate not available");
+        return ESP_OK;
     }
     
     // Set content type and disposition for download
     httpd_resp_set_type(req, "application/x-pem-file");
     httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"kannacloud-ca.crt\"");
     
-    httpd_resp_send(req, ca_cert, ca_cert_len - 1);
-    free(ca_cert);
+    httpd_resp_send(req, ca_cert, ca_cert_len);
+    config_cache_release_ca_cert();
     
     return ESP_OK;
 }
@@ -605,6 +1509,50 @@ static const httpd_uri_t ca_cert_uri = {
     .user_ctx = NULL
 };
 
+static const httpd_uri_t *const s_uri_handlers[] = {
+    &favicon_uri,
+    &root_uri,
+    &ca_cert_uri,           // CA certificate download
+    &api_status_uri,
+    &api_metrics_uri,
+    &api_trace_uri,
+    &api_stream_uri,
+    &api_history_uri,
+    &api_clear_wifi_uri,
+    &api_reboot_uri,
+    &api_test_mqtt_uri,
+    &api_settings_uri,
+    &api_sensors_list_uri,
+    &api_sensors_rescan_uri,
+    &api_sensors_read_uri,
+    &api_sensors_read_job_uri,
+    &api_sensors_config_uri,
+    &api_sensors_calibrate_uri,
+    &api_sensors_job_uri,
+    &api_sensors_pause_uri,
+    &api_sensors_resume_uri,
+};
+
+/**
+ * @brief Run a URI handler and record its latency
+ *
+ * Registered in place of every handler; user_ctx carries the real URI entry.
+ */
+static esp_err_t http_timed_handler(httpd_req_t *req)
+{
+    const httpd_uri_t *uri = (const httpd_uri_t *)req->user_ctx;
+    req->user_ctx = uri->user_ctx;
+    
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = uri->handler(req);
+    metrics_record_since(METRIC_HIST_HTTP_HANDLER, start_us);
+    metrics_count(METRIC_HTTP_REQUESTS);
+    if (ret != ESP_OK) {
+        metrics_count(METRIC_HTTP_ERRORS);
+    }
+    return ret;
+}
+
 esp_err_t http_server_start(void)
 {
     if (s_server != NULL) {
@@ -614,9 +1562,9 @@ esp_err_t http_server_start(void)
     
     ESP_LOGI(TAG, "Starting HTTPS server...");
     
-    // Get certificates from cloud provisioning
-    char *certificate = malloc(CLOUD_PROV_MAX_CERT_SIZE);
-    char *private_key = malloc(CLOUD_PROV_MAX_KEY_SIZE);
+    // Get certificates from cloud provisioning (PSRAM when available)
+    char *certificate = mem_policy_alloc_large(CLOUD_PROV_MAX_CERT_SIZE);
+    char *private_key = mem_policy_alloc_large(CLOUD_PROV_MAX_KEY_SIZE);
     
     if (certificate == NULL || private_key == NULL) {
         ESP_LOGE(TAG, "Failed to allocate memory for certificates");
@@ -653,13 +1601,17 @@ esp_err_t http_server_start(void)
     
     // Configure HTTPS server
     httpd_ssl_config_t config = HTTPD_SSL_CONFIG_DEFAULT();
-    config.httpd.max_uri_handlers = 15;  // Increased for pause/resume endpoints
+    config.httpd.max_uri_handlers = 24;  // Room for the sensor job endpoints and future APIs
     config.httpd.stack_size = 8192;  // Reduced stack to save memory
-    config.httpd.max_open_sockets = 3;  // Allow multiple connections now that PSRAM is enabled
-    config.httpd.lru_purge_enable = true;  // Enable automatic cleanup of old connections
-    config.httpd.close_fn = NULL;  // Use default close function
-    config.httpd.recv_wait_timeout = 30;  // Increased timeout for SSL handshake (was 10)
-    config.httpd.send_wait_timeout = 30;  // Increased timeout for SSL handshake (was 10)
+    config.httpd.max_open_sockets = HTTP_SERVER_MAX_SOCKETS;
+    config.httpd.lru_purge_enable = HTTP_SERVER_LRU_PURGE;
+    config.httpd.close_fn = http_server_close_fn;  // Drops stream clients, then closes the socket
+    config.httpd.recv_wait_timeout = HTTP_SERVER_RECV_TIMEOUT_SEC;
+    config.httpd.send_wait_timeout = HTTP_SERVER_SEND_TIMEOUT_SEC;
+    config.httpd.keep_alive_enable = true;  // TCP keep-alive probes
+    config.httpd.keep_alive_idle = HTTP_SERVER_TCP_KEEPALIVE_IDLE;
+    config.httpd.keep_alive_interval = HTTP_SERVER_TCP_KEEPALIVE_INTVL;
+    config.httpd.keep_alive_count = HTTP_SERVER_TCP_KEEPALIVE_COUNT;
     config.port_insecure = 0;  // Disable insecure port (HTTPS only)
     
     // Set certificates (PEM format from NVS is already null-terminated)
@@ -670,8 +1622,20 @@ esp_err_t http_server_start(void)
     config.prvtkey_len = key_len + 1;
     
     // Skip client certificate verification (allows browsers to connect without trusting cert)
-    config.session_tickets = false;  // Disable session resumption for testing
+#if CONFIG_ESP_TLS_SERVER_SESSION_TICKETS
+    // Ticket keys are generated at start, kept in RAM only and rotated by
+    // mbedTLS every CONFIG_ESP_TLS_SERVER_SESSION_TICKET_TIMEOUT seconds.
+    // Repeat connections then resume instead of redoing the key exchange.
+    config.session_tickets = true;
+#else
+    config.session_tickets = false;
+#endif
     config.use_secure_element = false;  // Not using hardware secure element
+    config.user_cb = http_server_tls_user_cb;
+    
+    for (int n = 0; n < HTTP_STREAM_MAX_CLIENTS; n++) {
+        s_stream_fds[n] = -1;
+    }
     
     // Start server
     err = httpd_ssl_start(&s_server, &config);
@@ -685,24 +1649,22 @@ esp_err_t http_server_start(void)
         return err;
     }
     
-    // Register URI handlers
-    httpd_register_uri_handler(s_server, &favicon_uri);
-    httpd_register_uri_handler(s_server, &root_uri);
-    httpd_register_uri_handler(s_server, &ca_cert_uri);  // CA certificate download
-    httpd_register_uri_handler(s_server, &api_status_uri);
-    httpd_register_uri_handler(s_server, &api_clear_wifi_uri);
-    httpd_register_uri_handler(s_server, &api_reboot_uri);
-    httpd_register_uri_handler(s_server, &api_test_mqtt_uri);
-    httpd_register_uri_handler(s_server, &api_settings_uri);
-    httpd_register_uri_handler(s_server, &api_sensors_list_uri);
-    httpd_register_uri_handler(s_server, &api_sensors_rescan_uri);
-    httpd_register_uri_handler(s_server, &api_sensors_config_uri);
-    httpd_register_uri_handler(s_server, &api_sensors_pause_uri);
-    httpd_register_uri_handler(s_server, &api_sensors_resume_uri);
+    // Register URI handlers, each behind the latency wrapper
+    for (size_t i = 0; i < sizeof(s_uri_handlers) / sizeof(s_uri_handlers[0]); i++) {
+        httpd_uri_t timed = *s_uri_handlers[i];
+        timed.handler = http_timed_handler;
+        timed.user_ctx = (void *)s_uri_handlers[i];
+        httpd_register_uri_handler(s_server, &timed);
+    }
+    
+    if (sensor_manager_add_update_callback(http_stream_on_sensor_update) != ESP_OK) {
+        ESP_LOGW(TAG, "No sensor callback slot; /api/stream will only send snapshots");
+    }
     
     ESP_LOGI(TAG, "✓ HTTPS server started successfully");
     ESP_LOGI(TAG, "Dashboard accessible at: https://kc.local");
-    ESP_LOGI(TAG, "Registered 11 API endpoints (includes pause/resume)");
+    ESP_LOGI(TAG, "Registered %u endpoints (includes live sensor stream)",
+             (unsigned)(sizeof(s_uri_handlers) / sizeof(s_uri_handlers[0])));
     
     return ESP_OK;
 }
@@ -714,9 +1676,17 @@ esp_err_t http_server_stop(void)
     }
     
     ESP_LOGI(TAG, "Stopping HTTPS server");
+    sensor_manager_remove_update_callback(http_stream_on_sensor_update);
     httpd_ssl_stop(s_server);
     s_server = NULL;
     
+    // httpd_ssl_stop() closed every socket through http_server_close_fn()
+    for (int n = 0; n < HTTP_STREAM_MAX_CLIENTS; n++) {
+        s_stream_fds[n] = -1;
+    }
+    atomic_store(&s_stream_client_count, 0);
+    memset(&s_stream_last, 0, sizeof(s_stream_last));
+    
     return ESP_OK;
 }
 
@@ -724,3 +1694,9 @@ bool http_server_is_running(void)
 {
     return (s_server != NULL);
 }
+
+void http_server_get_tls_stats(http_server_tls_stats_t *stats)
+{
+    stats->handshakes = metrics_get_counter(METRIC_TLS_HANDSHAKES);
+    stats->resumed = metrics_get_counter(METRIC_TLS_RESUMED);
+}
@@ -11,11 +11,31 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Connection tunables. Each open socket holds a TLS session (~40 KB with
+// mbedTLS buffers) and must stay below CONFIG_LWIP_MAX_SOCKETS - 3.
+#define HTTP_SERVER_MAX_SOCKETS         3       // Concurrent client connections
+#define HTTP_SERVER_LRU_PURGE           true    // Close the least recently used socket when full
+#define HTTP_SERVER_RECV_TIMEOUT_SEC    30      // Covers a full TLS handshake on a slow link
+#define HTTP_SERVER_SEND_TIMEOUT_SEC    30
+#define HTTP_SERVER_KEEPALIVE_SEC       60      // Advertised idle time for kept-alive API connections
+#define HTTP_SERVER_TCP_KEEPALIVE_IDLE  30      // TCP probes reap half-open sockets (seconds)
+#define HTTP_SERVER_TCP_KEEPALIVE_INTVL 5
+#define HTTP_SERVER_TCP_KEEPALIVE_COUNT 3
+
+/**
+ * @brief TLS session counters since the server started
+ */
+typedef struct {
+    uint32_t handshakes;        // Sessions established (full + resumed)
+    uint32_t resumed;           // Of those, resumed from a session ticket
+} http_server_tls_stats_t;
+
 /**
  * @brief Initialize and start HTTPS server
  * 
@@ -40,6 +60,17 @@ esp_err_t http_server_stop(void);
  */
 bool http_server_is_running(void);
 
+/**
+ * @brief Get handshake vs resumed session counts
+ *
+ * A resumed session skips the certificate exchange and key agreement, so
+ * resumed / handshakes is the share of connections that avoided a full
+ * handshake.
+ *
+ * @param stats Output
+ */
+void http_server_get_tls_stats(http_server_tls_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,316 @@
+/**
+ * @file i2c_arbiter.c
+ * @brief I2C bus owner task with prioritised request queues
+ */
+
+#include "i2c_arbiter.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_SENSOR
+#include "app_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "I2C_ARB";
+
+#define NO_SLOT     (-1)
+
+typedef struct {
+    int8_t slot;                // Async slot index, NO_SLOT for a synchronous request
+    i2c_arbiter_job_t job;      // Synchronous request only
+    void *ctx;
+    esp_err_t *result;
+    SemaphoreHandle_t done;     // Given once result is written
+} i2c_arbiter_request_t;
+
+typedef struct {
+    uint32_t id;                // 0 = never used
+    i2c_arbiter_job_state_t state;
+    i2c_arbiter_prio_t prio;
+    i2c_arbiter_job_t job;
+    esp_err_t result;
+    int64_t retry_at_us;        // DEFERRED: when to queue it again
+    int64_t deadline_us;        // Give up deferring after this
+    uint8_t ctx[I2C_ARBITER_ASYNC_CTX_MAX];
+} i2c_arbiter_slot_t;
+
+static QueueHandle_t s_request_queues[I2C_ARBITER_PRIO_COUNT];
+static SemaphoreHandle_t s_request_count = NULL;    // One count per queued request
+static TaskHandle_t s_bus_task_handle = NULL;
+
+// Async jobs. Slots are written by submitters and the bus task under s_slot_lock.
+static i2c_arbiter_slot_t s_slots[I2C_ARBITER_ASYNC_SLOTS];
+static uint32_t s_next_job_id = 1;
+static portMUX_TYPE s_slot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Queue a request and count it for the bus task
+ */
+static bool i2c_arbiter_post(i2c_arbiter_prio_t prio, const i2c_arbiter_request_t *request, TickType_t wait) {
+    if (xQueueSend(s_request_queues[prio], request, wait) != pdTRUE) {
+        return false;
+    }
+    xSemaphoreGive(s_request_count);
+    return true;
+}
+
+/**
+ * @brief Re-queue deferred jobs that are due
+ *
+ * @return TickType_t Ticks until the next deferred job is due, portMAX_DELAY if none
+ */
+static TickType_t i2c_arbiter_requeue_deferred(void) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = INT64_MAX;
+    int8_t due[I2C_ARBITER_ASYNC_SLOTS];
+    uint8_t due_count = 0;
+    
+    portENTER_CRITICAL(&s_slot_lock);
+    for (int8_t i = 0; i < I2C_ARBITER_ASYNC_SLOTS; i++) {
+        i2c_arbiter_slot_t *slot = &s_slots[i];
+        if (slot->state != I2C_ARBITER_JOB_DEFERRED) {
+            continue;
+        }
+        if (slot->retry_at_us <= now_us) {
+            slot->state = I2C_ARBITER_JOB_QUEUED;
+            due[due_count++] = i;
+        } else if (slot->retry_at_us < next_us) {
+            next_us = slot->retry_at_us;
+        }
+    }
+    portEXIT_CRITICAL(&s_slot_lock);
+    
+    for (uint8_t n = 0; n < due_count; n++) {
+        i2c_arbiter_request_t request = { .slot = due[n] };
+        if (!i2c_arbiter_post(s_slots[due[n]].prio, &request, 0)) {
+            // Queue full: try again on the next pass
+            portENTER_CRITICAL(&s_slot_lock);
+            s_slots[due[n]].state = I2C_ARBITER_JOB_DEFERRED;
+            portEXIT_CRITICAL(&s_slot_lock);
+            next_us = now_us;
+        }
+    }
+    
+    if (next_us == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+    TickType_t ticks = pdMS_TO_TICKS((next_us - now_us + 999) / 1000);
+    return ticks > 0 ? ticks : 1;
+}
+
+/**
+ * @brief Run one async job and record its outcome
+ */
+static void i2c_arbiter_run_slot(int8_t index) {
+    i2c_arbiter_slot_t *slot = &s_slots[index];
+    
+    portENTER_CRITICAL(&s_slot_lock);
+    slot->state = I2C_ARBITER_JOB_RUNNING;
+    portEXIT_CRITICAL(&s_slot_lock);
+    
+    esp_err_t ret = slot->job(slot->ctx);
+    int64_t now_us = esp_timer_get_time();
+    
+    portENTER_CRITICAL(&s_slot_lock);
+    if (ret == I2C_ARBITER_DEFER && now_us < slot->deadline_us) {
+        slot->state = I2C_ARBITER_JOB_DEFERRED;
+        slot->retry_at_us = now_us + (int64_t)I2C_ARBITER_RETRY_MS * 1000;
+    } else {
+        slot->result = (ret == I2C_ARBITER_DEFER) ? ESP_ERR_TIMEOUT : ret;
+        slot->state = I2C_ARBITER_JOB_DONE;
+    }
+    portEXIT_CRITICAL(&s_slot_lock);
+}
+
+/**
+ * @brief Bus owner task - the only task that touches the I2C bus once started
+ */
+static void i2c_arbiter_task(void *arg) {
+    i2c_arbiter_request_t request;
+    
+    while (1) {
+        TickType_t wait = i2c_arbiter_requeue_deferred();
+        if (xSemaphoreTake(s_request_count, wait) != pdTRUE) {
+            continue;   // A deferred job is due
+        }
+        
+        // Highest priority first
+        bool found = false;
+        for (int prio = I2C_ARBITER_PRIO_COUNT - 1; prio >= 0 && !found; prio--) {
+            found = (xQueueReceive(s_request_queues[prio], &request, 0) == pdTRUE);
+        }
+        if (!found) {
+            continue;
+        }
+        
+        if (request.slot != NO_SLOT) {
+            i2c_arbiter_run_slot(request.slot);
+        } else {
+            *request.result = request.job(request.ctx);
+            xSemaphoreGive(request.done);
+        }
+    }
+}
+
+esp_err_t i2c_arbiter_init(void) {
+    if (s_bus_task_handle != NULL) {
+        return ESP_OK;
+    }
+    
+    for (int prio = 0; prio < I2C_ARBITER_PRIO_COUNT; prio++) {
+        s_request_queues[prio] = xQueueCreate(I2C_ARBITER_QUEUE_LEN, sizeof(i2c_arbiter_request_t));
+        if (s_request_queues[prio] == NULL) {
+            ESP_LOGE(TAG, "Failed to create request queue");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_request_count = xSemaphoreCreateCounting(I2C_ARBITER_QUEUE_LEN * I2C_ARBITER_PRIO_COUNT, 0);
+    if (s_request_count == NULL) {
+        ESP_LOGE(TAG, "Failed to create request counter");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Above the sensor task so queued transactions are served promptly
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        i2c_arbiter_task,
+        "i2c_bus",
+        4096,
+        NULL,
+        6,
+        &s_bus_task_handle,
+        1  // Core 1, next to the sensor reading task
+    );
+    
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bus task");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "I2C bus arbiter started");
+    return ESP_OK;
+}
+
+bool i2c_arbiter_in_bus_task(void) {
+    return s_bus_task_handle != NULL && xTaskGetCurrentTaskHandle() == s_bus_task_handle;
+}
+
+esp_err_t i2c_arbiter_run(i2c_arbiter_prio_t prio, i2c_arbiter_job_t job, void *ctx) {
+    if (job == NULL || prio >= I2C_ARBITER_PRIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Not started yet, or nested inside a job: we already own the bus
+    if (s_bus_task_handle == NULL || i2c_arbiter_in_bus_task()) {
+        return job(ctx);
+    }
+    
+    // The request lives on the caller's stack, so wait for completion once queued
+    StaticSemaphore_t done_buffer;
+    esp_err_t result = ESP_FAIL;
+    i2c_arbiter_request_t request = {
+        .slot = NO_SLOT,
+        .job = job,
+        .ctx = ctx,
+        .result = &result,
+        .done = xSemaphoreCreateBinaryStatic(&done_buffer),
+    };
+    
+    if (!i2c_arbiter_post(prio, &request, pdMS_TO_TICKS(I2C_ARBITER_SUBMIT_TIMEOUT_MS))) {
+        ESP_LOGW(TAG, "Bus request queue full");
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    xSemaphoreTake(request.done, portMAX_DELAY);
+    return result;
+}
+
+esp_err_t i2c_arbiter_submit(i2c_arbiter_prio_t prio, i2c_arbiter_job_t job,
+                             const void *ctx, size_t ctx_len, uint32_t *job_id) {
+    if (job == NULL || job_id == NULL || prio >= I2C_ARBITER_PRIO_COUNT ||
+        ctx_len > I2C_ARBITER_ASYNC_CTX_MAX || (ctx == NULL && ctx_len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_bus_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Take a free slot, else recycle the oldest finished one
+    int8_t index = NO_SLOT;
+    portENTER_CRITICAL(&s_slot_lock);
+    for (int8_t i = 0; i < I2C_ARBITER_ASYNC_SLOTS; i++) {
+        i2c_arbiter_slot_t *slot = &s_slots[i];
+        if (slot->id == 0) {
+            index = i;
+            break;
+        }
+        if (slot->state == I2C_ARBITER_JOB_DONE &&
+            (index == NO_SLOT || slot->id < s_slots[index].id)) {
+            index = i;
+        }
+    }
+    if (index != NO_SLOT) {
+        i2c_arbiter_slot_t *slot = &s_slots[index];
+        slot->id = s_next_job_id++;
+        if (s_next_job_id == 0) {
+            s_next_job_id = 1;
+        }
+        slot->state = I2C_ARBITER_JOB_QUEUED;
+        slot->prio = prio;
+        slot->job = job;
+        slot->result = ESP_FAIL;
+        slot->deadline_us = esp_timer_get_time() + (int64_t)I2C_ARBITER_DEFER_TIMEOUT_MS * 1000;
+        if (ctx_len > 0) {
+            memcpy(slot->ctx, ctx, ctx_len);
+        }
+        *job_id = slot->id;
+    }
+    portEXIT_CRITICAL(&s_slot_lock);
+    
+    if (index == NO_SLOT) {
+        ESP_LOGW(TAG, "No free async job slot");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    i2c_arbiter_request_t request = { .slot = index };
+    if (!i2c_arbiter_post(prio, &request, 0)) {
+        portENTER_CRITICAL(&s_slot_lock);
+        s_slots[index].state = I2C_ARBITER_JOB_DONE;
+        s_slots[index].result = ESP_ERR_TIMEOUT;
+        portEXIT_CRITICAL(&s_slot_lock);
+        ESP_LOGW(TAG, "Bus request queue full");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGD(TAG, "Queued async job %lu (priority %d)", (unsigned long)*job_id, prio);
+    return ESP_OK;
+}
+
+i2c_arbiter_job_state_t i2c_arbiter_get_job(uint32_t job_id, esp_err_t *result) {
+    i2c_arbiter_job_state_t state = I2C_ARBITER_JOB_UNKNOWN;
+    
+    portENTER_CRITICAL(&s_slot_lock);
+    for (int i = 0; i < I2C_ARBITER_ASYNC_SLOTS; i++) {
+        if (job_id != 0 && s_slots[i].id == job_id) {
+            state = s_slots[i].state;
+            if (result != NULL) {
+                *result = s_slots[i].result;
+            }
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_slot_lock);
+    
+    return state;
+}
+
+const char *i2c_arbiter_job_state_name(i2c_arbiter_job_state_t state) {
+    switch (state) {
+        case I2C_ARBITER_JOB_QUEUED:    return "queued";
+        case I2C_ARBITER_JOB_RUNNING:   return "running";
+        case I2C_ARBITER_JOB_DEFERRED:  return "deferred";
+        case I2C_ARBITER_JOB_DONE:      return "done";
+        default:                        return "unknown";
+    }
+}
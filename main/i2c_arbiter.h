@@ -0,0 +1,133 @@
+/**
+ * @file i2c_arbiter.h
+ * @brief Single owner for all I2C bus traffic
+ *
+ * One task owns the bus from i2c_scanner_get_bus_handle() and runs I2C jobs
+ * one at a time from per-priority request queues: calibration before
+ * configuration before periodic reads. Jobs should be single transactions
+ * (trigger a reading, fetch a response, send one command) so the bus is
+ * never held across a sensor's conversion time; the caller waits outside.
+ *
+ * Jobs are either synchronous (the caller blocks until the result is in) or
+ * asynchronous (the caller gets a job ID and polls for completion), so HTTP
+ * handlers never hold a server worker while a sensor processes a command.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_ARBITER_QUEUE_LEN           8       // Per priority
+#define I2C_ARBITER_SUBMIT_TIMEOUT_MS   5000    // Give up if the queue stays full this long
+#define I2C_ARBITER_ASYNC_SLOTS         8       // Async jobs tracked at once (including finished ones)
+#define I2C_ARBITER_ASYNC_CTX_MAX       96      // Context bytes copied into an async job
+#define I2C_ARBITER_RETRY_MS            100     // Delay before a deferred job runs again
+#define I2C_ARBITER_DEFER_TIMEOUT_MS    10000   // Deferred jobs fail with ESP_ERR_TIMEOUT after this
+
+/**
+ * @brief Job result asking to be run again later (async jobs only)
+ *
+ * Returned by a job that cannot run yet, e.g. because its sensor is still
+ * converting. The arbiter serves other jobs and retries after I2C_ARBITER_RETRY_MS.
+ * The job keeps its context copy across retries, so a multi-step job can
+ * record its progress there and continue where it left off.
+ */
+#define I2C_ARBITER_DEFER               ESP_ERR_NOT_FINISHED
+
+/**
+ * @brief Request priority, highest wins
+ */
+typedef enum {
+    I2C_ARBITER_PRIO_READ = 0,          // Periodic sensor sweeps and live reads
+    I2C_ARBITER_PRIO_CONFIG,            // Settings changes, init and rescan
+    I2C_ARBITER_PRIO_CALIBRATION,       // Calibration commands
+    I2C_ARBITER_PRIO_COUNT
+} i2c_arbiter_prio_t;
+
+/**
+ * @brief Async job state
+ */
+typedef enum {
+    I2C_ARBITER_JOB_UNKNOWN = 0,        // No such job (never submitted or already recycled)
+    I2C_ARBITER_JOB_QUEUED,
+    I2C_ARBITER_JOB_RUNNING,
+    I2C_ARBITER_JOB_DEFERRED,           // Waiting to be retried
+    I2C_ARBITER_JOB_DONE,
+} i2c_arbiter_job_state_t;
+
+/**
+ * @brief Bus job, runs in the arbiter task
+ *
+ * @param ctx Caller context (for async jobs: the arbiter's copy)
+ * @return esp_err_t Result handed back to the caller
+ */
+typedef esp_err_t (*i2c_arbiter_job_t)(void *ctx);
+
+/**
+ * @brief Start the bus owner task
+ *
+ * Safe to call more than once. Until this has been called, synchronous jobs
+ * run inline in the calling task (boot-time scanning and sensor init).
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t i2c_arbiter_init(void);
+
+/**
+ * @brief Run a job on the bus and wait for its result
+ *
+ * Jobs submitted from inside another job run inline, so helpers can be
+ * composed freely.
+ *
+ * @param prio Request priority
+ * @param job Job function
+ * @param ctx Job context (must stay valid until the call returns)
+ * @return esp_err_t The job's result, or ESP_ERR_TIMEOUT if the queue stayed full
+ */
+esp_err_t i2c_arbiter_run(i2c_arbiter_prio_t prio, i2c_arbiter_job_t job, void *ctx);
+
+/**
+ * @brief Queue a job without waiting for it
+ *
+ * ctx is copied, so the caller's buffer can go away right after the call.
+ *
+ * @param prio Request priority
+ * @param job Job function
+ * @param ctx Job context to copy (may be NULL if ctx_len is 0)
+ * @param ctx_len Context size, at most I2C_ARBITER_ASYNC_CTX_MAX
+ * @param job_id Pointer to store the job ID for i2c_arbiter_get_job()
+ * @return esp_err_t ESP_OK if queued, ESP_ERR_NO_MEM if every slot is busy,
+ *         ESP_ERR_INVALID_STATE if the arbiter is not running
+ */
+esp_err_t i2c_arbiter_submit(i2c_arbiter_prio_t prio, i2c_arbiter_job_t job,
+                             const void *ctx, size_t ctx_len, uint32_t *job_id);
+
+/**
+ * @brief Get the state of an async job
+ *
+ * @param job_id ID from i2c_arbiter_submit()
+ * @param result Pointer to store the job's result once DONE (may be NULL)
+ * @return i2c_arbiter_job_state_t Job state
+ */
+i2c_arbiter_job_state_t i2c_arbiter_get_job(uint32_t job_id, esp_err_t *result);
+
+/**
+ * @brief Name of a job state for APIs ("queued", "running", "deferred", "done", "unknown")
+ */
+const char *i2c_arbiter_job_state_name(i2c_arbiter_job_state_t state);
+
+/**
+ * @brief Check whether the caller is the bus owner task
+ */
+bool i2c_arbiter_in_bus_task(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -43,7 +43,7 @@ bool i2c_scanner_device_exists(uint8_t address)
     }
     
     // Try to probe the device
-    esp_err_t ret = i2c_master_probe(bus_handle, address, I2C_MASTER_TIMEOUT_MS);
+    esp_err_t ret = i2c_master_probe(bus_handle, address, I2C_SCANNER_PROBE_TIMEOUT_MS);
     return (ret == ESP_OK);
 }
 
@@ -62,7 +62,7 @@ esp_err_t i2c_scanner_scan(void)
     
     // Scan all valid I2C addresses (0x08 to 0x77)
     for (uint8_t addr = 0x08; addr <= 0x77; addr++) {
-        esp_err_t ret = i2c_master_probe(bus_handle, addr, I2C_MASTER_TIMEOUT_MS);
+        esp_err_t ret = i2c_master_probe(bus_handle, addr, I2C_SCANNER_PROBE_TIMEOUT_MS);
         
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "✓ Device found at address 0x%02X", addr);
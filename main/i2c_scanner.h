@@ -17,6 +17,7 @@ extern "C" {
 #define I2C_MASTER_SDA_IO           47      /*!< GPIO number for I2C master data  */
 #define I2C_MASTER_FREQ_HZ          100000  /*!< I2C master clock frequency */
 #define I2C_MASTER_TIMEOUT_MS       1000    /*!< I2C timeout */
+#define I2C_SCANNER_PROBE_TIMEOUT_MS 10     /*!< Address probe timeout; an absent device NACKs in ~0.1 ms */
 
 /**
  * @brief Initialize I2C master bus
@@ -28,7 +29,8 @@ esp_err_t i2c_scanner_init(void);
 /**
  * @brief Scan I2C bus for devices
  * 
- * Scans all addresses from 0x08 to 0x77 and reports found devices
+ * Scans all addresses from 0x08 to 0x77 and reports found devices.
+ * Each address is probed with I2C_SCANNER_PROBE_TIMEOUT_MS.
  * 
  * @return esp_err_t ESP_OK on success
  */
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
@@ -15,7 +16,14 @@
 #include "mdns_service.h"
 #include "mqtt_telemetry.h"
 #include "i2c_scanner.h"
+#include "i2c_arbiter.h"
 #include "sensor_manager.h"
+#include "power_manager.h"
+#include "config_cache.h"
+#include "boot_pipeline.h"
+#include "metrics.h"
+#include "app_log.h"
+#include "mem_policy.h"
 
 static const char *TAG = "MAIN";
 
@@ -25,6 +33,192 @@ static void reset_button_handler(reset_button_event_t event, uint32_t press_dura
 static void time_sync_handler(bool synced, struct tm *current_time);
 static void cloud_prov_handler(bool success, const char *message);
 
+// MQTT broker settings for KannaCloud telemetry
+#define MQTT_BROKER_URI     "mqtts://mqtt.kannacloud.com:8883"
+#define MQTT_USERNAME       "sensor01"
+#define MQTT_PASSWORD       "xkKKYQWxiT83Ni3"
+
+/*
+ * Startup stages, run by boot_pipeline_run(). Sensors only need the I2C bus,
+ * so they come up while Wi-Fi associates; the dashboard needs certificates
+ * but not time or the MQTT CA, so it starts alongside the MQTT chain.
+ *
+ *   wifi ──┬── time ──┬── cloud_prov ──┬── mqtt_ca ── mqtt
+ *          │          │                └── http (+ api_keys)
+ *          └── mdns   └───────────────────────────── mqtt
+ *   sensors, api_keys, ble_stop: no dependencies
+ */
+enum {
+    STAGE_WIFI,
+    STAGE_SENSORS,
+    STAGE_TIME,
+    STAGE_API_KEYS,
+    STAGE_CLOUD_PROV,
+    STAGE_MQTT_CA,
+    STAGE_MDNS,
+    STAGE_HTTP,
+    STAGE_MQTT,
+    STAGE_BLE_STOP,     // Last: left out when booting from stored credentials
+    STAGE_COUNT
+};
+
+static bool s_sensors_started = false;
+
+static esp_err_t boot_stage_wifi(void)
+{
+    // wifi_manager_connect() was called by app_main; wait for the IP
+    if (!wifi_manager_wait_for_connection(pdMS_TO_TICKS(30000))) {
+        return ESP_ERR_TIMEOUT;
+    }
+    ESP_LOGI(TAG, "Successfully connected to stored WiFi network");
+    provisioning_state_set(PROV_STATE_PROVISIONED, STATUS_SUCCESS, "Connected using stored credentials");
+    return ESP_OK;
+}
+
+static esp_err_t boot_stage_sensors(void)
+{
+    esp_err_t ret = i2c_scanner_init();
+    if (ret == ESP_OK) {
+        // From here on all I2C traffic goes through the bus owner task
+        ret = i2c_arbiter_init();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "I2C arbiter not started, sensors will use the bus directly");
+        }
+        
+        ret = sensor_manager_init();
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "✓ Sensors initialized: Battery=%s, EZO sensors=%d",
+                     sensor_manager_has_battery_monitor() ? "YES" : "NO",
+                     sensor_manager_get_ezo_count());
+        } else {
+            ESP_LOGW(TAG, "Failed to initialize sensors: %s", esp_err_to_name(ret));
+        }
+    } else {
+        ESP_LOGW(TAG, "Failed to initialize I2C: %s", esp_err_to_name(ret));
+    }
+    
+    // Start sensor reading task (10 second interval)
+    esp_err_t task_ret = sensor_manager_start_reading_task(10);
+    if (task_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start sensor reading task: %s", esp_err_to_name(task_ret));
+    }
+    s_sensors_started = true;
+    return ret;
+}
+
+static bool boot_sensors_started(void)
+{
+    return s_sensors_started;
+}
+
+static esp_err_t boot_stage_time(void)
+{
+    esp_err_t ret = time_sync_init(NULL, time_sync_handler); // NULL = UTC timezone
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize time sync: %s", esp_err_to_name(ret));
+    }
+    
+    // Wait for time sync (required for HTTPS certificate validation)
+    int sync_wait = 0;
+    while (!time_sync_is_synced() && sync_wait < 10) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        sync_wait++;
+    }
+    if (!time_sync_is_synced()) {
+        ESP_LOGW(TAG, "Time not synchronized yet, continuing");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_stage_api_keys(void)
+{
+    return api_key_manager_init();
+}
+
+static esp_err_t boot_stage_cloud_prov(void)
+{
+    cloud_prov_init(cloud_prov_handler);
+    esp_err_t ret = cloud_prov_provision_device();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Cloud provisioning failed, dashboard not available");
+    }
+    return ret;
+}
+
+static esp_err_t boot_stage_mqtt_ca(void)
+{
+    esp_err_t ret = cloud_prov_download_mqtt_ca_cert();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to download MQTT CA certificate: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t boot_stage_mdns(void)
+{
+    esp_err_t ret = mdns_service_init("kc", "KannaCloud Device");
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "mDNS initialization failed, device accessible by IP only");
+        return ret;
+    }
+    return mdns_service_add_https(443);
+}
+
+static esp_err_t boot_stage_http(void)
+{
+    esp_err_t ret = http_server_start();
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "✓ HTTPS dashboard is ready!");
+        ESP_LOGI(TAG, "✓ Access at: https://kc.local");
+    } else {
+        ESP_LOGE(TAG, "Failed to start HTTPS server: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t boot_stage_mqtt(void)
+{
+    esp_err_t ret = mqtt_client_init(MQTT_BROKER_URI, MQTT_USERNAME, MQTT_PASSWORD);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to initialize MQTT client: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = mqtt_client_start();
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "✓ MQTT telemetry enabled");
+    } else {
+        ESP_LOGW(TAG, "Failed to start MQTT client: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t boot_stage_ble_stop(void)
+{
+    // Give the app time to receive the final notifications, off the critical path
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    ESP_LOGI(TAG, "Stopping BLE provisioning service...");
+    return ble_provisioning_deinit();
+}
+
+static const boot_stage_t s_boot_stages[STAGE_COUNT] = {
+    [STAGE_WIFI]       = { "wifi",       boot_stage_wifi,       wifi_manager_is_connected,   0, 3072 },
+    [STAGE_SENSORS]    = { "sensors",    boot_stage_sensors,    boot_sensors_started,        0, 4096 },
+    [STAGE_TIME]       = { "time",       boot_stage_time,       NULL,
+                           BOOT_STAGE_BIT(STAGE_WIFI), 3072 },
+    [STAGE_API_KEYS]   = { "api_keys",   boot_stage_api_keys,   NULL,                        0, 4096 },
+    [STAGE_CLOUD_PROV] = { "cloud_prov", boot_stage_cloud_prov, cloud_prov_is_provisioned,
+                           BOOT_STAGE_BIT(STAGE_TIME), 8192 },
+    [STAGE_MQTT_CA]    = { "mqtt_ca",    boot_stage_mqtt_ca,    cloud_prov_has_mqtt_ca_cert,
+                           BOOT_STAGE_BIT(STAGE_CLOUD_PROV), 8192 },
+    [STAGE_MDNS]       = { "mdns",       boot_stage_mdns,       NULL,
+                           BOOT_STAGE_BIT(STAGE_WIFI), 4096 },
+    [STAGE_HTTP]       = { "http",       boot_stage_http,       http_server_is_running,
+                           BOOT_STAGE_BIT(STAGE_CLOUD_PROV) | BOOT_STAGE_BIT(STAGE_API_KEYS), 6144 },
+    [STAGE_MQTT]       = { "mqtt",       boot_stage_mqtt,       NULL,
+                           BOOT_STAGE_BIT(STAGE_MQTT_CA) | BOOT_STAGE_BIT(STAGE_TIME), 6144 },
+    [STAGE_BLE_STOP]   = { "ble_stop",   boot_stage_ble_stop,   NULL,                        0, 3072 },
+};
+
 /**
  * @brief Main application entry point
  */
@@ -34,8 +228,14 @@ void app_main(void)
     ESP_LOGI(TAG, "ESP32-S3 WiFi BLE Provisioning");
     ESP_LOGI(TAG, "=================================");
     
+    // Buffer pools and PSRAM placement first, before anything allocates JSON or TLS state
+    esp_err_t ret = mem_policy_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Memory pools not fully available: %s", esp_err_to_name(ret));
+    }
+    
     // Initialize security features (NVS encryption with eFuse protection)
-    esp_err_t ret = security_init();
+    ret = security_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Security initialization failed: %s", esp_err_to_name(ret));
         ESP_LOGE(TAG, "Device will continue but credentials may not be secure!");
@@ -60,6 +260,30 @@ void app_main(void)
         return;
     }
     
+    // Payload dumps go to a RAM ring buffer (/api/trace) instead of the UART
+    ret = app_log_trace_init();
+    if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "Payload trace buffer not available: %s", esp_err_to_name(ret));
+    }
+    
+    // Counters, latency histograms and CPU sampling for /api/metrics
+    ret = metrics_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics CPU sampling not available: %s", esp_err_to_name(ret));
+    }
+    
+    // Enable DFS, automatic light sleep and modem sleep (needs the event loop from wifi_manager_init)
+    ret = power_manager_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Power management not enabled: %s", esp_err_to_name(ret));
+    }
+    
+    // RAM copy of device ID, SSID and CA cert for the HTTP API (NVS set up by security_init)
+    ret = config_cache_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Config cache not available: %s", esp_err_to_name(ret));
+    }
+    
     // Check if already provisioned
     char stored_ssid[33] = {0};
     char stored_password[64] = {0};
@@ -71,123 +295,32 @@ void app_main(void)
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "Connecting to stored WiFi network...");
             
-            // Wait for connection (with timeout)
-            int wait_time = 0;
-            while (!wifi_manager_is_connected() && wait_time < 30) {
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                wait_time++;
-            }
+            // Everything after the connect runs as a dependency graph; sensors
+            // come up while the station is still associating
+            boot_pipeline_result_t boot;
+            boot_pipeline_run(s_boot_stages, STAGE_BLE_STOP, portMAX_DELAY, &boot);
             
-            if (wifi_manager_is_connected()) {
-                ESP_LOGI(TAG, "Successfully connected to stored WiFi network");
-                provisioning_state_set(PROV_STATE_PROVISIONED, STATUS_SUCCESS, "Connected using stored credentials");
-                
-                // Initialize NTP time synchronization
-                ESP_LOGI(TAG, "Initializing NTP time synchronization...");
-                ret = time_sync_init(NULL, time_sync_handler); // NULL = UTC timezone
-                if (ret != ESP_OK) {
-                    ESP_LOGE(TAG, "Failed to initialize time sync: %s", esp_err_to_name(ret));
-                }
-                
-                // Wait for time sync (required for HTTPS certificate validation)
-                ESP_LOGI(TAG, "Waiting for time synchronization...");
-                int sync_wait = 0;
-                while (!time_sync_is_synced() && sync_wait < 10) {
+            // BLE provisioning only starts on PROV_STATE_WIFI_FAILED. A network
+            // that has connected before is retried forever and stays in
+            // PROV_STATE_WIFI_CONNECTING, so wait it out rather than advertise
+            // next to the retries; a short press of the reset button clears the
+            // credentials to re-provision such a device.
+            if (!(boot.ok & BOOT_STAGE_BIT(STAGE_WIFI))) {
+                while (provisioning_state_get() == PROV_STATE_WIFI_CONNECTING) {
                     vTaskDelay(pdMS_TO_TICKS(1000));
-                    sync_wait++;
                 }
-                
-                // Initialize API key manager
-                ESP_LOGI(TAG, "Initializing API key manager...");
-                api_key_manager_init();
-                
-                // Initialize cloud provisioning
-                ESP_LOGI(TAG, "Initializing cloud provisioning...");
-                cloud_prov_init(cloud_prov_handler);
-                
-                // Start automatic provisioning (get certificates)
-                ESP_LOGI(TAG, "Starting cloud provisioning...");
-                ret = cloud_prov_provision_device();
-                if (ret == ESP_OK) {
-                    // Download MQTT CA certificate for MQTTS
-                    ESP_LOGI(TAG, "Downloading MQTT CA certificate...");
-                    ret = cloud_prov_download_mqtt_ca_cert();
-                    if (ret != ESP_OK) {
-                        ESP_LOGW(TAG, "Failed to download MQTT CA certificate: %s", esp_err_to_name(ret));
-                    }
-                    
-                    // Initialize mDNS for local network discovery
-                    ESP_LOGI(TAG, "Initializing mDNS service...");
-                    ret = mdns_service_init("kc", "KannaCloud Device");
-                    if (ret == ESP_OK) {
-                        mdns_service_add_https(443);
-                    } else {
-                        ESP_LOGW(TAG, "mDNS initialization failed, device accessible by IP only");
-                    }
-                    
-                    // Start HTTPS server with downloaded certificates
-                    ESP_LOGI(TAG, "Starting HTTPS dashboard server...");
-                    ret = http_server_start();
-                    if (ret == ESP_OK) {
-                        ESP_LOGI(TAG, "✓ HTTPS dashboard is ready!");
-                        ESP_LOGI(TAG, "✓ Access at: https://kc.local");
-                    } else {
-                        ESP_LOGE(TAG, "Failed to start HTTPS server: %s", esp_err_to_name(ret));
-                    }
-                
-                // Initialize and scan I2C bus for sensors
-                ESP_LOGI(TAG, "Initializing I2C scanner...");
-                ret = i2c_scanner_init();
-                if (ret == ESP_OK) {
-                    i2c_scanner_scan();
-                    
-                    // Initialize sensor manager for real sensor data
-                    ESP_LOGI(TAG, "Initializing sensor manager...");
-                    ret = sensor_manager_init();
-                    if (ret == ESP_OK) {
-                        ESP_LOGI(TAG, "✓ Sensors initialized: Battery=%s, EZO sensors=%d",
-                                 sensor_manager_has_battery_monitor() ? "YES" : "NO",
-                                 sensor_manager_get_ezo_count());
-                    } else {
-                        ESP_LOGW(TAG, "Failed to initialize sensors: %s", esp_err_to_name(ret));
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to initialize I2C: %s", esp_err_to_name(ret));
-                }
-                    
-                // Start sensor reading task (10 second interval)
-                ESP_LOGI(TAG, "Starting sensor reading task...");
-                ret = sensor_manager_start_reading_task(10);
-                if (ret != ESP_OK) {
-                    ESP_LOGW(TAG, "Failed to start sensor reading task: %s", esp_err_to_name(ret));
-                }
-                
-                // Initialize and start MQTT client for KannaCloud telemetry
-                ESP_LOGI(TAG, "Initializing MQTT client...");
-                const char *mqtt_broker = "mqtts://mqtt.kannacloud.com:8883";
-                const char *mqtt_username = "sensor01";
-                const char *mqtt_password = "xkKKYQWxiT83Ni3";
-                ret = mqtt_client_init(mqtt_broker, mqtt_username, mqtt_password);
-                    if (ret == ESP_OK) {
-                        ret = mqtt_client_start();
-                        if (ret == ESP_OK) {
-                            ESP_LOGI(TAG, "✓ MQTT telemetry enabled");
-                        } else {
-                            ESP_LOGW(TAG, "Failed to start MQTT client: %s", esp_err_to_name(ret));
-                        }
-                    } else {
-                        ESP_LOGW(TAG, "Failed to initialize MQTT client: %s", esp_err_to_name(ret));
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Cloud provisioning failed, dashboard not available");
+                if (provisioning_state_get() == PROV_STATE_PROVISIONED) {
+                    // Stages that waited on Wi-Fi run now; done ones are skipped
+                    boot_pipeline_run(s_boot_stages, STAGE_BLE_STOP, portMAX_DELAY, &boot);
                 }
-                
+            }
+            
+            if (boot.ok & BOOT_STAGE_BIT(STAGE_WIFI)) {
                 // No need to start BLE provisioning
                 ESP_LOGI(TAG, "Device is provisioned and connected. BLE provisioning not started.");
                 return;
-            } else {
-                ESP_LOGW(TAG, "Failed to connect with stored credentials, starting BLE provisioning");
             }
+            ESP_LOGW(TAG, "Failed to connect with stored credentials, starting BLE provisioning");
         }
         
         // Clear sensitive data
@@ -223,87 +356,8 @@ void app_main(void)
         if (current_state == PROV_STATE_PROVISIONED) {
             ESP_LOGI(TAG, "Provisioning completed successfully!");
             
-            // Initialize NTP time synchronization
-            ESP_LOGI(TAG, "Initializing NTP time synchronization...");
-            ret = time_sync_init(NULL, time_sync_handler); // NULL = UTC timezone
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to initialize time sync: %s", esp_err_to_name(ret));
-            }
-            
-            // Wait for time sync (required for HTTPS certificate validation)
-            ESP_LOGI(TAG, "Waiting for time synchronization...");
-            int sync_wait = 0;
-            while (!time_sync_is_synced() && sync_wait < 10) {
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                sync_wait++;
-            }
-            
-            // Initialize API key manager
-            ESP_LOGI(TAG, "Initializing API key manager...");
-            api_key_manager_init();
-            
-            // Initialize cloud provisioning
-            ESP_LOGI(TAG, "Initializing cloud provisioning...");
-            cloud_prov_init(cloud_prov_handler);
-            
-            // Start automatic provisioning (get certificates)
-            ESP_LOGI(TAG, "Starting cloud provisioning...");
-            ret = cloud_prov_provision_device();
-            if (ret == ESP_OK) {
-                // Download MQTT CA certificate for MQTTS
-                ESP_LOGI(TAG, "Downloading MQTT CA certificate...");
-                ret = cloud_prov_download_mqtt_ca_cert();
-                if (ret != ESP_OK) {
-                    ESP_LOGW(TAG, "Failed to download MQTT CA certificate: %s", esp_err_to_name(ret));
-                }
-                
-                // Initialize mDNS for local network discovery
-                ESP_LOGI(TAG, "Initializing mDNS service...");
-                ret = mdns_service_init("kc", "KannaCloud Device");
-                if (ret == ESP_OK) {
-                    mdns_service_add_https(443);
-                } else {
-                    ESP_LOGW(TAG, "mDNS initialization failed, device accessible by IP only");
-                }
-                
-                // Start HTTPS server with downloaded certificates
-                ESP_LOGI(TAG, "Starting HTTPS dashboard server...");
-                ret = http_server_start();
-                if (ret == ESP_OK) {
-                    ESP_LOGI(TAG, "✓ HTTPS dashboard is ready!");
-                    ESP_LOGI(TAG, "✓ Access at: https://kc.local");
-                } else {
-                    ESP_LOGE(TAG, "Failed to start HTTPS server: %s", esp_err_to_name(ret));
-                }
-                
-                // Initialize and start MQTT client for KannaCloud telemetry
-                ESP_LOGI(TAG, "Initializing MQTT client...");
-                const char *mqtt_broker = "mqtts://mqtt.kannacloud.com:8883";
-                const char *mqtt_username = "sensor01";
-                const char *mqtt_password = "xkKKYQWxiT83Ni3";
-                ret = mqtt_client_init(mqtt_broker, mqtt_username, mqtt_password);
-                if (ret == ESP_OK) {
-                    ret = mqtt_client_start();
-                    if (ret == ESP_OK) {
-                        ESP_LOGI(TAG, "✓ MQTT telemetry enabled");
-                        // Set telemetry interval to 10 seconds for dashboard testing
-                        mqtt_set_telemetry_interval(10);
-                    } else {
-                        ESP_LOGW(TAG, "Failed to start MQTT client: %s", esp_err_to_name(ret));
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Failed to initialize MQTT client: %s", esp_err_to_name(ret));
-                }
-            } else {
-                ESP_LOGW(TAG, "Cloud provisioning failed, dashboard not available");
-            }
-            
-            // Wait a bit to ensure final notifications are sent
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            
-            // Stop BLE to save power
-            ESP_LOGI(TAG, "Stopping BLE provisioning service...");
-            ble_provisioning_deinit();
+            // Same startup graph; stages already done by the stored-credentials attempt are skipped
+            boot_pipeline_run(s_boot_stages, STAGE_COUNT, portMAX_DELAY, NULL);
             
             ESP_LOGI(TAG, "Device is now fully provisioned and connected to WiFi");
             break;
@@ -317,13 +371,11 @@ void app_main(void)
     
     // Here you can add your main application logic
     while (1) {
-        // Check WiFi connection status periodically
-        if (!wifi_manager_is_connected()) {
-            ESP_LOGW(TAG, "WiFi connection lost, attempting to reconnect...");
-            wifi_manager_connect(stored_ssid, stored_password);
+        // The WiFi manager reconnects on its own (backoff with jitter, driven by
+        // the disconnect event); just note outages that outlast the retry budget
+        if (wifi_manager_wait_for_failure(portMAX_DELAY)) {
+            ESP_LOGW(TAG, "WiFi connection lost, still retrying in the background");
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Check every 10 seconds
     }
 }
 
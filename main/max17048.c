@@ -135,6 +135,26 @@ esp_err_t max17048_read_soc(max17048_t *device, float *soc) {
     return ret;
 }
 
+/**
+ * @brief Read charge rate
+ */
+esp_err_t max17048_read_charge_rate(max17048_t *device, float *rate) {
+    if (device == NULL || rate == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t raw_rate = 0;
+    esp_err_t ret = max17048_read_reg(device, MAX17048_REG_CRATE, &raw_rate);
+    
+    if (ret == ESP_OK) {
+        // Convert to %/hour: CRATE = signed 16-bit value * 0.208 %/hr
+        *rate = (float)(int16_t)raw_rate * 0.208f;
+        ESP_LOGD(TAG, "Battery rate: %.2f%%/hr", *rate);
+    }
+    
+    return ret;
+}
+
 /**
  * @brief Read chip version
  */
@@ -23,6 +23,7 @@ extern "C" {
 #define MAX17048_REG_MODE       0x06    // Mode register
 #define MAX17048_REG_VERSION    0x08    // Chip version
 #define MAX17048_REG_CONFIG     0x0C    // Configuration
+#define MAX17048_REG_CRATE      0x16    // Charge/discharge rate
 #define MAX17048_REG_COMMAND    0xFE    // Command register
 
 // Commands
@@ -71,6 +72,15 @@ esp_err_t max17048_read_voltage(max17048_t *device, float *voltage);
  */
 esp_err_t max17048_read_soc(max17048_t *device, float *soc);
 
+/**
+ * @brief Read charge rate
+ * 
+ * @param device Pointer to MAX17048 device structure
+ * @param rate Pointer to store rate in %/hour (negative while discharging)
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t max17048_read_charge_rate(max17048_t *device, float *rate);
+
 /**
  * @brief Read chip version
  * 
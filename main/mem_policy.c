@@ -0,0 +1,235 @@
+/**
+ * @file mem_policy.c
+ * @brief Memory placement policy: block pools, PSRAM steering, heap watch
+ */
+
+#include "mem_policy.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
+#include "app_log.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "cJSON.h"
+
+static const char *TAG = "MEM_POLICY";
+
+#define LOW_BLOCK_LOG_INTERVAL_MS   (10 * 60 * 1000)
+
+/**
+ * @brief One fixed-size block pool (state under s_pool_lock)
+ */
+typedef struct {
+    uint8_t *base;              // NULL if the pool could not be allocated
+    uint32_t block_size;
+    uint32_t blocks;            // At most 32
+    uint32_t free_mask;         // Bit per free block
+    uint32_t in_use;
+    uint32_t peak;
+    uint32_t fallbacks;
+} mem_pool_t;
+
+static mem_pool_t s_pools[MEM_POOL_COUNT] = {
+    [MEM_POOL_SMALL] = { .block_size = MEM_POOL_SMALL_BLOCK, .blocks = MEM_POOL_SMALL_COUNT },
+    [MEM_POOL_LARGE] = { .block_size = MEM_POOL_LARGE_BLOCK, .blocks = MEM_POOL_LARGE_COUNT },
+};
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const s_pool_names[MEM_POOL_COUNT] = {
+    [MEM_POOL_SMALL] = "small",
+    [MEM_POOL_LARGE] = "large",
+};
+
+static atomic_uint s_largest_block_min = UINT32_MAX;
+static esp_timer_handle_t s_sample_timer = NULL;
+
+void *mem_policy_alloc_large(size_t size) {
+    void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr == NULL) {
+        ptr = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+void *mem_policy_realloc_large(void *ptr, size_t size) {
+    void *grown = heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (grown == NULL) {
+        grown = heap_caps_realloc(ptr, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return grown;
+}
+
+/**
+ * @brief cJSON allocator: nodes and printed strings stay out of internal RAM
+ */
+static void *mem_policy_json_malloc(size_t size) {
+    return mem_policy_alloc_large(size);
+}
+
+#if CONFIG_MBEDTLS_CUSTOM_MEM_ALLOC
+// Called by mbedTLS for every context and record buffer (see esp_mem.c in
+// the mbedtls component). PSRAM first keeps 16 KB record buffers from
+// competing with long-lived internal allocations.
+void *esp_mbedtls_mem_calloc(size_t n, size_t size) {
+    void *ptr = heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr == NULL) {
+        ptr = heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+void esp_mbedtls_mem_free(void *ptr) {
+    heap_caps_free(ptr);
+}
+#endif
+
+void *mem_policy_pool_alloc(size_t size) {
+    mem_pool_t *fallback_pool = NULL;
+
+    portENTER_CRITICAL(&s_pool_lock);
+    for (int i = 0; i < MEM_POOL_COUNT; i++) {
+        mem_pool_t *pool = &s_pools[i];
+        if (size > pool->block_size) {
+            continue;
+        }
+        if (pool->base != NULL && pool->free_mask != 0) {
+            uint32_t block = __builtin_ctz(pool->free_mask);
+            pool->free_mask &= ~(1u << block);
+            pool->in_use++;
+            if (pool->in_use > pool->peak) {
+                pool->peak = pool->in_use;
+            }
+            portEXIT_CRITICAL(&s_pool_lock);
+            return pool->base + block * pool->block_size;
+        }
+        if (fallback_pool == NULL) {
+            fallback_pool = pool;
+        }
+    }
+    if (fallback_pool != NULL) {
+        fallback_pool->fallbacks++;
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    // Exhausted, or larger than every block
+    return mem_policy_alloc_large(size);
+}
+
+void mem_policy_pool_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    uint8_t *p = (uint8_t *)ptr;
+    for (int i = 0; i < MEM_POOL_COUNT; i++) {
+        mem_pool_t *pool = &s_pools[i];
+        if (pool->base == NULL || p < pool->base || p >= pool->base + pool->blocks * pool->block_size) {
+            continue;
+        }
+        uint32_t block = (uint32_t)(p - pool->base) / pool->block_size;
+        portENTER_CRITICAL(&s_pool_lock);
+        pool->free_mask |= 1u << block;
+        pool->in_use--;
+        portEXIT_CRITICAL(&s_pool_lock);
+        return;
+    }
+    free(ptr);
+}
+
+void mem_policy_get_pool_stats(mem_pool_id_t pool, mem_pool_stats_t *stats) {
+    if (pool >= MEM_POOL_COUNT || stats == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&s_pool_lock);
+    stats->block_size = s_pools[pool].block_size;
+    stats->blocks = (s_pools[pool].base != NULL) ? s_pools[pool].blocks : 0;
+    stats->in_use = s_pools[pool].in_use;
+    stats->peak = s_pools[pool].peak;
+    stats->fallbacks = s_pools[pool].fallbacks;
+    portEXIT_CRITICAL(&s_pool_lock);
+}
+
+const char *mem_policy_pool_name(mem_pool_id_t pool) {
+    return (pool < MEM_POOL_COUNT) ? s_pool_names[pool] : "?";
+}
+
+/**
+ * @brief Record the internal heap's largest free block and its low watermark
+ */
+static uint32_t mem_policy_sample(void) {
+    uint32_t largest = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint32_t min = atomic_load_explicit(&s_largest_block_min, memory_order_relaxed);
+    while (largest < min &&
+           !atomic_compare_exchange_weak_explicit(&s_largest_block_min, &min, largest,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+    if (largest < MEM_POLICY_LOW_BLOCK) {
+        APP_LOGW_RATE_LIMITED(TAG, LOW_BLOCK_LOG_INTERVAL_MS,
+                              "Internal heap fragmented: largest free block %lu bytes (%lu free)",
+                              (unsigned long)largest,
+                              (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    }
+    return largest;
+}
+
+static void mem_policy_sample_timer_cb(void *arg) {
+    mem_policy_sample();
+}
+
+void mem_policy_get_heap_stats(mem_heap_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->largest_block = mem_policy_sample();
+    stats->largest_block_min = atomic_load_explicit(&s_largest_block_min, memory_order_relaxed);
+    stats->free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    stats->psram_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+esp_err_t mem_policy_init(void) {
+    esp_err_t ret = ESP_OK;
+
+    for (int i = 0; i < MEM_POOL_COUNT; i++) {
+        mem_pool_t *pool = &s_pools[i];
+        if (pool->base != NULL) {
+            continue;
+        }
+        // One allocation at boot; it never moves, so it cannot fragment anything
+        pool->base = mem_policy_alloc_large(pool->blocks * pool->block_size);
+        if (pool->base == NULL) {
+            ESP_LOGW(TAG, "No memory for the %s pool, using the heap", s_pool_names[i]);
+            ret = ESP_ERR_NO_MEM;
+            continue;
+        }
+        pool->free_mask = (pool->blocks >= 32) ? UINT32_MAX : ((1u << pool->blocks) - 1);
+        ESP_LOGI(TAG, "Pool %s: %lu x %lu bytes in %s", s_pool_names[i], (unsigned long)pool->blocks,
+                 (unsigned long)pool->block_size,
+                 esp_ptr_external_ram(pool->base) ? "PSRAM" : "internal RAM");
+    }
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = mem_policy_json_malloc,
+        .free_fn = free,
+    };
+    cJSON_InitHooks(&hooks);
+
+    if (s_sample_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = mem_policy_sample_timer_cb,
+            .name = "mem_sample",
+        };
+        if (esp_timer_create(&timer_args, &s_sample_timer) == ESP_OK) {
+            esp_timer_start_periodic(s_sample_timer, (uint64_t)MEM_POLICY_SAMPLE_SEC * 1000000);
+        }
+    }
+
+    mem_policy_sample();
+    ESP_LOGI(TAG, "Internal heap: %lu bytes free, largest block %lu; PSRAM: %lu bytes free",
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    return ret;
+}
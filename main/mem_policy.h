@@ -0,0 +1,133 @@
+/**
+ * @file mem_policy.h
+ * @brief Memory placement policy: block pools, PSRAM steering, heap watch
+ *
+ * Internal DRAM is kept for what needs it (stacks, DMA, Wi-Fi) and for TLS
+ * handshakes late in a long uptime:
+ *
+ * - Recurring buffers (command payloads, read-now waits, metrics reports)
+ *   come from fixed-size block pools carved out once at boot, so they never
+ *   fragment the heap. A request that does not fit a free block falls back
+ *   to the heap and is counted.
+ * - Large, long-lived buffers (certificates, downloads) go to PSRAM when it
+ *   is present via mem_policy_alloc_large().
+ * - cJSON trees and, with CONFIG_MBEDTLS_CUSTOM_MEM_ALLOC, mbedTLS contexts
+ *   and record buffers are allocated PSRAM first as well.
+ * - The internal heap's largest free block is sampled periodically; its low
+ *   watermark is the early warning for handshake allocation failures.
+ *
+ * Every allocation falls back to internal RAM, so boards without PSRAM
+ * behave as before. Large buffers are released with free(), pool buffers
+ * with mem_policy_pool_free().
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_POOL_SMALL_BLOCK        1152    // MQTT command payload (1 KB + NUL), read-now wait
+#define MEM_POOL_SMALL_COUNT        8
+#define MEM_POOL_LARGE_BLOCK        4096    // METRICS_JSON_MAX_LEN reports
+#define MEM_POOL_LARGE_COUNT        2
+
+#define MEM_POLICY_SAMPLE_SEC       30      // Internal heap sampling period
+#define MEM_POLICY_LOW_BLOCK        (16 * 1024)  // Warn below this largest free internal block
+
+typedef enum {
+    MEM_POOL_SMALL,
+    MEM_POOL_LARGE,
+    MEM_POOL_COUNT
+} mem_pool_id_t;
+
+/**
+ * @brief Pool usage
+ */
+typedef struct {
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t in_use;
+    uint32_t peak;              // Most blocks in use at once (since boot)
+    uint32_t fallbacks;         // Requests served by the heap instead (since boot)
+} mem_pool_stats_t;
+
+/**
+ * @brief Internal heap figures
+ */
+typedef struct {
+    uint32_t free;
+    uint32_t largest_block;
+    uint32_t largest_block_min; // Lowest largest_block seen (since boot)
+    uint32_t psram_free;
+} mem_heap_stats_t;
+
+/**
+ * @brief Carve out the pools, install the cJSON hooks and start heap sampling
+ *
+ * Call first in app_main(), before anything builds JSON.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if a pool could not be
+ *         allocated (its requests then use the heap)
+ */
+esp_err_t mem_policy_init(void);
+
+/**
+ * @brief Allocate a large buffer, PSRAM first
+ *
+ * @param size Bytes
+ * @return void* Buffer, or NULL if neither PSRAM nor internal RAM has room
+ */
+void *mem_policy_alloc_large(size_t size);
+
+/**
+ * @brief Resize a buffer from mem_policy_alloc_large(), PSRAM first
+ *
+ * @param ptr Buffer (may be NULL)
+ * @param size New size in bytes
+ * @return void* Resized buffer, or NULL (ptr is then left untouched)
+ */
+void *mem_policy_realloc_large(void *ptr, size_t size);
+
+/**
+ * @brief Allocate a buffer from the smallest pool whose blocks fit
+ *
+ * @param size Bytes
+ * @return void* Block (or heap fallback), NULL if out of memory
+ */
+void *mem_policy_pool_alloc(size_t size);
+
+/**
+ * @brief Release a buffer from mem_policy_pool_alloc()
+ *
+ * @param ptr Buffer (NULL is ignored)
+ */
+void mem_policy_pool_free(void *ptr);
+
+/**
+ * @brief Get the usage of one pool
+ *
+ * @param pool Pool
+ * @param stats Pointer to store the usage
+ */
+void mem_policy_get_pool_stats(mem_pool_id_t pool, mem_pool_stats_t *stats);
+
+/**
+ * @brief Sample the internal heap now and get its figures
+ *
+ * @param stats Pointer to store the figures
+ */
+void mem_policy_get_heap_stats(mem_heap_stats_t *stats);
+
+/**
+ * @brief Name of a pool for reports ("small", "large")
+ */
+const char *mem_policy_pool_name(mem_pool_id_t pool);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,363 @@
+/**
+ * @file metrics.c
+ * @brief Lock-free counters, latency histograms and system metrics
+ */
+
+#include "metrics.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sensor_manager.h"
+#include "sensor_history.h"
+#include "mem_policy.h"
+#include "ezo_sensor.h"
+
+static const char *TAG = "METRICS";
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#define METRICS_HAVE_RUN_TIME_STATS 1
+#else
+#define METRICS_HAVE_RUN_TIME_STATS 0
+#endif
+
+#define CPU_SAMPLE_MIN_US   1000000     // metrics_get_cpu_usage() reuses samples younger than this
+
+static metrics_histogram_t s_hists[METRIC_HIST_COUNT];
+static atomic_uint s_counters[METRIC_COUNTER_COUNT];
+static atomic_uint s_gauges[METRIC_GAUGE_COUNT];
+static atomic_uint s_gauge_max[METRIC_GAUGE_COUNT];
+
+static const char *const s_hist_names[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_SENSOR_SWEEP] = "sensor_sweep",
+    [METRIC_HIST_MQTT_BUILD] = "mqtt_build",
+    [METRIC_HIST_MQTT_PUBLISH] = "mqtt_publish",
+    [METRIC_HIST_HTTP_HANDLER] = "http_handler",
+    [METRIC_HIST_WIFI_ASSOC] = "wifi_assoc",
+    [METRIC_HIST_WIFI_RECONNECT] = "wifi_reconnect",
+};
+
+static const char *const s_counter_names[METRIC_COUNTER_COUNT] = {
+    [METRIC_MQTT_PUBLISHED] = "mqtt_published",
+    [METRIC_MQTT_PUBLISH_ERRORS] = "mqtt_publish_errors",
+    [METRIC_HTTP_REQUESTS] = "http_requests",
+    [METRIC_HTTP_ERRORS] = "http_errors",
+    [METRIC_TLS_HANDSHAKES] = "tls_handshakes",
+    [METRIC_TLS_RESUMED] = "tls_resumed",
+    [METRIC_WIFI_RECONNECTS] = "wifi_reconnects",
+    [METRIC_WIFI_FAST_CONNECTS] = "wifi_fast_connects",
+    [METRIC_WIFI_FAST_FALLBACKS] = "wifi_fast_fallbacks",
+};
+
+static const char *const s_gauge_names[METRIC_GAUGE_COUNT] = {
+    [METRIC_GAUGE_MQTT_OUTBOX] = "mqtt_outbox",
+};
+
+/**
+ * @brief CPU share of one task over the last sampling window
+ */
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint16_t cpu_permille;
+    uint32_t stack_free;
+} metrics_task_t;
+
+// CPU sampling state, guarded by s_cpu_lock
+static SemaphoreHandle_t s_cpu_lock = NULL;
+static int64_t s_cpu_sampled_us = 0;
+static int s_cpu_usage = -1;
+static metrics_task_t s_tasks[METRICS_MAX_TASKS];
+static uint8_t s_task_count = 0;
+#if METRICS_HAVE_RUN_TIME_STATS
+static TaskStatus_t s_task_status[METRICS_MAX_TASKS];
+static TaskHandle_t s_prev_handle[METRICS_MAX_TASKS];
+static uint32_t s_prev_runtime[METRICS_MAX_TASKS];
+static uint8_t s_prev_count = 0;
+static uint32_t s_prev_total = 0;
+#endif
+
+esp_err_t metrics_init(void) {
+    if (s_cpu_lock != NULL) {
+        return ESP_OK;
+    }
+    s_cpu_lock = xSemaphoreCreateMutex();
+    if (s_cpu_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create metrics mutex");
+        return ESP_ERR_NO_MEM;
+    }
+#if !METRICS_HAVE_RUN_TIME_STATS
+    ESP_LOGW(TAG, "FreeRTOS run-time stats disabled, no CPU figures");
+#endif
+    return ESP_OK;
+}
+
+/**
+ * @brief Raise an atomic high-water mark
+ */
+static void metrics_atomic_max(atomic_uint *slot, uint32_t value) {
+    unsigned int current = atomic_load_explicit(slot, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(slot, &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void metrics_hist_record(metrics_histogram_t *hist, uint32_t us) {
+    uint32_t bucket = 0;
+    if (us >= (1u << METRICS_HIST_MIN_SHIFT)) {
+        bucket = (32 - __builtin_clz(us)) - METRICS_HIST_MIN_SHIFT;
+        if (bucket > METRICS_HIST_BUCKETS) {
+            bucket = METRICS_HIST_BUCKETS;
+        }
+    }
+    atomic_fetch_add_explicit(&hist->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    metrics_atomic_max(&hist->max_us, us);
+}
+
+void metrics_hist_reset(metrics_histogram_t *hist) {
+    for (int i = 0; i <= METRICS_HIST_BUCKETS; i++) {
+        atomic_store_explicit(&hist->buckets[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&hist->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->max_us, 0, memory_order_relaxed);
+}
+
+void metrics_record(metrics_hist_id_t id, uint32_t us) {
+    if (id < METRIC_HIST_COUNT) {
+        metrics_hist_record(&s_hists[id], us);
+    }
+}
+
+uint32_t metrics_hist_percentile(const metrics_histogram_t *hist, uint8_t percent) {
+    // Buckets are read one by one, so a concurrent sample may be half counted; fine for estimates
+    uint32_t counts[METRICS_HIST_BUCKETS + 1];
+    uint64_t total = 0;
+    for (int i = 0; i <= METRICS_HIST_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint32_t max_us = atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+    uint64_t rank = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint32_t upper = 1u << (METRICS_HIST_MIN_SHIFT + i);
+            return upper < max_us ? upper : max_us;
+        }
+    }
+    return max_us;
+}
+
+void metrics_count(metrics_counter_id_t id) {
+    if (id < METRIC_COUNTER_COUNT) {
+        atomic_fetch_add_explicit(&s_counters[id], 1, memory_order_relaxed);
+    }
+}
+
+uint32_t metrics_get_counter(metrics_counter_id_t id) {
+    return id < METRIC_COUNTER_COUNT ? atomic_load_explicit(&s_counters[id], memory_order_relaxed) : 0;
+}
+
+void metrics_gauge_set(metrics_gauge_id_t id, uint32_t value) {
+    if (id < METRIC_GAUGE_COUNT) {
+        atomic_store_explicit(&s_gauges[id], value, memory_order_relaxed);
+        metrics_atomic_max(&s_gauge_max[id], value);
+    }
+}
+
+/**
+ * @brief Take a task snapshot and derive CPU shares since the previous one
+ *
+ * Caller holds s_cpu_lock.
+ */
+static void metrics_sample_cpu(void) {
+    s_cpu_sampled_us = esp_timer_get_time();
+#if METRICS_HAVE_RUN_TIME_STATS
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_task_status, METRICS_MAX_TASKS, &total);
+    if (count == 0) {
+        // More tasks than METRICS_MAX_TASKS: keep the previous figures
+        ESP_LOGW(TAG, "Too many tasks for CPU sampling (%u)", (unsigned)uxTaskGetNumberOfTasks());
+        return;
+    }
+
+    // The run-time counter is a shared timer, so each core adds one window of budget
+    uint64_t window = (uint64_t)(total - s_prev_total) * portNUM_PROCESSORS;
+    uint64_t idle = 0;
+    s_task_count = 0;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *status = &s_task_status[i];
+        uint32_t delta = status->ulRunTimeCounter;
+        for (uint8_t j = 0; j < s_prev_count; j++) {
+            if (s_prev_handle[j] == status->xHandle) {
+                delta = status->ulRunTimeCounter - s_prev_runtime[j];
+                break;
+            }
+        }
+        if (strncmp(status->pcTaskName, "IDLE", 4) == 0) {
+            idle += delta;
+        }
+
+        metrics_task_t *task = &s_tasks[s_task_count++];
+        strncpy(task->name, status->pcTaskName, sizeof(task->name) - 1);
+        task->name[sizeof(task->name) - 1] = '\0';
+        task->cpu_permille = window > 0 ? (uint16_t)((uint64_t)delta * 1000 / window) : 0;
+        task->stack_free = status->usStackHighWaterMark;
+    }
+
+    if (s_prev_count > 0 && window > 0) {
+        int busy = 100 - (int)(idle * 100 / window);
+        s_cpu_usage = busy < 0 ? 0 : busy;
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        s_prev_handle[i] = s_task_status[i].xHandle;
+        s_prev_runtime[i] = s_task_status[i].ulRunTimeCounter;
+    }
+    s_prev_count = count;
+    s_prev_total = total;
+#endif
+}
+
+int metrics_get_cpu_usage(void) {
+    if (s_cpu_lock == NULL) {
+        return -1;
+    }
+    xSemaphoreTake(s_cpu_lock, portMAX_DELAY);
+    if (esp_timer_get_time() - s_cpu_sampled_us >= CPU_SAMPLE_MIN_US) {
+        metrics_sample_cpu();
+    }
+    int usage = s_cpu_usage;
+    xSemaphoreGive(s_cpu_lock);
+    return usage;
+}
+
+/**
+ * @brief Append formatted text, tracking overflow
+ */
+static void metrics_append(char *buf, size_t size, size_t *len, bool *overflow, const char *fmt, ...) {
+    if (*overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *len, size - *len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= size - *len) {
+        *overflow = true;
+        return;
+    }
+    *len += n;
+}
+
+/**
+ * @brief Append one histogram summary as a JSON object
+ */
+static void metrics_append_hist(char *buf, size_t size, size_t *len, bool *overflow,
+                                const metrics_histogram_t *hist) {
+    metrics_append(buf, size, len, overflow,
+                   "{\"count\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}",
+                   (unsigned long)atomic_load_explicit(&hist->count, memory_order_relaxed),
+                   (unsigned long)metrics_hist_percentile(hist, 50),
+                   (unsigned long)metrics_hist_percentile(hist, 90),
+                   (unsigned long)metrics_hist_percentile(hist, 99),
+                   (unsigned long)atomic_load_explicit(&hist->max_us, memory_order_relaxed));
+}
+
+int metrics_format_json(char *buf, size_t size) {
+    if (buf == NULL || size == 0) {
+        return -1;
+    }
+
+    size_t len = 0;
+    bool overflow = false;
+
+    metrics_append(buf, size, &len, &overflow, "{\"uptime_s\":%lu,\"counters\":{",
+                   (unsigned long)(esp_timer_get_time() / 1000000));
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        metrics_append(buf, size, &len, &overflow, "%s\"%s\":%lu", i ? "," : "", s_counter_names[i],
+                       (unsigned long)atomic_load_explicit(&s_counters[i], memory_order_relaxed));
+    }
+
+    metrics_append(buf, size, &len, &overflow, "},\"gauges\":{");
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        metrics_append(buf, size, &len, &overflow, "%s\"%s\":{\"value\":%lu,\"max\":%lu}",
+                       i ? "," : "", s_gauge_names[i],
+                       (unsigned long)atomic_load_explicit(&s_gauges[i], memory_order_relaxed),
+                       (unsigned long)atomic_load_explicit(&s_gauge_max[i], memory_order_relaxed));
+    }
+
+    metrics_append(buf, size, &len, &overflow, "},\"latency_us\":{");
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        metrics_append(buf, size, &len, &overflow, "%s\"%s\":", i ? "," : "", s_hist_names[i]);
+        metrics_append_hist(buf, size, &len, &overflow, &s_hists[i]);
+    }
+
+    // largest_block_min is the fragmentation watermark TLS handshakes depend on
+    mem_heap_stats_t heap;
+    mem_policy_get_heap_stats(&heap);
+    metrics_append(buf, size, &len, &overflow,
+                   "},\"heap\":{\"free\":%lu,\"min_free\":%lu,\"largest_block\":%lu,\"largest_block_min\":%lu,"
+                   "\"psram_free\":%lu,\"psram_min_free\":%lu,\"history_bytes\":%lu,\"pools\":{",
+                   (unsigned long)heap.free,
+                   (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+                   (unsigned long)heap.largest_block,
+                   (unsigned long)heap.largest_block_min,
+                   (unsigned long)heap.psram_free,
+                   (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM),
+                   (unsigned long)sensor_history_memory_used());
+    for (int i = 0; i < MEM_POOL_COUNT; i++) {
+        mem_pool_stats_t pool;
+        mem_policy_get_pool_stats((mem_pool_id_t)i, &pool);
+        metrics_append(buf, size, &len, &overflow,
+                       "%s\"%s\":{\"block\":%lu,\"blocks\":%lu,\"in_use\":%lu,\"peak\":%lu,\"fallbacks\":%lu}",
+                       i ? "," : "", mem_policy_pool_name((mem_pool_id_t)i), (unsigned long)pool.block_size,
+                       (unsigned long)pool.blocks, (unsigned long)pool.in_use, (unsigned long)pool.peak,
+                       (unsigned long)pool.fallbacks);
+    }
+    metrics_append(buf, size, &len, &overflow, "}}");
+
+    if (s_cpu_lock != NULL) {
+        xSemaphoreTake(s_cpu_lock, portMAX_DELAY);
+        metrics_sample_cpu();
+        metrics_append(buf, size, &len, &overflow, ",\"cpu\":{\"usage\":%d,\"tasks\":[", s_cpu_usage);
+        for (uint8_t i = 0; i < s_task_count; i++) {
+            metrics_append(buf, size, &len, &overflow,
+                           "%s{\"name\":\"%s\",\"cpu\":%u.%u,\"stack_free\":%lu}", i ? "," : "",
+                           s_tasks[i].name, s_tasks[i].cpu_permille / 10, s_tasks[i].cpu_permille % 10,
+                           (unsigned long)s_tasks[i].stack_free);
+        }
+        metrics_append(buf, size, &len, &overflow, "]}");
+        xSemaphoreGive(s_cpu_lock);
+    }
+
+    metrics_append(buf, size, &len, &overflow, ",\"sensors\":[");
+    uint8_t ezo_count = sensor_manager_get_ezo_count();
+    for (uint8_t i = 0; i < ezo_count; i++) {
+        ezo_sensor_t *sensor = (ezo_sensor_t *)sensor_manager_get_ezo_sensor(i);
+        if (sensor == NULL) {
+            continue;
+        }
+        metrics_append(buf, size, &len, &overflow, "%s{\"index\":%u,\"type\":\"%s\",\"address\":%u,"
+                       "\"i2c_errors\":%lu,\"i2c_us\":", i ? "," : "", i, sensor->config.type,
+                       sensor->config.i2c_address,
+                       (unsigned long)atomic_load_explicit(&sensor->i2c_errors, memory_order_relaxed));
+        metrics_append_hist(buf, size, &len, &overflow, &sensor->i2c_time);
+        metrics_append(buf, size, &len, &overflow, "}");
+    }
+    metrics_append(buf, size, &len, &overflow, "]}");
+
+    return overflow ? -1 : (int)len;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file metrics.h
+ * @brief Lock-free counters, latency histograms and system metrics
+ *
+ * Hot paths only do relaxed atomic increments: no locks, no allocation,
+ * safe from any task. Histograms use fixed power-of-two buckets from 64 µs
+ * to 4 s, so percentiles are bucket upper bounds (within a factor of two).
+ * Heap, task stack and per-task CPU figures are sampled when a report is
+ * built. CPU shares cover the window since the previous report.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_HIST_MIN_SHIFT      6       // First bucket: < 64 µs
+#define METRICS_HIST_BUCKETS        17      // ... up to < 4.2 s, then overflow
+#define METRICS_MAX_TASKS           24      // Tasks tracked for CPU shares
+#define METRICS_JSON_MAX_LEN        4096    // Suggested buffer size for metrics_format_json()
+
+/**
+ * @brief Latency histogram (zero-initialise before use)
+ */
+typedef struct {
+    atomic_uint buckets[METRICS_HIST_BUCKETS + 1];  // Last bucket counts overflows
+    atomic_uint count;
+    atomic_uint max_us;
+} metrics_histogram_t;
+
+typedef enum {
+    METRIC_HIST_SENSOR_SWEEP,               // One sensor_reading_task() sweep
+    METRIC_HIST_MQTT_BUILD,                 // Formatting one telemetry payload
+    METRIC_HIST_MQTT_PUBLISH,               // esp_mqtt_client_publish() call
+    METRIC_HIST_HTTP_HANDLER,               // One HTTP URI handler
+    METRIC_HIST_WIFI_ASSOC,                 // esp_wifi_connect() to association
+    METRIC_HIST_WIFI_RECONNECT,             // Link loss to IP address again
+    METRIC_HIST_COUNT
+} metrics_hist_id_t;
+
+typedef enum {
+    METRIC_MQTT_PUBLISHED,
+    METRIC_MQTT_PUBLISH_ERRORS,
+    METRIC_HTTP_REQUESTS,
+    METRIC_HTTP_ERRORS,                     // Handlers that returned an error
+    METRIC_TLS_HANDSHAKES,                  // Full and resumed
+    METRIC_TLS_RESUMED,                     // Resumed from a session ticket
+    METRIC_WIFI_RECONNECTS,                 // Link restored after a loss
+    METRIC_WIFI_FAST_CONNECTS,              // Associations using the cached BSSID/channel
+    METRIC_WIFI_FAST_FALLBACKS,             // Cached AP failed, fell back to a full scan
+    METRIC_COUNTER_COUNT
+} metrics_counter_id_t;
+
+typedef enum {
+    METRIC_GAUGE_MQTT_OUTBOX,               // Bytes waiting in the MQTT outbox
+    METRIC_GAUGE_COUNT
+} metrics_gauge_id_t;
+
+/**
+ * @brief Create the lock that guards CPU sampling
+ *
+ * Counters and histograms work before this is called.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the mutex cannot be created
+ */
+esp_err_t metrics_init(void);
+
+/**
+ * @brief Add one sample to a histogram
+ */
+void metrics_hist_record(metrics_histogram_t *hist, uint32_t us);
+
+/**
+ * @brief Clear a histogram
+ */
+void metrics_hist_reset(metrics_histogram_t *hist);
+
+/**
+ * @brief Add one sample to a global histogram
+ */
+void metrics_record(metrics_hist_id_t id, uint32_t us);
+
+/**
+ * @brief Record the time elapsed since a start timestamp from esp_timer_get_time()
+ */
+static inline void metrics_record_since(metrics_hist_id_t id, int64_t start_us) {
+    metrics_record(id, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+/**
+ * @brief Estimate a percentile
+ *
+ * @param hist Histogram
+ * @param percent 1 to 100
+ * @return uint32_t Upper bound of the bucket holding the percentile in µs, 0 if empty
+ */
+uint32_t metrics_hist_percentile(const metrics_histogram_t *hist, uint8_t percent);
+
+/**
+ * @brief Increment a counter
+ */
+void metrics_count(metrics_counter_id_t id);
+
+/**
+ * @brief Current value of a counter
+ */
+uint32_t metrics_get_counter(metrics_counter_id_t id);
+
+/**
+ * @brief Set a gauge (its high-water mark is kept as well)
+ */
+void metrics_gauge_set(metrics_gauge_id_t id, uint32_t value);
+
+/**
+ * @brief CPU load over the last sampling window
+ *
+ * Takes a new sample if the last one is more than a second old. Needs
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+ *
+ * @return int Busy share of all cores in percent, -1 if run-time stats are off
+ */
+int metrics_get_cpu_usage(void);
+
+/**
+ * @brief Write a full metrics report as one JSON object
+ *
+ * Includes counters, histograms, heap and PSRAM low-water marks, per-task
+ * CPU shares and stack headroom, and per-sensor I2C timing. Takes a new CPU
+ * sample.
+ *
+ * @param buf Output buffer (METRICS_JSON_MAX_LEN is enough)
+ * @param size Size of buf
+ * @return int Length written, or -1 if the buffer is too small
+ */
+int metrics_format_json(char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file mqtt_command.c
+ * @brief MQTT command dispatcher
+ */
+
+#include "mqtt_command.h"
+#include "mqtt_telemetry.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_MQTT
+#include "app_log.h"
+#include "mem_policy.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "MQTT_CMD";
+
+#define MQTT_COMMAND_TASK_STACK     4096
+#define MQTT_COMMAND_TASK_PRIORITY  4       // Below the publish task
+
+typedef struct {
+    char name[MQTT_COMMAND_MAX_NAME_LEN];
+    mqtt_command_handler_t handler;
+} mqtt_command_entry_t;
+
+typedef struct {
+    char *data;                 // Heap copy of the payload, NUL terminated
+    size_t len;
+} mqtt_command_msg_t;
+
+static mqtt_command_entry_t s_handlers[MQTT_COMMAND_MAX_HANDLERS];
+static uint8_t s_handler_count = 0;
+static QueueHandle_t s_queue = NULL;
+static TaskHandle_t s_task_handle = NULL;
+static char s_response_topic[128] = {0};
+
+/**
+ * @brief Look up the handler for a command name
+ */
+static mqtt_command_handler_t mqtt_command_find(const char *name)
+{
+    for (uint8_t i = 0; i < s_handler_count; i++) {
+        if (strcmp(s_handlers[i].name, name) == 0) {
+            return s_handlers[i].handler;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parse one command, run its handler and publish the reply
+ */
+static void mqtt_command_dispatch(const mqtt_command_msg_t *msg)
+{
+    cJSON *reply = cJSON_CreateObject();
+    if (reply == NULL) {
+        ESP_LOGE(TAG, "No memory for command reply");
+        return;
+    }
+    
+    const char *status = "invalid";
+    const char *error = NULL;
+    cJSON *request = cJSON_ParseWithLength(msg->data, msg->len);
+    cJSON *id = request ? cJSON_GetObjectItem(request, "id") : NULL;
+    cJSON *cmd = request ? cJSON_GetObjectItem(request, "command") : NULL;
+    
+    // Echo the correlation id as sent, string or number
+    if (id && (cJSON_IsString(id) || cJSON_IsNumber(id))) {
+        cJSON_AddItemToObject(reply, "id", cJSON_Duplicate(id, false));
+    }
+    
+    if (!cJSON_IsObject(request) || !cJSON_IsString(cmd)) {
+        ESP_LOGW(TAG, "Ignoring malformed command message");
+        error = "expected {\"command\":\"...\"}";
+    } else {
+        cJSON_AddStringToObject(reply, "command", cmd->valuestring);
+        mqtt_command_handler_t handler = mqtt_command_find(cmd->valuestring);
+        if (handler == NULL) {
+            ESP_LOGW(TAG, "Unknown command: %s", cmd->valuestring);
+            status = "unknown_command";
+        } else {
+            ESP_LOGI(TAG, "Command received: %s", cmd->valuestring);
+            esp_err_t ret = handler(request, reply);
+            if (ret == ESP_OK) {
+                status = "ok";
+            } else {
+                ESP_LOGW(TAG, "Command %s failed: %s", cmd->valuestring, esp_err_to_name(ret));
+                status = "error";
+                error = esp_err_to_name(ret);
+            }
+        }
+    }
+    
+    cJSON_AddStringToObject(reply, "status", status);
+    if (error != NULL && cJSON_GetObjectItem(reply, "error") == NULL) {
+        cJSON_AddStringToObject(reply, "error", error);
+    }
+    
+    char *json = cJSON_PrintUnformatted(reply);
+    if (json != NULL) {
+        esp_err_t ret = mqtt_publish_json(s_response_topic, json, 1, false);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Command reply not sent: %s", esp_err_to_name(ret));
+        }
+        free(json);
+    }
+    
+    cJSON_Delete(request);
+    cJSON_Delete(reply);
+}
+
+/**
+ * @brief Dispatcher task: runs queued commands one at a time
+ */
+static void mqtt_command_task(void *arg)
+{
+    mqtt_command_msg_t msg;
+    
+    while (1) {
+        if (xQueueReceive(s_queue, &msg, portMAX_DELAY) == pdTRUE) {
+            mqtt_command_dispatch(&msg);
+            mem_policy_pool_free(msg.data);
+        }
+    }
+}
+
+esp_err_t mqtt_command_init(const char *response_topic)
+{
+    if (response_topic == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    snprintf(s_response_topic, sizeof(s_response_topic), "%s", response_topic);
+    if (s_task_handle != NULL) {
+        return ESP_OK;
+    }
+    
+    s_queue = xQueueCreate(MQTT_COMMAND_QUEUE_LEN, sizeof(mqtt_command_msg_t));
+    if (s_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create command queue");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Core 0 with the MQTT client (network core)
+    BaseType_t task_ret = xTaskCreatePinnedToCore(
+        mqtt_command_task,
+        "mqtt_cmd",
+        MQTT_COMMAND_TASK_STACK,
+        NULL,
+        MQTT_COMMAND_TASK_PRIORITY,
+        &s_task_handle,
+        0
+    );
+    
+    if (task_ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create command task");
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Command dispatcher started (replies on %s)", s_response_topic);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_command_register(const char *name, mqtt_command_handler_t handler)
+{
+    if (name == NULL || handler == NULL || strlen(name) >= MQTT_COMMAND_MAX_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    for (uint8_t i = 0; i < s_handler_count; i++) {
+        if (strcmp(s_handlers[i].name, name) == 0) {
+            s_handlers[i].handler = handler;
+            return ESP_OK;
+        }
+    }
+    
+    if (s_handler_count >= MQTT_COMMAND_MAX_HANDLERS) {
+        ESP_LOGE(TAG, "Command table full, cannot register %s", name);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    strncpy(s_handlers[s_handler_count].name, name, MQTT_COMMAND_MAX_NAME_LEN - 1);
+    s_handlers[s_handler_count].handler = handler;
+    s_handler_count++;
+    return ESP_OK;
+}
+
+esp_err_t mqtt_command_submit(const char *data, size_t len)
+{
+    if (s_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (data == NULL || len == 0 || len > MQTT_COMMAND_MAX_PAYLOAD) {
+        ESP_LOGW(TAG, "Rejected command message of %u bytes", (unsigned)len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    mqtt_command_msg_t msg = {
+        .data = mem_policy_pool_alloc(len + 1),
+        .len = len,
+    };
+    if (msg.data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(msg.data, data, len);
+    msg.data[len] = '\0';
+    
+    if (xQueueSend(s_queue, &msg, 0) != pdTRUE) {
+        APP_LOGW_RATE_LIMITED(TAG, 5000, "Command queue full, dropping command");
+        mem_policy_pool_free(msg.data);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    return ESP_OK;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file mqtt_command.h
+ * @brief MQTT command dispatcher
+ *
+ * Command messages arrive on kannacloud/sensor/{device_id}/cmd as JSON:
+ *
+ *     {"id":"42","command":"set_period","address":99,"period":30}
+ *
+ * The esp-mqtt event task only copies the payload onto a bounded queue; a
+ * dedicated task parses it and runs the handler registered for "command", so
+ * a slow handler never stalls keepalive, PUBACKs or publishing. Each command
+ * is answered on kannacloud/sensor/{device_id}/cmd/response:
+ *
+ *     {"id":"42","command":"set_period","status":"ok"}
+ *
+ * "id" is echoed back unchanged (string or number) when present. "status" is
+ * "ok", "error" (with "error" holding the reason), "unknown_command" or
+ * "invalid" for a payload that is not a command object.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_COMMAND_MAX_HANDLERS   16
+#define MQTT_COMMAND_MAX_NAME_LEN   32
+#define MQTT_COMMAND_MAX_PAYLOAD    1024    // Larger command messages are rejected
+#define MQTT_COMMAND_QUEUE_LEN      8       // Commands waiting for the dispatcher
+
+/**
+ * @brief Command handler, run on the dispatcher task
+ *
+ * May block (I2C, NVS, delays) without affecting the MQTT client, but holds
+ * up the commands queued behind it.
+ *
+ * @param request Parsed command message
+ * @param reply Response object; add result fields to it. Setting "error"
+ *              overrides the default reason reported for a failure.
+ * @return esp_err_t ESP_OK reports "ok", anything else "error"
+ */
+typedef esp_err_t (*mqtt_command_handler_t)(const cJSON *request, cJSON *reply);
+
+/**
+ * @brief Create the command queue and dispatcher task
+ *
+ * @param response_topic Topic replies are published on (copied)
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t mqtt_command_init(const char *response_topic);
+
+/**
+ * @brief Register the handler for a command name
+ *
+ * Registering an existing name replaces its handler.
+ *
+ * @param name Value of the "command" field
+ * @param handler Handler function
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t mqtt_command_register(const char *name, mqtt_command_handler_t handler);
+
+/**
+ * @brief Queue a received command message for the dispatcher
+ *
+ * Never blocks; called from the MQTT event handler.
+ *
+ * @param data Message payload (need not be NUL terminated)
+ * @param len Payload length in bytes
+ * @return esp_err_t ESP_OK if queued, ESP_ERR_INVALID_SIZE if too large,
+ *         ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t mqtt_command_submit(const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
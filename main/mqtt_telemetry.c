@@ -8,7 +8,13 @@
 #include "wifi_manager.h"
 #include "sensor_manager.h"
 #include "ezo_sensor.h"
-#include "esp_log.h"
+#include "telemetry_format.h"
+#include "telemetry_buffer.h"
+#include "metrics.h"
+#include "mqtt_command.h"
+#include "mem_policy.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_MQTT
+#include "app_log.h"
 #include "esp_system.h"
 #include "esp_timer.h"
 #include "esp_wifi.h"
@@ -18,24 +24,124 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "mqtt_client.h" // ESP-IDF MQTT client
+#include "nvs.h"
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/time.h>
 #include <math.h>
 
 static const char *TAG = "MQTT_CLIENT";
 
+#define MQTT_NVS_NAMESPACE      "mqtt_cfg"
+#define MQTT_NVS_KEY_ENCODING   "encoding"
+#define MQTT_NVS_KEY_BATCH_N    "batch_n"
+#define MQTT_NVS_KEY_BATCH_AGE  "batch_age"
+#define MQTT_NVS_KEY_CHANGE_PUB "chg_pub"
+#define MQTT_NVS_KEY_HEARTBEAT  "heartbeat"
+
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
 static mqtt_state_t s_mqtt_state = MQTT_STATE_DISCONNECTED;
 static TaskHandle_t s_publish_task_handle = NULL;
 static uint32_t s_publish_interval_sec = 10; // Default: 10 seconds between MQTT publishes
 static uint32_t s_mqtt_reconnects = 0;
 static char s_device_id[32] = {0};
-static char s_mqtt_ca_cert[CLOUD_PROV_MAX_CERT_SIZE] = {0}; // Static buffer for CA certificate
+static char *s_mqtt_ca_cert = NULL;  // CLOUD_PROV_MAX_CERT_SIZE bytes for the client's lifetime, PSRAM when available
+static char s_payload_buf[TELEMETRY_JSON_MAX_LEN];              // Publish task payload
+static char s_kannacloud_buf[TELEMETRY_JSON_MAX_LEN];           // mqtt_publish_kannacloud_data() payload
+static uint8_t s_cbor_buf[TELEMETRY_CBOR_MAX_LEN];              // Publish task binary payload
+static volatile mqtt_encoding_t s_encoding = MQTT_ENCODING_JSON;
+
+// Batched publishing (see mqtt_set_batching())
+static uint8_t s_batch_max_samples = 0;                         // 0 = publish every snapshot
+static uint32_t s_batch_max_age_sec = 0;
+static sensor_cache_t s_batch[MQTT_BATCH_MAX_SAMPLES];          // Collected snapshots, oldest first
+static uint8_t s_batch_count = 0;
+static uint64_t s_last_batched_us = 0;                          // Snapshot timestamp last collected
+static char s_batch_buf[4096];                                  // Batch JSON payload
+static uint8_t s_batch_cbor_buf[1024];                          // Batch CBOR payload
+
+// Change-driven publishing (see mqtt_set_change_publishing())
+#define MQTT_DEFAULT_HEARTBEAT_SEC  300
+#define MQTT_BATTERY_DEADBAND       1.0f    // % state of charge
+
+typedef enum {
+    MQTT_CHANGE_NONE,           // Nothing moved past its threshold: publish nothing
+    MQTT_CHANGE_DELTA,          // Publish only the sensors that changed
+    MQTT_CHANGE_FULL,           // Publish everything (heartbeat, first publish, layout change)
+} mqtt_change_t;
+
+typedef struct {
+    float deadband;             // Publish when a value moves this far from the last published one
+    float rate_per_min;         // ...or changes this fast between two samples (0 = off)
+} mqtt_deadband_t;
+
+static mqtt_deadband_t s_deadbands[SENSOR_KIND_COUNT] = {
+    [SENSOR_KIND_UNKNOWN] = { 0.0f,  0.0f },    // Any change
+    [SENSOR_KIND_RTD]     = { 0.1f,  0.5f },    // °C
+    [SENSOR_KIND_PH]      = { 0.02f, 0.1f },    // pH
+    [SENSOR_KIND_EC]      = { 10.0f, 50.0f },   // µS/cm (TDS/salinity share it)
+    [SENSOR_KIND_DO]      = { 0.1f,  0.5f },    // mg/L
+    [SENSOR_KIND_ORP]     = { 5.0f,  20.0f },   // mV
+    [SENSOR_KIND_HUM]     = { 1.0f,  5.0f },    // %RH / °C
+};
+
+static bool s_change_publishing = false;                        // false = publish every snapshot
+static uint32_t s_heartbeat_sec = MQTT_DEFAULT_HEARTBEAT_SEC;
+static sensor_cache_t s_last_reported;                          // Reference values for the deadband
+static sensor_cache_t s_prev_sample;                            // Previous sweep, for rate of change
+static sensor_cache_t s_delta;                                  // Changed sensors only
+static int64_t s_last_full_us = 0;                              // 0 = no full snapshot sent yet
+static volatile bool s_force_full = false;                      // Next report must be full
+
+// Publish task wake-up reasons (both also notify the task)
+static volatile bool s_connect_wake = false;                    // Broker (re)connected
+static volatile bool s_snapshot_ready = false;                  // Sensor task published a snapshot
+
+// Device metrics report (see metrics.h)
+#define MQTT_METRICS_INTERVAL_SEC   60
+static int64_t s_last_metrics_us = 0;
+
+// Remote commands (see mqtt_command.h)
+#define MQTT_REBOOT_DELAY_MS        3000    // Lets the reply and status reach the broker
+
+// Offline backlog replay (see telemetry_buffer.h)
+#define MQTT_REPLAY_MAX_RECORDS     16      // Records per backlog message
+#define MQTT_REPLAY_INTERVAL_MS     1000    // Minimum gap between backlog messages
+#define MQTT_REPLAY_ACK_TIMEOUT_US  (10 * 1000 * 1000)
+#define MQTT_ACKED_HISTORY          4
+static char s_replay_buf[1536];                                 // Backlog message payload
+static bool s_buffer_ready = false;                             // Flash ring buffer mounted
+static uint64_t s_last_buffered_us = 0;                         // Snapshot timestamp last stored offline
+static int s_replay_msg_id = -1;                                // In-flight backlog message, -1 if none
+static uint32_t s_replay_count = 0;                             // Records carried by the in-flight message
+static int64_t s_replay_sent_us = 0;
+static volatile int s_acked_msg_ids[MQTT_ACKED_HISTORY] = { -1, -1, -1, -1 };  // Recent PUBACKs
+static volatile uint8_t s_acked_next = 0;
+
+static const char *s_encoding_names[] = {
+    [MQTT_ENCODING_JSON] = "json",
+    [MQTT_ENCODING_CBOR] = "cbor",
+    [MQTT_ENCODING_BOTH] = "both",
+};
 
 // Forward declarations
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 static void mqtt_publish_task(void *arg);
 
+/**
+ * @brief esp_mqtt_client_publish() with latency, error and outbox metrics
+ */
+static int mqtt_publish_timed(const char *topic, const char *data, int len, int qos, int retain)
+{
+    int64_t start_us = esp_timer_get_time();
+    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, data, len, qos, retain);
+    metrics_record_since(METRIC_HIST_MQTT_PUBLISH, start_us);
+    metrics_count(msg_id < 0 ? METRIC_MQTT_PUBLISH_ERRORS : METRIC_MQTT_PUBLISHED);
+    metrics_gauge_set(METRIC_GAUGE_MQTT_OUTBOX, (uint32_t)esp_mqtt_client_get_outbox_size(s_mqtt_client));
+    return msg_id;
+}
+
 /**
  * @brief MQTT event handler
  */
@@ -56,6 +162,15 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
             
             // Publish initial connection status
             ESP_LOGI(TAG, "Device ready to publish sensor data");
+            
+            // Subscribers may have missed deltas while we were away
+            s_force_full = true;
+            s_connect_wake = true;
+            
+            // Wake the publish task: publish live data now, then replay any backlog
+            if (s_publish_task_handle != NULL) {
+                xTaskNotifyGive(s_publish_task_handle);
+            }
             break;
             
         case MQTT_EVENT_DISCONNECTED:
@@ -74,32 +189,19 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
             
         case MQTT_EVENT_PUBLISHED:
             ESP_LOGD(TAG, "Published, msg_id=%d", event->msg_id);
+            s_acked_msg_ids[s_acked_next] = event->msg_id;
+            s_acked_next = (s_acked_next + 1) % MQTT_ACKED_HISTORY;
             break;
             
         case MQTT_EVENT_DATA:
             ESP_LOGI(TAG, "Received message on topic: %.*s", event->topic_len, event->topic);
-            ESP_LOGI(TAG, "Data: %.*s", event->data_len, event->data);
+            APP_LOG_TRACE(TAG, event->data, event->data_len);
             
-            // Parse command (could be extended to handle different commands)
-            if (event->data_len > 0) {
-                cJSON *root = cJSON_ParseWithLength(event->data, event->data_len);
-                if (root) {
-                    cJSON *cmd = cJSON_GetObjectItem(root, "command");
-                    if (cmd && cJSON_IsString(cmd)) {
-                        ESP_LOGI(TAG, "Command received: %s", cmd->valuestring);
-                        
-                        // Handle commands here (reboot, update settings, etc.)
-                        if (strcmp(cmd->valuestring, "reboot") == 0) {
-                            ESP_LOGW(TAG, "Reboot command received, restarting in 3 seconds...");
-                            mqtt_publish_status("rebooting");
-                            vTaskDelay(pdMS_TO_TICKS(3000));
-                            esp_restart();
-                        } else if (strcmp(cmd->valuestring, "ping") == 0) {
-                            mqtt_publish_status("pong");
-                        }
-                    }
-                    cJSON_Delete(root);
-                }
+            // Hand the command to the dispatcher task; never block the MQTT event loop here
+            if (event->current_data_offset != 0 || event->data_len != event->total_data_len) {
+                ESP_LOGW(TAG, "Ignoring fragmented command message (%d bytes)", event->total_data_len);
+            } else if (event->data_len > 0) {
+                mqtt_command_submit(event->data, event->data_len);
             }
             break;
             
@@ -124,7 +226,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
  */
 float read_temperature(void) {
     float temp = 0.0f;
-    // Try to read from EZO-RTD sensor
+    // Latest EZO-RTD value from the sensor cache (no I2C)
     if (sensor_manager_read_temperature(&temp) == ESP_OK) {
         return temp;
     }
@@ -142,6 +244,7 @@ float read_soil_moisture(void) {
     float ec = 0.0f;
     // Use EC (electrical conductivity) sensor as soil moisture indicator
     // EC is often used to measure nutrient/moisture content in growing medium
+    // (served from the sensor cache, no I2C)
     if (sensor_manager_read_ec(&ec) == ESP_OK) {
         // Convert EC to approximate soil moisture percentage
         // EC typically ranges 0.5-3.0 mS/cm for soil
@@ -162,8 +265,8 @@ float read_light_level(void) {
 
 float read_battery_level(void) {
     float battery = 0.0f;
-    // Read from MAX17048 battery monitor
-    if (sensor_manager_read_battery_percentage(&battery) == ESP_OK) {
+    // Last MAX17048 reading from the sensor cache (no I2C)
+    if (sensor_manager_get_cached_battery(&battery, NULL) == ESP_OK) {
         return battery;
     }
     // Return 0 if sensor not available (don't send fake data)
@@ -171,97 +274,719 @@ float read_battery_level(void) {
 }
 
 /**
- * @brief MQTT publish task - reads from sensor_manager cache and publishes to MQTT
+ * @brief Whether any channel of a sensor moved past its deadband or rate limit
  */
-static void mqtt_publish_task(void *arg)
+static bool mqtt_sensor_changed(const cached_sensor_t *cur, const cached_sensor_t *last,
+                                const cached_sensor_t *prev)
 {
-    ESP_LOGI(TAG, "MQTT publish task started (interval: %lu seconds)", s_publish_interval_sec);
+    const mqtt_deadband_t *db = &s_deadbands[cur->kind < SENSOR_KIND_COUNT ? cur->kind : SENSOR_KIND_UNKNOWN];
+    float deadband = db->deadband;
+    float rate_per_min = db->rate_per_min;
+    
+    bool have_rate = rate_per_min > 0.0f && prev->valid && cur->timestamp_us > prev->timestamp_us &&
+                     prev->value_count == cur->value_count && prev->kind == cur->kind &&
+                     prev->address == cur->address;
+    float minutes = have_rate ? (float)(cur->timestamp_us - prev->timestamp_us) / 60e6f : 0.0f;
+    
+    for (uint8_t j = 0; j < cur->value_count && j < MAX_SENSOR_VALUES; j++) {
+        float moved = fabsf(cur->values[j] - last->values[j]);
+        if (moved > deadband || (deadband == 0.0f && moved > 0.0f)) {
+            return true;
+        }
+        if (have_rate && fabsf(cur->values[j] - prev->values[j]) / minutes >= rate_per_min) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decide what to report for a snapshot
+ *
+ * Compares against the last reported values and the previous sample. On
+ * MQTT_CHANGE_DELTA, s_delta holds only the changed sensors.
+ */
+static mqtt_change_t mqtt_check_changes(const sensor_cache_t *cache)
+{
+    if (!s_change_publishing) {
+        return MQTT_CHANGE_FULL;
+    }
     
-    while (1) {
-        // Only publish if connected to MQTT broker
-        if (s_mqtt_state != MQTT_STATE_CONNECTED) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            continue;
+    int64_t now = esp_timer_get_time();
+    bool full = s_force_full || s_last_full_us == 0 ||
+                (s_heartbeat_sec > 0 && now - s_last_full_us >= (int64_t)s_heartbeat_sec * 1000000) ||
+                cache->sensor_count != s_last_reported.sensor_count;
+    bool any = false;
+    
+    s_delta = *cache;
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        const cached_sensor_t *cur = &cache->sensors[i];
+        const cached_sensor_t *last = &s_last_reported.sensors[i];
+        
+        // A delta cannot say "sensor went away", so layout changes go out in full
+        if (cur->valid != last->valid || cur->kind != last->kind || cur->address != last->address ||
+            (cur->valid && cur->value_count != last->value_count)) {
+            full = true;
         }
         
-        // Skip publishing if sensor reading is in progress
-        if (sensor_manager_is_reading_in_progress()) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
+        bool changed = cur->valid && mqtt_sensor_changed(cur, last, &s_prev_sample.sensors[i]);
+        s_delta.sensors[i].valid = changed;
+        any |= changed;
+    }
+    s_delta.battery_valid = cache->battery_valid &&
+                            (!s_last_reported.battery_valid ||
+                             fabsf(cache->battery_percentage - s_last_reported.battery_percentage) >= MQTT_BATTERY_DEADBAND);
+    any |= s_delta.battery_valid;
+    s_prev_sample = *cache;
+    
+    if (full) {
+        s_last_reported = *cache;
+        s_last_full_us = now;
+        s_force_full = false;
+        return MQTT_CHANGE_FULL;
+    }
+    if (!any) {
+        return MQTT_CHANGE_NONE;
+    }
+    
+    // Move the reference only for what is actually reported, so slow drift still accumulates
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        if (s_delta.sensors[i].valid) {
+            s_last_reported.sensors[i] = cache->sensors[i];
+        }
+    }
+    if (s_delta.battery_valid) {
+        s_last_reported.battery_valid = true;
+        s_last_reported.battery_percentage = cache->battery_percentage;
+    }
+    return MQTT_CHANGE_DELTA;
+}
+
+/**
+ * @brief Publish one snapshot live in the selected encoding(s)
+ *
+ * @param full false for a change-only snapshot (adds "full":false)
+ */
+static void mqtt_publish_snapshot(const sensor_cache_t *cache, bool full)
+{
+    mqtt_encoding_t encoding = s_encoding;
+    
+    if (encoding != MQTT_ENCODING_CBOR) {
+        // Format straight into the static payload buffer (no heap allocation)
+        int64_t build_start_us = esp_timer_get_time();
+        int len = full ? telemetry_format_data(s_payload_buf, sizeof(s_payload_buf), s_device_id, cache) :
+                         telemetry_format_delta(s_payload_buf, sizeof(s_payload_buf), s_device_id, cache);
+        metrics_record_since(METRIC_HIST_MQTT_BUILD, build_start_us);
+        if (len > 0) {
+            APP_LOG_TRACE(TAG, s_payload_buf, len);
+            
+            char topic[128];
+            snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data", s_device_id);
+            
+            int msg_id = mqtt_publish_timed(topic, s_payload_buf, len, 1, 0);
+            if (msg_id >= 0) {
+                ESP_LOGD(TAG, "✓ MQTT data published (%d bytes)", len);
+            }
+        } else {
+            ESP_LOGE(TAG, "Telemetry payload exceeds %u bytes", (unsigned)sizeof(s_payload_buf));
+        }
+    }
+    
+    if (encoding != MQTT_ENCODING_JSON) {
+        // Fixed-width floats: no text formatting, no repeated keys
+        int len = full ? telemetry_encode_cbor(s_cbor_buf, sizeof(s_cbor_buf), (uint32_t)time(NULL), cache) :
+                         telemetry_encode_cbor_delta(s_cbor_buf, sizeof(s_cbor_buf), (uint32_t)time(NULL), cache);
+        if (len > 0) {
+            char topic[128];
+            snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data/cbor", s_device_id);
+            
+            int msg_id = mqtt_publish_timed(topic, (const char *)s_cbor_buf, len, 1, 0);
+            if (msg_id >= 0) {
+                ESP_LOGD(TAG, "✓ MQTT CBOR data published (%d bytes)", len);
+            }
+        } else {
+            ESP_LOGE(TAG, "CBOR payload exceeds %u bytes", (unsigned)sizeof(s_cbor_buf));
+        }
+    }
+}
+
+/**
+ * @brief Unix time at which a snapshot was taken
+ */
+static uint32_t mqtt_snapshot_time(const sensor_cache_t *cache)
+{
+    int64_t age_sec = (esp_timer_get_time() - (int64_t)cache->timestamp_us) / 1000000;
+    return (uint32_t)(time(NULL) - age_sec);
+}
+
+/**
+ * @brief Publish samples [start, start + count) as one batch message per encoding
+ *
+ * @return Number of samples published (fewer than count if the payload would not fit)
+ */
+static uint8_t mqtt_publish_batch_chunk(uint8_t start, uint8_t count)
+{
+    mqtt_encoding_t encoding = s_encoding;
+    const sensor_cache_t *samples = &s_batch[start];
+    uint32_t base_ts = mqtt_snapshot_time(&samples[0]);
+    char topic[128];
+    
+    // Halve the chunk until the larger (JSON) payload fits
+    int json_len = -1;
+    int cbor_len = -1;
+    while (count > 0) {
+        if (encoding != MQTT_ENCODING_CBOR) {
+            int64_t build_start_us = esp_timer_get_time();
+            json_len = telemetry_format_batch(s_batch_buf, sizeof(s_batch_buf), s_device_id, base_ts, samples, count);
+            metrics_record_since(METRIC_HIST_MQTT_BUILD, build_start_us);
+        }
+        if (encoding != MQTT_ENCODING_JSON) {
+            cbor_len = telemetry_encode_cbor_batch(s_batch_cbor_buf, sizeof(s_batch_cbor_buf), base_ts, samples, count);
+        }
+        if ((encoding == MQTT_ENCODING_CBOR || json_len > 0) && (encoding == MQTT_ENCODING_JSON || cbor_len > 0)) {
+            break;
+        }
+        count /= 2;
+    }
+    if (count == 0) {
+        ESP_LOGE(TAG, "Batch payload does not fit even for one sample");
+        return 0;
+    }
+    
+    if (encoding != MQTT_ENCODING_CBOR) {
+        snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data/batch", s_device_id);
+        mqtt_publish_timed(topic, s_batch_buf, json_len, 1, 0);
+    }
+    if (encoding != MQTT_ENCODING_JSON) {
+        snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data/batch/cbor", s_device_id);
+        mqtt_publish_timed(topic, (const char *)s_batch_cbor_buf, cbor_len, 1, 0);
+    }
+    if (encoding != MQTT_ENCODING_CBOR) {
+        APP_LOG_TRACE(TAG, s_batch_buf, json_len);
+    }
+    APP_LOGI_RATE_LIMITED(TAG, 60000, "✓ MQTT batch published (%u samples, json %d / cbor %d bytes)",
+                          count, json_len, cbor_len);
+    return count;
+}
+
+static void mqtt_publish_batch(void)
+{
+    uint8_t start = 0;
+    while (start < s_batch_count) {
+        uint8_t sent = mqtt_publish_batch_chunk(start, s_batch_count - start);
+        if (sent == 0) {
+            break;
+        }
+        start += sent;
+    }
+    s_batch_count = 0;
+}
+
+/**
+ * @brief Add a new snapshot to the batch and publish it when full or old enough
+ */
+static void mqtt_batch_snapshot(const sensor_cache_t *cache)
+{
+    if (cache->timestamp_us == s_last_batched_us) {
+        return;
+    }
+    s_last_batched_us = cache->timestamp_us;
+    
+    uint8_t max_samples = s_batch_max_samples;
+    if (max_samples > MQTT_BATCH_MAX_SAMPLES) {
+        max_samples = MQTT_BATCH_MAX_SAMPLES;
+    }
+    s_batch[s_batch_count++] = *cache;
+    
+    uint64_t age_us = cache->timestamp_us - s_batch[0].timestamp_us;
+    if (s_batch_count >= max_samples ||
+        (s_batch_max_age_sec > 0 && age_us >= (uint64_t)s_batch_max_age_sec * 1000000)) {
+        mqtt_publish_batch();
+    }
+}
+
+/**
+ * @brief Store a snapshot in the offline buffer (once per sensor sweep)
+ */
+static void mqtt_buffer_snapshot(const sensor_cache_t *cache)
+{
+    if (!s_buffer_ready || cache->timestamp_us == s_last_buffered_us) {
+        return;
+    }
+    
+    // Stamp with the time the sweep finished, not the time it was stored
+    if (telemetry_buffer_append(cache, mqtt_snapshot_time(cache)) == ESP_OK) {
+        s_last_buffered_us = cache->timestamp_us;
+        APP_LOGI_RATE_LIMITED(TAG, 60000, "Offline: buffered snapshot (%lu pending)",
+                              (unsigned long)telemetry_buffer_pending());
+    }
+}
+
+static bool mqtt_msg_acked(int msg_id)
+{
+    for (int i = 0; i < MQTT_ACKED_HISTORY; i++) {
+        if (s_acked_msg_ids[i] == msg_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Send the next backlog message once the previous one is acknowledged
+ *
+ * Records are consumed only after the broker's PUBACK, so a drop mid-replay
+ * resends them (at-least-once; the backend deduplicates on "ts").
+ *
+ * Publishes to: kannacloud/sensor/{device_id}/data/backlog
+ * {"device_id":"...","records":[{"ts":..,"sensors":{...},"battery":..,"rssi":..},...]}
+ */
+static void mqtt_replay_step(void)
+{
+    int64_t now = esp_timer_get_time();
+    
+    if (s_replay_msg_id >= 0) {
+        if (mqtt_msg_acked(s_replay_msg_id)) {
+            telemetry_buffer_consume(s_replay_count);
+            APP_LOGI_RATE_LIMITED(TAG, 10000, "Backlog: %lu records delivered, %lu pending",
+                                  (unsigned long)s_replay_count, (unsigned long)telemetry_buffer_pending());
+            s_replay_msg_id = -1;
+        } else if (now - s_replay_sent_us > MQTT_REPLAY_ACK_TIMEOUT_US) {
+            ESP_LOGW(TAG, "Backlog message %d not acknowledged, resending", s_replay_msg_id);
+            s_replay_msg_id = -1;
+        } else {
+            return;
+        }
+    }
+    
+    json_writer_t w;
+    // Keep room for the closing "]}" while records are added
+    json_writer_init(&w, s_replay_buf, sizeof(s_replay_buf) - 4);
+    json_begin_object(&w, NULL);
+    json_add_string(&w, "device_id", s_device_id);
+    json_begin_array(&w, "records");
+    
+    uint32_t count = 0;
+    sensor_cache_t record;
+    uint32_t timestamp;
+    while (count < MQTT_REPLAY_MAX_RECORDS) {
+        esp_err_t ret = telemetry_buffer_peek(count, &record, &timestamp);
+        if (ret == ESP_ERR_INVALID_CRC && count == 0) {
+            // Torn write from a power loss: skip it
+            telemetry_buffer_consume(1);
             continue;
         }
+        if (ret != ESP_OK) {
+            break;
+        }
+        
+        json_writer_t mark = w;
+        telemetry_format_record(&w, "ts", timestamp, &record);
+        if (w.overflow) {
+            w = mark;
+            break;
+        }
+        count++;
+    }
+    
+    if (count == 0) {
+        return;
+    }
+    
+    w.size = sizeof(s_replay_buf);
+    json_end_array(&w);
+    json_end_object(&w);
+    if (json_writer_finish(&w) == NULL) {
+        return;
+    }
+    
+    char topic[128];
+    snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data/backlog", s_device_id);
+    
+    int msg_id = mqtt_publish_timed(topic, s_replay_buf, (int)w.len, 1, 0);
+    if (msg_id >= 0) {
+        s_replay_msg_id = msg_id;
+        s_replay_count = count;
+        s_replay_sent_us = now;
+        ESP_LOGD(TAG, "Backlog: sent %lu records (msg_id=%d)", (unsigned long)count, msg_id);
+    }
+}
+
+/**
+ * @brief Wait until the next live publish, replaying backlog in the gaps
+ *
+ * Returns early when the connection comes back so live data goes out first,
+ * or, with until_snapshot, as soon as the sensor task publishes a new snapshot.
+ *
+ * @return true if woken by an event, false if wait_ms elapsed
+ */
+static bool mqtt_wait_and_replay(uint32_t wait_ms, bool until_snapshot)
+{
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)wait_ms * 1000;
+    
+    while (1) {
+        if (s_connect_wake || (until_snapshot && s_snapshot_ready)) {
+            s_connect_wake = false;
+            return true;
+        }
+        
+        int64_t now = esp_timer_get_time();
+        if (now >= deadline_us) {
+            return false;
+        }
+        uint32_t remaining_ms = (uint32_t)((deadline_us - now) / 1000);
+        
+        if (s_mqtt_state == MQTT_STATE_CONNECTED && s_buffer_ready &&
+            (telemetry_buffer_pending() > 0 || s_replay_msg_id >= 0)) {
+            mqtt_replay_step();
+            if (remaining_ms > MQTT_REPLAY_INTERVAL_MS) {
+                remaining_ms = MQTT_REPLAY_INTERVAL_MS;
+            }
+        }
         
-        // Get cached sensor data from sensor_manager (non-blocking)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining_ms));
+    }
+}
+
+/**
+ * @brief sensor_manager update callback (runs in the sensor reading task)
+ */
+static void mqtt_on_sensor_update(void)
+{
+    s_snapshot_ready = true;
+    if (s_publish_task_handle != NULL) {
+        xTaskNotifyGive(s_publish_task_handle);
+    }
+}
+
+/**
+ * @brief Publish the device metrics report to devices/<id>/metrics
+ */
+static void mqtt_publish_metrics(void)
+{
+    char *json = mem_policy_pool_alloc(METRICS_JSON_MAX_LEN);
+    if (json == NULL) {
+        ESP_LOGW(TAG, "No memory for metrics report");
+        return;
+    }
+    
+    int len = metrics_format_json(json, METRICS_JSON_MAX_LEN);
+    if (len > 0) {
+        char topic[128];
+        snprintf(topic, sizeof(topic), "devices/%s/metrics", s_device_id);
+        mqtt_publish_timed(topic, json, len, 0, 0);
+    } else {
+        ESP_LOGE(TAG, "Metrics report exceeds %u bytes", (unsigned)METRICS_JSON_MAX_LEN);
+    }
+    mem_policy_pool_free(json);
+}
+
+/**
+ * @brief MQTT publish task - reads from sensor_manager cache and publishes to MQTT
+ *
+ * Event driven: the task blocks until a new snapshot arrives or the broker
+ * reconnects, and publishes at most once per interval, right after a sensor
+ * sweep so the radio and CPU wake together. While disconnected, snapshots go
+ * to the flash ring buffer instead and are replayed in rate-limited batches
+ * between live publishes after reconnecting. While connected, the device
+ * metrics report goes out every MQTT_METRICS_INTERVAL_SEC.
+ */
+static void mqtt_publish_task(void *arg)
+{
+    ESP_LOGI(TAG, "MQTT publish task started (interval: %lu seconds)", s_publish_interval_sec);
+    
+    uint64_t last_live_us = 0;      // Snapshot timestamp last handled
+    
+    while (1) {
+        // Get latest complete snapshot from sensor_manager (lock-free, never waits on I2C)
         sensor_cache_t cache;
+        s_snapshot_ready = false;
         if (sensor_manager_get_cached_data(&cache) != ESP_OK) {
             ESP_LOGW(TAG, "No cached sensor data available yet");
-            vTaskDelay(pdMS_TO_TICKS(1000));
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);    // Woken by the first sweep
             continue;
         }
         
-        // Create JSON from cached data
-        cJSON *root = cJSON_CreateObject();
-        if (root == NULL) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            continue;
+        if (cache.timestamp_us == last_live_us && !s_connect_wake) {
+            // Nothing new yet: wait for the next sweep, but never longer than one interval
+            if (mqtt_wait_and_replay(s_publish_interval_sec * 1000, true)) {
+                continue;
+            }
         }
+        s_connect_wake = false;
+        last_live_us = cache.timestamp_us;
         
-        cJSON_AddStringToObject(root, "device_id", s_device_id);
-        
-        // Add sensors
-        cJSON *sensors = cJSON_CreateObject();
-        for (uint8_t i = 0; i < cache.sensor_count && i < 8; i++) {
-            cached_sensor_t *sensor = &cache.sensors[i];
-            if (!sensor->valid) continue;
-            
-            if (sensor->value_count == 1) {
-                cJSON_AddNumberToObject(sensors, sensor->sensor_type, sensor->values[0]);
-            } else if (sensor->value_count > 1) {
-                cJSON *sensor_obj = cJSON_CreateObject();
-                if (strcmp(sensor->sensor_type, "HUM") == 0) {
-                    if (sensor->value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "humidity", sensor->values[0]);
-                    if (sensor->value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "air_temp", sensor->values[1]);
-                    if (sensor->value_count >= 3) cJSON_AddNumberToObject(sensor_obj, "dew_point", sensor->values[2]);
-                } else if (strcmp(sensor->sensor_type, "EC") == 0) {
-                    if (sensor->value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "conductivity", sensor->values[0]);
-                    if (sensor->value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "tds", sensor->values[1]);
-                    if (sensor->value_count >= 3) cJSON_AddNumberToObject(sensor_obj, "salinity", sensor->values[2]);
-                } else if (strcmp(sensor->sensor_type, "DO") == 0) {
-                    if (sensor->value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "dissolved_oxygen", sensor->values[0]);
-                    if (sensor->value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "saturation", sensor->values[1]);
+        if (s_mqtt_state == MQTT_STATE_CONNECTED) {
+            mqtt_change_t change = mqtt_check_changes(&cache);
+            if (s_batch_max_samples > 1) {
+                // Batches carry whole samples; unchanged ones are left out
+                if (change != MQTT_CHANGE_NONE) {
+                    mqtt_batch_snapshot(&cache);
+                }
+            } else {
+                if (s_batch_count > 0) {
+                    mqtt_publish_batch();   // Batching was just turned off
+                }
+                if (change == MQTT_CHANGE_FULL) {
+                    mqtt_publish_snapshot(&cache, true);
+                } else if (change == MQTT_CHANGE_DELTA) {
+                    mqtt_publish_snapshot(&s_delta, false);
+                } else {
+                    ESP_LOGD(TAG, "All values within deadband, nothing to publish");
                 }
-                cJSON_AddItemToObject(sensors, sensor->sensor_type, sensor_obj);
             }
+        } else if (s_buffer_ready) {
+            // Keep a half-collected batch: move it to flash with the new snapshot
+            for (uint8_t i = 0; i < s_batch_count; i++) {
+                mqtt_buffer_snapshot(&s_batch[i]);
+            }
+            s_batch_count = 0;
+            if (mqtt_check_changes(&cache) != MQTT_CHANGE_NONE) {
+                mqtt_buffer_snapshot(&cache);
+            }
+        } else {
+            // Nowhere to put the data: sleep until the broker connection is back
+            while (s_mqtt_state != MQTT_STATE_CONNECTED) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+            continue;
         }
-        cJSON_AddItemToObject(root, "sensors", sensors);
         
-        // Add battery
-        if (cache.battery_valid) {
-            cJSON_AddNumberToObject(root, "battery", cache.battery_percentage);
+        if (s_mqtt_state == MQTT_STATE_CONNECTED &&
+            esp_timer_get_time() - s_last_metrics_us >= (int64_t)MQTT_METRICS_INTERVAL_SEC * 1000000) {
+            s_last_metrics_us = esp_timer_get_time();
+            mqtt_publish_metrics();
         }
         
-        // Add RSSI
-        cJSON_AddNumberToObject(root, "rssi", cache.rssi);
-        
-        // Serialize and publish
-        char *json_str = cJSON_PrintUnformatted(root);
-        cJSON_Delete(root);
-        
-        if (json_str != NULL) {
-            ESP_LOGI(TAG, "Publishing JSON: %s", json_str);
-            
-            char topic[128];
-            snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data", s_device_id);
-            
-            int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, json_str, 0, 1, 0);
-            if (msg_id >= 0) {
-                ESP_LOGI(TAG, "✓ MQTT data published successfully");
-            }
-            free(json_str);
+        // Hold the publish spacing (backlog replay uses the gap)
+        mqtt_wait_and_replay(s_publish_interval_sec * 1000, false);
+    }
+}
+
+/**
+ * @brief Restart after the reboot reply has had time to go out
+ */
+static void mqtt_reboot_timer_cb(void *arg)
+{
+    esp_restart();
+}
+
+/**
+ * @brief {"command":"reboot"}
+ */
+static esp_err_t mqtt_cmd_reboot(const cJSON *request, cJSON *reply)
+{
+    static esp_timer_handle_t s_reboot_timer = NULL;
+    
+    if (s_reboot_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = mqtt_reboot_timer_cb,
+            .name = "mqtt_reboot",
+        };
+        esp_err_t ret = esp_timer_create(&timer_args, &s_reboot_timer);
+        if (ret != ESP_OK) {
+            return ret;
         }
-        
-        // Wait for next publish cycle
-        vTaskDelay(pdMS_TO_TICKS(s_publish_interval_sec * 1000));
     }
+    
+    ESP_LOGW(TAG, "Reboot command received, restarting in %d ms...", MQTT_REBOOT_DELAY_MS);
+    mqtt_publish_status("rebooting");
+    esp_timer_stop(s_reboot_timer);
+    return esp_timer_start_once(s_reboot_timer, (uint64_t)MQTT_REBOOT_DELAY_MS * 1000);
+}
+
+/**
+ * @brief {"command":"ping"}
+ */
+static esp_err_t mqtt_cmd_ping(const cJSON *request, cJSON *reply)
+{
+    mqtt_publish_status("pong");
+    return ESP_OK;
+}
+
+/**
+ * @brief {"command":"set_interval","interval":30}
+ */
+static esp_err_t mqtt_cmd_set_interval(const cJSON *request, cJSON *reply)
+{
+    cJSON *interval = cJSON_GetObjectItem(request, "interval");
+    if (!interval || !cJSON_IsNumber(interval) || interval->valueint <= 0) {
+        cJSON_AddStringToObject(reply, "error", "interval must be a positive number of seconds");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return mqtt_set_telemetry_interval((uint32_t)interval->valueint);
+}
+
+/**
+ * @brief {"command":"set_period","address":99,"period":30,"priority":1}
+ */
+static esp_err_t mqtt_cmd_set_period(const cJSON *request, cJSON *reply)
+{
+    cJSON *address = cJSON_GetObjectItem(request, "address");
+    int index = (address && cJSON_IsNumber(address)) ?
+                sensor_manager_get_ezo_index((uint8_t)address->valueint) : -1;
+    sensor_schedule_t schedule;
+    if (index < 0 || sensor_manager_get_sensor_schedule(index, &schedule) != ESP_OK) {
+        ESP_LOGW(TAG, "set_period: unknown sensor address");
+        cJSON_AddStringToObject(reply, "error", "unknown sensor address");
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    cJSON *period = cJSON_GetObjectItem(request, "period");
+    cJSON *phase = cJSON_GetObjectItem(request, "phase_ms");
+    cJSON *priority = cJSON_GetObjectItem(request, "priority");
+    if (period && cJSON_IsNumber(period) && period->valueint >= 0) {
+        schedule.period_sec = (uint32_t)period->valueint;
+    }
+    if (phase && cJSON_IsNumber(phase) && phase->valueint >= 0) {
+        schedule.phase_ms = (uint32_t)phase->valueint;
+    }
+    if (priority && cJSON_IsNumber(priority) && priority->valueint >= 0) {
+        schedule.priority = (uint8_t)priority->valueint;
+    }
+    return sensor_manager_set_sensor_schedule(index, &schedule);
+}
+
+/**
+ * @brief {"command":"set_encoding","encoding":"cbor"}
+ */
+static esp_err_t mqtt_cmd_set_encoding(const cJSON *request, cJSON *reply)
+{
+    cJSON *name = cJSON_GetObjectItem(request, "encoding");
+    mqtt_encoding_t encoding;
+    if (!name || !cJSON_IsString(name) ||
+        mqtt_parse_telemetry_encoding(name->valuestring, &encoding) != ESP_OK) {
+        ESP_LOGW(TAG, "set_encoding: expected \"json\", \"cbor\" or \"both\"");
+        cJSON_AddStringToObject(reply, "error", "encoding must be \"json\", \"cbor\" or \"both\"");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return mqtt_set_telemetry_encoding(encoding);
+}
+
+/**
+ * @brief {"command":"set_batching","samples":15,"max_age":30}
+ */
+static esp_err_t mqtt_cmd_set_batching(const cJSON *request, cJSON *reply)
+{
+    cJSON *samples = cJSON_GetObjectItem(request, "samples");
+    cJSON *max_age = cJSON_GetObjectItem(request, "max_age");
+    if (!samples || !cJSON_IsNumber(samples) || samples->valueint < 0 ||
+        samples->valueint > MQTT_BATCH_MAX_SAMPLES) {
+        ESP_LOGW(TAG, "set_batching: samples must be 0-%d", MQTT_BATCH_MAX_SAMPLES);
+        cJSON_AddStringToObject(reply, "error", "samples out of range");
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t age = (max_age && cJSON_IsNumber(max_age) && max_age->valueint > 0) ?
+                   (uint32_t)max_age->valueint : 0;
+    return mqtt_set_batching((uint8_t)samples->valueint, age);
+}
+
+/**
+ * @brief {"command":"set_change_publishing","enabled":true,"heartbeat":300}
+ */
+static esp_err_t mqtt_cmd_set_change_publishing(const cJSON *request, cJSON *reply)
+{
+    cJSON *enabled = cJSON_GetObjectItem(request, "enabled");
+    cJSON *heartbeat = cJSON_GetObjectItem(request, "heartbeat");
+    uint32_t heartbeat_sec = s_heartbeat_sec;
+    if (heartbeat && cJSON_IsNumber(heartbeat) && heartbeat->valueint >= 0) {
+        heartbeat_sec = (uint32_t)heartbeat->valueint;
+    }
+    if (!enabled || !cJSON_IsBool(enabled)) {
+        ESP_LOGW(TAG, "set_change_publishing: missing \"enabled\"");
+        cJSON_AddStringToObject(reply, "error", "missing \"enabled\"");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return mqtt_set_change_publishing(cJSON_IsTrue(enabled), heartbeat_sec);
+}
+
+/**
+ * @brief {"command":"set_deadband","type":"pH","deadband":0.02,"rate":0.1}
+ */
+static esp_err_t mqtt_cmd_set_deadband(const cJSON *request, cJSON *reply)
+{
+    cJSON *type = cJSON_GetObjectItem(request, "type");
+    cJSON *deadband = cJSON_GetObjectItem(request, "deadband");
+    cJSON *rate = cJSON_GetObjectItem(request, "rate");
+    if (!type || !cJSON_IsString(type) || !deadband || !cJSON_IsNumber(deadband)) {
+        ESP_LOGW(TAG, "set_deadband: missing \"type\" or \"deadband\"");
+        cJSON_AddStringToObject(reply, "error", "missing \"type\" or \"deadband\"");
+        return ESP_ERR_INVALID_ARG;
+    }
+    float rate_value = (rate && cJSON_IsNumber(rate)) ? (float)rate->valuedouble : 0.0f;
+    esp_err_t ret = mqtt_set_deadband(type->valuestring, (float)deadband->valuedouble, rate_value);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "set_deadband: invalid type or threshold");
+    }
+    return ret;
+}
+
+/**
+ * @brief {"command":"read_now","sensors":["pH","EC_2"]}
+ *
+ * Omitting "sensors" reads them all. The reply carries the fresh values and
+ * the next report is a full snapshot.
+ */
+static esp_err_t mqtt_cmd_read_now(const cJSON *request, cJSON *reply)
+{
+    uint32_t mask = SENSOR_READ_ALL;
+    cJSON *sensors = cJSON_GetObjectItem(request, "sensors");
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, sensors) {
+        int index = cJSON_IsString(item) ? sensor_manager_find_by_key(item->valuestring) : -1;
+        if (index < 0) {
+            cJSON_AddStringToObject(reply, "error", "unknown sensor");
+            return ESP_ERR_NOT_FOUND;
+        }
+        mask |= 1u << index;
+    }
+    
+    // Subscribers of .../data get every sensor, not just the ones that moved
+    s_force_full = true;
+    
+    sensor_cache_t cache;
+    esp_err_t ret = sensor_manager_read_now(mask, &cache, SENSOR_READ_TIMEOUT_MS);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_RESPONSE) {
+        return ret;
+    }
+    
+    cJSON_AddBoolToObject(reply, "fresh", ret == ESP_OK);   // false: some sensors kept old values
+    cJSON *values = cJSON_AddObjectToObject(reply, "values");
+    for (uint8_t i = 0; i < cache.sensor_count; i++) {
+        const cached_sensor_t *sensor = &cache.sensors[i];
+        if (!sensor->valid || (mask != SENSOR_READ_ALL && !(mask & (1u << i)))) {
+            continue;
+        }
+        char key[EZO_MAX_SENSOR_TYPE + 4];
+        telemetry_format_sensor_key(key, sizeof(key), i, sensor);
+        cJSON_AddItemToObject(values, key, cJSON_CreateFloatArray(sensor->values, sensor->value_count));
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Start the command dispatcher and register the built-in commands
+ */
+static esp_err_t mqtt_commands_init(void)
+{
+    char response_topic[128];
+    snprintf(response_topic, sizeof(response_topic), "kannacloud/sensor/%s/cmd/response", s_device_id);
+    
+    esp_err_t ret = mqtt_command_init(response_topic);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    mqtt_command_register("reboot", mqtt_cmd_reboot);
+    mqtt_command_register("ping", mqtt_cmd_ping);
+    mqtt_command_register("set_interval", mqtt_cmd_set_interval);
+    mqtt_command_register("read_now", mqtt_cmd_read_now);
+    mqtt_command_register("set_period", mqtt_cmd_set_period);
+    mqtt_command_register("set_encoding", mqtt_cmd_set_encoding);
+    mqtt_command_register("set_batching", mqtt_cmd_set_batching);
+    mqtt_command_register("set_change_publishing", mqtt_cmd_set_change_publishing);
+    mqtt_command_register("set_deadband", mqtt_cmd_set_deadband);
+    return ESP_OK;
 }
 
 esp_err_t mqtt_client_init(const char *broker_uri, const char *username, const char *password)
@@ -274,6 +999,43 @@ esp_err_t mqtt_client_init(const char *broker_uri, const char *username, const c
     // Get device ID from cloud provisioning
     cloud_prov_get_device_id(s_device_id, sizeof(s_device_id));
     
+    // Restore the persisted payload encoding (JSON if never set)
+    nvs_handle_t nvs_handle;
+    if (nvs_open(MQTT_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK) {
+        uint8_t stored = MQTT_ENCODING_JSON;
+        if (nvs_get_u8(nvs_handle, MQTT_NVS_KEY_ENCODING, &stored) == ESP_OK && stored <= MQTT_ENCODING_BOTH) {
+            s_encoding = (mqtt_encoding_t)stored;
+        }
+        uint8_t batch_n = 0;
+        uint32_t batch_age = 0;
+        if (nvs_get_u8(nvs_handle, MQTT_NVS_KEY_BATCH_N, &batch_n) == ESP_OK && batch_n <= MQTT_BATCH_MAX_SAMPLES) {
+            s_batch_max_samples = batch_n;
+        }
+        if (nvs_get_u32(nvs_handle, MQTT_NVS_KEY_BATCH_AGE, &batch_age) == ESP_OK) {
+            s_batch_max_age_sec = batch_age;
+        }
+        uint8_t change_pub = 0;
+        if (nvs_get_u8(nvs_handle, MQTT_NVS_KEY_CHANGE_PUB, &change_pub) == ESP_OK) {
+            s_change_publishing = (change_pub != 0);
+        }
+        nvs_get_u32(nvs_handle, MQTT_NVS_KEY_HEARTBEAT, &s_heartbeat_sec);
+        nvs_close(nvs_handle);
+    }
+    ESP_LOGI(TAG, "Telemetry encoding: %s, batching: %u samples / %lu s", mqtt_telemetry_encoding_name(s_encoding),
+             s_batch_max_samples, s_batch_max_age_sec);
+    ESP_LOGI(TAG, "Change-driven publishing: %s (heartbeat %lu s)", s_change_publishing ? "on" : "off",
+             s_heartbeat_sec);
+    
+    // Offline buffering is optional: a missing partition just disables it
+    s_buffer_ready = (telemetry_buffer_init() == ESP_OK);
+    
+    // Commands run on their own task so they never block MQTT event processing
+    esp_err_t cmd_ret = mqtt_commands_init();
+    if (cmd_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start command dispatcher: %s", esp_err_to_name(cmd_ret));
+        return cmd_ret;
+    }
+    
     ESP_LOGI(TAG, "Initializing MQTT client");
     ESP_LOGI(TAG, "Broker URI: %s", broker_uri);
     ESP_LOGI(TAG, "Device ID: %s", s_device_id);
@@ -302,9 +1064,13 @@ esp_err_t mqtt_client_init(const char *broker_uri, const char *username, const c
     if (is_secure) {
         ESP_LOGI(TAG, "Configuring MQTTS with TLS encryption");
         
-        // Load CA certificate from NVS into static buffer
+        // Load CA certificate from NVS; the buffer must outlive the client
+        if (s_mqtt_ca_cert == NULL) {
+            s_mqtt_ca_cert = mem_policy_alloc_large(CLOUD_PROV_MAX_CERT_SIZE);
+        }
         size_t ca_cert_len = 0;
-        esp_err_t ret = cloud_prov_get_mqtt_ca_cert(s_mqtt_ca_cert, &ca_cert_len);
+        esp_err_t ret = (s_mqtt_ca_cert != NULL) ? cloud_prov_get_mqtt_ca_cert(s_mqtt_ca_cert, &ca_cert_len)
+                                                 : ESP_ERR_NO_MEM;
         
         if (ret == ESP_OK && ca_cert_len > 0) {
             ESP_LOGI(TAG, "Loaded CA certificate for MQTTS (%zu bytes)", ca_cert_len);
@@ -382,7 +1148,7 @@ esp_err_t mqtt_client_start(void)
         BaseType_t task_ret = xTaskCreatePinnedToCore(
             mqtt_publish_task,
             "mqtt_publish",
-            4096,
+            6144,  // Two sensor_cache_t snapshots on the stack during replay
             NULL,
             5,
             &s_publish_task_handle,
@@ -394,6 +1160,7 @@ esp_err_t mqtt_client_start(void)
             return ESP_FAIL;
         }
         
+        sensor_manager_add_update_callback(mqtt_on_sensor_update);
         ESP_LOGI(TAG, "✓ MQTT publish task started (publish interval: %lu seconds)", s_publish_interval_sec);
     }
     
@@ -407,6 +1174,7 @@ esp_err_t mqtt_client_stop(void)
     }
     
     // Stop MQTT publish task
+    sensor_manager_remove_update_callback(mqtt_on_sensor_update);
     if (s_publish_task_handle != NULL) {
         vTaskDelete(s_publish_task_handle);
         s_publish_task_handle = NULL;
@@ -491,7 +1259,7 @@ esp_err_t mqtt_publish_telemetry(const telemetry_data_t *data)
     char topic[128];
     snprintf(topic, sizeof(topic), "devices/%s/telemetry", s_device_id);
     
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, json_str, 0, 1, 0);
+    int msg_id = mqtt_publish_timed(topic, json_str, 0, 1, 0);
     free(json_str);
     
     if (msg_id < 0) {
@@ -513,114 +1281,28 @@ esp_err_t mqtt_publish_kannacloud_data(const kannacloud_data_t *data)
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Create JSON payload following KannaCloud format
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        return ESP_ERR_NO_MEM;
+    // EZO values come from the latest background sweep (no I2C, never blocks)
+    sensor_cache_t cache = {0};
+    if (sensor_manager_get_cached_data(&cache) != ESP_OK) {
+        ESP_LOGW(TAG, "No cached sensor data yet, publishing battery/RSSI only");
     }
+    cache.battery_valid = !isnan(data->battery);
+    cache.battery_percentage = data->battery;
+    cache.rssi = data->rssi;
     
-    // Add device_id (required)
-    cJSON_AddStringToObject(root, "device_id", data->device_id);
-    
-    // Add sensors object - read all EZO sensors dynamically
-    cJSON *sensors = cJSON_CreateObject();
-    if (sensors == NULL) {
-        cJSON_Delete(root);
+    int len = telemetry_format_data(s_kannacloud_buf, sizeof(s_kannacloud_buf), data->device_id, &cache);
+    if (len < 0) {
         return ESP_ERR_NO_MEM;
     }
     
-    uint8_t sensor_count = sensor_manager_get_ezo_count();
-    for (uint8_t i = 0; i < sensor_count; i++) {
-        char sensor_type[16];
-        float values[4];
-        uint8_t value_count;
-        
-        if (sensor_manager_read_ezo_sensor(i, sensor_type, values, &value_count) == ESP_OK) {
-            if (value_count == 1) {
-                // Single value sensor
-                cJSON_AddNumberToObject(sensors, sensor_type, values[0]);
-            } else if (value_count > 1) {
-                // Multi-value sensor - create object with named fields
-                cJSON *sensor_obj = cJSON_CreateObject();
-                
-                // Define field names based on sensor type
-                if (strcmp(sensor_type, "HUM") == 0) {
-                    // Get HUM sensor config to determine which parameters are enabled
-                    ezo_sensor_t *sensor = (ezo_sensor_t *)sensor_manager_get_ezo_sensor(i);
-                    if (sensor != NULL && sensor->config.hum.param_count > 0) {
-                        // Use dynamic parameter mapping based on enabled outputs
-                        for (uint8_t j = 0; j < value_count && j < sensor->config.hum.param_count; j++) {
-                            const char *param = sensor->config.hum.param_order[j];
-                            const char *field_name = NULL;
-                            
-                            if (strcmp(param, "HUM") == 0) {
-                                field_name = "humidity";
-                            } else if (strcmp(param, "T") == 0) {
-                                field_name = "air_temp";
-                            } else if (strcmp(param, "DEW") == 0) {
-                                field_name = "dew_point";
-                            }
-                            
-                            if (field_name != NULL) {
-                                cJSON_AddNumberToObject(sensor_obj, field_name, values[j]);
-                            }
-                        }
-                    } else {
-                        // Fallback if config unavailable
-                        if (value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "humidity", values[0]);
-                        if (value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "air_temp", values[1]);
-                        if (value_count >= 3) cJSON_AddNumberToObject(sensor_obj, "dew_point", values[2]);
-                    }
-                } else if (strcmp(sensor_type, "ORP") == 0) {
-                    if (value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "orp", values[0]);
-                } else if (strcmp(sensor_type, "DO") == 0) {
-                    if (value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "dissolved_oxygen", values[0]);
-                    if (value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "saturation", values[1]);
-                } else if (strcmp(sensor_type, "EC") == 0) {
-                    if (value_count >= 1) cJSON_AddNumberToObject(sensor_obj, "conductivity", values[0]);
-                    if (value_count >= 2) cJSON_AddNumberToObject(sensor_obj, "tds", values[1]);
-                    if (value_count >= 3) cJSON_AddNumberToObject(sensor_obj, "salinity", values[2]);
-                    if (value_count >= 4) cJSON_AddNumberToObject(sensor_obj, "specific_gravity", values[3]);
-                } else {
-                    // Unknown multi-value sensor - use generic field names
-                    for (uint8_t j = 0; j < value_count; j++) {
-                        char field_name[16];
-                        snprintf(field_name, sizeof(field_name), "value_%d", j);
-                        cJSON_AddNumberToObject(sensor_obj, field_name, values[j]);
-                    }
-                }
-                
-                cJSON_AddItemToObject(sensors, sensor_type, sensor_obj);
-            }
-        }
-    }
-    
-    cJSON_AddItemToObject(root, "sensors", sensors);
-    
-    // Add battery level (optional)
-    if (!isnan(data->battery)) {
-        cJSON_AddNumberToObject(root, "battery", data->battery);
-    }
-    
-    // Add RSSI
-    cJSON_AddNumberToObject(root, "rssi", data->rssi);
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
-    if (json_str == NULL) {
-        return ESP_ERR_NO_MEM;
-    }
-    
-    // Debug: Log the exact JSON being published
-    ESP_LOGI(TAG, "Publishing JSON: %s", json_str);
+    // Payload goes to the trace buffer (/api/trace), not the UART
+    APP_LOG_TRACE(TAG, s_kannacloud_buf, len);
     
     // Publish to KannaCloud topic: kannacloud/sensor/{device_id}/data
     char topic[128];
     snprintf(topic, sizeof(topic), "kannacloud/sensor/%s/data", data->device_id);
     
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, json_str, 0, 1, 0); // QoS 1
-    free(json_str);
+    int msg_id = mqtt_publish_timed(topic, s_kannacloud_buf, len, 1, 0); // QoS 1
     
     if (msg_id < 0) {
         ESP_LOGE(TAG, "Failed to publish KannaCloud data");
@@ -665,7 +1347,7 @@ esp_err_t mqtt_publish_status(const char *status)
     char topic[128];
     snprintf(topic, sizeof(topic), "devices/%s/status", s_device_id);
     
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, json_str, 0, 1, 1); // QoS 1, Retain
+    int msg_id = mqtt_publish_timed(topic, json_str, 0, 1, 1); // QoS 1, Retain
     free(json_str);
     
     if (msg_id < 0) {
@@ -687,7 +1369,7 @@ esp_err_t mqtt_publish_json(const char *topic, const char *json_data, int qos, b
         return ESP_ERR_INVALID_ARG;
     }
     
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, json_data, 0, qos, retain ? 1 : 0);
+    int msg_id = mqtt_publish_timed(topic, json_data, 0, qos, retain ? 1 : 0);
     if (msg_id < 0) {
         ESP_LOGE(TAG, "Failed to publish to %s", topic);
         return ESP_FAIL;
@@ -746,6 +1428,161 @@ esp_err_t mqtt_set_telemetry_interval(uint32_t interval_sec)
     return ESP_OK;
 }
 
+esp_err_t mqtt_set_batching(uint8_t max_samples, uint32_t max_age_sec)
+{
+    if (max_samples > MQTT_BATCH_MAX_SAMPLES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    s_batch_max_age_sec = max_age_sec;
+    s_batch_max_samples = max_samples;
+    ESP_LOGI(TAG, "Batching set to %u samples / %lu s", max_samples, max_age_sec);
+    
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(MQTT_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, MQTT_NVS_KEY_BATCH_N, max_samples);
+    if (err == ESP_OK) {
+        err = nvs_set_u32(nvs_handle, MQTT_NVS_KEY_BATCH_AGE, max_age_sec);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save batching settings: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t mqtt_set_change_publishing(bool enabled, uint32_t heartbeat_sec)
+{
+    s_heartbeat_sec = heartbeat_sec;
+    s_change_publishing = enabled;
+    s_force_full = true;
+    ESP_LOGI(TAG, "Change-driven publishing %s (heartbeat %lu s)", enabled ? "enabled" : "disabled", heartbeat_sec);
+    
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(MQTT_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, MQTT_NVS_KEY_CHANGE_PUB, enabled ? 1 : 0);
+    if (err == ESP_OK) {
+        err = nvs_set_u32(nvs_handle, MQTT_NVS_KEY_HEARTBEAT, heartbeat_sec);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save change publishing settings: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+void mqtt_get_change_publishing(bool *enabled, uint32_t *heartbeat_sec)
+{
+    if (enabled != NULL) {
+        *enabled = s_change_publishing;
+    }
+    if (heartbeat_sec != NULL) {
+        *heartbeat_sec = s_heartbeat_sec;
+    }
+}
+
+esp_err_t mqtt_set_deadband(const char *sensor_type, float deadband, float rate_per_min)
+{
+    if (sensor_type == NULL || deadband < 0.0f || rate_per_min < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    sensor_kind_t kind = sensor_kind_from_type(sensor_type);
+    if (kind == SENSOR_KIND_UNKNOWN) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    mqtt_deadband_t *db = &s_deadbands[kind];
+    db->deadband = deadband;
+    db->rate_per_min = rate_per_min;
+    ESP_LOGI(TAG, "%s deadband %.3f, rate %.3f/min", sensor_type, deadband, rate_per_min);
+    return ESP_OK;
+}
+
+void mqtt_get_batching(uint8_t *max_samples, uint32_t *max_age_sec)
+{
+    if (max_samples != NULL) {
+        *max_samples = s_batch_max_samples;
+    }
+    if (max_age_sec != NULL) {
+        *max_age_sec = s_batch_max_age_sec;
+    }
+}
+
+esp_err_t mqtt_set_telemetry_encoding(mqtt_encoding_t encoding)
+{
+    if (encoding > MQTT_ENCODING_BOTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    s_encoding = encoding;
+    ESP_LOGI(TAG, "Telemetry encoding set to %s", mqtt_telemetry_encoding_name(encoding));
+    
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(MQTT_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+    
+    err = nvs_set_u8(nvs_handle, MQTT_NVS_KEY_ENCODING, (uint8_t)encoding);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save telemetry encoding: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+mqtt_encoding_t mqtt_get_telemetry_encoding(void)
+{
+    return s_encoding;
+}
+
+esp_err_t mqtt_parse_telemetry_encoding(const char *name, mqtt_encoding_t *encoding)
+{
+    if (name == NULL || encoding == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    for (size_t i = 0; i < sizeof(s_encoding_names) / sizeof(s_encoding_names[0]); i++) {
+        if (strcmp(name, s_encoding_names[i]) == 0) {
+            *encoding = (mqtt_encoding_t)i;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+const char *mqtt_telemetry_encoding_name(mqtt_encoding_t encoding)
+{
+    if (encoding > MQTT_ENCODING_BOTH) {
+        return "unknown";
+    }
+    return s_encoding_names[encoding];
+}
+
 esp_err_t mqtt_get_device_id(char *device_id, size_t size)
 {
     if (device_id == NULL || size == 0) {
@@ -24,6 +24,15 @@ typedef enum {
     MQTT_STATE_ERROR
 } mqtt_state_t;
 
+/**
+ * @brief Payload encoding for kannacloud/sensor/{device_id}/data
+ */
+typedef enum {
+    MQTT_ENCODING_JSON = 0,       // JSON on .../data (default)
+    MQTT_ENCODING_CBOR,           // CBOR on .../data/cbor
+    MQTT_ENCODING_BOTH,           // Both topics (migration)
+} mqtt_encoding_t;
+
 /**
  * @brief Telemetry data structure (legacy)
  */
@@ -188,6 +197,101 @@ esp_err_t mqtt_unsubscribe(const char *topic);
  */
 esp_err_t mqtt_set_telemetry_interval(uint32_t interval_sec);
 
+/**
+ * @brief Configure batched publishing
+ *
+ * Snapshots are still taken every telemetry interval (see
+ * mqtt_set_telemetry_interval()), but are collected and published as one
+ * message once max_samples are held or the oldest is max_age_sec old.
+ * Batches go to kannacloud/sensor/{device_id}/data/batch (JSON) and/or
+ * .../data/batch/cbor, following the telemetry encoding. The setting is
+ * stored in NVS.
+ *
+ * @param max_samples Samples per message (0 or 1 disables batching, max MQTT_BATCH_MAX_SAMPLES)
+ * @param max_age_sec Publish a partial batch after this long (0 = only by count)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if max_samples is too large
+ */
+#define MQTT_BATCH_MAX_SAMPLES 16
+esp_err_t mqtt_set_batching(uint8_t max_samples, uint32_t max_age_sec);
+
+/**
+ * @brief Get batched publishing configuration
+ *
+ * @param max_samples Samples per message (0 = batching disabled)
+ * @param max_age_sec Maximum batch age in seconds
+ */
+void mqtt_get_batching(uint8_t *max_samples, uint32_t *max_age_sec);
+
+/**
+ * @brief Configure change-driven (deadband) publishing
+ *
+ * When enabled, a snapshot is published only if some value moved past its
+ * per-type deadband since it was last published, or changed faster than its
+ * rate-of-change limit. Only the changed sensors are sent, marked "full":false.
+ * A full snapshot is still sent every heartbeat_sec and after reconnecting.
+ * The setting is stored in NVS.
+ *
+ * @param enabled true to publish changes only
+ * @param heartbeat_sec Interval for forced full snapshots (0 = never)
+ * @return ESP_OK on success, error code if it could not be stored
+ */
+esp_err_t mqtt_set_change_publishing(bool enabled, uint32_t heartbeat_sec);
+
+/**
+ * @brief Get change-driven publishing configuration
+ *
+ * @param enabled Whether change-driven publishing is on
+ * @param heartbeat_sec Full snapshot interval in seconds
+ */
+void mqtt_get_change_publishing(bool *enabled, uint32_t *heartbeat_sec);
+
+/**
+ * @brief Set the thresholds for one sensor type
+ *
+ * Every channel of the sensor uses the same thresholds.
+ *
+ * @param sensor_type EZO type name (e.g. "pH")
+ * @param deadband Absolute change since the last published value
+ * @param rate_per_min Change per minute between consecutive samples (0 = off)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND for an unknown type
+ */
+esp_err_t mqtt_set_deadband(const char *sensor_type, float deadband, float rate_per_min);
+
+/**
+ * @brief Set telemetry payload encoding
+ *
+ * CBOR payloads go to kannacloud/sensor/{device_id}/data/cbor, so existing JSON
+ * subscribers on .../data are unaffected. The choice is stored in NVS.
+ *
+ * @param encoding Payload encoding
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an unknown encoding
+ */
+esp_err_t mqtt_set_telemetry_encoding(mqtt_encoding_t encoding);
+
+/**
+ * @brief Get telemetry payload encoding
+ *
+ * @return Current payload encoding
+ */
+mqtt_encoding_t mqtt_get_telemetry_encoding(void);
+
+/**
+ * @brief Parse an encoding name ("json", "cbor" or "both")
+ *
+ * @param name Encoding name
+ * @param encoding Parsed encoding
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an unknown name
+ */
+esp_err_t mqtt_parse_telemetry_encoding(const char *name, mqtt_encoding_t *encoding);
+
+/**
+ * @brief Get the name of an encoding
+ *
+ * @param encoding Payload encoding
+ * @return "json", "cbor" or "both"
+ */
+const char *mqtt_telemetry_encoding_name(mqtt_encoding_t encoding);
+
 /**
  * @brief Get device ID for MQTT topics
  * 
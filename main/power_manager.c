@@ -0,0 +1,59 @@
+/**
+ * @file power_manager.c
+ * @brief Dynamic frequency scaling, automatic light sleep and Wi-Fi modem sleep
+ */
+
+#include "power_manager.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "POWER_MGR";
+
+static bool s_light_sleep_enabled = false;
+
+/**
+ * @brief Enable modem sleep as soon as the station is associated
+ *
+ * The radio then wakes only for DTIM beacons and our own traffic.
+ */
+static void power_manager_ip_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+    esp_err_t ret = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to enable Wi-Fi modem sleep: %s", esp_err_to_name(ret));
+        return;
+    }
+    ESP_LOGI(TAG, "Wi-Fi modem sleep enabled (DTIM)");
+}
+
+esp_err_t power_manager_init(void) {
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = POWER_MANAGER_MIN_FREQ_MHZ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#endif
+    };
+
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure power management: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_light_sleep_enabled = pm_config.light_sleep_enable;
+    ESP_LOGI(TAG, "Power management: %d-%d MHz, light sleep %s", pm_config.min_freq_mhz,
+             pm_config.max_freq_mhz, s_light_sleep_enabled ? "on" : "off");
+#else
+    ESP_LOGI(TAG, "Power management disabled (CONFIG_PM_ENABLE not set)");
+#endif
+
+    // The default event loop is created by wifi_manager_init()
+    return esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &power_manager_ip_event_handler, NULL);
+}
+
+bool power_manager_light_sleep_enabled(void) {
+    return s_light_sleep_enabled;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file power_manager.h
+ * @brief Dynamic frequency scaling, automatic light sleep and Wi-Fi modem sleep
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POWER_MANAGER_MIN_FREQ_MHZ  40      // XTAL frequency: lowest CPU clock between bursts
+
+/**
+ * @brief Set up power management
+ *
+ * With CONFIG_PM_ENABLE the CPU scales between POWER_MANAGER_MIN_FREQ_MHZ and
+ * the default frequency. With CONFIG_FREERTOS_USE_TICKLESS_IDLE it also enters
+ * light sleep whenever every task is blocked, e.g. during EZO conversion waits
+ * and between sensor sweeps. Once an IP address is obtained, Wi-Fi is put
+ * into DTIM-based modem sleep (WIFI_PS_MIN_MODEM).
+ *
+ * Call after wifi_manager_init(), which creates the default event loop.
+ *
+ * @return esp_err_t ESP_OK on success (also when PM is disabled in sdkconfig)
+ */
+esp_err_t power_manager_init(void);
+
+/**
+ * @brief Whether automatic light sleep is active
+ */
+bool power_manager_light_sleep_enabled(void);
+
+#ifdef __cplusplus
+}
+#endif
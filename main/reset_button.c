@@ -7,6 +7,10 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+#include "esp_sleep.h"
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -26,6 +30,21 @@ static int64_t button_press_start_time = 0;
 static bool button_pressed = false;
 static bool event_fired = false;
 static QueueHandle_t button_event_queue = NULL;
+static TaskHandle_t button_monitor_task = NULL;
+
+/**
+ * @brief Arm the GPIO interrupt for the next button transition (ISR)
+ *
+ * Level interrupts are used instead of edges because only level triggers can
+ * wake the chip from light sleep. The level is flipped after every transition
+ * so the interrupt does not retrigger while the button is held. The driver
+ * calls take locks and may log, so the ISR writes the pin's interrupt type
+ * directly; the wakeup enable set up at init is left as it is.
+ */
+static inline void IRAM_ATTR reset_button_arm(gpio_int_type_t level)
+{
+    gpio_ll_set_intr_type(&GPIO, button_gpio, level);
+}
 
 /**
  * @brief GPIO interrupt handler for button events
@@ -37,14 +56,25 @@ static void IRAM_ATTR reset_button_isr_handler(void* arg)
     int64_t now = esp_timer_get_time();
     
     if (level == 0) {
-        // Button pressed (low state)
+        // Button pressed (low state): wait for release next
+        reset_button_arm(GPIO_INTR_HIGH_LEVEL);
         if (!button_pressed) {
             button_pressed = true;
             button_press_start_time = now;
             event_fired = false;
+            
+            // Wake the monitor task for long press detection
+            if (button_monitor_task != NULL) {
+                BaseType_t higher_priority_task_woken = pdFALSE;
+                vTaskNotifyGiveFromISR(button_monitor_task, &higher_priority_task_woken);
+                if (higher_priority_task_woken == pdTRUE) {
+                    portYIELD_FROM_ISR();
+                }
+            }
         }
     } else {
-        // Button released (high state)
+        // Button released (high state): wait for the next press
+        reset_button_arm(GPIO_INTR_LOW_LEVEL);
         if (button_pressed) {
             button_pressed = false;
             
@@ -100,10 +130,18 @@ static void reset_button_event_handler_task(void* arg)
 
 /**
  * @brief Task to monitor long press and fire event while button is held
+ *
+ * Sleeps until the ISR reports a press and only polls while the button is
+ * down, so an idle button never keeps the CPU out of light sleep.
  */
 static void reset_button_monitor_task(void* arg)
 {
     while (1) {
+        if (!button_pressed || event_fired) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        
         if (button_pressed && !event_fired) {
             int64_t now = esp_timer_get_time();
             uint32_t press_duration_ms = (now - button_press_start_time) / 1000;
@@ -156,7 +194,7 @@ esp_err_t reset_button_init(int gpio_num, reset_button_callback_t callback)
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_ANYEDGE, // Trigger on both rising and falling edge
+        .intr_type = GPIO_INTR_LOW_LEVEL, // Press first; the ISR flips the level after each transition
     };
     
     esp_err_t ret = gpio_config(&io_conf);
@@ -166,6 +204,12 @@ esp_err_t reset_button_init(int gpio_num, reset_button_callback_t callback)
         return ret;
     }
     
+#if CONFIG_PM_ENABLE
+    // Let the button wake the chip from automatic light sleep
+    gpio_wakeup_enable(gpio_num, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+#endif
+    
     // Install GPIO ISR service
     ret = gpio_install_isr_service(0);
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
@@ -207,7 +251,7 @@ esp_err_t reset_button_init(int gpio_num, reset_button_callback_t callback)
         2048,
         NULL,
         5,
-        NULL
+        &button_monitor_task
     );
     
     if (task_ret != pdPASS) {
@@ -0,0 +1,94 @@
+/**
+ * @file sensor_filter.c
+ * @brief Per-channel streaming filter: outlier gate, median and EWMA
+ */
+
+#include "sensor_filter.h"
+#include <string.h>
+#include <math.h>
+
+#define MAD_TO_SIGMA    1.4826f     // Scales the MAD to a standard deviation for normal noise
+
+/**
+ * @brief Median of a small array (sorted in place)
+ */
+static float filter_median(float *values, uint8_t count) {
+    for (uint8_t i = 1; i < count; i++) {
+        float v = values[i];
+        int8_t j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+    return (count & 1) ? values[count / 2] : 0.5f * (values[count / 2 - 1] + values[count / 2]);
+}
+
+void sensor_filter_config_default(sensor_filter_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->window = 1;
+}
+
+bool sensor_filter_config_valid(const sensor_filter_config_t *config) {
+    return config != NULL &&
+           config->window >= 1 && config->window <= SENSOR_FILTER_WINDOW_MAX &&
+           config->outlier_k >= 0.0f && config->outlier_floor >= 0.0f &&
+           config->ewma_alpha >= 0.0f && config->ewma_alpha <= 1.0f;
+}
+
+void sensor_filter_reset(sensor_filter_state_t *state) {
+    memset(state, 0, sizeof(*state));
+}
+
+float sensor_filter_apply(const sensor_filter_config_t *config, sensor_filter_state_t *state,
+                          float raw, bool *rejected) {
+    bool gated = false;
+    float value = raw;
+    uint8_t window = config->window;
+
+    if (window > 1 && isfinite(raw)) {
+        state->window[state->head] = raw;
+        state->head = (state->head + 1) % window;
+        if (state->fill < window) {
+            state->fill++;
+        }
+
+        float sorted[SENSOR_FILTER_WINDOW_MAX];
+        memcpy(sorted, state->window, state->fill * sizeof(float));
+        float median = filter_median(sorted, state->fill);
+
+        // Hampel identifier: distance from the median in units of the window spread
+        if (config->outlier_k > 0.0f && state->fill >= SENSOR_FILTER_MIN_GATE) {
+            for (uint8_t i = 0; i < state->fill; i++) {
+                sorted[i] = fabsf(sorted[i] - median);
+            }
+            float threshold = config->outlier_k * MAD_TO_SIGMA * filter_median(sorted, state->fill);
+            if (threshold < config->outlier_floor) {
+                threshold = config->outlier_floor;
+            }
+            if (fabsf(raw - median) > threshold) {
+                value = median;
+                gated = true;
+                state->rejected++;
+            }
+        }
+
+        if (config->median) {
+            value = median;
+        }
+    }
+
+    if (config->ewma_alpha > 0.0f && config->ewma_alpha < 1.0f && state->has_output && isfinite(value)) {
+        value = state->output + config->ewma_alpha * (value - state->output);
+    }
+
+    if (isfinite(value)) {
+        state->output = value;
+        state->has_output = true;
+    }
+    if (rejected != NULL) {
+        *rejected = gated;
+    }
+    return value;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file sensor_filter.h
+ * @brief Per-channel streaming filter: outlier gate, median and EWMA
+ *
+ * Each sample passes through three optional stages, in order:
+ *   1. Hampel gate: a sample further than outlier_k scaled MADs (and at
+ *      least outlier_floor) from the window median is replaced by the median.
+ *   2. Median: output the median of the last window samples.
+ *   3. EWMA: exponential smoothing with weight ewma_alpha for the new value.
+ *
+ * State is a fixed ring of SENSOR_FILTER_WINDOW_MAX samples, so each sample
+ * costs the same bounded work. Nothing here is thread safe; the sensor
+ * manager keeps one state per sensor channel on its reading task.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_FILTER_WINDOW_MAX    7       // Longest median / outlier window
+#define SENSOR_FILTER_MIN_GATE      3       // Window samples needed before the gate acts
+
+/**
+ * @brief Filter settings of one sensor (shared by its channels)
+ */
+typedef struct {
+    uint8_t window;             // Samples in the window, 1 to SENSOR_FILTER_WINDOW_MAX (1 = no window)
+    bool median;                // Output the window median instead of the (gated) sample
+    float outlier_k;            // Hampel threshold in scaled MADs, 0 = gate off
+    float outlier_floor;        // Smallest deviation ever rejected, in sensor units
+    float ewma_alpha;           // Weight of the new value, 0 or 1 = smoothing off
+} sensor_filter_config_t;
+
+/**
+ * @brief Filter state of one channel
+ */
+typedef struct {
+    float window[SENSOR_FILTER_WINDOW_MAX]; // Recent raw samples, oldest overwritten first
+    uint8_t head;
+    uint8_t fill;
+    bool has_output;
+    float output;               // Last filtered value
+    uint32_t rejected;          // Samples replaced by the gate
+} sensor_filter_state_t;
+
+/**
+ * @brief Pass-through configuration
+ */
+void sensor_filter_config_default(sensor_filter_config_t *config);
+
+/**
+ * @brief Check a configuration
+ *
+ * @return true if every field is in range
+ */
+bool sensor_filter_config_valid(const sensor_filter_config_t *config);
+
+/**
+ * @brief Forget all samples
+ */
+void sensor_filter_reset(sensor_filter_state_t *state);
+
+/**
+ * @brief Filter one sample
+ *
+ * @param config Filter settings
+ * @param state Channel state
+ * @param raw New sample
+ * @param rejected Set to true if the gate replaced the sample (may be NULL)
+ * @return float Filtered value
+ */
+float sensor_filter_apply(const sensor_filter_config_t *config, sensor_filter_state_t *state,
+                          float raw, bool *rejected);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,408 @@
+/**
+ * @file sensor_history.c
+ * @brief In-PSRAM time-series history of sensor readings
+ */
+
+#include "sensor_history.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "SENSOR_HISTORY";
+
+#define HISTORY_BLOCK_SAMPLES   64
+#define HISTORY_RAW_BLOCKS      (SENSOR_HISTORY_RAW_SEC / HISTORY_BLOCK_SAMPLES + 2)    // One hour at 1 s sampling
+#define HISTORY_EMPTY_BUCKET    UINT32_MAX
+#define HISTORY_ROLLUP_COUNT    2
+
+/**
+ * @brief Run of raw samples, each stored as a change from the previous one
+ *
+ * A new block starts when this one is full or when the next sample's time
+ * step or value change does not fit its 8-bit / 16-bit slot.
+ */
+typedef struct {
+    uint32_t t0;                                // Uptime seconds of the first sample
+    uint32_t t_last;                            // Uptime seconds of the last sample
+    int32_t v0;                                 // Fixed-point value of the first sample
+    int32_t v_last;                             // Fixed-point value of the last sample
+    uint8_t count;
+    uint8_t dt[HISTORY_BLOCK_SAMPLES];          // Seconds after the previous sample
+    int16_t delta[HISTORY_BLOCK_SAMPLES];       // Change from the previous sample
+} history_block_t;
+
+/**
+ * @brief One rollup bucket; min and max are offsets from the mean
+ */
+typedef struct {
+    uint32_t bucket;                            // Uptime / width, HISTORY_EMPTY_BUCKET when unused
+    int32_t mean;
+    uint16_t below;                             // mean - min, saturated
+    uint16_t above;                             // max - mean, saturated
+    uint16_t count;                             // Samples in the bucket, saturated
+} history_rollup_t;
+
+/**
+ * @brief Bucket being filled
+ */
+typedef struct {
+    uint32_t bucket;
+    int64_t sum;
+    int32_t min;
+    int32_t max;
+    uint32_t count;
+} history_acc_t;
+
+typedef struct {
+    uint8_t kind;                               // Sensor the series belongs to
+    uint8_t address;
+    uint16_t scale;                             // Fixed-point steps per unit
+    uint16_t raw_head;                          // Block being appended
+    uint16_t raw_count;                         // Blocks in use
+    history_acc_t acc[HISTORY_ROLLUP_COUNT];
+    history_block_t raw[HISTORY_RAW_BLOCKS];
+    history_rollup_t rollup_1min[SENSOR_HISTORY_1MIN_SLOTS];
+    history_rollup_t rollup_15min[SENSOR_HISTORY_15MIN_SLOTS];
+} history_series_t;
+
+typedef struct {
+    uint32_t width;                             // Seconds per bucket
+    uint32_t slots;
+    size_t offset;                              // Ring offset in history_series_t
+} history_rollup_desc_t;
+
+static const history_rollup_desc_t s_rollups[HISTORY_ROLLUP_COUNT] = {
+    { SENSOR_HISTORY_1MIN,  SENSOR_HISTORY_1MIN_SLOTS,  offsetof(history_series_t, rollup_1min) },
+    { SENSOR_HISTORY_15MIN, SENSOR_HISTORY_15MIN_SLOTS, offsetof(history_series_t, rollup_15min) },
+};
+
+// Fixed-point resolution per kind and channel, at or below the EZO output
+// resolution. Coarser steps keep more changes inside a 16-bit delta.
+static const uint16_t s_scales[SENSOR_KIND_COUNT][MAX_SENSOR_VALUES] = {
+    [SENSOR_KIND_UNKNOWN] = { 1000, 1000, 1000, 1000 },
+    [SENSOR_KIND_RTD]     = { 1000, 1000, 1000, 1000 },    // 0.001 °C
+    [SENSOR_KIND_PH]      = { 1000, 1000, 1000, 1000 },    // 0.001 pH
+    [SENSOR_KIND_EC]      = { 100, 100, 100, 1000 },       // 0.01 µS/cm, ppm, PSU; 0.001 SG
+    [SENSOR_KIND_DO]      = { 100, 100, 100, 100 },        // 0.01 mg/L, %
+    [SENSOR_KIND_ORP]     = { 10, 10, 10, 10 },            // 0.1 mV
+    [SENSOR_KIND_HUM]     = { 100, 100, 100, 100 },        // 0.01 %RH, °C
+};
+
+static history_series_t *s_series[SENSOR_MAX_SENSORS][MAX_SENSOR_VALUES];
+static uint64_t s_last_sample_us[SENSOR_MAX_SENSORS];  // Cache fallbacks repeat the previous sample
+static SemaphoreHandle_t s_lock = NULL;
+static size_t s_memory_used = 0;
+static bool s_alloc_failed = false;             // Logged once; no PSRAM or PSRAM full
+
+static inline history_rollup_t *history_ring(history_series_t *series, uint8_t r) {
+    return (history_rollup_t *)((uint8_t *)series + s_rollups[r].offset);
+}
+
+static inline uint32_t history_uptime_sec(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static void history_series_reset(history_series_t *series, const cached_sensor_t *sensor, uint8_t channel) {
+    memset(series, 0, sizeof(*series));
+    series->kind = sensor->kind;
+    series->address = sensor->address;
+    series->scale = s_scales[sensor->kind < SENSOR_KIND_COUNT ? sensor->kind : SENSOR_KIND_UNKNOWN][channel];
+    for (uint8_t r = 0; r < HISTORY_ROLLUP_COUNT; r++) {
+        history_rollup_t *ring = history_ring(series, r);
+        for (uint32_t i = 0; i < s_rollups[r].slots; i++) {
+            ring[i].bucket = HISTORY_EMPTY_BUCKET;
+        }
+    }
+}
+
+/**
+ * @brief Series for a sensor channel, allocated on first use
+ */
+static history_series_t *history_get_series(uint8_t index, uint8_t channel, const cached_sensor_t *sensor) {
+    history_series_t *series = s_series[index][channel];
+    if (series == NULL) {
+        if (s_alloc_failed) {
+            return NULL;
+        }
+        series = heap_caps_malloc(sizeof(history_series_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (series == NULL) {
+            ESP_LOGW(TAG, "No PSRAM for a %u-byte history series; history limited to %u KB",
+                     (unsigned)sizeof(history_series_t), (unsigned)(s_memory_used / 1024));
+            s_alloc_failed = true;
+            return NULL;
+        }
+        s_series[index][channel] = series;
+        s_memory_used += sizeof(history_series_t);
+        history_series_reset(series, sensor, channel);
+        return series;
+    }
+
+    if (series->kind != sensor->kind || series->address != sensor->address) {
+        // Another sensor took this index after a rescan
+        history_series_reset(series, sensor, channel);
+    }
+    return series;
+}
+
+static int32_t history_to_fixed(const history_series_t *series, float value) {
+    float scaled = value * (float)series->scale;
+    if (scaled >= (float)(INT32_MAX / 2)) {
+        return INT32_MAX / 2;
+    }
+    if (scaled <= (float)(INT32_MIN / 2)) {
+        return INT32_MIN / 2;
+    }
+    return (int32_t)lroundf(scaled);
+}
+
+static inline float history_from_fixed(const history_series_t *series, int32_t value) {
+    return (float)value / (float)series->scale;
+}
+
+static void history_append_raw(history_series_t *series, uint32_t now, int32_t value) {
+    // Drop blocks that have aged out entirely (slow sensors fill the ring slowly)
+    while (series->raw_count > 1) {
+        uint16_t oldest = (series->raw_head + HISTORY_RAW_BLOCKS - series->raw_count + 1) % HISTORY_RAW_BLOCKS;
+        if (series->raw[oldest].t_last + SENSOR_HISTORY_RAW_SEC >= now) {
+            break;
+        }
+        series->raw_count--;
+    }
+
+    history_block_t *block = (series->raw_count > 0) ? &series->raw[series->raw_head] : NULL;
+    if (block != NULL) {
+        if (now < block->t_last) {
+            return;
+        }
+        uint32_t dt = now - block->t_last;
+        int32_t change = value - block->v_last;
+        if (block->count < HISTORY_BLOCK_SAMPLES && dt <= UINT8_MAX &&
+            change >= INT16_MIN && change <= INT16_MAX) {
+            block->dt[block->count] = (uint8_t)dt;
+            block->delta[block->count] = (int16_t)change;
+            block->count++;
+            block->t_last = now;
+            block->v_last = value;
+            return;
+        }
+        series->raw_head = (series->raw_head + 1) % HISTORY_RAW_BLOCKS;
+    }
+
+    if (series->raw_count < HISTORY_RAW_BLOCKS) {
+        series->raw_count++;
+    }
+    block = &series->raw[series->raw_head];
+    block->t0 = now;
+    block->t_last = now;
+    block->v0 = value;
+    block->v_last = value;
+    block->count = 1;
+    block->dt[0] = 0;
+    block->delta[0] = 0;
+}
+
+static void history_rollup_from_acc(const history_acc_t *acc, history_rollup_t *out) {
+    int32_t mean = (int32_t)(acc->sum / (int64_t)acc->count);
+    uint32_t below = (uint32_t)(mean - acc->min);
+    uint32_t above = (uint32_t)(acc->max - mean);
+
+    out->bucket = acc->bucket;
+    out->mean = mean;
+    out->below = (below > UINT16_MAX) ? UINT16_MAX : (uint16_t)below;
+    out->above = (above > UINT16_MAX) ? UINT16_MAX : (uint16_t)above;
+    out->count = (acc->count > UINT16_MAX) ? UINT16_MAX : (uint16_t)acc->count;
+}
+
+static void history_accumulate(history_series_t *series, uint8_t r, uint32_t now, int32_t value) {
+    history_acc_t *acc = &series->acc[r];
+    uint32_t bucket = now / s_rollups[r].width;
+
+    if (acc->count > 0 && acc->bucket != bucket) {
+        history_rollup_from_acc(acc, &history_ring(series, r)[acc->bucket % s_rollups[r].slots]);
+        acc->count = 0;
+    }
+    if (acc->count == 0) {
+        acc->bucket = bucket;
+        acc->sum = 0;
+        acc->min = value;
+        acc->max = value;
+    }
+    acc->sum += value;
+    acc->count++;
+    if (value < acc->min) {
+        acc->min = value;
+    }
+    if (value > acc->max) {
+        acc->max = value;
+    }
+}
+
+esp_err_t sensor_history_init(void) {
+    if (s_lock != NULL) {
+        return ESP_OK;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "History: %u s raw, %u x 1 min, %u x 15 min (%u bytes per channel)",
+             SENSOR_HISTORY_RAW_SEC, SENSOR_HISTORY_1MIN_SLOTS, SENSOR_HISTORY_15MIN_SLOTS,
+             (unsigned)sizeof(history_series_t));
+    return ESP_OK;
+}
+
+void sensor_history_record(uint8_t index, const cached_sensor_t *sensor) {
+    if (s_lock == NULL || sensor == NULL || !sensor->valid || index >= SENSOR_MAX_SENSORS ||
+        sensor->timestamp_us == 0 || sensor->timestamp_us == s_last_sample_us[index]) {
+        return;
+    }
+    s_last_sample_us[index] = sensor->timestamp_us;
+
+    uint32_t now = (uint32_t)(sensor->timestamp_us / 1000000);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (uint8_t ch = 0; ch < sensor->value_count && ch < MAX_SENSOR_VALUES; ch++) {
+        if (!isfinite(sensor->values[ch])) {
+            continue;
+        }
+        history_series_t *series = history_get_series(index, ch, sensor);
+        if (series == NULL) {
+            break;
+        }
+
+        int32_t value = history_to_fixed(series, sensor->values[ch]);
+        history_append_raw(series, now, value);
+        for (uint8_t r = 0; r < HISTORY_ROLLUP_COUNT; r++) {
+            history_accumulate(series, r, now, value);
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static size_t history_read_raw(const history_series_t *series, uint32_t from, uint16_t skip, uint32_t to,
+                               sensor_history_point_t *points, size_t max_points) {
+    size_t n = 0;
+    for (uint16_t k = 0; k < series->raw_count; k++) {
+        const history_block_t *block =
+            &series->raw[(series->raw_head + HISTORY_RAW_BLOCKS - series->raw_count + 1 + k) % HISTORY_RAW_BLOCKS];
+        if (block->t_last < from) {
+            continue;
+        }
+        if (block->t0 > to) {
+            break;
+        }
+
+        uint32_t t = block->t0;
+        int32_t value = block->v0;
+        for (uint8_t s = 0; s < block->count; s++) {
+            if (s > 0) {
+                t += block->dt[s];
+                value += block->delta[s];
+            }
+            if (t < from) {
+                continue;
+            }
+            if (t == from && skip > 0) {
+                skip--;     // Returned by the previous batch
+                continue;
+            }
+            if (t > to) {
+                return n;
+            }
+            float v = history_from_fixed(series, value);
+            points[n++] = (sensor_history_point_t){ .time = t, .mean = v, .min = v, .max = v, .count = 1 };
+            if (n == max_points) {
+                return n;
+            }
+        }
+    }
+    return n;
+}
+
+static size_t history_read_rollup(history_series_t *series, uint8_t r, uint32_t from, uint16_t skip, uint32_t to,
+                                  sensor_history_point_t *points, size_t max_points) {
+    const history_rollup_desc_t *desc = &s_rollups[r];
+    const history_rollup_t *ring = history_ring(series, r);
+    const history_acc_t *acc = &series->acc[r];
+    uint32_t now_bucket = history_uptime_sec() / desc->width;
+    uint32_t first = from / desc->width;
+    uint32_t last = to / desc->width;
+
+    if (now_bucket >= desc->slots && first < now_bucket - desc->slots + 1) {
+        first = now_bucket - desc->slots + 1;
+    }
+    if (last > now_bucket) {
+        last = now_bucket;
+    }
+
+    size_t n = 0;
+    for (uint32_t b = first; b <= last && n < max_points; b++) {
+        history_rollup_t entry;
+        if (acc->count > 0 && acc->bucket == b) {
+            history_rollup_from_acc(acc, &entry);   // Bucket still filling
+        } else if (ring[b % desc->slots].bucket == b) {
+            entry = ring[b % desc->slots];
+        } else {
+            continue;
+        }
+        if (skip > 0 && b * desc->width == from) {
+            continue;   // One point per bucket: already returned
+        }
+
+        points[n++] = (sensor_history_point_t){
+            .time = b * desc->width,
+            .mean = history_from_fixed(series, entry.mean),
+            .min = history_from_fixed(series, entry.mean - (int32_t)entry.below),
+            .max = history_from_fixed(series, entry.mean + (int32_t)entry.above),
+            .count = entry.count,
+        };
+    }
+    return n;
+}
+
+size_t sensor_history_read(uint8_t index, uint8_t channel, sensor_history_res_t res,
+                           uint32_t from, uint16_t skip, uint32_t to,
+                           sensor_history_point_t *points, size_t max_points) {
+    if (s_lock == NULL || index >= SENSOR_MAX_SENSORS || channel >= MAX_SENSOR_VALUES ||
+        points == NULL || max_points == 0 || from > to) {
+        return 0;
+    }
+
+    size_t n = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    history_series_t *series = s_series[index][channel];
+    if (series != NULL) {
+        switch (res) {
+            case SENSOR_HISTORY_RAW: {
+                uint32_t now = history_uptime_sec();
+                if (now > SENSOR_HISTORY_RAW_SEC && from < now - SENSOR_HISTORY_RAW_SEC) {
+                    from = now - SENSOR_HISTORY_RAW_SEC;
+                    skip = 0;       // The skipped samples have expired
+                }
+                n = (from <= to) ? history_read_raw(series, from, skip, to, points, max_points) : 0;
+                break;
+            }
+            case SENSOR_HISTORY_1MIN:
+                n = history_read_rollup(series, 0, from, skip, to, points, max_points);
+                break;
+            case SENSOR_HISTORY_15MIN:
+                n = history_read_rollup(series, 1, from, skip, to, points, max_points);
+                break;
+            default:
+                break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+bool sensor_history_has_series(uint8_t index, uint8_t channel) {
+    return index < SENSOR_MAX_SENSORS && channel < MAX_SENSOR_VALUES && s_series[index][channel] != NULL;
+}
+
+size_t sensor_history_memory_used(void) {
+    return s_memory_used;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file sensor_history.h
+ * @brief In-PSRAM time-series history of sensor readings
+ *
+ * Every reading the sensor task takes is recorded per sensor value channel.
+ * Raw samples are kept for the last hour as delta-encoded fixed-point
+ * blocks. Min/max/mean rollups are kept at 1-minute resolution for a day and
+ * at 15-minute resolution for a week. A series is allocated from PSRAM the
+ * first time its sensor reports. Without PSRAM nothing is recorded.
+ *
+ * Timestamps are uptime seconds (esp_timer), so samples taken before SNTP
+ * sync stay ordered. Callers convert to wall time at query time.
+ *
+ * Recording and reading are serialized by a mutex. Each read copies a
+ * bounded batch of points, so a slow HTTP client never blocks the sensor task.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensor_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_HISTORY_RAW_SEC      3600                // Raw sample retention
+#define SENSOR_HISTORY_1MIN_SLOTS   1440                // 24 h of 1-minute rollups
+#define SENSOR_HISTORY_15MIN_SLOTS  672                 // 7 days of 15-minute rollups
+
+/**
+ * @brief Query resolution (value is the bucket width in seconds, 0 = raw)
+ */
+typedef enum {
+    SENSOR_HISTORY_RAW = 0,
+    SENSOR_HISTORY_1MIN = 60,
+    SENSOR_HISTORY_15MIN = 900,
+} sensor_history_res_t;
+
+/**
+ * @brief One history point
+ *
+ * For raw samples min, max and mean are the sample value. For rollups, time
+ * is the start of the bucket.
+ */
+typedef struct {
+    uint32_t time;              // Uptime seconds
+    float mean;
+    float min;
+    float max;
+    uint16_t count;             // Samples in the bucket (1 for raw)
+} sensor_history_point_t;
+
+/**
+ * @brief Create the history lock
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the mutex cannot be created
+ */
+esp_err_t sensor_history_init(void);
+
+/**
+ * @brief Record a sensor's latest reading
+ *
+ * Called by the sensor reading task after each read. Invalid readings,
+ * NaN channels and repeats of an already recorded sample are skipped. If a
+ * different sensor now occupies the index (after a rescan), its series
+ * start over.
+ *
+ * @param index Sensor index
+ * @param sensor Cached reading (kind, address, values and timestamp)
+ */
+void sensor_history_record(uint8_t index, const cached_sensor_t *sensor);
+
+/**
+ * @brief Copy points of one series in ascending time order
+ *
+ * Several raw samples can share a second. For the next batch, call again
+ * with from = the last point's time and skip = the number of points already
+ * returned with that time.
+ *
+ * @param index Sensor index
+ * @param channel Value channel (0 to MAX_SENSOR_VALUES - 1)
+ * @param res Resolution
+ * @param from First uptime second to include
+ * @param skip Points at time from to leave out
+ * @param to Last uptime second to include
+ * @param points Output buffer
+ * @param max_points Capacity of points
+ * @return size_t Number of points written (0 when there are no more)
+ */
+size_t sensor_history_read(uint8_t index, uint8_t channel, sensor_history_res_t res,
+                           uint32_t from, uint16_t skip, uint32_t to,
+                           sensor_history_point_t *points, size_t max_points);
+
+/**
+ * @brief Whether a sensor channel has any recorded history
+ */
+bool sensor_history_has_series(uint8_t index, uint8_t channel);
+
+/**
+ * @brief Bytes of PSRAM held by history series
+ */
+size_t sensor_history_memory_used(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file sensor_inventory.c
+ * @brief Persisted sensor inventory for fast sensor bring-up
+ *
+ * One NVS blob: a small header followed by the raw sensor_inventory_t. The
+ * header's layout word is the struct size plus a version, so a firmware
+ * update that changes ezo_sensor_config_t falls back to full discovery
+ * instead of misreading the old record.
+ */
+
+#include "sensor_inventory.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "SENSOR_INV";
+
+#define INVENTORY_NVS_KEY   "inventory"
+#define INVENTORY_CRC_KEY   "inventory_crc" // Copy of the record's CRC, compared before writing
+#define INVENTORY_VERSION   2
+#define INVENTORY_LAYOUT    ((INVENTORY_VERSION << 16) | sizeof(sensor_inventory_t))
+
+typedef struct {
+    uint32_t layout;            // INVENTORY_LAYOUT of the writer
+    uint32_t crc;               // CRC32 of inventory
+    sensor_inventory_t inventory;
+} inventory_record_t;
+
+// The only record buffer: loads, fills and saves all work in place under s_lock
+static inventory_record_t s_record;
+static SemaphoreHandle_t s_lock = NULL;
+
+static uint32_t inventory_crc(const sensor_inventory_t *inventory) {
+    return esp_rom_crc32_le(0, (const uint8_t *)inventory, sizeof(*inventory));
+}
+
+sensor_inventory_t *sensor_inventory_acquire(void) {
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return NULL;
+        }
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    return &s_record.inventory;
+}
+
+void sensor_inventory_release(void) {
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t sensor_inventory_load(void) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SENSOR_INVENTORY_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t size = sizeof(s_record);
+    err = nvs_get_blob(nvs_handle, INVENTORY_NVS_KEY, &s_record, &size);
+    nvs_close(nvs_handle);
+
+    if (err != ESP_OK || size != sizeof(s_record)) {
+        memset(&s_record, 0, sizeof(s_record));
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_record.layout != INVENTORY_LAYOUT) {
+        ESP_LOGI(TAG, "Stored inventory has an older layout, ignoring it");
+        memset(&s_record, 0, sizeof(s_record));
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_record.crc != inventory_crc(&s_record.inventory) ||
+        s_record.inventory.ezo_count > SENSOR_INVENTORY_MAX_EZO) {
+        ESP_LOGW(TAG, "Stored inventory is corrupt, ignoring it");
+        memset(&s_record, 0, sizeof(s_record));
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t sensor_inventory_save(void) {
+    const sensor_inventory_t *inventory = &s_record.inventory;
+    if (inventory->ezo_count > SENSOR_INVENTORY_MAX_EZO) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_record.layout = INVENTORY_LAYOUT;
+    s_record.crc = inventory_crc(inventory);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(SENSOR_INVENTORY_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Same length and fingerprint already stored: nothing to write
+    size_t size = 0;
+    uint32_t stored_crc = 0;
+    if (nvs_get_blob(nvs_handle, INVENTORY_NVS_KEY, NULL, &size) == ESP_OK && size == sizeof(s_record) &&
+        nvs_get_u32(nvs_handle, INVENTORY_CRC_KEY, &stored_crc) == ESP_OK && stored_crc == s_record.crc) {
+        nvs_close(nvs_handle);
+        return ESP_OK;
+    }
+
+    err = nvs_set_blob(nvs_handle, INVENTORY_NVS_KEY, &s_record, sizeof(s_record));
+    if (err == ESP_OK) {
+        err = nvs_set_u32(nvs_handle, INVENTORY_CRC_KEY, s_record.crc);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Stored inventory: battery=%s, %u EZO sensor(s)",
+                 inventory->battery ? "yes" : "no", inventory->ezo_count);
+    } else {
+        ESP_LOGE(TAG, "Failed to store inventory: %s", esp_err_to_name(err));
+    }
+    return err;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file sensor_inventory.h
+ * @brief Persisted sensor inventory for fast sensor bring-up
+ *
+ * Records which sensors were found on the bus and each EZO sensor's
+ * configuration, so the next boot can skip bus discovery and the EZO info
+ * queries when the same sensors still answer at the same addresses.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "ezo_sensor.h"
+#include "sensor_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_INVENTORY_NVS_NAMESPACE  "sensor_inv"
+#define SENSOR_INVENTORY_MAX_EZO        SENSOR_MAX_SENSORS
+
+/**
+ * @brief Sensors found on the bus
+ */
+typedef struct {
+    bool battery;                                       // MAX17048 present
+    uint8_t ezo_count;                                  // Valid entries in ezo[]
+    uint8_t bus[SENSOR_INVENTORY_MAX_EZO];              // Bus ID of each entry
+    ezo_sensor_config_t ezo[SENSOR_INVENTORY_MAX_EZO];  // In discovery order
+} sensor_inventory_t;
+
+/**
+ * @brief Take the shared inventory buffer
+ *
+ * The inventory is about 1.5 KB, so there is a single static copy rather
+ * than one on each caller's stack. Hold it from load or fill through save.
+ * The bus task must not take it: callers fill it from a bus job while
+ * holding it.
+ *
+ * @return sensor_inventory_t* The buffer, or NULL if the lock could not be created
+ */
+sensor_inventory_t *sensor_inventory_acquire(void);
+
+/**
+ * @brief Return the buffer taken with sensor_inventory_acquire()
+ */
+void sensor_inventory_release(void);
+
+/**
+ * @brief Load the stored inventory into the acquired buffer
+ *
+ * The record carries a layout fingerprint and a CRC32; a record written by a
+ * firmware with a different ezo_sensor_config_t layout, or a corrupted one,
+ * is rejected.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if missing or invalid
+ */
+esp_err_t sensor_inventory_load(void);
+
+/**
+ * @brief Store the acquired buffer
+ *
+ * Skips the flash write when the stored record has the same length and CRC.
+ * Zero the buffer before filling it so struct padding does not change the CRC.
+ *
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_inventory_save(void);
+
+#ifdef __cplusplus
+}
+#endif
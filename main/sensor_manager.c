@@ -7,13 +7,25 @@
 #include "i2c_scanner.h"
 #include "max17048.h"
 #include "ezo_sensor.h"
-#include "esp_log.h"
+#include "i2c_arbiter.h"
+#include "sensor_inventory.h"
+#include "sensor_history.h"
+#include "metrics.h"
+#include "mem_policy.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_SENSOR
+#include "app_log.h"
 #include "esp_timer.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <math.h>
 
 static const char *TAG = "SENSOR_MGR";
 
@@ -21,19 +33,37 @@ static const char *TAG = "SENSOR_MGR";
 static max17048_t s_battery_monitor;
 static bool s_battery_available = false;
 
-#define MAX_EZO_SENSORS 5
-static ezo_sensor_t s_ezo_sensors[MAX_EZO_SENSORS];
-static uint8_t s_ezo_count = 0;
+// Sensor registry. The fields the sweep, cache and telemetry touch on every
+// pass are parallel arrays indexed by sensor index, so lookups scan a few
+// bytes instead of ~100-byte driver handles; the EZO handles (config strings,
+// device handles) are kept apart in s_ezo_sensors. kind_mask has one bit per
+// sensor index, which gives constant-time "n-th sensor of kind" lookups.
+typedef struct {
+    uint8_t count;
+    uint8_t kind[SENSOR_MAX_SENSORS];           // sensor_kind_t
+    uint8_t ordinal[SENSOR_MAX_SENSORS];        // n-th sensor of its kind
+    uint8_t bus[SENSOR_MAX_SENSORS];
+    uint8_t address[SENSOR_MAX_SENSORS];
+    uint32_t kind_mask[SENSOR_KIND_COUNT];
+} sensor_registry_t;
+
+_Static_assert(SENSOR_MAX_SENSORS <= 32, "kind_mask and s_read_pending hold one bit per sensor");
+
+static sensor_registry_t s_registry;
+static ezo_sensor_t s_ezo_sensors[SENSOR_MAX_SENSORS];
 
-// EZO sensor type indices
-static int s_rtd_index = -1;  // Temperature
-static int s_ph_index = -1;   // pH
-static int s_ec_index = -1;   // Electrical conductivity
-static int s_do_index = -1;   // Dissolved oxygen
-static int s_orp_index = -1;  // ORP
-static int s_hum_index = -1;  // Humidity
+static const char *const s_kind_names[SENSOR_KIND_COUNT] = {
+    [SENSOR_KIND_UNKNOWN] = "EZO",
+    [SENSOR_KIND_RTD]     = EZO_TYPE_RTD,
+    [SENSOR_KIND_PH]      = EZO_TYPE_PH,
+    [SENSOR_KIND_EC]      = EZO_TYPE_EC,
+    [SENSOR_KIND_DO]      = EZO_TYPE_DO,
+    [SENSOR_KIND_ORP]     = EZO_TYPE_ORP,
+    [SENSOR_KIND_HUM]     = EZO_TYPE_HUM,
+};
 
-// Cached sensor readings (last successful values) - old per-sensor cache
+// Cached sensor readings (last successful values) - old per-sensor cache.
+// Only the reading task touches it; other tasks use the published snapshot.
 typedef struct {
     float values[4];
     uint8_t count;
@@ -41,27 +71,343 @@ typedef struct {
     uint32_t timestamp_ms;
 } cached_sensor_data_t;
 
-static cached_sensor_data_t s_cached_readings[MAX_EZO_SENSORS] = {0};
+static cached_sensor_data_t s_cached_readings[SENSOR_MAX_SENSORS] = {0};
 #define CACHE_TIMEOUT_MS 300000  // 5 minutes - consider cached data stale after this
 
-// Global sensor cache for API access
-static sensor_cache_t s_sensor_cache = {0};
-static bool s_cache_valid = false;
-static SemaphoreHandle_t s_cache_mutex = NULL;
+// Global sensor cache for API access.
+// Double-buffered seqlock: the reading task builds a private snapshot, copies it
+// into the back buffer and then flips s_cache_front. Readers copy the front buffer
+// and retry if its sequence number moved (odd = being written), so they never wait
+// on the I2C sweep.
+#define CACHE_READ_RETRIES 4
+static sensor_cache_t s_cache_buffers[2];
+static atomic_uint s_cache_seq[2];
+static atomic_int s_cache_front = -1;       // -1 until the first sweep completes
+#define CACHE_EMPTY -1
+#define CACHE_BUSY  -2
+static sensor_cache_t s_sweep_snapshot;     // Private to the reading task
 
 // Background reading task
 static TaskHandle_t s_reading_task_handle = NULL;
-static uint32_t s_reading_interval_sec = 10;
-static bool s_reading_paused = false;
-static bool s_reading_in_progress = false;
+static volatile uint32_t s_reading_interval_sec = 10;
+static volatile sensor_update_callback_t s_update_callbacks[SENSOR_UPDATE_MAX_CALLBACKS];
+static portMUX_TYPE s_callback_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Per-sensor sampling schedules. The reading task keeps EZO indices in a
+// min-heap ordered by next deadline (then priority) and sleeps until the root
+// is due. Configuration is shared with API callers under s_sched_lock; the
+// heap and deadlines are owned by the reading task.
+#define SCHED_COALESCE_US       50000   // Sensors due within this window share one wait
+#define SCHED_MIN_PERIOD_SEC    1
+#define SCHED_DIRTY_CONFIG      (1 << 0)
+#define SCHED_DIRTY_INVENTORY   (1 << 1)
+
+typedef struct {
+    sensor_schedule_t cfg;
+    bool reschedule;            // cfg changed, recompute next_due_us
+    int64_t next_due_us;
+    int64_t last_run_us;
+} sensor_slot_schedule_t;
+
+static sensor_slot_schedule_t s_schedules[SENSOR_MAX_SENSORS];
+static uint8_t s_sched_heap[SENSOR_MAX_SENSORS];
+static uint8_t s_sched_heap_len = 0;
+static atomic_int s_sched_dirty = SCHED_DIRTY_INVENTORY;
+static portMUX_TYPE s_sched_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_reading_paused = false;
+static atomic_bool s_reading_in_progress = false;
+static atomic_bool s_inventory_dirty = false;   // An EZO config changed, the reading task saves it
+
+// On-demand reads. Requests collect here under s_read_now_lock until the
+// reading task takes the whole set for its next sweep. Taken requests stay
+// in the batch until served, so a stop can still complete them.
+typedef struct {
+    sensor_read_callback_t callback;
+    void *ctx;
+    uint32_t mask;              // Requested EZO indices
+} sensor_read_waiter_t;
+
+static sensor_read_waiter_t s_read_waiters[SENSOR_READ_MAX_WAITERS];
+static uint8_t s_read_waiter_count = 0;
+static uint32_t s_read_now_mask = 0;        // Union of the waiters' masks
+static sensor_read_waiter_t s_batch_waiters[SENSOR_READ_MAX_WAITERS];
+static uint8_t s_batch_waiter_count = 0;    // Taken into the current sweep
+static uint8_t s_batch_waiter_next = 0;     // Next one to serve
+static portMUX_TYPE s_read_now_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Stop handshake: the reading task fails its waiters and parks itself before
+// sensor_manager_stop_reading_task() deletes it
+#define READING_STOP_TIMEOUT_MS     SENSOR_READ_TIMEOUT_MS
+static atomic_bool s_reading_stop = false;
+static SemaphoreHandle_t s_reading_stopped = NULL;
+
+// Per-sensor reading filters. Settings are shared with API callers under
+// s_filter_lock; the per-channel state belongs to the reading task, which
+// clears it when the sensor's bit in s_filter_dirty is set.
+static sensor_filter_config_t s_filter_cfg[SENSOR_MAX_SENSORS];
+static sensor_filter_state_t s_filter_state[SENSOR_MAX_SENSORS][MAX_SENSOR_VALUES];
+static atomic_uint s_filter_dirty = 0;
+static portMUX_TYPE s_filter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Bit per EZO index: "R" was sent and the response is not collected yet.
+// Commands to such a sensor are held back, since its next response frame
+// belongs to the reading.
+static atomic_uint s_read_pending = 0;
+
+// Per EZO index: a command job is waiting for this sensor's response until
+// then, so the sweep must not send "R". Only touched by bus jobs; expires
+// by itself if the arbiter gives up on the job.
+static int64_t s_command_until_us[SENSOR_MAX_SENSORS];
+
+/**
+ * @brief One multi-sensor EZO read, driven as short bus jobs
+ */
+typedef struct {
+    const uint8_t *slots;       // EZO indices to read
+    uint8_t slot_count;
+    cached_sensor_t *sensors;   // Results: sensors[i - sensors_base] for EZO index i
+    uint8_t sensors_base;
+    esp_err_t *read_ret;        // Per slot position
+    uint32_t outstanding;       // Bit per slot position still converting
+    float comp_temp_c;          // Sent with "RT" to pH/EC/DO, NAN = plain "R"
+    uint32_t compensated;       // Bit per slot position started with "RT"
+} ezo_read_batch_t;
+
+// Temperature compensation. pH/EC/DO take the first RTD's reading through
+// "RT,<temp>"; readings outside this range (e.g. -1023 with no probe) are
+// not passed on.
+#define COMP_TEMP_MIN_C         -20.0f
+#define COMP_TEMP_MAX_C         150.0f
 
-// Forward declaration
+// Bit per EZO index: the firmware rejected "RT", use "R" until rescan
+static atomic_uint s_comp_unsupported = 0;
+
+// Forward declarations
 static void sensor_reading_task(void *arg);
+static void sensor_manager_notify_scheduler(int dirty_flags);
+static int sensor_cache_read_begin(unsigned *seq);
+static bool sensor_cache_read_end(int front, unsigned seq);
+
+// Atlas Scientific factory-default EZO block (DO 0x61 ... HUM 0x6F). Discovery stays inside it
+// because answering an unknown device with "i" would be a write to e.g. an EEPROM.
+#define EZO_DISCOVERY_FIRST_ADDR    0x61
+#define EZO_DISCOVERY_LAST_ADDR     0x70
+
+// Addresses this board has always used; a device here counts as EZO even if "i" gets no answer
+static const uint8_t s_known_ezo_addresses[] = {0x16, 0x63, 0x64, 0x6F};
+
+static bool sensor_manager_is_known_ezo_address(uint8_t addr) {
+    for (size_t i = 0; i < sizeof(s_known_ezo_addresses); i++) {
+        if (s_known_ezo_addresses[i] == addr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+sensor_kind_t sensor_kind_from_type(const char *type) {
+    if (type == NULL) {
+        return SENSOR_KIND_UNKNOWN;
+    }
+    for (int kind = SENSOR_KIND_UNKNOWN + 1; kind < SENSOR_KIND_COUNT; kind++) {
+        if (strcmp(type, s_kind_names[kind]) == 0) {
+            return (sensor_kind_t)kind;
+        }
+    }
+    return SENSOR_KIND_UNKNOWN;
+}
+
+const char *sensor_kind_name(sensor_kind_t kind) {
+    return (kind < SENSOR_KIND_COUNT) ? s_kind_names[kind] : s_kind_names[SENSOR_KIND_UNKNOWN];
+}
 
 /**
- * @brief Initialize all sensors
+ * @brief Default filter of a sensor kind
+ * 
+ * EC and ORP probes pick up spikes from pumps and ground loops, so they get
+ * a Hampel gate; its floor matches the MQTT publish deadband.
  */
-esp_err_t sensor_manager_init(void) {
+static void sensor_manager_filter_defaults(sensor_kind_t kind, sensor_filter_config_t *filter) {
+    sensor_filter_config_default(filter);
+    if (kind == SENSOR_KIND_EC || kind == SENSOR_KIND_ORP) {
+        filter->window = 5;
+        filter->outlier_k = 3.0f;
+        filter->outlier_floor = (kind == SENSOR_KIND_EC) ? 10.0f : 5.0f;   // µS/cm, mV
+    }
+}
+
+/**
+ * @brief Register the sensor in the next free slot
+ * 
+ * The type string is compared here, once; everything after uses the kind.
+ */
+static void sensor_manager_add_ezo(uint8_t bus) {
+    uint8_t index = s_registry.count;
+    ezo_sensor_t *sensor = &s_ezo_sensors[index];
+    sensor_kind_t kind = sensor_kind_from_type(sensor->config.type);
+    uint32_t same_kind = s_registry.kind_mask[kind];
+    
+    s_registry.kind[index] = kind;
+    s_registry.ordinal[index] = (uint8_t)__builtin_popcount(same_kind);
+    s_registry.bus[index] = bus;
+    s_registry.address[index] = sensor->config.i2c_address;
+    s_registry.kind_mask[kind] = same_kind | (1u << index);
+    s_registry.count++;
+    
+    portENTER_CRITICAL(&s_filter_lock);
+    sensor_manager_filter_defaults(kind, &s_filter_cfg[index]);
+    portEXIT_CRITICAL(&s_filter_lock);
+    atomic_fetch_or(&s_filter_dirty, 1u << index);
+    
+    ESP_LOGI(TAG, "✓ EZO sensor %u initialized: Type=%s #%u, Name=%s, FW=%s, bus %u",
+             index, sensor->config.type, s_registry.ordinal[index] + 1,
+             sensor->config.name, sensor->config.firmware_version, bus);
+}
+
+/**
+ * @brief Bring up the MAX17048 battery monitor
+ */
+static void sensor_manager_init_battery(i2c_master_bus_handle_t bus_handle) {
+    ESP_LOGI(TAG, "MAX17048 battery monitor detected at 0x%02X", MAX17048_I2C_ADDR);
+    esp_err_t ret = max17048_init(&s_battery_monitor, bus_handle);
+    if (ret == ESP_OK) {
+        s_battery_available = true;
+        ESP_LOGI(TAG, "✓ MAX17048 initialized successfully");
+        
+        // Read initial values
+        float voltage, soc;
+        if (max17048_read_voltage(&s_battery_monitor, &voltage) == ESP_OK &&
+            max17048_read_soc(&s_battery_monitor, &soc) == ESP_OK) {
+            ESP_LOGI(TAG, "  Battery: %.2f V, %.1f%%", voltage, soc);
+        }
+    } else {
+        ESP_LOGW(TAG, "Failed to initialize MAX17048");
+    }
+}
+
+/**
+ * @brief Copy the current inventory and EZO configurations (bus task)
+ * 
+ * Fills the shared inventory buffer in place; EZO configurations are only
+ * written by bus jobs, so this sees a consistent set.
+ */
+static void sensor_manager_fill_inventory(sensor_inventory_t *inventory) {
+    // Zeroed first so struct padding does not change the CRC between saves
+    memset(inventory, 0, sizeof(*inventory));
+    inventory->battery = s_battery_available;
+    inventory->ezo_count = s_registry.count;
+    for (int i = 0; i < s_registry.count; i++) {
+        inventory->bus[i] = s_registry.bus[i];
+        memcpy(&inventory->ezo[i], &s_ezo_sensors[i].config, sizeof(ezo_sensor_config_t));
+    }
+}
+
+static esp_err_t sensor_manager_fill_inventory_job(void *arg) {
+    sensor_manager_fill_inventory((sensor_inventory_t *)arg);
+    return ESP_OK;
+}
+
+/**
+ * @brief Persist the current inventory (any task but the bus task)
+ * 
+ * The snapshot is taken in a bus job and written to NVS from the calling
+ * task, so the flash write never holds the bus.
+ */
+static void sensor_manager_save_inventory(void) {
+    sensor_inventory_t *inventory = sensor_inventory_acquire();
+    if (inventory == NULL) {
+        return;
+    }
+    if (i2c_arbiter_run(I2C_ARBITER_PRIO_CONFIG, sensor_manager_fill_inventory_job, inventory) == ESP_OK) {
+        sensor_inventory_save();
+    }
+    sensor_inventory_release();
+}
+
+/**
+ * @brief Reuse a stored inventory if exactly those sensors still answer
+ * 
+ * Costs one address probe per stored sensor plus one for the battery
+ * monitor, and no EZO commands. New sensors at other addresses are only
+ * picked up by sensor_manager_rescan().
+ * 
+ * @return true if all sensors were restored, false if the bus has changed
+ */
+static bool sensor_manager_restore_inventory(i2c_master_bus_handle_t bus_handle, const sensor_inventory_t *inventory) {
+    if (i2c_scanner_device_exists(MAX17048_I2C_ADDR) != inventory->battery) {
+        ESP_LOGI(TAG, "Battery monitor %s since last boot", inventory->battery ? "removed" : "added");
+        return false;
+    }
+    for (int i = 0; i < inventory->ezo_count; i++) {
+        if (!i2c_scanner_device_exists(inventory->ezo[i].i2c_address)) {
+            ESP_LOGI(TAG, "EZO sensor at 0x%02X no longer answers", inventory->ezo[i].i2c_address);
+            return false;
+        }
+    }
+    
+    if (inventory->battery) {
+        sensor_manager_init_battery(bus_handle);
+    }
+    for (int i = 0; i < inventory->ezo_count; i++) {
+        if (ezo_sensor_init_from_config(&s_ezo_sensors[s_registry.count], bus_handle, &inventory->ezo[i]) != ESP_OK) {
+            return false;
+        }
+        sensor_manager_add_ezo(inventory->bus[i]);
+    }
+    return true;
+}
+
+/**
+ * @brief Probe the EZO address block and query every sensor found
+ */
+static void sensor_manager_discover(i2c_master_bus_handle_t bus_handle) {
+    if (i2c_scanner_device_exists(MAX17048_I2C_ADDR)) {
+        sensor_manager_init_battery(bus_handle);
+    }
+    
+    for (uint8_t addr = 0x08; addr <= EZO_DISCOVERY_LAST_ADDR && s_registry.count < SENSOR_MAX_SENSORS; addr++) {
+        bool known = sensor_manager_is_known_ezo_address(addr);
+        if ((addr < EZO_DISCOVERY_FIRST_ADDR && !known) || !i2c_scanner_device_exists(addr)) {
+            continue;
+        }
+        ESP_LOGI(TAG, "EZO sensor detected at 0x%02X", addr);
+        
+        ezo_sensor_t *sensor = &s_ezo_sensors[s_registry.count];
+        esp_err_t ret = ezo_sensor_init(sensor, bus_handle, addr);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to initialize EZO sensor at 0x%02X", addr);
+            continue;
+        }
+        if (sensor->config.type[0] == '\0' && !known) {
+            ESP_LOGI(TAG, "Device at 0x%02X did not identify as EZO, ignoring it", addr);
+            ezo_sensor_deinit(sensor);
+            continue;
+        }
+        sensor_manager_add_ezo(SENSOR_BUS_MAIN);
+    }
+}
+
+/**
+ * @brief Context of the init and rescan bus jobs
+ * 
+ * inventory is the shared buffer, held by the caller: the stored inventory
+ * going in (if loaded), the discovered one coming out. NVS is read before
+ * and written after the job, in the caller's task.
+ */
+typedef struct {
+    bool force_discovery;       // Ignore the stored inventory (rescan)
+    bool loaded;                // inventory holds the stored record
+    bool discovered;            // Out: full discovery ran, inventory holds the result
+    sensor_inventory_t *inventory;  // NULL if the buffer was unavailable
+} sensor_init_ctx_t;
+
+/**
+ * @brief Initialize all sensors (bus job)
+ */
+static esp_err_t sensor_manager_init_job(void *arg) {
+    sensor_init_ctx_t *ctx = (sensor_init_ctx_t *)arg;
+    int64_t start_us = esp_timer_get_time();
+    
     ESP_LOGI(TAG, "Initializing sensor manager");
     
     i2c_master_bus_handle_t bus_handle = i2c_scanner_get_bus_handle();
@@ -70,76 +416,71 @@ esp_err_t sensor_manager_init(void) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Initialize MAX17048 battery monitor at 0x36
-    if (i2c_scanner_device_exists(0x36)) {
-        ESP_LOGI(TAG, "MAX17048 battery monitor detected at 0x36");
-        esp_err_t ret = max17048_init(&s_battery_monitor, bus_handle);
-        if (ret == ESP_OK) {
-            s_battery_available = true;
-            ESP_LOGI(TAG, "✓ MAX17048 initialized successfully");
-            
-            // Read initial values
-            float voltage, soc;
-            if (max17048_read_voltage(&s_battery_monitor, &voltage) == ESP_OK &&
-                max17048_read_soc(&s_battery_monitor, &soc) == ESP_OK) {
-                ESP_LOGI(TAG, "  Battery: %.2f V, %.1f%%", voltage, soc);
-            }
-        } else {
-            ESP_LOGW(TAG, "Failed to initialize MAX17048");
+    // Warm path: same sensors at the same addresses as last time
+    bool restored = false;
+    if (!ctx->force_discovery && ctx->loaded) {
+        restored = sensor_manager_restore_inventory(bus_handle, ctx->inventory);
+        if (!restored) {
+            ESP_LOGI(TAG, "Sensor inventory changed, running full discovery");
+            sensor_manager_deinit();
         }
     }
     
-    // Initialize EZO sensors
-    // Scan for EZO sensors at known addresses (excluding 0x36 which is MAX17048)
-    uint8_t ezo_addresses[] = {0x16, 0x63, 0x64, 0x6F};
-    
-    for (int i = 0; i < sizeof(ezo_addresses) && s_ezo_count < MAX_EZO_SENSORS; i++) {
-        uint8_t addr = ezo_addresses[i];
-        
-        if (i2c_scanner_device_exists(addr)) {
-            ESP_LOGI(TAG, "EZO sensor detected at 0x%02X", addr);
-            
-            esp_err_t ret = ezo_sensor_init(&s_ezo_sensors[s_ezo_count], bus_handle, addr);
-            if (ret == ESP_OK) {
-                ezo_sensor_t *sensor = &s_ezo_sensors[s_ezo_count];
-                
-                ESP_LOGI(TAG, "✓ EZO sensor initialized: Type=%s, Name=%s, FW=%s", 
-                         sensor->config.type, sensor->config.name, sensor->config.firmware_version);
-                
-                // Map sensor type to index
-                if (strcmp(sensor->config.type, EZO_TYPE_RTD) == 0) {
-                    s_rtd_index = s_ezo_count;
-                    ESP_LOGI(TAG, "  → Temperature sensor (RTD)");
-                } else if (strcmp(sensor->config.type, EZO_TYPE_PH) == 0) {
-                    s_ph_index = s_ezo_count;
-                    ESP_LOGI(TAG, "  → pH sensor");
-                } else if (strcmp(sensor->config.type, EZO_TYPE_EC) == 0) {
-                    s_ec_index = s_ezo_count;
-                    ESP_LOGI(TAG, "  → Electrical Conductivity sensor");
-                } else if (strcmp(sensor->config.type, EZO_TYPE_DO) == 0) {
-                    s_do_index = s_ezo_count;
-                    ESP_LOGI(TAG, "  → Dissolved Oxygen sensor");
-                } else if (strcmp(sensor->config.type, EZO_TYPE_ORP) == 0) {
-                    s_orp_index = s_ezo_count;
-                    ESP_LOGI(TAG, "  → ORP sensor");
-                } else if (strcmp(sensor->config.type, EZO_TYPE_HUM) == 0) {
-                    s_hum_index = s_ezo_count;
-                    ESP_LOGI(TAG, "  → Humidity sensor");
-                }
-                
-                s_ezo_count++;
-            } else {
-                ESP_LOGW(TAG, "Failed to initialize EZO sensor at 0x%02X", addr);
-            }
+    if (!restored) {
+        sensor_manager_discover(bus_handle);
+        if (ctx->inventory != NULL) {
+            sensor_manager_fill_inventory(ctx->inventory);
+            ctx->discovered = true;
         }
     }
     
-    ESP_LOGI(TAG, "Sensor manager initialized: Battery=%s, EZO sensors=%d",
-             s_battery_available ? "YES" : "NO", s_ezo_count);
+    // New inventory - every sensor starts on the default schedule
+    portENTER_CRITICAL(&s_sched_lock);
+    memset(s_schedules, 0, sizeof(s_schedules));
+    for (int i = 0; i < SENSOR_MAX_SENSORS; i++) {
+        s_schedules[i].reschedule = true;
+    }
+    portEXIT_CRITICAL(&s_sched_lock);
+    sensor_manager_notify_scheduler(SCHED_DIRTY_INVENTORY);
+    
+    ESP_LOGI(TAG, "Sensor manager initialized in %lu ms (%s): Battery=%s, EZO sensors=%d",
+             (unsigned long)((esp_timer_get_time() - start_us) / 1000),
+             restored ? "stored inventory" : "full discovery",
+             s_battery_available ? "YES" : "NO", s_registry.count);
     
     return ESP_OK;
 }
 
+/**
+ * @brief Run the init or rescan job with the inventory loaded before and saved after
+ */
+static esp_err_t sensor_manager_run_init(i2c_arbiter_job_t job, bool force_discovery) {
+    sensor_init_ctx_t ctx = {
+        .force_discovery = force_discovery,
+        .inventory = sensor_inventory_acquire(),
+    };
+    if (ctx.inventory != NULL && !force_discovery) {
+        ctx.loaded = (sensor_inventory_load() == ESP_OK);
+    }
+    
+    esp_err_t ret = i2c_arbiter_run(I2C_ARBITER_PRIO_CONFIG, job, &ctx);
+    
+    if (ctx.inventory != NULL) {
+        if (ret == ESP_OK && ctx.discovered) {
+            sensor_inventory_save();
+        }
+        sensor_inventory_release();
+    }
+    return ret;
+}
+
+/**
+ * @brief Initialize all sensors
+ */
+esp_err_t sensor_manager_init(void) {
+    return sensor_manager_run_init(sensor_manager_init_job, false);
+}
+
 /**
  * @brief Deinitialize all sensors
  */
@@ -151,16 +492,13 @@ esp_err_t sensor_manager_deinit(void) {
     }
     
     // Deinitialize EZO sensors
-    for (int i = 0; i < s_ezo_count; i++) {
+    for (int i = 0; i < s_registry.count; i++) {
         ezo_sensor_deinit(&s_ezo_sensors[i]);
     }
-    s_ezo_count = 0;
-    s_rtd_index = -1;
-    s_ph_index = -1;
-    s_ec_index = -1;
-    s_do_index = -1;
-    s_orp_index = -1;
-    s_hum_index = -1;
+    memset(&s_registry, 0, sizeof(s_registry));
+    atomic_store(&s_read_pending, 0);
+    atomic_store(&s_comp_unsupported, 0);
+    memset(s_command_until_us, 0, sizeof(s_command_until_us));
     
     // Clear cached readings
     memset(s_cached_readings, 0, sizeof(s_cached_readings));
@@ -169,6 +507,27 @@ esp_err_t sensor_manager_deinit(void) {
     return ESP_OK;
 }
 
+/**
+ * @brief One MAX17048 register read, run as a bus job
+ */
+typedef struct {
+    esp_err_t (*read)(max17048_t *device, float *value);
+    float *value;
+} battery_read_job_t;
+
+static esp_err_t battery_read_job(void *arg) {
+    battery_read_job_t *job = (battery_read_job_t *)arg;
+    return job->read(&s_battery_monitor, job->value);
+}
+
+static esp_err_t sensor_manager_read_battery(esp_err_t (*read)(max17048_t *, float *), float *value) {
+    battery_read_job_t job = {
+        .read = read,
+        .value = value,
+    };
+    return i2c_arbiter_run(I2C_ARBITER_PRIO_READ, battery_read_job, &job);
+}
+
 /**
  * @brief Read battery voltage
  */
@@ -178,7 +537,7 @@ esp_err_t sensor_manager_read_battery_voltage(float *voltage) {
         return ESP_ERR_NOT_FOUND;
     }
     
-    return max17048_read_voltage(&s_battery_monitor, voltage);
+    return sensor_manager_read_battery(max17048_read_voltage, voltage);
 }
 
 /**
@@ -190,86 +549,258 @@ esp_err_t sensor_manager_read_battery_percentage(float *percentage) {
         return ESP_ERR_NOT_FOUND;
     }
     
-    return max17048_read_soc(&s_battery_monitor, percentage);
+    return sensor_manager_read_battery(max17048_read_soc, percentage);
+}
+
+/**
+ * @brief Read battery charge rate from MAX17048
+ */
+esp_err_t sensor_manager_read_battery_rate(float *rate) {
+    if (!s_battery_available) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    return sensor_manager_read_battery(max17048_read_charge_rate, rate);
+}
+
+/**
+ * @brief Copy one sensor's entry out of the published snapshot (no I2C)
+ * 
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND before the first sweep, or
+ *         ESP_ERR_TIMEOUT if the writer kept refilling the front buffer
+ */
+static esp_err_t sensor_cache_copy_sensor(int index, cached_sensor_t *sensor, uint64_t *snapshot_us) {
+    for (int attempt = 0; attempt < CACHE_READ_RETRIES; attempt++) {
+        unsigned seq;
+        int front = sensor_cache_read_begin(&seq);
+        if (front == CACHE_EMPTY) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (front == CACHE_BUSY) {
+            continue;
+        }
+        memcpy(sensor, &s_cache_buffers[front].sensors[index], sizeof(*sensor));
+        if (snapshot_us != NULL) {
+            *snapshot_us = s_cache_buffers[front].timestamp_us;
+        }
+        if (sensor_cache_read_end(front, seq)) {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief First cached value of the EZO sensor at index (no I2C)
+ */
+static esp_err_t sensor_manager_cached_first_value(int index, float *value, uint32_t *age_ms) {
+    if (index < 0 || value == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    cached_sensor_t sensor;
+    uint64_t snapshot_us = 0;
+    esp_err_t ret = sensor_cache_copy_sensor(index, &sensor, &snapshot_us);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (!sensor.valid || sensor.value_count == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    *value = sensor.values[0];
+    if (age_ms != NULL) {
+        uint64_t sampled_us = sensor.timestamp_us ? sensor.timestamp_us : snapshot_us;
+        *age_ms = (uint32_t)((esp_timer_get_time() - (int64_t)sampled_us) / 1000);
+    }
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_get_cached_value(const char *sensor_type, float *value, uint32_t *age_ms) {
+    if (sensor_type == NULL || value == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    int index = sensor_manager_find_sensor(sensor_kind_from_type(sensor_type), 0);
+    if (index < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return sensor_manager_cached_first_value(index, value, age_ms);
+}
+
+esp_err_t sensor_manager_get_cached_battery(float *percentage, uint32_t *age_ms) {
+    if (percentage == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    float battery_pct = 0.0f;
+    bool battery_valid = false;
+    uint64_t snapshot_us = 0;
+    bool copied = false;
+    for (int attempt = 0; attempt < CACHE_READ_RETRIES && !copied; attempt++) {
+        unsigned seq;
+        int front = sensor_cache_read_begin(&seq);
+        if (front == CACHE_EMPTY) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (front == CACHE_BUSY) {
+            continue;
+        }
+        battery_pct = s_cache_buffers[front].battery_percentage;
+        battery_valid = s_cache_buffers[front].battery_valid;
+        snapshot_us = s_cache_buffers[front].timestamp_us;
+        copied = sensor_cache_read_end(front, seq);
+    }
+    if (!copied) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (!battery_valid) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    *percentage = battery_pct;
+    if (age_ms != NULL) {
+        *age_ms = (uint32_t)((esp_timer_get_time() - (int64_t)snapshot_us) / 1000);
+    }
+    return ESP_OK;
 }
 
 /**
- * @brief Read temperature from EZO-RTD
+ * @brief Read temperature from EZO-RTD (cached)
  */
 esp_err_t sensor_manager_read_temperature(float *temperature) {
-    if (s_rtd_index < 0) {
+    int index = sensor_manager_find_sensor(SENSOR_KIND_RTD, 0);
+    if (index < 0) {
         ESP_LOGD(TAG, "RTD sensor not available");
         return ESP_ERR_NOT_FOUND;
     }
     
-    return ezo_sensor_read(&s_ezo_sensors[s_rtd_index], temperature);
+    return sensor_manager_cached_first_value(index, temperature, NULL);
 }
 
 /**
- * @brief Read pH from EZO-pH
+ * @brief Read pH from EZO-pH (cached)
  */
 esp_err_t sensor_manager_read_ph(float *ph) {
-    if (s_ph_index < 0) {
+    int index = sensor_manager_find_sensor(SENSOR_KIND_PH, 0);
+    if (index < 0) {
         ESP_LOGD(TAG, "pH sensor not available");
         return ESP_ERR_NOT_FOUND;
     }
     
-    return ezo_sensor_read(&s_ezo_sensors[s_ph_index], ph);
+    return sensor_manager_cached_first_value(index, ph, NULL);
 }
 
 /**
- * @brief Read EC from EZO-EC
+ * @brief Read EC from EZO-EC (cached)
  */
 esp_err_t sensor_manager_read_ec(float *ec) {
-    if (s_ec_index < 0) {
+    int index = sensor_manager_find_sensor(SENSOR_KIND_EC, 0);
+    if (index < 0) {
         ESP_LOGD(TAG, "EC sensor not available");
         return ESP_ERR_NOT_FOUND;
     }
     
-    return ezo_sensor_read(&s_ezo_sensors[s_ec_index], ec);
+    return sensor_manager_cached_first_value(index, ec, NULL);
 }
 
 /**
- * @brief Read DO from EZO-DO
+ * @brief Read DO from EZO-DO (cached)
  */
 esp_err_t sensor_manager_read_do(float *dox) {
-    if (s_do_index < 0) {
+    int index = sensor_manager_find_sensor(SENSOR_KIND_DO, 0);
+    if (index < 0) {
         ESP_LOGD(TAG, "DO sensor not available");
         return ESP_ERR_NOT_FOUND;
     }
     
-    return ezo_sensor_read(&s_ezo_sensors[s_do_index], dox);
+    return sensor_manager_cached_first_value(index, dox, NULL);
 }
 
 /**
- * @brief Read ORP from EZO-ORP
+ * @brief Read ORP from EZO-ORP (cached)
  */
 esp_err_t sensor_manager_read_orp(float *orp) {
-    if (s_orp_index < 0) {
+    int index = sensor_manager_find_sensor(SENSOR_KIND_ORP, 0);
+    if (index < 0) {
         ESP_LOGD(TAG, "ORP sensor not available");
         return ESP_ERR_NOT_FOUND;
     }
     
-    return ezo_sensor_read(&s_ezo_sensors[s_orp_index], orp);
+    return sensor_manager_cached_first_value(index, orp, NULL);
 }
 
 /**
- * @brief Read humidity from EZO-HUM
+ * @brief Read humidity from EZO-HUM (cached)
  */
 esp_err_t sensor_manager_read_humidity(float *humidity) {
-    if (s_hum_index < 0) {
+    int index = sensor_manager_find_sensor(SENSOR_KIND_HUM, 0);
+    if (index < 0) {
         ESP_LOGD(TAG, "Humidity sensor not available");
         return ESP_ERR_NOT_FOUND;
     }
     
-    return ezo_sensor_read(&s_ezo_sensors[s_hum_index], humidity);
+    return sensor_manager_cached_first_value(index, humidity, NULL);
+}
+
+int sensor_manager_find_sensor(sensor_kind_t kind, uint8_t ordinal) {
+    if (kind >= SENSOR_KIND_COUNT) {
+        return -1;
+    }
+    
+    // Drop the lowest set bits until the requested one is lowest
+    uint32_t mask = s_registry.kind_mask[kind];
+    for (uint8_t n = 0; n < ordinal && mask != 0; n++) {
+        mask &= mask - 1;
+    }
+    return (mask != 0) ? __builtin_ctz(mask) : -1;
+}
+
+int sensor_manager_find_by_key(const char *key) {
+    if (key == NULL || key[0] == '\0') {
+        return -1;
+    }
+    
+    char *end = NULL;
+    unsigned long index = strtoul(key, &end, 10);
+    if (*end == '\0') {
+        return (index < s_registry.count) ? (int)index : -1;
+    }
+    
+    // "<type>" or "<type>_<n>", n counting from 2
+    size_t name_len = strlen(key);
+    uint8_t ordinal = 0;
+    const char *suffix = strrchr(key, '_');
+    if (suffix != NULL && suffix[1] != '\0') {
+        unsigned long n = strtoul(suffix + 1, &end, 10);
+        if (*end == '\0' && n >= 2 && n <= SENSOR_MAX_SENSORS) {
+            name_len = (size_t)(suffix - key);
+            ordinal = (uint8_t)(n - 1);
+        }
+    }
+    
+    for (int kind = 0; kind < SENSOR_KIND_COUNT; kind++) {
+        if (strlen(s_kind_names[kind]) == name_len && strncasecmp(key, s_kind_names[kind], name_len) == 0) {
+            return sensor_manager_find_sensor((sensor_kind_t)kind, ordinal);
+        }
+    }
+    return -1;
+}
+
+uint8_t sensor_manager_count_kind(sensor_kind_t kind) {
+    return (kind < SENSOR_KIND_COUNT) ? (uint8_t)__builtin_popcount(s_registry.kind_mask[kind]) : 0;
+}
+
+sensor_kind_t sensor_manager_get_sensor_kind(uint8_t index) {
+    return (index < s_registry.count) ? (sensor_kind_t)s_registry.kind[index] : SENSOR_KIND_UNKNOWN;
 }
 
 /**
  * @brief Get number of EZO sensors
  */
 uint8_t sensor_manager_get_ezo_count(void) {
-    return s_ezo_count;
+    return s_registry.count;
 }
 
 /**
@@ -283,145 +814,937 @@ bool sensor_manager_has_battery_monitor(void) {
  * @brief Get EZO sensor handle by index
  */
 void* sensor_manager_get_ezo_sensor(uint8_t index) {
-    if (index >= s_ezo_count) {
+    if (index >= s_registry.count) {
         return NULL;
     }
     return &s_ezo_sensors[index];
 }
 
 /**
- * @brief Read all values from an EZO sensor by index
+ * @brief Update the per-sensor fallback cache from a read result
  * 
- * This function attempts to read fresh sensor data. If the read fails or the sensor
- * is not ready, it returns cached data from the last successful read (if available).
+ * Reading task only: s_cached_readings has no lock. On success the fresh
+ * values are cached. On failure the last successful values are returned
+ * instead, as long as they are younger than CACHE_TIMEOUT_MS.
  */
-esp_err_t sensor_manager_read_ezo_sensor(uint8_t index, char *sensor_type, float values[4], uint8_t *count) {
-    if (index >= s_ezo_count || sensor_type == NULL || values == NULL || count == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    ezo_sensor_t *sensor = &s_ezo_sensors[index];
-    
-    // Debug: Log the sensor type from config
-    ESP_LOGD(TAG, "Reading sensor index %d: type='%s' (addr=0x%02X)", 
-             index, sensor->config.type, sensor->config.i2c_address);
+static esp_err_t sensor_manager_resolve_reading(uint8_t index, esp_err_t read_ret,
+                                                float values[4], uint8_t *count) {
+    cached_sensor_data_t *cache = &s_cached_readings[index];
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
     
-    strncpy(sensor_type, sensor->config.type, 15);
-    sensor_type[15] = '\0';
-    
-    // Try to read fresh data from sensor
-    esp_err_t ret = ezo_sensor_read_all(sensor, values, count);
-    
-    if (ret == ESP_OK) {
+    if (read_ret == ESP_OK) {
         // Success - cache the new readings
-        cached_sensor_data_t *cache = &s_cached_readings[index];
         for (uint8_t i = 0; i < *count && i < 4; i++) {
             cache->values[i] = values[i];
         }
         cache->count = *count;
         cache->valid = true;
-        cache->timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        cache->timestamp_ms = now_ms;
         return ESP_OK;
-    } else {
-        // Read failed - try to use cached data
-        cached_sensor_data_t *cache = &s_cached_readings[index];
-        uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        
-        if (cache->valid && (now_ms - cache->timestamp_ms) < CACHE_TIMEOUT_MS) {
-            // Return cached data
-            for (uint8_t i = 0; i < cache->count && i < 4; i++) {
-                values[i] = cache->values[i];
-            }
-            *count = cache->count;
-            ESP_LOGD(TAG, "Sensor 0x%02X read failed, using cached data (%lu ms old)", 
-                     sensor->config.i2c_address, now_ms - cache->timestamp_ms);
-            return ESP_OK;
+    }
+    
+    // Read failed - try to use cached data
+    if (cache->valid && (now_ms - cache->timestamp_ms) < CACHE_TIMEOUT_MS) {
+        for (uint8_t i = 0; i < cache->count && i < 4; i++) {
+            values[i] = cache->values[i];
         }
-        
-        // No valid cache available
-        return ret;
+        *count = cache->count;
+        ESP_LOGD(TAG, "Sensor 0x%02X read failed, using cached data (%lu ms old)", 
+                 s_ezo_sensors[index].config.i2c_address, (unsigned long)(now_ms - cache->timestamp_ms));
+        return ESP_OK;
     }
+    
+    // No valid cache available
+    return read_ret;
 }
 
 /**
- * @brief Rescan I2C bus and reinitialize sensors
+ * @brief Bus job: send "R" to every sensor in the batch
  */
-esp_err_t sensor_manager_rescan(void) {
-    ESP_LOGI(TAG, "Rescanning I2C bus for sensors");
-    
-    // Deinitialize existing sensors
-    sensor_manager_deinit();
+static esp_err_t ezo_batch_trigger_job(void *arg) {
+    ezo_read_batch_t *batch = (ezo_read_batch_t *)arg;
     
-    // Reinitialize all sensors
-    return sensor_manager_init();
-}
-
+    for (uint8_t n = 0; n < batch->slot_count; n++) {
+        uint8_t i = batch->slots[n];
+        if (i >= s_registry.count) {
+            batch->read_ret[n] = ESP_ERR_INVALID_ARG;   // Rescanned meanwhile
+            continue;
+        }
+        if (atomic_load(&s_read_pending) & (1u << i)) {
+            batch->read_ret[n] = ESP_ERR_INVALID_STATE; // Another reader has a conversion running
+            continue;
+        }
+        if (s_command_until_us[i] > esp_timer_get_time()) {
+            batch->read_ret[n] = ESP_ERR_INVALID_STATE; // Processing a command, the response is not ours
+            continue;
+        }
+        
+        ezo_sensor_t *sensor = &s_ezo_sensors[i];
+        if (!isnan(batch->comp_temp_c) && ezo_sensor_supports_compensation(sensor) &&
+            !(atomic_load(&s_comp_unsupported) & (1u << i))) {
+            batch->read_ret[n] = ezo_sensor_start_compensated_read(sensor, batch->comp_temp_c);
+            if (batch->read_ret[n] == ESP_OK) {
+                batch->compensated |= 1u << n;
+            }
+        } else {
+            batch->read_ret[n] = ezo_sensor_start_read(sensor);
+        }
+        if (batch->read_ret[n] == ESP_OK) {
+            atomic_fetch_or(&s_read_pending, 1u << i);
+            batch->outstanding |= 1u << n;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Bus job: one status check on every sensor still converting
+ */
+static esp_err_t ezo_batch_fetch_job(void *arg) {
+    ezo_read_batch_t *batch = (ezo_read_batch_t *)arg;
+    
+    for (uint8_t n = 0; n < batch->slot_count; n++) {
+        if (!(batch->outstanding & (1u << n))) {
+            continue;
+        }
+        
+        uint8_t i = batch->slots[n];
+        cached_sensor_t *cached = &batch->sensors[i - batch->sensors_base];
+        esp_err_t ret = ezo_sensor_fetch_read(&s_ezo_sensors[i], cached->values, &cached->value_count);
+        if (ret == ESP_ERR_NOT_FINISHED) {
+            continue;
+        }
+        
+        if (ret == ESP_ERR_INVALID_ARG && (batch->compensated & (1u << n))) {
+            ESP_LOGW(TAG, "Sensor 0x%02X rejected RT; reading without compensation from now on",
+                     s_registry.address[i]);
+            atomic_fetch_or(&s_comp_unsupported, 1u << i);
+        }
+        
+        batch->read_ret[n] = ret;
+        batch->outstanding &= ~(1u << n);
+        atomic_fetch_and(&s_read_pending, ~(1u << i));
+        if (ret == ESP_OK) {
+            cached->timestamp_us = esp_timer_get_time();
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief RTD reading in °C, or NAN if it cannot be used for compensation
+ */
+static float sensor_manager_comp_temperature(uint8_t rtd_index, float value) {
+    switch (s_ezo_sensors[rtd_index].config.rtd.temperature_scale) {
+        case 'f':
+        case 'F':
+            value = (value - 32.0f) * 5.0f / 9.0f;
+            break;
+        case 'k':
+        case 'K':
+            value -= 273.15f;
+            break;
+        default:
+            break;
+    }
+    return (value >= COMP_TEMP_MIN_C && value <= COMP_TEMP_MAX_C) ? value : NAN;
+}
+
+/**
+ * @brief Last published sample of a sensor, if younger than CACHE_TIMEOUT_MS
+ * 
+ * Goes through the seqlock, so any task may call it.
+ */
+static bool sensor_manager_recent_sample(int index, cached_sensor_t *sensor) {
+    if (sensor_cache_copy_sensor(index, sensor, NULL) != ESP_OK) {
+        return false;
+    }
+    return sensor->valid && sensor->value_count > 0 && sensor->timestamp_us != 0 &&
+           (esp_timer_get_time() - (int64_t)sensor->timestamp_us) < (int64_t)CACHE_TIMEOUT_MS * 1000;
+}
+
+/**
+ * @brief Compensation temperature from the last successful RTD read
+ */
+static float sensor_manager_cached_comp_temperature(void) {
+    int rtd = sensor_manager_find_sensor(SENSOR_KIND_RTD, 0);
+    cached_sensor_t sensor;
+    if (rtd < 0 || !sensor_manager_recent_sample(rtd, &sensor)) {
+        return NAN;
+    }
+    return sensor_manager_comp_temperature((uint8_t)rtd, sensor.raw[0]);
+}
+
+/**
+ * @brief Read several EZO sensors without holding the bus during conversion
+ * 
+ * Every sensor is triggered back-to-back, the caller sleeps for the slowest
+ * typical conversion with the bus free for other jobs, then responses are
+ * collected with short status checks on a backoff until each sensor's own
+ * read timeout.
+ */
+static void sensor_manager_read_ezo_batch(ezo_read_batch_t *batch) {
+    TickType_t start = xTaskGetTickCount();
+    uint32_t wait_ms = 0;
+    
+    batch->outstanding = 0;
+    batch->compensated = 0;
+    i2c_arbiter_run(I2C_ARBITER_PRIO_READ, ezo_batch_trigger_job, batch);
+    
+    for (uint8_t n = 0; n < batch->slot_count; n++) {
+        if (batch->outstanding & (1u << n)) {
+            uint32_t read_time_ms = ezo_sensor_get_read_time_ms(&s_ezo_sensors[batch->slots[n]]);
+            if (read_time_ms > wait_ms) {
+                wait_ms = read_time_ms;
+            }
+        }
+    }
+    
+    if (batch->outstanding == 0) {
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(wait_ms));
+    
+    uint32_t interval_ms = EZO_POLL_MIN_MS;
+    while (1) {
+        i2c_arbiter_run(I2C_ARBITER_PRIO_READ, ezo_batch_fetch_job, batch);
+        
+        uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        for (uint8_t n = 0; n < batch->slot_count; n++) {
+            uint8_t i = batch->slots[n];
+            if ((batch->outstanding & (1u << n)) &&
+                elapsed_ms >= ezo_sensor_get_read_timeout_ms(&s_ezo_sensors[i])) {
+                ESP_LOGW(TAG, "Sensor 0x%02X still busy after %lu ms",
+                         s_ezo_sensors[i].config.i2c_address, (unsigned long)elapsed_ms);
+                batch->read_ret[n] = ESP_ERR_NOT_FINISHED;
+                batch->outstanding &= ~(1u << n);
+                atomic_fetch_and(&s_read_pending, ~(1u << i));
+            }
+        }
+        
+        if (batch->outstanding == 0) {
+            return;
+        }
+        
+        vTaskDelay(pdMS_TO_TICKS(interval_ms));
+        interval_ms *= 2;
+        if (interval_ms > EZO_POLL_MAX_MS) {
+            interval_ms = EZO_POLL_MAX_MS;
+        }
+    }
+}
+
+/**
+ * @brief Read all values from an EZO sensor by index
+ * 
+ * This function attempts to read fresh sensor data. If the read fails or the sensor
+ * is not ready, it returns cached data from the last successful read (if available).
+ */
+esp_err_t sensor_manager_read_ezo_sensor(uint8_t index, char *sensor_type, float values[4], uint8_t *count) {
+    if (index >= s_registry.count || sensor_type == NULL || values == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ezo_sensor_t *sensor = &s_ezo_sensors[index];
+    
+    // Debug: Log the sensor type from config
+    ESP_LOGD(TAG, "Reading sensor index %d: type='%s' (addr=0x%02X)", 
+             index, sensor->config.type, sensor->config.i2c_address);
+    
+    strncpy(sensor_type, sensor->config.type, 15);
+    sensor_type[15] = '\0';
+    
+    // Try to read fresh data from sensor
+    cached_sensor_t reading;
+    esp_err_t ret = ESP_FAIL;
+    ezo_read_batch_t batch = {
+        .slots = &index,
+        .slot_count = 1,
+        .sensors = &reading,
+        .sensors_base = index,
+        .read_ret = &ret,
+        .comp_temp_c = sensor_manager_cached_comp_temperature(),
+    };
+    sensor_manager_read_ezo_batch(&batch);
+    if (ret == ESP_OK) {
+        *count = reading.value_count;
+        memcpy(values, reading.values, sizeof(float) * MAX_SENSOR_VALUES);
+        return ESP_OK;
+    }
+    
+    // The fallback cache belongs to the reading task; use its published sample
+    cached_sensor_t cached;
+    if (!sensor_manager_recent_sample(index, &cached)) {
+        return ret;
+    }
+    *count = cached.value_count;
+    memcpy(values, cached.raw, sizeof(float) * MAX_SENSOR_VALUES);
+    ESP_LOGD(TAG, "Sensor 0x%02X read failed, using cached data", sensor->config.i2c_address);
+    return ESP_OK;
+}
+
+esp_err_t sensor_ezo_commands_add(sensor_ezo_commands_t *commands, const char *fmt, ...) {
+    if (commands == NULL || fmt == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    size_t room = sizeof(commands->buf) - commands->len;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(commands->buf + commands->len, room, fmt, args);
+    va_end(args);
+    
+    if (len <= 0 || (size_t)len >= room) {
+        commands->buf[commands->len] = '\0';
+        commands->overflow = true;
+        return ESP_ERR_NO_MEM;
+    }
+    commands->len += (uint8_t)(len + 1);
+    return ESP_OK;
+}
+
+/**
+ * @brief Commands to a single EZO sensor, run as an async bus job
+ * 
+ * The arbiter keeps this copy across deferrals, so each run picks up where
+ * the last one stopped: collect the pending response, then send the next
+ * command and defer until it has been processed.
+ */
+typedef struct {
+    uint8_t index;
+    uint8_t address;            // Guards against the slot changing on rescan
+    uint8_t len;                // Bytes used in commands
+    uint8_t next;               // Offset of the next command to send
+    uint8_t current;            // Offset of the command awaiting its response
+    bool awaiting;
+    esp_err_t result;           // First failure
+    int64_t ready_us;           // First status check not before this
+    int64_t deadline_us;        // Give up on the response after this
+    char commands[SENSOR_EZO_COMMANDS_MAX];
+} ezo_command_job_t;
+
+_Static_assert(sizeof(ezo_command_job_t) <= I2C_ARBITER_ASYNC_CTX_MAX,
+               "EZO command context does not fit an arbiter job");
+
+static esp_err_t ezo_command_job(void *arg) {
+    ezo_command_job_t *cmd = (ezo_command_job_t *)arg;
+    
+    if (cmd->index >= s_registry.count || s_ezo_sensors[cmd->index].config.i2c_address != cmd->address) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (atomic_load(&s_read_pending) & (1u << cmd->index)) {
+        // Its next response frame belongs to a reading: let the sweep collect it first
+        return I2C_ARBITER_DEFER;
+    }
+    
+    ezo_sensor_t *sensor = &s_ezo_sensors[cmd->index];
+    int64_t now_us = esp_timer_get_time();
+    
+    if (cmd->awaiting) {
+        if (now_us < cmd->ready_us) {
+            return I2C_ARBITER_DEFER;
+        }
+        esp_err_t ret = ezo_sensor_fetch_response(sensor, NULL, 0);
+        if (ret == ESP_ERR_NOT_FINISHED && now_us < cmd->deadline_us) {
+            return I2C_ARBITER_DEFER;
+        }
+        
+        const char *command = &cmd->commands[cmd->current];
+        cmd->awaiting = false;
+        s_command_until_us[cmd->index] = 0;
+        if (ret == ESP_OK) {
+            if (ezo_sensor_command_applied(sensor, command)) {
+                // Keep the stored copy in step so the next boot restores the new settings.
+                // The reading task writes it; the flash write must not hold the bus.
+                atomic_store(&s_inventory_dirty, true);
+                if (s_reading_task_handle != NULL) {
+                    xTaskNotifyGive(s_reading_task_handle);
+                }
+            }
+        } else {
+            ESP_LOGW(TAG, "Sensor 0x%02X: \"%s\" failed: %s", cmd->address, command, esp_err_to_name(ret));
+            if (cmd->result == ESP_OK) {
+                cmd->result = ret;
+            }
+        }
+    }
+    
+    // Send the next command; a later run collects its response
+    while (cmd->next < cmd->len) {
+        const char *command = &cmd->commands[cmd->next];
+        cmd->current = cmd->next;
+        cmd->next += (uint8_t)(strlen(command) + 1);
+        
+        uint32_t ready_ms = 0;
+        uint32_t timeout_ms = 0;
+        esp_err_t ret = ezo_sensor_start_command(sensor, command, &ready_ms, &timeout_ms);
+        if (ret != ESP_OK) {
+            if (cmd->result == ESP_OK) {
+                cmd->result = ret;
+            }
+            continue;
+        }
+        if (timeout_ms == 0) {
+            continue;   // No response will come
+        }
+        
+        cmd->ready_us = now_us + (int64_t)ready_ms * 1000;
+        cmd->deadline_us = now_us + (int64_t)timeout_ms * 1000;
+        cmd->awaiting = true;
+        s_command_until_us[cmd->index] = cmd->deadline_us;
+        return I2C_ARBITER_DEFER;
+    }
+    
+    return cmd->result;
+}
+
+esp_err_t sensor_manager_ezo_command(uint8_t index, i2c_arbiter_prio_t prio,
+                                     const sensor_ezo_commands_t *commands, uint32_t *job_id) {
+    if (index >= s_registry.count || commands == NULL || commands->overflow ||
+        commands->len > SENSOR_EZO_COMMANDS_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ezo_command_job_t cmd = {
+        .index = index,
+        .address = s_ezo_sensors[index].config.i2c_address,
+        .len = commands->len,
+    };
+    memcpy(cmd.commands, commands->buf, commands->len);
+    
+    return i2c_arbiter_submit(prio, ezo_command_job, &cmd, sizeof(cmd), job_id);
+}
+
+/**
+ * @brief Rescan as a single bus job so no reading interleaves with re-init
+ */
+static esp_err_t sensor_manager_rescan_job(void *arg) {
+    // Deinitialize existing sensors
+    sensor_manager_deinit();
+    
+    // Reinitialize all sensors, ignoring the stored inventory
+    return sensor_manager_init_job(arg);
+}
+
+/**
+ * @brief Rescan I2C bus and reinitialize sensors
+ */
+esp_err_t sensor_manager_rescan(void) {
+    ESP_LOGI(TAG, "Rescanning I2C bus for sensors");
+    
+    return sensor_manager_run_init(sensor_manager_rescan_job, true);
+}
+
+/**
+ * @brief Publish a completed snapshot to readers
+ * 
+ * Only the reading task calls this, so there is a single writer.
+ */
+static void sensor_cache_publish(const sensor_cache_t *snapshot) {
+    int front = atomic_load_explicit(&s_cache_front, memory_order_relaxed);
+    int back = (front == 0) ? 1 : 0;
+    
+    atomic_fetch_add_explicit(&s_cache_seq[back], 1, memory_order_relaxed);   // odd: writing
+    atomic_thread_fence(memory_order_release);
+    memcpy(&s_cache_buffers[back], snapshot, sizeof(sensor_cache_t));
+    atomic_fetch_add_explicit(&s_cache_seq[back], 1, memory_order_release);   // even: stable
+    
+    atomic_store_explicit(&s_cache_front, back, memory_order_release);
+}
+
+/**
+ * @brief Start a seqlock read of the front buffer
+ * 
+ * Readers copy only what they need between this and sensor_cache_read_end(),
+ * so a getter for one value does not put the whole snapshot on its stack.
+ * 
+ * @return int Front buffer index, CACHE_EMPTY before the first sweep, or
+ *         CACHE_BUSY while the writer is refilling it (re-read the front index)
+ */
+static int sensor_cache_read_begin(unsigned *seq) {
+    int front = atomic_load_explicit(&s_cache_front, memory_order_acquire);
+    if (front < 0) {
+        return CACHE_EMPTY;
+    }
+    *seq = atomic_load_explicit(&s_cache_seq[front], memory_order_acquire);
+    return (*seq & 1) ? CACHE_BUSY : front;
+}
+
+/**
+ * @brief Finish a seqlock read: true if the copy is consistent
+ */
+static bool sensor_cache_read_end(int front, unsigned seq) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&s_cache_seq[front], memory_order_relaxed) == seq;
+}
+
+/**
+ * @brief Run a reading through its sensor's filter
+ * 
+ * Keeps the parsed values in cached->raw. A fresh sample advances the
+ * filter; a stale cache fallback repeats the last filtered output instead.
+ */
+static void sensor_manager_filter_reading(uint8_t index, cached_sensor_t *cached, bool fresh) {
+    sensor_filter_config_t filter;
+    portENTER_CRITICAL(&s_filter_lock);
+    filter = s_filter_cfg[index];
+    portEXIT_CRITICAL(&s_filter_lock);
+    
+    if (atomic_fetch_and(&s_filter_dirty, ~(1u << index)) & (1u << index)) {
+        for (uint8_t ch = 0; ch < MAX_SENSOR_VALUES; ch++) {
+            sensor_filter_reset(&s_filter_state[index][ch]);
+        }
+    }
+    
+    memcpy(cached->raw, cached->values, sizeof(cached->raw));
+    cached->rejected = 0;
+    for (uint8_t ch = 0; ch < cached->value_count && ch < MAX_SENSOR_VALUES; ch++) {
+        sensor_filter_state_t *state = &s_filter_state[index][ch];
+        if (fresh) {
+            bool rejected = false;
+            cached->values[ch] = sensor_filter_apply(&filter, state, cached->raw[ch], &rejected);
+            if (rejected) {
+                cached->rejected |= 1u << ch;
+                ESP_LOGD(TAG, "Sensor %u ch %u: outlier %.3f replaced by %.3f",
+                         index, ch, cached->raw[ch], cached->values[ch]);
+            }
+        } else if (state->has_output) {
+            cached->values[ch] = state->output;
+        }
+    }
+}
+
+/**
+ * @brief Read battery, RSSI and the given EZO sensors into a snapshot
+ * 
+ * EZO sensors are read in two phases: every listed sensor is triggered
+ * back-to-back, the task waits once for the slowest typical conversion, then
+ * all responses are collected (see sensor_manager_read_ezo_batch()). Each I2C
+ * transaction is a separate arbiter job. Slots that are not listed keep their
+ * previous values. sensors[i] always corresponds to EZO index i.
+ * 
+ * If the RTD is listed, pH/EC/DO go in a second batch whose "RT,<temp>"
+ * carries the temperature just read, so compensation costs no extra command.
+ */
+static void sensor_manager_sweep(sensor_cache_t *snapshot, const uint8_t *slots, uint8_t slot_count) {
+    snapshot->battery_valid = false;
+    snapshot->timestamp_us = esp_timer_get_time();
+    
+    // Read battery
+    if (s_battery_available) {
+        float battery_pct;
+        if (sensor_manager_read_battery_percentage(&battery_pct) == ESP_OK) {
+            snapshot->battery_percentage = battery_pct;
+            snapshot->battery_valid = true;
+            if (sensor_manager_read_battery_rate(&snapshot->battery_rate) != ESP_OK) {
+                snapshot->battery_rate = 0.0f;
+            }
+        }
+    }
+    
+    // Read RSSI
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        snapshot->rssi = ap_info.rssi;
+    }
+    
+    // When the RTD is due too, pH/EC/DO wait for it and are read with "RT"
+    // using the fresh temperature; otherwise they use the last RTD value.
+    int rtd = sensor_manager_find_sensor(SENSOR_KIND_RTD, 0);
+    bool chain = false;
+    for (uint8_t n = 0; n < slot_count; n++) {
+        chain |= (slots[n] == rtd);
+    }
+    
+    uint8_t ordered[SENSOR_MAX_SENSORS];
+    uint8_t first_count = 0;
+    uint8_t later_count = 0;
+    for (uint8_t n = 0; n < slot_count; n++) {
+        if (!chain || !ezo_sensor_supports_compensation(&s_ezo_sensors[slots[n]])) {
+            ordered[first_count++] = slots[n];
+        }
+    }
+    for (uint8_t n = 0; n < slot_count; n++) {
+        if (chain && ezo_sensor_supports_compensation(&s_ezo_sensors[slots[n]])) {
+            ordered[first_count + later_count++] = slots[n];
+        }
+    }
+    
+    esp_err_t read_ret[SENSOR_MAX_SENSORS];
+    uint8_t valid_count = 0;
+    ezo_read_batch_t batch = {
+        .slots = ordered,
+        .slot_count = first_count,
+        .sensors = snapshot->sensors,
+        .read_ret = read_ret,
+        .comp_temp_c = chain ? NAN : sensor_manager_cached_comp_temperature(),
+    };
+    sensor_manager_read_ezo_batch(&batch);
+    
+    if (later_count > 0) {
+        float temp_c = NAN;
+        for (uint8_t n = 0; n < first_count; n++) {
+            if (ordered[n] == rtd && read_ret[n] == ESP_OK && snapshot->sensors[rtd].value_count > 0) {
+                temp_c = sensor_manager_comp_temperature((uint8_t)rtd, snapshot->sensors[rtd].values[0]);
+            }
+        }
+        if (isnan(temp_c)) {
+            temp_c = sensor_manager_cached_comp_temperature();
+        }
+        ESP_LOGD(TAG, "Compensating %u sensors at %.2f °C", later_count, temp_c);
+        
+        batch.slots = ordered + first_count;
+        batch.slot_count = later_count;
+        batch.read_ret = read_ret + first_count;
+        batch.comp_temp_c = temp_c;
+        sensor_manager_read_ezo_batch(&batch);
+    }
+    
+    for (uint8_t n = 0; n < slot_count; n++) {
+        uint8_t i = ordered[n];
+        cached_sensor_t *cached = &snapshot->sensors[i];
+        
+        cached->kind = s_registry.kind[i];
+        cached->ordinal = s_registry.ordinal[i];
+        cached->bus = s_registry.bus[i];
+        cached->address = s_registry.address[i];
+        
+        if (sensor_manager_resolve_reading(i, read_ret[n], cached->values, &cached->value_count) == ESP_OK) {
+            sensor_manager_filter_reading(i, cached, read_ret[n] == ESP_OK);
+            cached->valid = true;
+            valid_count++;
+        } else {
+            cached->valid = false;
+        }
+    }
+    snapshot->sensor_count = s_registry.count;
+    
+    if (valid_count > 0) {
+        APP_LOGI_RATE_LIMITED(TAG, 60000, "✓ Cache updated with %u of %u due sensors", valid_count, slot_count);
+    }
+}
+
+/**
+ * @brief Effective sampling period of a schedule, in microseconds
+ */
+static int64_t sched_period_us(const sensor_schedule_t *cfg) {
+    uint32_t period_sec = cfg->period_sec ? cfg->period_sec : s_reading_interval_sec;
+    if (period_sec < SCHED_MIN_PERIOD_SEC) {
+        period_sec = SCHED_MIN_PERIOD_SEC;
+    }
+    return (int64_t)period_sec * 1000000;
+}
+
+/**
+ * @brief Heap order: earlier deadline first, then higher priority
+ */
+static bool sched_before(uint8_t a, uint8_t b) {
+    if (s_schedules[a].next_due_us != s_schedules[b].next_due_us) {
+        return s_schedules[a].next_due_us < s_schedules[b].next_due_us;
+    }
+    return s_schedules[a].cfg.priority > s_schedules[b].cfg.priority;
+}
+
+static void sched_sift_down(uint8_t pos) {
+    while (1) {
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+        uint8_t best = pos;
+        
+        if (left < s_sched_heap_len && sched_before(s_sched_heap[left], s_sched_heap[best])) {
+            best = left;
+        }
+        if (right < s_sched_heap_len && sched_before(s_sched_heap[right], s_sched_heap[best])) {
+            best = right;
+        }
+        if (best == pos) {
+            return;
+        }
+        
+        uint8_t tmp = s_sched_heap[pos];
+        s_sched_heap[pos] = s_sched_heap[best];
+        s_sched_heap[best] = tmp;
+        pos = best;
+    }
+}
+
+static void sched_push(uint8_t index) {
+    uint8_t pos = s_sched_heap_len++;
+    s_sched_heap[pos] = index;
+    
+    while (pos > 0) {
+        uint8_t parent = (pos - 1) / 2;
+        if (!sched_before(s_sched_heap[pos], s_sched_heap[parent])) {
+            break;
+        }
+        uint8_t tmp = s_sched_heap[pos];
+        s_sched_heap[pos] = s_sched_heap[parent];
+        s_sched_heap[parent] = tmp;
+        pos = parent;
+    }
+}
+
+static uint8_t sched_pop(void) {
+    uint8_t index = s_sched_heap[0];
+    s_sched_heap[0] = s_sched_heap[--s_sched_heap_len];
+    sched_sift_down(0);
+    return index;
+}
+
+/**
+ * @brief Apply pending schedule changes and rebuild the deadline heap
+ */
+static void sched_rebuild(int dirty_flags, int64_t now_us) {
+    if (dirty_flags & SCHED_DIRTY_INVENTORY) {
+        // Slots may now hold different sensors - drop stale values
+        memset(&s_sweep_snapshot.sensors, 0, sizeof(s_sweep_snapshot.sensors));
+        for (int i = 0; i < SENSOR_MAX_SENSORS; i++) {
+            s_schedules[i].last_run_us = 0;
+        }
+    }
+    
+    portENTER_CRITICAL(&s_sched_lock);
+    for (uint8_t i = 0; i < s_registry.count; i++) {
+        sensor_slot_schedule_t *slot = &s_schedules[i];
+        if (!slot->reschedule) {
+            continue;
+        }
+        slot->reschedule = false;
+        
+        if (slot->last_run_us > 0) {
+            slot->next_due_us = slot->last_run_us + sched_period_us(&slot->cfg);
+        } else {
+            slot->next_due_us = now_us + (int64_t)slot->cfg.phase_ms * 1000;
+        }
+        if (slot->next_due_us < now_us) {
+            slot->next_due_us = now_us;
+        }
+    }
+    portEXIT_CRITICAL(&s_sched_lock);
+    
+    s_sched_heap_len = 0;
+    for (uint8_t i = 0; i < s_registry.count; i++) {
+        sched_push(i);
+    }
+}
+
+/**
+ * @brief Tell the reading task that schedules or the inventory changed
+ */
+static void sensor_manager_notify_scheduler(int dirty_flags) {
+    atomic_fetch_or(&s_sched_dirty, dirty_flags);
+    if (s_reading_task_handle != NULL) {
+        xTaskNotifyGive(s_reading_task_handle);
+    }
+}
+
+/**
+ * @brief Move every pending on-demand read into the sweep batch (reading task)
+ * 
+ * Call only once the previous batch has been served.
+ * 
+ * @param mask Receives the union of their sensor masks
+ * @return uint8_t Number of requests taken
+ */
+static uint8_t sensor_manager_take_read_requests(uint32_t *mask) {
+    portENTER_CRITICAL(&s_read_now_lock);
+    uint8_t count = s_read_waiter_count;
+    memcpy(s_batch_waiters, s_read_waiters, count * sizeof(sensor_read_waiter_t));
+    s_batch_waiter_count = count;
+    s_batch_waiter_next = 0;
+    *mask = s_read_now_mask;
+    s_read_waiter_count = 0;
+    s_read_now_mask = 0;
+    portEXIT_CRITICAL(&s_read_now_lock);
+    return count;
+}
+
+/**
+ * @brief Claim the next unserved request, taken ones first
+ * 
+ * @param include_pending Also claim requests not yet taken into a sweep
+ * @return bool false when none are left
+ */
+static bool sensor_manager_next_read_request(sensor_read_waiter_t *waiter, bool include_pending) {
+    bool found = false;
+    portENTER_CRITICAL(&s_read_now_lock);
+    if (s_batch_waiter_next < s_batch_waiter_count) {
+        *waiter = s_batch_waiters[s_batch_waiter_next++];
+        found = true;
+    } else if (include_pending && s_read_waiter_count > 0) {
+        *waiter = s_read_waiters[--s_read_waiter_count];
+        if (s_read_waiter_count == 0) {
+            s_read_now_mask = 0;
+        }
+        found = true;
+    }
+    portEXIT_CRITICAL(&s_read_now_lock);
+    return found;
+}
+
+/**
+ * @brief Complete every outstanding request with ESP_ERR_INVALID_STATE
+ */
+static void sensor_manager_fail_read_requests(void) {
+    sensor_read_waiter_t waiter;
+    while (sensor_manager_next_read_request(&waiter, true)) {
+        waiter.callback(ESP_ERR_INVALID_STATE, NULL, waiter.ctx);
+    }
+}
+
+/**
+ * @brief Make the requested sensors due now and restore heap order
+ */
+static void sched_read_now(uint32_t mask, int64_t now_us) {
+    bool changed = false;
+    for (uint8_t i = 0; i < s_registry.count; i++) {
+        if ((mask & (1u << i)) && s_schedules[i].next_due_us > now_us) {
+            s_schedules[i].next_due_us = now_us;
+            changed = true;
+        }
+    }
+    if (changed) {
+        s_sched_heap_len = 0;
+        for (uint8_t i = 0; i < s_registry.count; i++) {
+            sched_push(i);
+        }
+    }
+}
+
+/**
+ * @brief Completion result of one request: did every requested sensor sample fresh?
+ */
+static esp_err_t sensor_manager_read_result(const sensor_cache_t *snapshot, uint32_t mask, int64_t sweep_start_us) {
+    for (uint8_t i = 0; i < snapshot->sensor_count; i++) {
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+        const cached_sensor_t *sensor = &snapshot->sensors[i];
+        if (!sensor->valid || (int64_t)sensor->timestamp_us < sweep_start_us) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    return ESP_OK;
+}
+
 /**
  * @brief Background sensor reading task
  */
 static void sensor_reading_task(void *arg) {
-    ESP_LOGI(TAG, "Sensor reading task started (interval: %lu seconds)", s_reading_interval_sec);
-    
-    // Perform first read immediately
-    bool first_read = true;
+    ESP_LOGI(TAG, "Sensor reading task started (interval: %lu seconds)", (unsigned long)s_reading_interval_sec);
     
     while (1) {
-        // Check if reading is paused
+        if (atomic_load(&s_reading_stop)) {
+            // Nobody will serve the requests after this; wait to be deleted
+            sensor_manager_fail_read_requests();
+            xSemaphoreGive(s_reading_stopped);
+            while (1) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+        }
+        
+        if (atomic_exchange(&s_inventory_dirty, false)) {
+            sensor_manager_save_inventory();
+        }
+        
+        // Check if reading is paused (resume notifies the task)
         if (s_reading_paused) {
-            vTaskDelay(pdMS_TO_TICKS(500));
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
             continue;
         }
         
-        // Wait before next reading (except for first read)
-        if (!first_read) {
-            vTaskDelay(pdMS_TO_TICKS(s_reading_interval_sec * 1000));
+        int dirty_flags = atomic_exchange(&s_sched_dirty, 0);
+        if (dirty_flags) {
+            sched_rebuild(dirty_flags, esp_timer_get_time());
         }
-        first_read = false;
         
-        // Read all sensors
-        if (s_cache_mutex != NULL && xSemaphoreTake(s_cache_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            s_reading_in_progress = true;
-            s_sensor_cache.sensor_count = 0;
-            s_sensor_cache.battery_valid = false;
-            s_sensor_cache.timestamp_us = esp_timer_get_time();
-            
-            // Read battery
-            if (s_battery_available) {
-                float battery_pct;
-                if (sensor_manager_read_battery_percentage(&battery_pct) == ESP_OK) {
-                    s_sensor_cache.battery_percentage = battery_pct;
-                    s_sensor_cache.battery_valid = true;
-                }
+        int64_t now_us = esp_timer_get_time();
+        uint8_t due[SENSOR_MAX_SENSORS];
+        uint8_t due_count = 0;
+        
+        // On-demand reads pull their sensors forward; later requests wait for the next sweep
+        uint32_t read_now_mask = 0;
+        uint8_t waiter_count = sensor_manager_take_read_requests(&read_now_mask);
+        if (waiter_count > 0) {
+            sched_read_now(read_now_mask, now_us);
+        }
+        
+        if (s_sched_heap_len == 0) {
+            // No EZO sensors - still refresh battery and RSSI on the global interval
+            if (waiter_count == 0 &&
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(s_reading_interval_sec * 1000)) > 0) {
+                continue;
+            }
+        } else {
+            int64_t next_due_us = s_schedules[s_sched_heap[0]].next_due_us;
+            if (next_due_us > now_us && waiter_count == 0) {
+                // Sleep until the earliest deadline, or until a schedule changes
+                TickType_t ticks = pdMS_TO_TICKS((next_due_us - now_us + 999) / 1000);
+                ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+                continue;
             }
             
-            // Read RSSI
-            wifi_ap_record_t ap_info;
-            if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
-                s_sensor_cache.rssi = ap_info.rssi;
+            // Collect everything that is due now or within the coalescing window
+            while (s_sched_heap_len > 0 &&
+                   s_schedules[s_sched_heap[0]].next_due_us <= now_us + SCHED_COALESCE_US) {
+                due[due_count++] = sched_pop();
             }
             
-            // Read all EZO sensors
-            for (uint8_t i = 0; i < s_ezo_count && i < 8; i++) {
-                cached_sensor_t *cached = &s_sensor_cache.sensors[i];
-                
-                if (sensor_manager_read_ezo_sensor(i, cached->sensor_type, cached->values, &cached->value_count) == ESP_OK) {
-                    cached->valid = true;
-                    s_sensor_cache.sensor_count++;
-                } else {
-                    cached->valid = false;
+            // Trigger higher-priority sensors first
+            for (uint8_t a = 1; a < due_count; a++) {
+                uint8_t idx = due[a];
+                int8_t b = a - 1;
+                while (b >= 0 && s_schedules[due[b]].cfg.priority < s_schedules[idx].cfg.priority) {
+                    due[b + 1] = due[b];
+                    b--;
                 }
-                
-                // Yield between sensor reads
-                vTaskDelay(pdMS_TO_TICKS(100));
+                due[b + 1] = idx;
+            }
+        }
+        
+        atomic_store(&s_reading_in_progress, true);
+        int64_t sweep_start_us = esp_timer_get_time();
+        sensor_manager_sweep(&s_sweep_snapshot, due, due_count);
+        metrics_record_since(METRIC_HIST_SENSOR_SWEEP, sweep_start_us);
+        sensor_cache_publish(&s_sweep_snapshot);
+        atomic_store(&s_reading_in_progress, false);
+        
+        for (uint8_t n = 0; n < due_count; n++) {
+            sensor_history_record(due[n], &s_sweep_snapshot.sensors[due[n]]);
+        }
+        
+        for (int n = 0; n < SENSOR_UPDATE_MAX_CALLBACKS; n++) {
+            sensor_update_callback_t callback = s_update_callbacks[n];
+            if (callback != NULL) {
+                callback();
             }
+        }
+        
+        // Every coalesced request gets this same snapshot
+        sensor_read_waiter_t waiter;
+        while (sensor_manager_next_read_request(&waiter, false)) {
+            waiter.callback(sensor_manager_read_result(&s_sweep_snapshot, waiter.mask, sweep_start_us),
+                            &s_sweep_snapshot, waiter.ctx);
+        }
+        if (waiter_count > 1) {
+            ESP_LOGD(TAG, "%u read requests served by one sweep", waiter_count);
+        }
+        
+        // Reschedule; a sensor that overran skips missed slots instead of bursting
+        int64_t done_us = esp_timer_get_time();
+        for (uint8_t n = 0; n < due_count; n++) {
+            sensor_slot_schedule_t *slot = &s_schedules[due[n]];
             
-            s_cache_valid = true;
-            s_reading_in_progress = false;
-            xSemaphoreGive(s_cache_mutex);
+            portENTER_CRITICAL(&s_sched_lock);
+            int64_t period_us = sched_period_us(&slot->cfg);
+            portEXIT_CRITICAL(&s_sched_lock);
             
-            if (s_sensor_cache.sensor_count > 0) {
-                ESP_LOGI(TAG, "✓ Cache updated with %u sensors", s_sensor_cache.sensor_count);
+            slot->last_run_us = now_us;
+            slot->next_due_us += period_us;
+            if (slot->next_due_us <= done_us) {
+                slot->next_due_us = done_us + period_us;
             }
+            sched_push(due[n]);
         }
     }
 }
@@ -434,17 +1757,15 @@ esp_err_t sensor_manager_start_reading_task(uint32_t interval_sec) {
     
     s_reading_interval_sec = interval_sec;
     
-    // Create mutex for cache access
-    if (s_cache_mutex == NULL) {
-        s_cache_mutex = xSemaphoreCreateMutex();
-        if (s_cache_mutex == NULL) {
-            ESP_LOGE(TAG, "Failed to create cache mutex");
-            return ESP_ERR_NO_MEM;
-        }
+    if (s_reading_stopped == NULL && (s_reading_stopped = xSemaphoreCreateBinary()) == NULL) {
+        return ESP_ERR_NO_MEM;
     }
+    xSemaphoreTake(s_reading_stopped, 0);   // Late signal of a stop that timed out
+    atomic_store(&s_reading_stop, false);
     
-    // Initialize cache as valid but empty to prevent startup warnings
-    s_cache_valid = false;  // Will be set true after first read completes
+    if (sensor_history_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor history unavailable");
+    }
     
     // Create reading task on Core 1
     BaseType_t ret = xTaskCreatePinnedToCore(
@@ -468,42 +1789,319 @@ esp_err_t sensor_manager_start_reading_task(uint32_t interval_sec) {
 
 esp_err_t sensor_manager_stop_reading_task(void) {
     if (s_reading_task_handle != NULL) {
+        // Let a running sweep finish and serve its requests, then the task fails the rest
+        atomic_store(&s_reading_stop, true);
+        xTaskNotifyGive(s_reading_task_handle);
+        if (xSemaphoreTake(s_reading_stopped, pdMS_TO_TICKS(READING_STOP_TIMEOUT_MS)) != pdTRUE) {
+            ESP_LOGW(TAG, "Reading task did not stop in time, deleting it");
+        }
         vTaskDelete(s_reading_task_handle);
         s_reading_task_handle = NULL;
         ESP_LOGI(TAG, "Sensor reading task stopped");
     }
+    
+    // Requests that came in during the handshake, or all of them if the task was stuck
+    sensor_manager_fail_read_requests();
     return ESP_OK;
 }
 
-esp_err_t sensor_manager_get_cached_data(sensor_cache_t *cache) {
-    if (cache == NULL) {
+esp_err_t sensor_manager_request_read(uint32_t mask, sensor_read_callback_t callback, void *ctx) {
+    if (callback == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (s_reading_task_handle == NULL || s_reading_paused || atomic_load(&s_reading_stop)) {
+        return ESP_ERR_INVALID_STATE;
+    }
     
-    if (!s_cache_valid) {
-        return ESP_ERR_NOT_FOUND;
+    uint32_t all = (1u << s_registry.count) - 1;
+    if (mask & ~all) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mask == SENSOR_READ_ALL) {
+        mask = all;
     }
     
-    if (s_cache_mutex == NULL) {
-        return ESP_ERR_INVALID_STATE;
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_read_now_lock);
+    if (s_read_waiter_count < SENSOR_READ_MAX_WAITERS) {
+        s_read_waiters[s_read_waiter_count].callback = callback;
+        s_read_waiters[s_read_waiter_count].ctx = ctx;
+        s_read_waiters[s_read_waiter_count].mask = mask;
+        s_read_waiter_count++;
+        s_read_now_mask |= mask;
+        ret = ESP_OK;
     }
+    portEXIT_CRITICAL(&s_read_now_lock);
     
-    // Copy cached data (thread-safe)
-    if (xSemaphoreTake(s_cache_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        memcpy(cache, &s_sensor_cache, sizeof(sensor_cache_t));
-        xSemaphoreGive(s_cache_mutex);
-        return ESP_OK;
+    if (ret != ESP_OK) {
+        APP_LOGW_RATE_LIMITED(TAG, 5000, "Too many pending read requests");
+        return ret;
+    }
+    xTaskNotifyGive(s_reading_task_handle);
+    return ESP_OK;
+}
+
+/**
+ * @brief Shared between a sensor_manager_read_now() caller and its callback
+ * 
+ * Reference counted, so a caller that timed out can leave before the sweep
+ * completes.
+ */
+typedef struct {
+    SemaphoreHandle_t done;
+    atomic_int refs;
+    esp_err_t result;
+    sensor_cache_t cache;
+} sensor_read_wait_t;
+
+static void sensor_read_wait_release(sensor_read_wait_t *wait) {
+    if (atomic_fetch_sub(&wait->refs, 1) == 1) {
+        vSemaphoreDelete(wait->done);
+        mem_policy_pool_free(wait);
+    }
+}
+
+static void sensor_read_wait_done(esp_err_t result, const sensor_cache_t *snapshot, void *ctx) {
+    sensor_read_wait_t *wait = (sensor_read_wait_t *)ctx;
+    wait->result = result;
+    if (snapshot != NULL) {
+        memcpy(&wait->cache, snapshot, sizeof(sensor_cache_t));
+    }
+    xSemaphoreGive(wait->done);
+    sensor_read_wait_release(wait);
+}
+
+esp_err_t sensor_manager_read_now(uint32_t mask, sensor_cache_t *cache, uint32_t timeout_ms) {
+    sensor_read_wait_t *wait = mem_policy_pool_alloc(sizeof(sensor_read_wait_t));
+    if (wait == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(wait, 0, sizeof(sensor_read_wait_t));
+    wait->done = xSemaphoreCreateBinary();
+    if (wait->done == NULL) {
+        mem_policy_pool_free(wait);
+        return ESP_ERR_NO_MEM;
+    }
+    atomic_init(&wait->refs, 2);
+    
+    esp_err_t ret = sensor_manager_request_read(mask, sensor_read_wait_done, wait);
+    if (ret != ESP_OK) {
+        vSemaphoreDelete(wait->done);
+        mem_policy_pool_free(wait);
+        return ret;
+    }
+    
+    if (xSemaphoreTake(wait->done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        ret = ESP_ERR_TIMEOUT;
+    } else {
+        ret = wait->result;
+        if (cache != NULL && ret != ESP_ERR_INVALID_STATE) {
+            memcpy(cache, &wait->cache, sizeof(sensor_cache_t));
+        }
+    }
+    sensor_read_wait_release(wait);
+    return ret;
+}
+
+/**
+ * @brief One sensor_manager_start_read() request
+ * 
+ * A pending slot is never recycled, as its callback is still to come (a
+ * stop completes it too). Guarded by s_read_job_lock.
+ */
+typedef struct {
+    uint32_t id;                // 0 = free
+    sensor_read_job_state_t state;
+    esp_err_t result;
+} sensor_read_job_t;
+
+static sensor_read_job_t s_read_jobs[SENSOR_READ_JOB_SLOTS];
+static uint32_t s_next_read_job_id = 1;
+static portMUX_TYPE s_read_job_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void sensor_read_job_done(esp_err_t result, const sensor_cache_t *snapshot, void *ctx) {
+    (void)snapshot;     // Published to the cache before the callbacks run
+    sensor_read_job_t *job = &s_read_jobs[(uintptr_t)ctx];
+    portENTER_CRITICAL(&s_read_job_lock);
+    job->result = result;
+    job->state = SENSOR_READ_JOB_DONE;
+    portEXIT_CRITICAL(&s_read_job_lock);
+}
+
+esp_err_t sensor_manager_start_read(uint32_t mask, uint32_t *job_id) {
+    if (job_id == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Take a free slot, else recycle the oldest finished one
+    int index = -1;
+    portENTER_CRITICAL(&s_read_job_lock);
+    for (int i = 0; i < SENSOR_READ_JOB_SLOTS; i++) {
+        sensor_read_job_t *job = &s_read_jobs[i];
+        if (job->id == 0) {
+            index = i;
+            break;
+        }
+        if (job->state == SENSOR_READ_JOB_DONE && (index < 0 || job->id < s_read_jobs[index].id)) {
+            index = i;
+        }
+    }
+    if (index >= 0) {
+        sensor_read_job_t *job = &s_read_jobs[index];
+        job->id = s_next_read_job_id++;
+        if (s_next_read_job_id == 0) {
+            s_next_read_job_id = 1;
+        }
+        job->state = SENSOR_READ_JOB_PENDING;
+        job->result = ESP_FAIL;
+        *job_id = job->id;
+    }
+    portEXIT_CRITICAL(&s_read_job_lock);
+    
+    if (index < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    
+    esp_err_t ret = sensor_manager_request_read(mask, sensor_read_job_done, (void *)(uintptr_t)index);
+    if (ret != ESP_OK) {
+        portENTER_CRITICAL(&s_read_job_lock);
+        s_read_jobs[index].id = 0;
+        portEXIT_CRITICAL(&s_read_job_lock);
+    }
+    return ret;
+}
+
+sensor_read_job_state_t sensor_manager_get_read_job(uint32_t job_id, esp_err_t *result) {
+    sensor_read_job_state_t state = SENSOR_READ_JOB_UNKNOWN;
+    
+    portENTER_CRITICAL(&s_read_job_lock);
+    for (int i = 0; i < SENSOR_READ_JOB_SLOTS; i++) {
+        if (job_id != 0 && s_read_jobs[i].id == job_id) {
+            state = s_read_jobs[i].state;
+            if (result != NULL) {
+                *result = s_read_jobs[i].result;
+            }
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_read_job_lock);
+    
+    return state;
+}
+
+esp_err_t sensor_manager_get_cached_data(sensor_cache_t *cache) {
+    if (cache == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    for (int attempt = 0; attempt < CACHE_READ_RETRIES; attempt++) {
+        unsigned seq;
+        int front = sensor_cache_read_begin(&seq);
+        if (front == CACHE_EMPTY) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (front == CACHE_BUSY) {
+            continue;
+        }
+        
+        memcpy(cache, &s_cache_buffers[front], sizeof(sensor_cache_t));
+        if (sensor_cache_read_end(front, seq)) {
+            return ESP_OK;
+        }
     }
     
-    return ESP_FAIL;
+    // Only reachable if the writer lapped us repeatedly, which the sweep period rules out
+    return ESP_ERR_TIMEOUT;
 }
 
 esp_err_t sensor_manager_set_reading_interval(uint32_t interval_sec) {
     s_reading_interval_sec = interval_sec;
-    ESP_LOGI(TAG, "Reading interval updated to %lu seconds", interval_sec);
+    
+    // Sensors that follow the global interval pick up the new period right away
+    portENTER_CRITICAL(&s_sched_lock);
+    for (int i = 0; i < SENSOR_MAX_SENSORS; i++) {
+        if (s_schedules[i].cfg.period_sec == 0) {
+            s_schedules[i].reschedule = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_sched_lock);
+    sensor_manager_notify_scheduler(SCHED_DIRTY_CONFIG);
+    
+    ESP_LOGI(TAG, "Reading interval updated to %lu seconds", (unsigned long)interval_sec);
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_set_sensor_schedule(uint8_t index, const sensor_schedule_t *schedule) {
+    if (index >= s_registry.count || schedule == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_sched_lock);
+    s_schedules[index].cfg = *schedule;
+    s_schedules[index].reschedule = true;
+    portEXIT_CRITICAL(&s_sched_lock);
+    sensor_manager_notify_scheduler(SCHED_DIRTY_CONFIG);
+    
+    ESP_LOGI(TAG, "Sensor %u (0x%02X) schedule: period=%lu s, phase=%lu ms, priority=%u",
+             index, s_ezo_sensors[index].config.i2c_address,
+             (unsigned long)schedule->period_sec, (unsigned long)schedule->phase_ms, schedule->priority);
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_get_sensor_schedule(uint8_t index, sensor_schedule_t *schedule) {
+    if (index >= s_registry.count || schedule == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_sched_lock);
+    *schedule = s_schedules[index].cfg;
+    portEXIT_CRITICAL(&s_sched_lock);
+    return ESP_OK;
+}
+
+esp_err_t sensor_manager_set_sensor_filter(uint8_t index, const sensor_filter_config_t *filter) {
+    if (index >= s_registry.count || !sensor_filter_config_valid(filter)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_filter_lock);
+    s_filter_cfg[index] = *filter;
+    portEXIT_CRITICAL(&s_filter_lock);
+    atomic_fetch_or(&s_filter_dirty, 1u << index);
+    
+    ESP_LOGI(TAG, "Sensor %u (0x%02X) filter: window=%u, median=%d, outlier_k=%.2f (floor %.3f), ewma=%.2f",
+             index, s_registry.address[index], filter->window, filter->median,
+             filter->outlier_k, filter->outlier_floor, filter->ewma_alpha);
     return ESP_OK;
 }
 
+esp_err_t sensor_manager_get_sensor_filter(uint8_t index, sensor_filter_config_t *filter, uint32_t *rejected) {
+    if (index >= s_registry.count || filter == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    portENTER_CRITICAL(&s_filter_lock);
+    *filter = s_filter_cfg[index];
+    portEXIT_CRITICAL(&s_filter_lock);
+    
+    if (rejected != NULL) {
+        *rejected = 0;
+        for (uint8_t ch = 0; ch < MAX_SENSOR_VALUES; ch++) {
+            *rejected += s_filter_state[index][ch].rejected;
+        }
+    }
+    return ESP_OK;
+}
+
+int sensor_manager_get_ezo_index(uint8_t address) {
+    for (uint8_t i = 0; i < s_registry.count; i++) {
+        if (s_registry.address[i] == address) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 esp_err_t sensor_manager_pause_reading(void) {
     s_reading_paused = true;
     ESP_LOGI(TAG, "Sensor reading paused");
@@ -512,10 +2110,49 @@ esp_err_t sensor_manager_pause_reading(void) {
 
 esp_err_t sensor_manager_resume_reading(void) {
     s_reading_paused = false;
+    if (s_reading_task_handle != NULL) {
+        xTaskNotifyGive(s_reading_task_handle);
+    }
     ESP_LOGI(TAG, "Sensor reading resumed");
     return ESP_OK;
 }
 
 bool sensor_manager_is_reading_in_progress(void) {
-    return s_reading_in_progress;
+    return atomic_load(&s_reading_in_progress);
+}
+
+esp_err_t sensor_manager_add_update_callback(sensor_update_callback_t callback) {
+    if (callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_callback_lock);
+    int free_slot = -1;
+    for (int n = 0; n < SENSOR_UPDATE_MAX_CALLBACKS; n++) {
+        if (s_update_callbacks[n] == callback) {
+            free_slot = -1;
+            ret = ESP_OK;       // Already registered
+            break;
+        }
+        if (s_update_callbacks[n] == NULL && free_slot < 0) {
+            free_slot = n;
+        }
+    }
+    if (free_slot >= 0) {
+        s_update_callbacks[free_slot] = callback;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_callback_lock);
+    return ret;
+}
+
+void sensor_manager_remove_update_callback(sensor_update_callback_t callback) {
+    portENTER_CRITICAL(&s_callback_lock);
+    for (int n = 0; n < SENSOR_UPDATE_MAX_CALLBACKS; n++) {
+        if (s_update_callbacks[n] == callback) {
+            s_update_callbacks[n] = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&s_callback_lock);
 }
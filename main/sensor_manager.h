@@ -7,16 +7,55 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
+#include "sensor_filter.h"
+#include "i2c_arbiter.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define SENSOR_MAX_SENSORS      16      // EZO sensors across all buses
+#define SENSOR_BUS_MAIN         0       // STEMMA QT bus; other bus IDs are mux channels + 1
+
+/**
+ * @brief EZO sensor kinds, resolved once when a sensor is registered
+ */
+typedef enum {
+    SENSOR_KIND_UNKNOWN = 0,            // EZO type this firmware has no table entry for
+    SENSOR_KIND_RTD,                    // Temperature
+    SENSOR_KIND_PH,                     // pH
+    SENSOR_KIND_EC,                     // Electrical conductivity
+    SENSOR_KIND_DO,                     // Dissolved oxygen
+    SENSOR_KIND_ORP,                    // Oxidation-reduction potential
+    SENSOR_KIND_HUM,                    // Humidity
+    SENSOR_KIND_COUNT
+} sensor_kind_t;
+
+/**
+ * @brief Map an EZO type string ("RTD", "pH", ...) to its kind
+ * 
+ * @param type EZO type string (may be NULL)
+ * @return sensor_kind_t SENSOR_KIND_UNKNOWN if not recognised
+ */
+sensor_kind_t sensor_kind_from_type(const char *type);
+
+/**
+ * @brief EZO type string of a kind
+ * 
+ * @param kind Sensor kind
+ * @return const char* Type string, "EZO" for SENSOR_KIND_UNKNOWN
+ */
+const char *sensor_kind_name(sensor_kind_t kind);
+
 /**
  * @brief Initialize all sensors
  * 
- * Scans I2C bus and initializes MAX17048 battery monitor and EZO water sensors
+ * Initializes the MAX17048 battery monitor and EZO water sensors. When the
+ * inventory stored by the previous boot still matches the bus (one probe per
+ * stored address), sensors are restored from it without any EZO commands;
+ * otherwise the EZO address block is discovered and the inventory stored.
  * 
  * @return esp_err_t ESP_OK on success
  */
@@ -45,9 +84,57 @@ esp_err_t sensor_manager_read_battery_voltage(float *voltage);
  */
 esp_err_t sensor_manager_read_battery_percentage(float *percentage);
 
+/**
+ * @brief Read battery charge/discharge rate from MAX17048
+ * 
+ * @param rate Pointer to store rate in %/hour (negative while discharging)
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t sensor_manager_read_battery_rate(float *rate);
+
+/**
+ * @brief Find a sensor by kind
+ * 
+ * Constant-time lookup through a per-kind bitmask; no string compares.
+ * 
+ * @param kind Sensor kind
+ * @param ordinal 0 for the first sensor of that kind, 1 for the second, ...
+ * @return int Sensor index, or -1 if there is no such sensor
+ */
+int sensor_manager_find_sensor(sensor_kind_t kind, uint8_t ordinal);
+
+/**
+ * @brief Number of registered sensors of a kind
+ */
+uint8_t sensor_manager_count_kind(sensor_kind_t kind);
+
+/**
+ * @brief Find a sensor by the key it is published under
+ * 
+ * Accepts the telemetry JSON key ("pH", "EC_2"; case-insensitive) or a
+ * decimal sensor index ("3").
+ * 
+ * @param key Sensor key
+ * @return int Sensor index, or -1 if there is no such sensor
+ */
+int sensor_manager_find_by_key(const char *key);
+
+/**
+ * @brief Kind of a registered sensor
+ * 
+ * @param index Sensor index
+ * @return sensor_kind_t SENSOR_KIND_UNKNOWN for an invalid index
+ */
+sensor_kind_t sensor_manager_get_sensor_kind(uint8_t index);
+
 /**
  * @brief Read temperature from EZO-RTD sensor
  * 
+ * Served from the background sweep cache; never touches the bus.
+ * Use sensor_manager_get_cached_value() to also get the sample age.
+ * With several sensors of one kind, these helpers return the first one;
+ * use sensor_manager_find_sensor() to reach the others.
+ * 
  * @param temperature Pointer to store temperature value
  * @return esp_err_t ESP_OK on success
  */
@@ -56,6 +143,9 @@ esp_err_t sensor_manager_read_temperature(float *temperature);
 /**
  * @brief Read pH from EZO-pH sensor
  * 
+ * Served from the background sweep cache; never touches the bus.
+ * Use sensor_manager_get_cached_value() to also get the sample age.
+ * 
  * @param ph Pointer to store pH value
  * @return esp_err_t ESP_OK on success
  */
@@ -64,6 +154,9 @@ esp_err_t sensor_manager_read_ph(float *ph);
 /**
  * @brief Read electrical conductivity from EZO-EC sensor
  * 
+ * Served from the background sweep cache; never touches the bus.
+ * Use sensor_manager_get_cached_value() to also get the sample age.
+ * 
  * @param ec Pointer to store EC value (µS/cm)
  * @return esp_err_t ESP_OK on success
  */
@@ -72,6 +165,9 @@ esp_err_t sensor_manager_read_ec(float *ec);
 /**
  * @brief Read dissolved oxygen from EZO-DO sensor
  * 
+ * Served from the background sweep cache; never touches the bus.
+ * Use sensor_manager_get_cached_value() to also get the sample age.
+ * 
  * @param dox Pointer to store DO value (mg/L)
  * @return esp_err_t ESP_OK on success
  */
@@ -80,6 +176,9 @@ esp_err_t sensor_manager_read_do(float *dox);
 /**
  * @brief Read ORP (oxidation-reduction potential) from EZO-ORP sensor
  * 
+ * Served from the background sweep cache; never touches the bus.
+ * Use sensor_manager_get_cached_value() to also get the sample age.
+ * 
  * @param orp Pointer to store ORP value (mV)
  * @return esp_err_t ESP_OK on success
  */
@@ -88,11 +187,37 @@ esp_err_t sensor_manager_read_orp(float *orp);
 /**
  * @brief Read humidity from EZO-HUM sensor
  * 
+ * Served from the background sweep cache; never touches the bus.
+ * Use sensor_manager_get_cached_value() to also get the sample age.
+ * 
  * @param humidity Pointer to store humidity value (%)
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t sensor_manager_read_humidity(float *humidity);
 
+/**
+ * @brief Get the latest cached value of an EZO sensor type, with its age
+ * 
+ * Non-blocking: reads the snapshot cache, no I2C. For multi-value sensors the
+ * first enabled output is returned. With several sensors of the type, the
+ * first one is used.
+ * 
+ * @param sensor_type EZO type string ("RTD", "pH", "EC", "DO", "ORP", "HUM")
+ * @param value Pointer to store the value
+ * @param age_ms Pointer to store the sample age in ms (may be NULL)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no such sensor or no valid sample
+ */
+esp_err_t sensor_manager_get_cached_value(const char *sensor_type, float *value, uint32_t *age_ms);
+
+/**
+ * @brief Get the latest cached battery percentage, with its age
+ * 
+ * @param percentage Pointer to store battery percentage (0-100%)
+ * @param age_ms Pointer to store the sample age in ms (may be NULL)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no battery reading yet
+ */
+esp_err_t sensor_manager_get_cached_battery(float *percentage, uint32_t *age_ms);
+
 /**
  * @brief Get number of detected EZO sensors
  * 
@@ -118,6 +243,11 @@ void* sensor_manager_get_ezo_sensor(uint8_t index);
 /**
  * @brief Read all values from an EZO sensor by index
  * 
+ * Live read through the I2C arbiter: blocks the caller for the conversion
+ * time (up to the sensor's read timeout). Prefer sensor_manager_get_cached_data().
+ * If the read fails, the last sample published by the reading task is
+ * returned instead when it is under five minutes old.
+ * 
  * @param index Sensor index
  * @param sensor_type Buffer to store sensor type (min 16 bytes)
  * @param values Array to store readings (up to 4 values)
@@ -126,10 +256,56 @@ void* sensor_manager_get_ezo_sensor(uint8_t index);
  */
 esp_err_t sensor_manager_read_ezo_sensor(uint8_t index, char *sensor_type, float values[4], uint8_t *count);
 
+#define SENSOR_EZO_COMMANDS_MAX 64      // Bytes of commands queued with one sensor_manager_ezo_command()
+
+/**
+ * @brief EZO commands for sensor_manager_ezo_command()
+ * 
+ * NUL-separated command strings, built with sensor_ezo_commands_add().
+ */
+typedef struct {
+    char buf[SENSOR_EZO_COMMANDS_MAX];
+    uint8_t len;                 // Bytes used, including each command's terminator
+    bool overflow;               // A command did not fit and was dropped
+} sensor_ezo_commands_t;
+
+/**
+ * @brief Append a printf-formatted EZO command (e.g. "L,%d", "Cal,mid,%.2f")
+ * 
+ * @return esp_err_t ESP_OK, or ESP_ERR_NO_MEM if it does not fit (overflow is set)
+ */
+esp_err_t sensor_ezo_commands_add(sensor_ezo_commands_t *commands, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Queue configuration/calibration commands for one EZO sensor
+ * 
+ * Returns immediately. The commands are sent in order from the I2C arbiter
+ * task: each one is a single write job, and its response is collected by
+ * later status checks that defer while the circuit is processing, so the
+ * bus stays free for readings during slow calibrations. The sweep does not
+ * start a reading on the sensor while one of its commands is in flight, and
+ * a command waits for a reading already converting to be collected.
+ * Settings the sensor accepts update its configuration and, from the
+ * reading task, the stored inventory. Poll the outcome with
+ * i2c_arbiter_get_job(); the result is the first command that failed.
+ * 
+ * @param index EZO sensor index
+ * @param prio I2C_ARBITER_PRIO_CONFIG or I2C_ARBITER_PRIO_CALIBRATION
+ * @param commands Commands to send (copied; may be empty)
+ * @param job_id Pointer to store the job ID
+ * @return esp_err_t ESP_OK if queued, ESP_ERR_NO_MEM if the arbiter is full,
+ *         ESP_ERR_INVALID_ARG if commands overflowed
+ */
+esp_err_t sensor_manager_ezo_command(uint8_t index, i2c_arbiter_prio_t prio,
+                                     const sensor_ezo_commands_t *commands, uint32_t *job_id);
+
 /**
  * @brief Rescan I2C bus and reinitialize all sensors
  * 
- * Useful after hot-swapping sensors (with power cycle)
+ * Useful after hot-swapping sensors (with power cycle). Always runs full
+ * discovery and replaces the stored inventory; sensor_manager_init() reuses
+ * that inventory while every stored sensor still answers.
  * 
  * @return esp_err_t ESP_OK on success
  */
@@ -140,25 +316,70 @@ esp_err_t sensor_manager_rescan(void);
  */
 #define MAX_SENSOR_VALUES 4
 typedef struct {
-    char sensor_type[16];
-    float values[MAX_SENSOR_VALUES];
+    float values[MAX_SENSOR_VALUES];    // Filtered (see sensor_manager_set_sensor_filter())
+    float raw[MAX_SENSOR_VALUES];       // As parsed from the sensor
+    uint64_t timestamp_us;       // When this sensor last returned a fresh sample
+    uint8_t kind;                // sensor_kind_t
+    uint8_t ordinal;             // 0 for the first sensor of its kind, 1 for the second, ...
+    uint8_t bus;                 // SENSOR_BUS_MAIN or mux channel + 1
+    uint8_t address;             // 7-bit I2C address on that bus
     uint8_t value_count;
+    uint8_t rejected;            // Bit per channel whose sample the outlier gate replaced
     bool valid;
 } cached_sensor_t;
 
 typedef struct {
-    cached_sensor_t sensors[8];  // Support up to 8 EZO sensors
-    uint8_t sensor_count;
+    cached_sensor_t sensors[SENSOR_MAX_SENSORS];  // sensors[i] is sensor index i
+    uint8_t sensor_count;        // Number of slots filled (check each slot's valid flag)
     float battery_percentage;
+    float battery_rate;          // %/hour, negative while discharging (valid with battery_valid)
     bool battery_valid;
     int8_t rssi;
-    uint64_t timestamp_us;
+    uint64_t timestamp_us;       // When the snapshot was last published
 } sensor_cache_t;
 
+/**
+ * @brief Called from the reading task each time a new snapshot is published
+ *
+ * Must return quickly (e.g. just notify a task).
+ */
+typedef void (*sensor_update_callback_t)(void);
+
+#define SENSOR_UPDATE_MAX_CALLBACKS 4   // MQTT publisher, dashboard stream, spare
+
+/**
+ * @brief Completion of an on-demand read (see sensor_manager_request_read())
+ *
+ * Runs on the reading task after the sweep is published; must return quickly.
+ *
+ * @param result ESP_OK if every requested sensor returned a fresh sample,
+ *        ESP_ERR_INVALID_RESPONSE if some kept their previous value,
+ *        ESP_ERR_INVALID_STATE if the reading task stopped first
+ * @param snapshot The sweep's snapshot, shared by all coalesced requests
+ *        (NULL with ESP_ERR_INVALID_STATE)
+ * @param ctx Context passed with the request
+ */
+typedef void (*sensor_read_callback_t)(esp_err_t result, const sensor_cache_t *snapshot, void *ctx);
+
+#define SENSOR_READ_ALL             0       // Mask for sensor_manager_request_read(): every sensor
+#define SENSOR_READ_MAX_WAITERS     8       // Requests that can wait for one sweep
+#define SENSOR_READ_TIMEOUT_MS      10000   // Default wait of sensor_manager_read_now() callers
+
+/**
+ * @brief Per-sensor sampling schedule
+ */
+typedef struct {
+    uint32_t period_sec;         // Sampling period, 0 = follow the global reading interval
+    uint32_t phase_ms;           // Delay of the first sample after the schedule is (re)applied
+    uint8_t priority;            // Higher is read first when several sensors are due together
+} sensor_schedule_t;
+
 /**
  * @brief Start background sensor reading task
  * 
- * Starts a task that periodically reads all sensors and updates the cache.
+ * Starts a task that reads each sensor on its own schedule (see
+ * sensor_manager_set_sensor_schedule()) and updates the cache. Sensors that
+ * are due at the same time share one conversion wait.
  * 
  * @param interval_sec Reading interval in seconds (default 10)
  * @return esp_err_t ESP_OK on success
@@ -168,6 +389,10 @@ esp_err_t sensor_manager_start_reading_task(uint32_t interval_sec);
 /**
  * @brief Stop background sensor reading task
  * 
+ * A sweep in progress finishes and serves its requests first. Every request
+ * still outstanding then completes with ESP_ERR_INVALID_STATE. Waits up to
+ * SENSOR_READ_TIMEOUT_MS for the task before deleting it anyway.
+ * 
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t sensor_manager_stop_reading_task(void);
@@ -175,8 +400,9 @@ esp_err_t sensor_manager_stop_reading_task(void);
 /**
  * @brief Get cached sensor data (non-blocking, no I2C operations)
  * 
- * Returns the most recent sensor readings from the background task.
- * This is safe to call from any context including HTTP handlers.
+ * Returns the most recent complete sweep from the background task. The cache is
+ * double-buffered and lock-free, so this never waits for an I2C sweep and
+ * is safe to call from any task context including HTTP handlers.
  * 
  * @param cache Pointer to sensor_cache_t structure to fill
  * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if no data yet
@@ -191,6 +417,60 @@ esp_err_t sensor_manager_get_cached_data(sensor_cache_t *cache);
  */
 esp_err_t sensor_manager_set_reading_interval(uint32_t interval_sec);
 
+/**
+ * @brief Set the sampling schedule of one EZO sensor
+ * 
+ * Takes effect immediately: the next sample is due one period after the
+ * previous one (or after phase_ms if the sensor has not been read yet).
+ * Schedules are reset to defaults on rescan.
+ * 
+ * @param index EZO sensor index
+ * @param schedule New schedule
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on bad index
+ */
+esp_err_t sensor_manager_set_sensor_schedule(uint8_t index, const sensor_schedule_t *schedule);
+
+/**
+ * @brief Get the sampling schedule of one EZO sensor
+ * 
+ * @param index EZO sensor index
+ * @param schedule Pointer to store the schedule
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on bad index
+ */
+esp_err_t sensor_manager_get_sensor_schedule(uint8_t index, sensor_schedule_t *schedule);
+
+/**
+ * @brief Set the reading filter of one EZO sensor
+ * 
+ * Applies to every value channel of the sensor, between the read and the
+ * cache publish. The filter state starts over with the next sample. Filters
+ * are reset to per-type defaults on rescan (outlier gate on EC and ORP,
+ * pass-through elsewhere).
+ * 
+ * @param index EZO sensor index
+ * @param filter New filter settings
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on bad index or settings
+ */
+esp_err_t sensor_manager_set_sensor_filter(uint8_t index, const sensor_filter_config_t *filter);
+
+/**
+ * @brief Get the reading filter of one EZO sensor
+ * 
+ * @param index EZO sensor index
+ * @param filter Pointer to store the filter settings
+ * @param rejected Samples replaced by the outlier gate since the filter was set (may be NULL)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG on bad index
+ */
+esp_err_t sensor_manager_get_sensor_filter(uint8_t index, sensor_filter_config_t *filter, uint32_t *rejected);
+
+/**
+ * @brief Find the index of an EZO sensor by I2C address
+ * 
+ * @param address I2C address
+ * @return int Sensor index, or -1 if no sensor has that address
+ */
+int sensor_manager_get_ezo_index(uint8_t address);
+
 /**
  * @brief Pause sensor reading task
  * 
@@ -210,10 +490,100 @@ esp_err_t sensor_manager_resume_reading(void);
 /**
  * @brief Check if sensor reading is currently in progress
  * 
+ * Informational only - sensor_manager_get_cached_data() does not need to be
+ * gated on this.
+ * 
  * @return true if currently reading sensors, false otherwise
  */
 bool sensor_manager_is_reading_in_progress(void);
 
+/**
+ * @brief Register a callback for new snapshots
+ *
+ * Lets consumers wake on data instead of polling the cache, so publishing
+ * follows the sensor sweep and the chip can stay asleep in between. Callbacks
+ * run in registration-slot order on the reading task.
+ *
+ * @param callback Callback
+ * @return esp_err_t ESP_OK on success (also if already registered),
+ *         ESP_ERR_NO_MEM if all SENSOR_UPDATE_MAX_CALLBACKS slots are taken
+ */
+esp_err_t sensor_manager_add_update_callback(sensor_update_callback_t callback);
+
+/**
+ * @brief Unregister a snapshot callback
+ *
+ * @param callback Callback passed to sensor_manager_add_update_callback()
+ */
+void sensor_manager_remove_update_callback(sensor_update_callback_t callback);
+
+/**
+ * @brief Read sensors now instead of at their next scheduled sample
+ *
+ * Wakes the reading task, which samples the requested sensors right away
+ * (together with any that are due anyway) and restarts their periods from
+ * this sample. Requests that arrive before the sweep starts are coalesced
+ * into it, so several clients asking at once cost a single bus sweep and all
+ * get the same snapshot. Requests made during a sweep wait for the next one.
+ *
+ * @param mask Bit per EZO sensor index, SENSOR_READ_ALL for every sensor
+ * @param callback Completion callback (reading task)
+ * @param ctx Passed to the callback
+ * @return esp_err_t ESP_OK if queued, ESP_ERR_INVALID_ARG on a bad mask,
+ *         ESP_ERR_INVALID_STATE if the reading task is not running or paused,
+ *         ESP_ERR_NO_MEM if SENSOR_READ_MAX_WAITERS requests are waiting
+ */
+esp_err_t sensor_manager_request_read(uint32_t mask, sensor_read_callback_t callback, void *ctx);
+
+/**
+ * @brief Blocking wrapper of sensor_manager_request_read()
+ *
+ * For tasks that may wait (HTTP handlers, the MQTT command task). Never call
+ * it from the reading task or a snapshot callback.
+ *
+ * @param mask Bit per EZO sensor index, SENSOR_READ_ALL for every sensor
+ * @param cache Receives the fresh snapshot (may be NULL)
+ * @param timeout_ms Maximum wait
+ * @return esp_err_t The completion result, ESP_ERR_TIMEOUT if the sweep did
+ *         not finish in time, or an error from sensor_manager_request_read()
+ */
+esp_err_t sensor_manager_read_now(uint32_t mask, sensor_cache_t *cache, uint32_t timeout_ms);
+
+#define SENSOR_READ_JOB_SLOTS       4       // Read jobs tracked at once (including finished ones)
+
+/**
+ * @brief State of a read started with sensor_manager_start_read()
+ */
+typedef enum {
+    SENSOR_READ_JOB_UNKNOWN = 0,        // No such job (never started or already recycled)
+    SENSOR_READ_JOB_PENDING,
+    SENSOR_READ_JOB_DONE,
+} sensor_read_job_state_t;
+
+/**
+ * @brief Non-blocking counterpart of sensor_manager_read_now()
+ *
+ * For callers that must not wait, such as HTTP handlers: the request joins
+ * the next sweep like any other and the caller polls the job. The snapshot
+ * is then the cached one (sensor_manager_get_cached_data()). The oldest
+ * finished job is recycled when all slots are taken.
+ *
+ * @param mask Bit per EZO sensor index, SENSOR_READ_ALL for every sensor
+ * @param job_id Receives the job ID (never 0)
+ * @return esp_err_t ESP_OK if started, ESP_ERR_NO_MEM if SENSOR_READ_JOB_SLOTS
+ *         reads are pending, or an error from sensor_manager_request_read()
+ */
+esp_err_t sensor_manager_start_read(uint32_t mask, uint32_t *job_id);
+
+/**
+ * @brief Look up a read job
+ *
+ * @param job_id ID from sensor_manager_start_read()
+ * @param result Receives the completion result once done (may be NULL)
+ * @return sensor_read_job_state_t Job state
+ */
+sensor_read_job_state_t sensor_manager_get_read_job(uint32_t job_id, esp_err_t *result);
+
 #ifdef __cplusplus
 }
 #endif
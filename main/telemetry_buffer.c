@@ -0,0 +1,344 @@
+/**
+ * @file telemetry_buffer.c
+ * @brief Offline telemetry ring buffer in the "telemetry" flash partition
+ *
+ * Layout: every 4 KB sector holds a 16-byte header followed by fixed-size
+ * record slots. Record positions are numbered linearly across the partition
+ * (sector * TB_RECORDS_PER_SECTOR + slot) and wrap at the capacity.
+ *
+ * A record's state word moves from erased (0xFFFFFFFF) to TB_STATE_VALID when
+ * written and to 0 when consumed. Both steps only clear bits, so no erase is
+ * needed until the head wraps around onto the sector again.
+ */
+
+#include "telemetry_buffer.h"
+#define APP_LOG_LEVEL CONFIG_APP_LOG_LEVEL_MQTT
+#include "app_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include <string.h>
+
+static const char *TAG = "TLM_BUFFER";
+
+#define TB_SECTOR_SIZE          4096
+#define TB_HEADER_SIZE          16
+#define TB_RECORD_SIZE          408     // 10 records per sector
+#define TB_RECORDS_PER_SECTOR   ((TB_SECTOR_SIZE - TB_HEADER_SIZE) / TB_RECORD_SIZE)
+#define TB_MAX_SENSORS          SENSOR_MAX_SENSORS
+
+#define TB_MAGIC                0x544C4D42  // "TLMB"
+#define TB_VERSION              2
+#define TB_STATE_ERASED         0xFFFFFFFF
+#define TB_STATE_VALID          0x5AA5C33C
+#define TB_STATE_CONSUMED       0x00000000
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                   // Increments each time a sector is opened
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t reserved;
+} tb_sector_header_t;
+
+typedef struct {
+    uint8_t kind;                   // sensor_kind_t
+    uint8_t ordinal;
+    uint8_t bus;
+    uint8_t address;
+    float values[MAX_SENSOR_VALUES];
+    uint8_t value_count;
+    uint8_t valid;
+    uint8_t reserved[2];
+} tb_sensor_t;
+
+typedef struct {
+    uint32_t state;                 // Must stay first: consumed by clearing this word
+    uint32_t timestamp;
+    float battery_percentage;
+    int8_t rssi;
+    uint8_t battery_valid;
+    uint8_t sensor_count;
+    uint8_t reserved;
+    tb_sensor_t sensors[TB_MAX_SENSORS];
+    uint32_t crc;                   // CRC32 of everything after state and before crc
+} tb_record_t;
+
+_Static_assert(sizeof(tb_sector_header_t) == TB_HEADER_SIZE, "sector header size");
+_Static_assert(sizeof(tb_record_t) <= TB_RECORD_SIZE, "record does not fit its slot");
+
+static const esp_partition_t *s_partition = NULL;
+static uint32_t s_capacity = 0;         // Record slots in the partition
+static uint32_t s_head = 0;             // Next slot to write
+static uint32_t s_tail = 0;             // Oldest pending slot
+static uint32_t s_pending = 0;
+static bool s_head_open = false;        // Sector containing s_head is erased and has a header
+static uint32_t s_seq = 0;              // Highest sector sequence number in use
+static uint32_t s_dropped = 0;
+static uint32_t s_sector_erases = 0;
+
+static size_t tb_slot_offset(uint32_t pos) {
+    uint32_t sector = pos / TB_RECORDS_PER_SECTOR;
+    uint32_t slot = pos % TB_RECORDS_PER_SECTOR;
+    return (size_t)sector * TB_SECTOR_SIZE + TB_HEADER_SIZE + (size_t)slot * TB_RECORD_SIZE;
+}
+
+static uint32_t tb_record_crc(const tb_record_t *record) {
+    const uint8_t *start = (const uint8_t *)record + sizeof(record->state);
+    size_t len = offsetof(tb_record_t, crc) - sizeof(record->state);
+    return esp_rom_crc32_le(0, start, len);
+}
+
+static bool tb_read_header(uint32_t sector, tb_sector_header_t *header) {
+    if (esp_partition_read(s_partition, (size_t)sector * TB_SECTOR_SIZE, header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == TB_MAGIC && header->version == TB_VERSION &&
+           header->record_size == TB_RECORD_SIZE;
+}
+
+static uint32_t tb_read_state(uint32_t pos) {
+    uint32_t state = TB_STATE_ERASED;
+    esp_partition_read(s_partition, tb_slot_offset(pos), &state, sizeof(state));
+    return state;
+}
+
+/**
+ * @brief Erase the sector at the head and write a fresh header
+ *
+ * Pending records still in that sector are the oldest ones; they are dropped.
+ */
+static esp_err_t tb_open_head_sector(void) {
+    uint32_t sector = s_head / TB_RECORDS_PER_SECTOR;
+
+    while (s_pending > 0 && s_tail / TB_RECORDS_PER_SECTOR == sector) {
+        s_tail = (s_tail + 1) % s_capacity;
+        s_pending--;
+        s_dropped++;
+    }
+    if (s_pending == 0) {
+        s_tail = s_head;
+    }
+
+    esp_err_t ret = esp_partition_erase_range(s_partition, (size_t)sector * TB_SECTOR_SIZE, TB_SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %lu: %s", (unsigned long)sector, esp_err_to_name(ret));
+        return ret;
+    }
+    s_sector_erases++;
+
+    tb_sector_header_t header = {
+        .magic = TB_MAGIC,
+        .seq = ++s_seq,
+        .version = TB_VERSION,
+        .record_size = TB_RECORD_SIZE,
+    };
+    ret = esp_partition_write(s_partition, (size_t)sector * TB_SECTOR_SIZE, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write sector header: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_head_open = true;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_buffer_init(void) {
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_UNDEFINED,
+                                           TELEMETRY_BUFFER_PARTITION);
+    if (s_partition == NULL) {
+        ESP_LOGW(TAG, "No \"%s\" partition, offline buffering disabled", TELEMETRY_BUFFER_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t sector_count = s_partition->size / TB_SECTOR_SIZE;
+    s_capacity = sector_count * TB_RECORDS_PER_SECTOR;
+    s_head = 0;
+    s_tail = 0;
+    s_pending = 0;
+    s_head_open = false;
+    s_seq = 0;
+
+    // The newest sector (highest sequence number) holds the write head
+    int head_sector = -1;
+    tb_sector_header_t header;
+    for (uint32_t s = 0; s < sector_count; s++) {
+        if (tb_read_header(s, &header) && (head_sector < 0 || header.seq > s_seq)) {
+            s_seq = header.seq;
+            head_sector = (int)s;
+        }
+    }
+
+    if (head_sector < 0) {
+        ESP_LOGI(TAG, "Empty buffer: %lu records in %lu sectors", (unsigned long)s_capacity,
+                 (unsigned long)sector_count);
+        return ESP_OK;
+    }
+
+    // Write position: first erased slot in the head sector, else the next sector
+    uint32_t base = (uint32_t)head_sector * TB_RECORDS_PER_SECTOR;
+    s_head = (base + TB_RECORDS_PER_SECTOR) % s_capacity;
+    for (uint32_t slot = 0; slot < TB_RECORDS_PER_SECTOR; slot++) {
+        if (tb_read_state(base + slot) == TB_STATE_ERASED) {
+            s_head = base + slot;
+            s_head_open = true;
+            break;
+        }
+    }
+
+    // Oldest pending record: walk sectors from oldest to newest
+    for (uint32_t i = 1; i <= sector_count; i++) {
+        uint32_t s = ((uint32_t)head_sector + i) % sector_count;
+        if (!tb_read_header(s, &header)) {
+            continue;
+        }
+        for (uint32_t slot = 0; slot < TB_RECORDS_PER_SECTOR; slot++) {
+            uint32_t pos = s * TB_RECORDS_PER_SECTOR + slot;
+            uint32_t state = tb_read_state(pos);
+            if (state == TB_STATE_ERASED) {
+                break;
+            }
+            if (state != TB_STATE_CONSUMED) {
+                s_tail = pos;
+                s_pending = (s_head + s_capacity - s_tail) % s_capacity;
+                if (s_pending == 0) {
+                    s_pending = s_capacity;
+                }
+                goto done;
+            }
+        }
+    }
+    s_tail = s_head;
+
+done:
+    ESP_LOGI(TAG, "Recovered buffer: %lu pending of %lu records", (unsigned long)s_pending,
+             (unsigned long)s_capacity);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_buffer_append(const sensor_cache_t *cache, uint32_t timestamp) {
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cache == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!s_head_open) {
+        esp_err_t ret = tb_open_head_sector();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    tb_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.state = TB_STATE_VALID;
+    record.timestamp = timestamp;
+    record.battery_percentage = cache->battery_percentage;
+    record.battery_valid = cache->battery_valid;
+    record.rssi = cache->rssi;
+    record.sensor_count = (cache->sensor_count < TB_MAX_SENSORS) ? cache->sensor_count : TB_MAX_SENSORS;
+    for (uint8_t i = 0; i < record.sensor_count; i++) {
+        const cached_sensor_t *src = &cache->sensors[i];
+        tb_sensor_t *dst = &record.sensors[i];
+        dst->kind = src->kind;
+        dst->ordinal = src->ordinal;
+        dst->bus = src->bus;
+        dst->address = src->address;
+        memcpy(dst->values, src->values, sizeof(dst->values));
+        dst->value_count = src->value_count;
+        dst->valid = src->valid;
+    }
+    record.crc = tb_record_crc(&record);
+
+    esp_err_t ret = esp_partition_write(s_partition, tb_slot_offset(s_head), &record, sizeof(record));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write record: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (s_pending == 0) {
+        s_tail = s_head;
+    }
+    s_pending++;
+    s_head = (s_head + 1) % s_capacity;
+    if (s_head % TB_RECORDS_PER_SECTOR == 0) {
+        s_head_open = false;
+    }
+    return ESP_OK;
+}
+
+esp_err_t telemetry_buffer_peek(uint32_t offset, sensor_cache_t *cache, uint32_t *timestamp) {
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cache == NULL || timestamp == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset >= s_pending) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    tb_record_t record;
+    esp_err_t ret = esp_partition_read(s_partition, tb_slot_offset((s_tail + offset) % s_capacity),
+                                       &record, sizeof(record));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (record.state != TB_STATE_VALID || record.crc != tb_record_crc(&record) ||
+        record.sensor_count > TB_MAX_SENSORS) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+    cache->battery_percentage = record.battery_percentage;
+    cache->battery_valid = record.battery_valid;
+    cache->rssi = record.rssi;
+    cache->sensor_count = record.sensor_count;
+    for (uint8_t i = 0; i < record.sensor_count; i++) {
+        const tb_sensor_t *src = &record.sensors[i];
+        cached_sensor_t *dst = &cache->sensors[i];
+        dst->kind = (src->kind < SENSOR_KIND_COUNT) ? src->kind : SENSOR_KIND_UNKNOWN;
+        dst->ordinal = src->ordinal;
+        dst->bus = src->bus;
+        dst->address = src->address;
+        memcpy(dst->values, src->values, sizeof(dst->values));
+        dst->value_count = (src->value_count <= MAX_SENSOR_VALUES) ? src->value_count : MAX_SENSOR_VALUES;
+        dst->valid = src->valid;
+    }
+    *timestamp = record.timestamp;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_buffer_consume(uint32_t count) {
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uint32_t consumed = TB_STATE_CONSUMED;
+    while (count > 0 && s_pending > 0) {
+        esp_err_t ret = esp_partition_write(s_partition, tb_slot_offset(s_tail), &consumed, sizeof(consumed));
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to mark record consumed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        s_tail = (s_tail + 1) % s_capacity;
+        s_pending--;
+        count--;
+    }
+    return ESP_OK;
+}
+
+uint32_t telemetry_buffer_pending(void) {
+    return s_pending;
+}
+
+void telemetry_buffer_get_stats(telemetry_buffer_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->capacity = s_capacity;
+    stats->pending = s_pending;
+    stats->dropped = s_dropped;
+    stats->sector_erases = s_sector_erases;
+}
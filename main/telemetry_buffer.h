@@ -0,0 +1,86 @@
+/**
+ * @file telemetry_buffer.h
+ * @brief Offline telemetry ring buffer in the "telemetry" flash partition
+ *
+ * Snapshots that could not be published are appended as fixed-size records.
+ * Each flash sector starts with a sequence-numbered header and is erased only
+ * when the write head wraps onto it, so wear is spread evenly over the
+ * partition. When full, the oldest sector is dropped. Records are consumed in
+ * order by clearing their state word, so nothing is rewritten in place.
+ *
+ * Not thread safe: all calls are made from the MQTT publish task.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensor_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_BUFFER_PARTITION  "telemetry"     // Partition label in partitions.csv
+
+/**
+ * @brief Buffer statistics
+ */
+typedef struct {
+    uint32_t capacity;          // Total record slots
+    uint32_t pending;           // Records waiting for replay
+    uint32_t dropped;           // Records overwritten while full (since boot)
+    uint32_t sector_erases;     // Sector erases (since boot)
+} telemetry_buffer_stats_t;
+
+/**
+ * @brief Mount the partition and recover head/tail from flash
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t telemetry_buffer_init(void);
+
+/**
+ * @brief Append one snapshot
+ *
+ * @param cache Sensor snapshot
+ * @param timestamp Unix time in seconds when the snapshot was taken
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t telemetry_buffer_append(const sensor_cache_t *cache, uint32_t timestamp);
+
+/**
+ * @brief Read a pending record without consuming it
+ *
+ * @param offset Position from the oldest pending record (0 = oldest)
+ * @param cache Restored snapshot
+ * @param timestamp Unix time of the snapshot
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND past the end,
+ *         ESP_ERR_INVALID_CRC for a torn record (consume it to skip)
+ */
+esp_err_t telemetry_buffer_peek(uint32_t offset, sensor_cache_t *cache, uint32_t *timestamp);
+
+/**
+ * @brief Mark the oldest records as delivered
+ *
+ * @param count Number of records to consume
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t telemetry_buffer_consume(uint32_t count);
+
+/**
+ * @brief Number of records waiting for replay
+ */
+uint32_t telemetry_buffer_pending(void);
+
+/**
+ * @brief Get buffer statistics
+ *
+ * @param stats Output statistics
+ */
+void telemetry_buffer_get_stats(telemetry_buffer_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
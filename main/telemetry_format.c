@@ -0,0 +1,537 @@
+/**
+ * @file telemetry_format.c
+ * @brief Allocation-free JSON writer and shared sensor payload formatting
+ */
+
+#include "telemetry_format.h"
+#include "ezo_sensor.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <inttypes.h>
+#include <math.h>
+
+/**
+ * @brief Field names for multi-value EZO outputs, in the sensor's default order
+ */
+static const char *const s_field_maps[SENSOR_KIND_COUNT][MAX_SENSOR_VALUES] = {
+    [SENSOR_KIND_HUM] = { "humidity", "air_temp", "dew_point", NULL },
+    [SENSOR_KIND_EC]  = { "conductivity", "tds", "salinity", "specific_gravity" },
+    [SENSOR_KIND_DO]  = { "dissolved_oxygen", "saturation", NULL, NULL },
+    [SENSOR_KIND_ORP] = { "orp", NULL, NULL, NULL },
+};
+
+/**
+ * @brief HUM output parameter names (as reported by "O,?") to field names
+ */
+static const struct {
+    const char *param;
+    const char *field;
+} s_hum_params[] = {
+    { "HUM", "humidity" },
+    { "T",   "air_temp" },
+    { "Dew", "dew_point" },
+};
+
+static const char *s_generic_fields[MAX_SENSOR_VALUES] = { "value_0", "value_1", "value_2", "value_3" };
+
+static void json_put(json_writer_t *w, const char *data, size_t len) {
+    if (w->overflow) {
+        return;
+    }
+    // Always keep room for the terminating NUL
+    if (w->len + len >= w->size) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void json_put_char(json_writer_t *w, char c) {
+    json_put(w, &c, 1);
+}
+
+static void json_put_escaped(json_writer_t *w, const char *str) {
+    json_put_char(w, '"');
+    for (const char *p = str; *p != '\0'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            json_put(w, esc, 2);
+        } else if (c < 0x20) {
+            char esc[8];
+            int n = snprintf(esc, sizeof(esc), "\\u%04x", c);
+            json_put(w, esc, (size_t)n);
+        } else {
+            json_put_char(w, (char)c);
+        }
+    }
+    json_put_char(w, '"');
+}
+
+/**
+ * @brief Emit the separator and key that precede an element
+ */
+static void json_prefix(json_writer_t *w, const char *key) {
+    uint8_t bit = (uint8_t)(1u << w->depth);
+    if (w->needs_comma & bit) {
+        json_put_char(w, ',');
+    }
+    w->needs_comma |= bit;
+
+    if (key != NULL) {
+        json_put_escaped(w, key);
+        json_put_char(w, ':');
+    }
+}
+
+static void json_open(json_writer_t *w, const char *key, char bracket) {
+    json_prefix(w, key);
+    json_put_char(w, bracket);
+    if (w->depth + 1 >= TELEMETRY_JSON_MAX_DEPTH) {
+        w->overflow = true;
+        return;
+    }
+    w->depth++;
+    w->needs_comma &= (uint8_t)~(1u << w->depth);
+}
+
+static void json_close(json_writer_t *w, char bracket) {
+    if (w->depth > 0) {
+        w->depth--;
+    }
+    json_put_char(w, bracket);
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size) {
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = (buf == NULL || size == 0);
+    w->depth = 0;
+    w->needs_comma = 0;
+}
+
+const char *json_writer_finish(json_writer_t *w) {
+    if (w->overflow) {
+        if (w->buf != NULL && w->size > 0) {
+            w->buf[0] = '\0';
+        }
+        return NULL;
+    }
+    w->buf[w->len] = '\0';
+    return w->buf;
+}
+
+void json_begin_object(json_writer_t *w, const char *key) {
+    json_open(w, key, '{');
+}
+
+void json_end_object(json_writer_t *w) {
+    json_close(w, '}');
+}
+
+void json_begin_array(json_writer_t *w, const char *key) {
+    json_open(w, key, '[');
+}
+
+void json_end_array(json_writer_t *w) {
+    json_close(w, ']');
+}
+
+void json_add_string(json_writer_t *w, const char *key, const char *value) {
+    json_prefix(w, key);
+    json_put_escaped(w, value != NULL ? value : "");
+}
+
+void json_add_float(json_writer_t *w, const char *key, double value) {
+    json_prefix(w, key);
+    if (isnan(value) || isinf(value)) {
+        json_put(w, "null", 4);
+        return;
+    }
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%.7g", value);
+    json_put(w, num, (size_t)n);
+}
+
+void json_add_int(json_writer_t *w, const char *key, int64_t value) {
+    json_prefix(w, key);
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%" PRId64, value);
+    json_put(w, num, (size_t)n);
+}
+
+void json_add_bool(json_writer_t *w, const char *key, bool value) {
+    json_prefix(w, key);
+    if (value) {
+        json_put(w, "true", 4);
+    } else {
+        json_put(w, "false", 5);
+    }
+}
+
+static const char *telemetry_hum_field(const char *param) {
+    for (size_t i = 0; i < sizeof(s_hum_params) / sizeof(s_hum_params[0]); i++) {
+        if (strcasecmp(param, s_hum_params[i].param) == 0) {
+            return s_hum_params[i].field;
+        }
+    }
+    return NULL;
+}
+
+void telemetry_format_sensor_key(char *key, size_t size, uint8_t index, const cached_sensor_t *sensor) {
+    const char *name = sensor_kind_name((sensor_kind_t)sensor->kind);
+    if (sensor->kind == SENSOR_KIND_UNKNOWN) {
+        // Keep the type the sensor reported for kinds without a table entry
+        const ezo_sensor_t *ezo = (const ezo_sensor_t *)sensor_manager_get_ezo_sensor(index);
+        if (ezo != NULL && ezo->config.type[0] != '\0') {
+            name = ezo->config.type;
+        }
+    }
+
+    if (sensor->ordinal == 0) {
+        snprintf(key, size, "%s", name);
+    } else {
+        snprintf(key, size, "%s_%u", name, (unsigned)sensor->ordinal + 1);
+    }
+}
+
+void telemetry_format_sensor(json_writer_t *w, uint8_t index, const cached_sensor_t *sensor) {
+    if (sensor->value_count == 0) {
+        return;
+    }
+
+    char key[EZO_MAX_SENSOR_TYPE + 4];
+    telemetry_format_sensor_key(key, sizeof(key), index, sensor);
+
+    if (sensor->value_count == 1) {
+        json_add_float(w, key, sensor->values[0]);
+        return;
+    }
+
+    const char *const *fields = (sensor->kind < SENSOR_KIND_COUNT) ? s_field_maps[sensor->kind] : NULL;
+    const ezo_sensor_t *ezo = NULL;
+    if (sensor->kind == SENSOR_KIND_HUM) {
+        ezo = (const ezo_sensor_t *)sensor_manager_get_ezo_sensor(index);
+        if (ezo != NULL && ezo->config.hum.param_count == 0) {
+            ezo = NULL;
+        }
+    }
+
+    json_begin_object(w, key);
+    for (uint8_t j = 0; j < sensor->value_count && j < MAX_SENSOR_VALUES; j++) {
+        const char *field = NULL;
+
+        if (ezo != NULL) {
+            // Follow the enabled output order reported by the sensor
+            if (j < ezo->config.hum.param_count) {
+                field = telemetry_hum_field(ezo->config.hum.param_order[j]);
+            }
+        } else if (fields != NULL) {
+            field = fields[j];
+        }
+
+        json_add_float(w, field != NULL ? field : s_generic_fields[j], sensor->values[j]);
+    }
+    json_end_object(w);
+}
+
+void telemetry_format_sensors(json_writer_t *w, const sensor_cache_t *cache) {
+    json_begin_object(w, "sensors");
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        const cached_sensor_t *sensor = &cache->sensors[i];
+        if (sensor->valid) {
+            telemetry_format_sensor(w, i, sensor);
+        }
+    }
+    json_end_object(w);
+}
+
+static int telemetry_format_payload(char *buf, size_t size, const char *device_id,
+                                    const sensor_cache_t *cache, bool delta) {
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+
+    json_begin_object(&w, NULL);
+    json_add_string(&w, "device_id", device_id);
+    telemetry_format_sensors(&w, cache);
+    if (cache->battery_valid) {
+        json_add_float(&w, "battery", cache->battery_percentage);
+    }
+    json_add_int(&w, "rssi", cache->rssi);
+    if (delta) {
+        json_add_bool(&w, "full", false);
+    }
+    json_end_object(&w);
+
+    if (json_writer_finish(&w) == NULL) {
+        return -1;
+    }
+    return (int)w.len;
+}
+
+int telemetry_format_data(char *buf, size_t size, const char *device_id, const sensor_cache_t *cache) {
+    return telemetry_format_payload(buf, size, device_id, cache, false);
+}
+
+int telemetry_format_delta(char *buf, size_t size, const char *device_id, const sensor_cache_t *cache) {
+    return telemetry_format_payload(buf, size, device_id, cache, true);
+}
+
+void telemetry_format_record(json_writer_t *w, const char *time_key, int64_t time_value,
+                             const sensor_cache_t *cache) {
+    json_begin_object(w, NULL);
+    json_add_int(w, time_key, time_value);
+    telemetry_format_sensors(w, cache);
+    if (cache->battery_valid) {
+        json_add_float(w, "battery", cache->battery_percentage);
+    }
+    json_add_int(w, "rssi", cache->rssi);
+    json_end_object(w);
+}
+
+static void cbor_put(cbor_writer_t *w, const void *data, size_t len) {
+    if (w->overflow) {
+        return;
+    }
+    if (w->len + len > w->size) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+/**
+ * @brief Write a CBOR head: major type plus shortest-form argument
+ */
+static void cbor_put_head(cbor_writer_t *w, uint8_t major, uint64_t arg) {
+    uint8_t head[9];
+    size_t n;
+
+    if (arg < 24) {
+        head[0] = (uint8_t)((major << 5) | arg);
+        n = 1;
+    } else if (arg <= UINT8_MAX) {
+        head[0] = (uint8_t)((major << 5) | 24);
+        head[1] = (uint8_t)arg;
+        n = 2;
+    } else if (arg <= UINT16_MAX) {
+        head[0] = (uint8_t)((major << 5) | 25);
+        head[1] = (uint8_t)(arg >> 8);
+        head[2] = (uint8_t)arg;
+        n = 3;
+    } else if (arg <= UINT32_MAX) {
+        head[0] = (uint8_t)((major << 5) | 26);
+        for (int i = 0; i < 4; i++) {
+            head[1 + i] = (uint8_t)(arg >> (24 - 8 * i));
+        }
+        n = 5;
+    } else {
+        head[0] = (uint8_t)((major << 5) | 27);
+        for (int i = 0; i < 8; i++) {
+            head[1 + i] = (uint8_t)(arg >> (56 - 8 * i));
+        }
+        n = 9;
+    }
+    cbor_put(w, head, n);
+}
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size) {
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = (buf == NULL || size == 0);
+}
+
+void cbor_add_uint(cbor_writer_t *w, uint64_t value) {
+    cbor_put_head(w, 0, value);
+}
+
+void cbor_add_int(cbor_writer_t *w, int64_t value) {
+    if (value >= 0) {
+        cbor_put_head(w, 0, (uint64_t)value);
+    } else {
+        cbor_put_head(w, 1, (uint64_t)(-1 - value));
+    }
+}
+
+void cbor_add_float(cbor_writer_t *w, float value) {
+    if (isnan(value)) {
+        cbor_add_null(w);
+        return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t out[5] = { 0xFA, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16),
+                       (uint8_t)(bits >> 8), (uint8_t)bits };
+    cbor_put(w, out, sizeof(out));
+}
+
+void cbor_add_null(cbor_writer_t *w) {
+    uint8_t null_value = 0xF6;
+    cbor_put(w, &null_value, 1);
+}
+
+void cbor_add_text(cbor_writer_t *w, const char *str) {
+    size_t len = strlen(str);
+    cbor_put_head(w, 3, len);
+    cbor_put(w, str, len);
+}
+
+void cbor_begin_array(cbor_writer_t *w, size_t count) {
+    cbor_put_head(w, 4, count);
+}
+
+void cbor_begin_map(cbor_writer_t *w, size_t pairs) {
+    cbor_put_head(w, 5, pairs);
+}
+
+static const telemetry_schema_id_t s_schema_ids[SENSOR_KIND_COUNT] = {
+    [SENSOR_KIND_UNKNOWN] = TELEMETRY_SCHEMA_UNKNOWN,
+    [SENSOR_KIND_RTD]     = TELEMETRY_SCHEMA_RTD,
+    [SENSOR_KIND_PH]      = TELEMETRY_SCHEMA_PH,
+    [SENSOR_KIND_EC]      = TELEMETRY_SCHEMA_EC,
+    [SENSOR_KIND_DO]      = TELEMETRY_SCHEMA_DO,
+    [SENSOR_KIND_ORP]     = TELEMETRY_SCHEMA_ORP,
+    [SENSOR_KIND_HUM]     = TELEMETRY_SCHEMA_HUM,
+};
+
+/**
+ * @brief Write HUM values in the fixed schema order (humidity, air_temp, dew_point)
+ */
+static void telemetry_encode_hum(cbor_writer_t *w, uint8_t index, const cached_sensor_t *sensor) {
+    float fixed[3] = { NAN, NAN, NAN };
+    const ezo_sensor_t *ezo = (const ezo_sensor_t *)sensor_manager_get_ezo_sensor(index);
+
+    if (ezo != NULL && ezo->config.hum.param_count > 0) {
+        for (uint8_t j = 0; j < sensor->value_count && j < ezo->config.hum.param_count; j++) {
+            for (size_t k = 0; k < 3; k++) {
+                if (strcasecmp(ezo->config.hum.param_order[j], s_hum_params[k].param) == 0) {
+                    fixed[k] = sensor->values[j];
+                }
+            }
+        }
+    } else {
+        for (uint8_t j = 0; j < sensor->value_count && j < 3; j++) {
+            fixed[j] = sensor->values[j];
+        }
+    }
+
+    cbor_begin_array(w, 4);
+    cbor_add_uint(w, TELEMETRY_SCHEMA_HUM);
+    for (size_t k = 0; k < 3; k++) {
+        cbor_add_float(w, fixed[k]);
+    }
+}
+
+/**
+ * @brief Write battery, rssi and the sensor array of one snapshot
+ */
+static void telemetry_encode_snapshot_body(cbor_writer_t *w, const sensor_cache_t *cache) {
+    uint8_t valid_count = 0;
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        if (cache->sensors[i].valid && cache->sensors[i].value_count > 0) {
+            valid_count++;
+        }
+    }
+
+    if (cache->battery_valid) {
+        cbor_add_float(w, cache->battery_percentage);
+    } else {
+        cbor_add_null(w);
+    }
+    cbor_add_int(w, cache->rssi);
+
+    cbor_begin_array(w, valid_count);
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        const cached_sensor_t *sensor = &cache->sensors[i];
+        if (!sensor->valid || sensor->value_count == 0) {
+            continue;
+        }
+
+        telemetry_schema_id_t schema = (sensor->kind < SENSOR_KIND_COUNT) ? s_schema_ids[sensor->kind]
+                                                                          : TELEMETRY_SCHEMA_UNKNOWN;
+        if (schema == TELEMETRY_SCHEMA_HUM) {
+            telemetry_encode_hum(w, i, sensor);
+            continue;
+        }
+
+        uint8_t count = sensor->value_count < MAX_SENSOR_VALUES ? sensor->value_count : MAX_SENSOR_VALUES;
+        cbor_begin_array(w, 1 + count);
+        cbor_add_uint(w, schema);
+        for (uint8_t j = 0; j < count; j++) {
+            cbor_add_float(w, sensor->values[j]);
+        }
+    }
+}
+
+static int telemetry_encode_cbor_payload(uint8_t *buf, size_t size, uint32_t timestamp,
+                                         const sensor_cache_t *cache, bool delta) {
+    cbor_writer_t w;
+    cbor_writer_init(&w, buf, size);
+
+    cbor_begin_array(&w, delta ? 6 : 5);
+    cbor_add_uint(&w, TELEMETRY_CBOR_VERSION);
+    cbor_add_uint(&w, timestamp);
+    telemetry_encode_snapshot_body(&w, cache);
+    if (delta) {
+        uint8_t false_value = 0xF4;
+        cbor_put(&w, &false_value, 1);
+    }
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+int telemetry_encode_cbor(uint8_t *buf, size_t size, uint32_t timestamp, const sensor_cache_t *cache) {
+    return telemetry_encode_cbor_payload(buf, size, timestamp, cache, false);
+}
+
+int telemetry_encode_cbor_delta(uint8_t *buf, size_t size, uint32_t timestamp, const sensor_cache_t *cache) {
+    return telemetry_encode_cbor_payload(buf, size, timestamp, cache, true);
+}
+
+static uint32_t telemetry_sample_offset_ms(const sensor_cache_t *samples, uint8_t i) {
+    return (uint32_t)((samples[i].timestamp_us - samples[0].timestamp_us) / 1000);
+}
+
+int telemetry_encode_cbor_batch(uint8_t *buf, size_t size, uint32_t base_timestamp,
+                                const sensor_cache_t *samples, uint8_t count) {
+    cbor_writer_t w;
+    cbor_writer_init(&w, buf, size);
+
+    cbor_begin_array(&w, 3);
+    cbor_add_uint(&w, TELEMETRY_CBOR_VERSION);
+    cbor_add_uint(&w, base_timestamp);
+    cbor_begin_array(&w, count);
+    for (uint8_t i = 0; i < count; i++) {
+        cbor_begin_array(&w, 4);
+        cbor_add_uint(&w, telemetry_sample_offset_ms(samples, i));
+        telemetry_encode_snapshot_body(&w, &samples[i]);
+    }
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+int telemetry_format_batch(char *buf, size_t size, const char *device_id, uint32_t base_timestamp,
+                           const sensor_cache_t *samples, uint8_t count) {
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+
+    json_begin_object(&w, NULL);
+    json_add_string(&w, "device_id", device_id);
+    json_add_int(&w, "base_ts", base_timestamp);
+    json_begin_array(&w, "samples");
+    for (uint8_t i = 0; i < count; i++) {
+        telemetry_format_record(&w, "dt_ms", telemetry_sample_offset_ms(samples, i), &samples[i]);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    if (json_writer_finish(&w) == NULL) {
+        return -1;
+    }
+    return (int)w.len;
+}
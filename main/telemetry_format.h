@@ -0,0 +1,260 @@
+/**
+ * @file telemetry_format.h
+ * @brief Allocation-free JSON writer and shared sensor payload formatting
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensor_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_JSON_MAX_DEPTH    8       // Maximum object/array nesting
+#define TELEMETRY_JSON_MAX_LEN      2048    // Suggested buffer size for one snapshot payload
+
+/**
+ * @brief Streaming JSON writer over a caller-provided buffer
+ *
+ * Nothing is allocated. If the buffer fills up, further writes are dropped and
+ * json_writer_finish() returns NULL.
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+    uint8_t depth;
+    uint8_t needs_comma;                    // Bit per depth: an element was already written
+} json_writer_t;
+
+/**
+ * @brief Start writing into a buffer
+ *
+ * @param w Writer
+ * @param buf Output buffer
+ * @param size Output buffer size in bytes
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t size);
+
+/**
+ * @brief Terminate the output
+ *
+ * @param w Writer
+ * @return const char* The NUL-terminated JSON text, or NULL if the buffer overflowed
+ */
+const char *json_writer_finish(json_writer_t *w);
+
+/**
+ * @brief Open an object. key is NULL at top level and inside arrays.
+ */
+void json_begin_object(json_writer_t *w, const char *key);
+
+/**
+ * @brief Close the innermost object
+ */
+void json_end_object(json_writer_t *w);
+
+/**
+ * @brief Open an array. key is NULL at top level and inside arrays.
+ */
+void json_begin_array(json_writer_t *w, const char *key);
+
+/**
+ * @brief Close the innermost array
+ */
+void json_end_array(json_writer_t *w);
+
+/**
+ * @brief Add a string member (escaped)
+ */
+void json_add_string(json_writer_t *w, const char *key, const char *value);
+
+/**
+ * @brief Add a float member ("%.7g"; NaN and infinity are written as null)
+ */
+void json_add_float(json_writer_t *w, const char *key, double value);
+
+/**
+ * @brief Add an integer member
+ */
+void json_add_int(json_writer_t *w, const char *key, int64_t value);
+
+/**
+ * @brief Add a boolean member
+ */
+void json_add_bool(json_writer_t *w, const char *key, bool value);
+
+/**
+ * @brief Write one EZO sensor's values under its type name
+ *
+ * A single value is written as a number. Multiple values become an object
+ * with field names from the per-type table, e.g. HUM -> humidity/air_temp/dew_point.
+ * HUM follows the sensor's enabled output order when it is known. The second
+ * and later sensors of the same type get a suffix: "RTD", "RTD_2", "RTD_3".
+ *
+ * @param w Writer (must be inside an object)
+ * @param index EZO sensor index, used to look up the HUM output order
+ * @param sensor Cached sensor reading
+ */
+void telemetry_format_sensor(json_writer_t *w, uint8_t index, const cached_sensor_t *sensor);
+
+/**
+ * @brief Key a sensor is published under: its type name, plus "_<n>" after the first of a type
+ *
+ * @param key Output buffer
+ * @param size Output buffer size
+ * @param index EZO sensor index
+ * @param sensor Cached sensor reading
+ */
+void telemetry_format_sensor_key(char *key, size_t size, uint8_t index, const cached_sensor_t *sensor);
+
+/**
+ * @brief Write the "sensors" object for every valid slot in a snapshot
+ *
+ * @param w Writer (must be inside an object)
+ * @param cache Sensor snapshot
+ */
+void telemetry_format_sensors(json_writer_t *w, const sensor_cache_t *cache);
+
+/**
+ * @brief Format a complete KannaCloud data payload
+ *
+ * {"device_id":"...","sensors":{...},"battery":..,"rssi":..}
+ *
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param device_id Device ID
+ * @param cache Sensor snapshot
+ * @return int Payload length, or -1 if the buffer is too small
+ */
+int telemetry_format_data(char *buf, size_t size, const char *device_id, const sensor_cache_t *cache);
+
+/**
+ * @brief Format a change-only payload
+ *
+ * Same layout as telemetry_format_data() with "full":false appended. Only
+ * the slots marked valid in cache (the changed sensors) are written.
+ *
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param device_id Device ID
+ * @param cache Snapshot holding only the changed sensors
+ * @return int Payload length, or -1 if the buffer is too small
+ */
+int telemetry_format_delta(char *buf, size_t size, const char *device_id, const sensor_cache_t *cache);
+
+/**
+ * @brief Write one timestamped snapshot as an object inside an array
+ *
+ * {"<time_key>":..,"sensors":{...},"battery":..,"rssi":..}
+ *
+ * @param w Writer (must be inside an array)
+ * @param time_key Name of the time member, e.g. "ts" or "dt_ms"
+ * @param time_value Time value
+ * @param cache Sensor snapshot
+ */
+void telemetry_format_record(json_writer_t *w, const char *time_key, int64_t time_value,
+                             const sensor_cache_t *cache);
+
+/**
+ * @brief Format several snapshots as one batch payload
+ *
+ * {"device_id":"...","base_ts":..,"samples":[{"dt_ms":0,"sensors":{...},...},...]}
+ * dt_ms is each sample's offset from the first, taken from timestamp_us.
+ *
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param device_id Device ID
+ * @param base_timestamp Unix time in seconds of the first sample
+ * @param samples Snapshots, oldest first
+ * @param count Number of snapshots
+ * @return int Payload length, or -1 if the buffer is too small
+ */
+int telemetry_format_batch(char *buf, size_t size, const char *device_id, uint32_t base_timestamp,
+                           const sensor_cache_t *samples, uint8_t count);
+
+/**
+ * @brief Binary (CBOR) payload schema
+ *
+ * The payload is one CBOR array:
+ *   [version, timestamp, battery, rssi, [[schema_id, v0, v1, ...], ...]]
+ * version is TELEMETRY_CBOR_VERSION, timestamp is Unix seconds, battery is a
+ * float32 or null and rssi is an integer. Each sensor is an array that starts
+ * with its schema ID, followed by float32 values in the schema's fixed field
+ * order. HUM always carries humidity, air_temp and dew_point, with null for
+ * disabled outputs. A change-only payload appends a sixth element, false,
+ * and lists only the sensors that changed.
+ */
+#define TELEMETRY_CBOR_VERSION      1
+#define TELEMETRY_CBOR_MAX_LEN      512     // Suggested buffer size for one snapshot payload
+
+typedef enum {
+    TELEMETRY_SCHEMA_UNKNOWN = 0,           // Values in sensor output order
+    TELEMETRY_SCHEMA_RTD = 1,               // temperature
+    TELEMETRY_SCHEMA_PH = 2,                // ph
+    TELEMETRY_SCHEMA_EC = 3,                // conductivity, tds, salinity, specific_gravity
+    TELEMETRY_SCHEMA_DO = 4,                // dissolved_oxygen, saturation
+    TELEMETRY_SCHEMA_ORP = 5,               // orp
+    TELEMETRY_SCHEMA_HUM = 6,               // humidity, air_temp, dew_point
+} telemetry_schema_id_t;
+
+/**
+ * @brief Streaming CBOR writer over a caller-provided buffer
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} cbor_writer_t;
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size);
+void cbor_add_uint(cbor_writer_t *w, uint64_t value);
+void cbor_add_int(cbor_writer_t *w, int64_t value);
+void cbor_add_float(cbor_writer_t *w, float value);   // float32, NaN written as null
+void cbor_add_null(cbor_writer_t *w);
+void cbor_add_text(cbor_writer_t *w, const char *str);
+void cbor_begin_array(cbor_writer_t *w, size_t count);
+void cbor_begin_map(cbor_writer_t *w, size_t pairs);
+
+/**
+ * @brief Encode a snapshot as a compact CBOR payload
+ *
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param timestamp Unix time in seconds
+ * @param cache Sensor snapshot
+ * @return int Payload length, or -1 if the buffer is too small
+ */
+int telemetry_encode_cbor(uint8_t *buf, size_t size, uint32_t timestamp, const sensor_cache_t *cache);
+
+/**
+ * @brief Encode a change-only CBOR payload (see the schema note above)
+ */
+int telemetry_encode_cbor_delta(uint8_t *buf, size_t size, uint32_t timestamp, const sensor_cache_t *cache);
+
+/**
+ * @brief Encode several snapshots as one CBOR batch payload
+ *
+ * [version, base_timestamp, [[dt_ms, battery, rssi, [sensors...]], ...]]
+ * Each sample body has the same layout as the single-snapshot payload.
+ *
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param base_timestamp Unix time in seconds of the first sample
+ * @param samples Snapshots, oldest first
+ * @param count Number of snapshots
+ * @return int Payload length, or -1 if the buffer is too small
+ */
+int telemetry_encode_cbor_batch(uint8_t *buf, size_t size, uint32_t base_timestamp,
+                                const sensor_cache_t *samples, uint8_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -77,7 +77,7 @@ const heapKB=(d.free_heap/1024).toFixed(1);
 document.getElementById('free-heap').textContent=heapKB+' KB';
 if(d.rssi){document.getElementById('wifi-rssi').textContent=d.rssi+' dBm';}
 if(d.cpu_usage){document.getElementById('cpu-usage').textContent=d.cpu_usage+'%';}
-if(d.sensors){displaySensorValues(d.sensors);}
+if(d.sensors){liveSensors=d.sensors;displaySensorValues(liveSensors);}
 document.getElementById('status-dot').className='bg-green-500 w-3 h-3 rounded-full status-dot';
 document.getElementById('status-text').textContent='Device Online';
 }catch(e){console.error(e);
@@ -131,8 +131,20 @@ const probe=document.getElementById(`probe-${addr}`)?.value;
 if(probe)cfg.probe_type=parseFloat(probe);
 const tds=document.getElementById(`tds-${addr}`)?.value;
 if(tds)cfg.tds_factor=parseFloat(tds);
-await fetch('/api/sensors/config',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(cfg)});
-alert('Sensor configuration saved!');await loadSensors();}
+const r=await fetch('/api/sensors/config',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(cfg)});
+if(!r.ok){alert('Sensor is busy, try again');return;}
+const q=await r.json();
+const j=await waitSensorJob(q.job_id);
+alert(j.success?'Sensor configuration saved!':'Sensor configuration failed: '+(j.result||j.state));
+await loadSensors();}
+async function waitSensorJob(id){
+for(let i=0;i<60;i++){
+const r=await fetch('/api/sensors/job?id='+id);
+const j=await r.json();
+if(j.state==='done'||j.state==='unknown')return j;
+await new Promise(res=>setTimeout(res,250));
+}
+return {state:'timeout'};}
 function showTab(n){
 document.querySelectorAll('.tab').forEach((t,i)=>{
 if(i===n){
@@ -152,9 +164,30 @@ if(isLoadingStatus)return;
 isLoadingStatus=true;
 try{await loadStatus();}catch(e){console.error('Status load failed:',e);}
 finally{isLoadingStatus=false;}}
+let liveSensors={};
+let statusTimer=null;
+function startPolling(ms){
+if(statusTimer)clearInterval(statusTimer);
+statusTimer=setInterval(safeLoadStatus,ms);}
+function applyStreamEvent(d,full){
+if(full)liveSensors={};
+Object.assign(liveSensors,d.sensors||{});
+if(d.rssi){document.getElementById('wifi-rssi').textContent=d.rssi+' dBm';}
+displaySensorValues(liveSensors);}
+function startStream(){
+if(!window.EventSource){startPolling(10000);return;}
+const es=new EventSource('/api/stream');
+es.addEventListener('snapshot',e=>{applyStreamEvent(JSON.parse(e.data),true);startPolling(60000);});
+es.addEventListener('update',e=>{applyStreamEvent(JSON.parse(e.data),false);});
+es.onerror=()=>{
+startPolling(10000);
+if(es.readyState===EventSource.CLOSED)setTimeout(startStream,60000);
+};
+}
 async function initializeDashboard(){
 loadTheme();
 await safeLoadStatus();
-setInterval(safeLoadStatus,10000);
+startPolling(10000);
+startStream();
 }
 window.onload=()=>{initializeDashboard();};
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Pack the dashboard into flash assets
+
+Inlines local <script src='...'> files into the page, strips indentation and
+blank lines, and writes the result gzipped (<page>.gz) and plain (<stem>.min.html,
+for clients without gzip) plus a header with its content-hash ETag.
+Run by main/CMakeLists.txt on every build where a web file changed.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+
+SCRIPT_SRC = re.compile(r"<script src=['\"](?![a-z]+:|//)([^'\"]+)['\"]></script>")
+HTML_COMMENT = re.compile(r"<!--.*?-->", re.S)
+
+
+def minify(text):
+    """Drop comments, indentation and blank lines (newlines kept for JS ASI)"""
+    text = HTML_COMMENT.sub("", text)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def inline_scripts(html, base_dir):
+    def repl(match):
+        with open(os.path.join(base_dir, match.group(1)), encoding="utf-8") as f:
+            return "<script>\n" + f.read() + "\n</script>"
+    return SCRIPT_SRC.sub(repl, html)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("page", help="HTML page (e.g. web/index.html)")
+    parser.add_argument("--out-dir", required=True, help="Directory for the packed pages and web_assets.h")
+    args = parser.parse_args()
+
+    with open(args.page, encoding="utf-8") as f:
+        html = f.read()
+    inlined = inline_scripts(html, os.path.dirname(os.path.abspath(args.page)))
+    page = minify(inlined).encode("utf-8")
+
+    # mtime=0 keeps the output (and the ETag) identical across rebuilds
+    packed = gzip.compress(page, compresslevel=9, mtime=0)
+    etag = hashlib.sha256(page).hexdigest()[:16]
+
+    name = os.path.basename(args.page)
+    os.makedirs(args.out_dir, exist_ok=True)
+    with open(os.path.join(args.out_dir, name + ".gz"), "wb") as f:
+        f.write(packed)
+    with open(os.path.join(args.out_dir, os.path.splitext(name)[0] + ".min.html"), "wb") as f:
+        f.write(page)
+
+    header = (
+        "// Generated by main/web/pack_assets.py - do not edit\n"
+        "#pragma once\n\n"
+        f"#define WEB_INDEX_ETAG          \"\\\"{etag}\\\"\"\n"
+        f"#define WEB_INDEX_RAW_LEN       {len(page)}\n"
+    )
+    with open(os.path.join(args.out_dir, "web_assets.h"), "w", encoding="utf-8") as f:
+        f.write(header)
+
+    print(f"{name}: {len(inlined)} -> {len(page)} bytes minified, {len(packed)} gzipped, ETag {etag}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,12 +1,18 @@
 #include "wifi_manager.h"
 #include "provisioning_state.h"
 #include "ble_provisioning.h"
+#include "config_cache.h"
+#include "metrics.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_mac.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "cJSON.h"
 #include <string.h>
@@ -18,19 +24,46 @@ static const char *TAG = "WIFI_MGR";
 #define NVS_KEY_SSID "ssid"
 #define NVS_KEY_PASSWORD "password"
 #define NVS_KEY_PROVISIONED "provisioned"
+#define NVS_KEY_AP_CACHE "ap_cache"
 
 // WiFi event bits
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
 
-// Maximum retry attempts
+// Maximum retry attempts (a network that has worked before is retried forever)
 #define MAX_RETRY_ATTEMPTS 5
 
+// Reconnect backoff. The first retry is spread over 0..RETRY_FIRST_MS so a
+// building full of devices doesn't hit a rebooted AP in the same instant;
+// later delays double from RETRY_BASE_MS up to RETRY_MAX_MS, half fixed and
+// half random.
+#define RETRY_FIRST_MS 500
+#define RETRY_BASE_MS 1000
+#define RETRY_MAX_MS 60000
+
+// Last AP we associated with, for connecting without a full scan
+typedef struct {
+    char ssid[33];              // Network the entry belongs to
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;           // wifi_auth_mode_t; WPA3-only means PMF required
+} wifi_ap_cache_t;
+
 static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 static bool s_is_connected = false;
 static bool s_has_credentials_configured = false;
 
+static wifi_ap_cache_t s_ap_cache;
+static bool s_ap_cache_valid = false;
+static bool s_fast_connect = false;         // Current attempt is pinned to the cached AP
+static bool s_known_network = false;        // Network has worked before; never give up on it
+static bool s_auto_reconnect = false;       // Disconnects schedule a retry
+static bool s_link_up = false;              // Got an IP since the last connect/disconnect
+static int64_t s_attempt_us = 0;            // esp_wifi_connect() of the current attempt
+static int64_t s_link_lost_us = 0;          // When the link dropped, 0 if it is not lost
+static esp_timer_handle_t s_retry_timer = NULL;
+
 // Store credentials temporarily before saving
 static char pending_ssid[33] = {0};
 static char pending_password[64] = {0};
@@ -62,6 +95,113 @@ static void send_status_notification(provisioning_state_t state, provisioning_st
     cJSON_Delete(root);
 }
 
+// Load the cached AP from NVS
+static void load_ap_cache(void)
+{
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    
+    size_t len = sizeof(s_ap_cache);
+    s_ap_cache_valid = (nvs_get_blob(nvs_handle, NVS_KEY_AP_CACHE, &s_ap_cache, &len) == ESP_OK &&
+                        len == sizeof(s_ap_cache) && s_ap_cache.channel != 0);
+    nvs_close(nvs_handle);
+    
+    if (s_ap_cache_valid) {
+        s_ap_cache.ssid[sizeof(s_ap_cache.ssid) - 1] = '\0';
+        ESP_LOGI(TAG, "Cached AP for %s: channel %d", s_ap_cache.ssid, s_ap_cache.channel);
+    }
+}
+
+// Remember the AP we just associated with (written only when it changed)
+static void save_ap_cache(const wifi_event_sta_connected_t* event)
+{
+    wifi_ap_cache_t entry = {0};
+    memcpy(entry.ssid, event->ssid, event->ssid_len < sizeof(entry.ssid) ? event->ssid_len : sizeof(entry.ssid) - 1);
+    memcpy(entry.bssid, event->bssid, sizeof(entry.bssid));
+    entry.channel = event->channel;
+    entry.authmode = (uint8_t)event->authmode;
+    
+    if (s_ap_cache_valid && memcmp(&entry, &s_ap_cache, sizeof(entry)) == 0) {
+        return;
+    }
+    
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs_handle, NVS_KEY_AP_CACHE, &entry, sizeof(entry));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs_handle);
+        }
+        nvs_close(nvs_handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to cache AP: %s", esp_err_to_name(ret));
+        return;
+    }
+    
+    s_ap_cache = entry;
+    s_ap_cache_valid = true;
+    ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %d", MAC2STR(entry.bssid), entry.channel);
+}
+
+// Drop the pinned BSSID/channel so the next attempt scans for the network
+static void disable_fast_connect(void)
+{
+    wifi_config_t wifi_config;
+    
+    s_fast_connect = false;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) != ESP_OK) {
+        return;
+    }
+    wifi_config.sta.bssid_set = false;
+    memset(wifi_config.sta.bssid, 0, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = 0;
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config.sta.pmf_cfg.required = false;
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    metrics_count(METRIC_WIFI_FAST_FALLBACKS);
+}
+
+static void start_connect(void)
+{
+    s_attempt_us = esp_timer_get_time();
+    esp_err_t ret = esp_wifi_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_connect failed: %s", esp_err_to_name(ret));
+    }
+}
+
+static void retry_timer_callback(void* arg)
+{
+    if (s_auto_reconnect && !s_is_connected) {
+        start_connect();
+    }
+}
+
+// Delay before retry number `attempt` (0-based)
+static uint32_t retry_delay_ms(int attempt)
+{
+    if (attempt == 0) {
+        return esp_random() % (RETRY_FIRST_MS + 1);
+    }
+    
+    uint32_t delay = RETRY_BASE_MS << (attempt - 1 < 6 ? attempt - 1 : 6);
+    if (delay > RETRY_MAX_MS) {
+        delay = RETRY_MAX_MS;
+    }
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+static void schedule_retry(uint32_t delay_ms)
+{
+    esp_timer_stop(s_retry_timer);
+    if (esp_timer_start_once(s_retry_timer, (uint64_t)delay_ms * 1000) != ESP_OK) {
+        start_connect();
+    }
+}
+
 // WiFi event handler
 static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
@@ -69,25 +209,63 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
         ESP_LOGI(TAG, "WiFi station started, attempting to connect...");
         // Only connect if we have credentials configured
         if (s_has_credentials_configured) {
-            esp_wifi_connect();
+            start_connect();
+        }
+        
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* conn_event = (wifi_event_sta_connected_t*) event_data;
+        metrics_record_since(METRIC_HIST_WIFI_ASSOC, s_attempt_us);
+        if (s_fast_connect) {
+            metrics_count(METRIC_WIFI_FAST_CONNECTS);
         }
+        save_ap_cache(conn_event);
         
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         wifi_event_sta_disconnected_t* disconn_event = (wifi_event_sta_disconnected_t*) event_data;
         ESP_LOGI(TAG, "WiFi disconnected (reason: %d)", disconn_event->reason);
         
         s_is_connected = false;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        
+        bool link_lost = s_link_up;
+        s_link_up = false;
+        
+        if (!s_auto_reconnect) {
+            // wifi_manager_disconnect() or a config change in progress
+            return;
+        }
+        
+        if (link_lost) {
+            s_link_lost_us = esp_timer_get_time();
+        }
+        
+        // The first retry after a link loss still goes to the same AP; a
+        // pinned attempt that fails falls back to a full scan, as the AP may
+        // have changed channel or been replaced
+        if (s_fast_connect && !link_lost) {
+            ESP_LOGW(TAG, "Cached AP not reachable, scanning for %s", s_ap_cache.ssid);
+            disable_fast_connect();
+        }
+        
+        uint32_t delay_ms = retry_delay_ms(s_retry_num);
         
         if (s_retry_num < MAX_RETRY_ATTEMPTS) {
-            esp_wifi_connect();
+            schedule_retry(delay_ms);
             s_retry_num++;
-            ESP_LOGI(TAG, "Retry connection attempt %d/%d", s_retry_num, MAX_RETRY_ATTEMPTS);
+            ESP_LOGI(TAG, "Retry connection attempt %d/%d in %lu ms", s_retry_num, MAX_RETRY_ATTEMPTS,
+                     (unsigned long)delay_ms);
             
             char msg[64];
             snprintf(msg, sizeof(msg), "Connecting... (attempt %d/%d)", s_retry_num, MAX_RETRY_ATTEMPTS);
             provisioning_state_set(PROV_STATE_WIFI_CONNECTING, STATUS_SUCCESS, msg);
             send_status_notification(PROV_STATE_WIFI_CONNECTING, STATUS_SUCCESS, msg);
             
+        } else if (s_retry_num > MAX_RETRY_ATTEMPTS) {
+            // Known network, failure already reported: keep backing off
+            schedule_retry(delay_ms);
+            s_retry_num++;
+            ESP_LOGI(TAG, "Retry connection attempt %d in %lu ms", s_retry_num, (unsigned long)delay_ms);
+            
         } else {
             ESP_LOGE(TAG, "Failed to connect after %d attempts", MAX_RETRY_ATTEMPTS);
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
@@ -112,18 +290,51 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
                     break;
             }
             
-            provisioning_state_set(PROV_STATE_WIFI_FAILED, status_code, error_msg);
-            send_status_notification(PROV_STATE_WIFI_FAILED, status_code, error_msg);
+            if (s_known_network) {
+                // Not terminal: the state stays CONNECTING so nothing treats
+                // this as a reason to re-provision while retries go on
+                ESP_LOGI(TAG, "Network has worked before, retrying in %lu ms", (unsigned long)delay_ms);
+                schedule_retry(delay_ms);
+                s_retry_num++;
+                
+                char msg[96];
+                snprintf(msg, sizeof(msg), "%s, retrying in the background", error_msg);
+                provisioning_state_set(PROV_STATE_WIFI_CONNECTING, status_code, msg);
+                send_status_notification(PROV_STATE_WIFI_CONNECTING, status_code, msg);
+            } else {
+                provisioning_state_set(PROV_STATE_WIFI_FAILED, status_code, error_msg);
+                send_status_notification(PROV_STATE_WIFI_FAILED, status_code, error_msg);
+            }
         }
         
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "WiFi connected! IP: " IPSTR, IP2STR(&event->ip_info.ip));
         
+        if (s_link_lost_us != 0) {
+            metrics_record_since(METRIC_HIST_WIFI_RECONNECT, s_link_lost_us);
+            metrics_count(METRIC_WIFI_RECONNECTS);
+            ESP_LOGI(TAG, "Reconnected %lu ms after link loss (%d retries)",
+                     (unsigned long)((esp_timer_get_time() - s_link_lost_us) / 1000), s_retry_num);
+            s_link_lost_us = 0;
+        }
+        
         s_retry_num = 0;
         s_is_connected = true;
+        s_link_up = true;
+        s_known_network = true;
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         
+        char ip_str[16];
+        snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&event->ip_info.ip));
+        
+        if (pending_ssid[0] == '\0') {
+            // Reconnect to the stored network: nothing new to save
+            provisioning_state_set(PROV_STATE_PROVISIONED, STATUS_SUCCESS, ip_str);
+            send_status_notification(PROV_STATE_PROVISIONED, STATUS_SUCCESS, ip_str);
+            return;
+        }
+        
         // Save credentials to NVS
         esp_err_t ret = save_credentials_to_nvs(pending_ssid, pending_password);
         if (ret == ESP_OK) {
@@ -133,9 +344,6 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
             memset(pending_ssid, 0, sizeof(pending_ssid));
             memset(pending_password, 0, sizeof(pending_password));
             
-            char ip_str[16];
-            snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&event->ip_info.ip));
-            
             provisioning_state_set(PROV_STATE_PROVISIONED, STATUS_SUCCESS, ip_str);
             send_status_notification(PROV_STATE_PROVISIONED, STATUS_SUCCESS, ip_str);
             
@@ -190,6 +398,7 @@ static esp_err_t save_credentials_to_nvs(const char* ssid, const char* password)
     }
     
     nvs_close(nvs_handle);
+    config_cache_invalidate(CONFIG_CACHE_WIFI);
     return ret;
 }
 
@@ -204,6 +413,14 @@ esp_err_t wifi_manager_init(void)
         return ESP_FAIL;
     }
     
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_callback,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_retry_timer));
+    
+    load_ap_cache();
+    
     // Initialize TCP/IP stack
     ESP_ERROR_CHECK(esp_netif_init());
     
@@ -255,6 +472,26 @@ esp_err_t wifi_manager_connect(const char* ssid, const char* password)
     wifi_config.sta.pmf_cfg.capable = true;
     wifi_config.sta.pmf_cfg.required = false;
     
+    // Same network as last time: go straight to the cached AP (no scan).
+    // A failure falls back to a full scan in the disconnect handler.
+    s_known_network = (s_ap_cache_valid && strcmp(s_ap_cache.ssid, ssid) == 0);
+    s_fast_connect = s_known_network;
+    if (s_fast_connect) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, s_ap_cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = s_ap_cache.channel;
+        if (s_ap_cache.authmode == WIFI_AUTH_WPA3_PSK) {
+            wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA3_PSK;
+            wifi_config.sta.pmf_cfg.required = true;
+        }
+        ESP_LOGI(TAG, "Fast connect to cached AP " MACSTR " on channel %d",
+                 MAC2STR(s_ap_cache.bssid), s_ap_cache.channel);
+    }
+    
+    // No retries while the station restarts
+    s_auto_reconnect = false;
+    esp_timer_stop(s_retry_timer);
+    
     // Stop WiFi if already running
     esp_wifi_stop();
     
@@ -264,11 +501,14 @@ esp_err_t wifi_manager_connect(const char* ssid, const char* password)
     // Mark that we have credentials configured
     s_has_credentials_configured = true;
     
-    // Start WiFi
-    ESP_ERROR_CHECK(esp_wifi_start());
-    
     // Reset retry counter
     s_retry_num = 0;
+    s_link_up = false;
+    s_auto_reconnect = true;
+    xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
+    
+    // Start WiFi
+    ESP_ERROR_CHECK(esp_wifi_start());
     
     // Update state
     provisioning_state_set(PROV_STATE_WIFI_CONNECTING, STATUS_SUCCESS, "Initiating WiFi connection");
@@ -282,6 +522,30 @@ bool wifi_manager_is_connected(void)
     return s_is_connected;
 }
 
+bool wifi_manager_wait_for_failure(TickType_t timeout)
+{
+    if (s_wifi_event_group == NULL) {
+        vTaskDelay(timeout);
+        return false;
+    }
+    
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_FAIL_BIT,
+                                           pdTRUE, pdFALSE, timeout);
+    return (bits & WIFI_FAIL_BIT) != 0;
+}
+
+bool wifi_manager_wait_for_connection(TickType_t timeout)
+{
+    if (s_wifi_event_group == NULL) {
+        return false;
+    }
+    
+    // FAIL_BIT is cleared by wifi_manager_connect(), so a stale failure can't end the wait
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           pdFALSE, pdFALSE, timeout);
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
 esp_err_t wifi_manager_get_stored_credentials(char* ssid, char* password)
 {
     nvs_handle_t nvs_handle;
@@ -332,6 +596,8 @@ esp_err_t wifi_manager_get_stored_credentials(char* ssid, char* password)
 esp_err_t wifi_manager_disconnect(void)
 {
     ESP_LOGI(TAG, "Disconnecting from WiFi");
+    s_auto_reconnect = false;
+    esp_timer_stop(s_retry_timer);
     s_is_connected = false;
     return esp_wifi_disconnect();
 }
@@ -359,9 +625,12 @@ esp_err_t wifi_manager_clear_credentials(void)
     
     ret = nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
+    config_cache_invalidate(CONFIG_CACHE_WIFI);
     
-    // Clear the configured flag
+    // Clear the configured flag (the cached AP went with the namespace)
     s_has_credentials_configured = false;
+    s_ap_cache_valid = false;
+    s_known_network = false;
     
     ESP_LOGI(TAG, "Credentials cleared successfully");
     return ret;
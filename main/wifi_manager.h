@@ -3,6 +3,7 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"
 
 /**
  * @brief Initialize WiFi manager
@@ -14,6 +15,11 @@ esp_err_t wifi_manager_init(void);
 /**
  * @brief Connect to WiFi network with given credentials
  * 
+ * If the last AP associated with belongs to this SSID, its BSSID, channel
+ * and security mode (cached in NVS) are used to skip the scan; a failed
+ * attempt falls back to a normal scan. Disconnects are retried with
+ * jittered exponential backoff until wifi_manager_disconnect().
+ * 
  * @param ssid WiFi SSID
  * @param password WiFi password
  * @return ESP_OK on success
@@ -27,6 +33,30 @@ esp_err_t wifi_manager_connect(const char* ssid, const char* password);
  */
 bool wifi_manager_is_connected(void);
 
+/**
+ * @brief Block until the station has an IP address
+ * 
+ * Returns early if the retry budget runs out first.
+ * 
+ * @param timeout Maximum time to wait
+ * @return true if connected, false on failure or timeout
+ */
+bool wifi_manager_wait_for_connection(TickType_t timeout);
+
+/**
+ * @brief Block until the connection has failed for good
+ * 
+ * Returns once the retry budget is used up after a disconnect, so callers can
+ * sleep instead of polling wifi_manager_is_connected(). A network that has
+ * connected before keeps being retried in the background after this, and its
+ * provisioning state stays PROV_STATE_WIFI_CONNECTING; PROV_STATE_WIFI_FAILED
+ * is only set once retries have stopped.
+ * 
+ * @param timeout Maximum time to wait
+ * @return true if the connection failed, false on timeout
+ */
+bool wifi_manager_wait_for_failure(TickType_t timeout);
+
 /**
  * @brief Get stored WiFi credentials from NVS
  * 
@@ -0,0 +1,146 @@
+/**
+ * @file bench.c
+ * @brief Benchmark runner: timing, statistics, checks and JSON Lines output
+ */
+
+#include "bench.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+volatile uint32_t bench_sink;
+
+static const char *s_suite = "";
+static FILE *s_json = NULL;
+static bool s_quick = false;
+static uint32_t s_checks = 0;
+static uint32_t s_failures = 0;
+static uint32_t s_skipped = 0;
+
+int bench_init(int argc, char **argv, const char *suite) {
+    s_suite = suite;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            s_json = fopen(argv[++i], "w");
+            if (s_json == NULL) {
+                perror(argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            s_quick = true;
+        } else {
+            fprintf(stderr, "usage: %s [--json <results.jsonl>] [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("== %s%s\n", suite, s_quick ? " (quick)" : "");
+    printf("%-28s %-8s %14s %s\n", "bench", "metric", "value", "unit");
+    return 0;
+}
+
+bool bench_quick(void) {
+    return s_quick;
+}
+
+uint32_t bench_iterations(uint32_t iterations) {
+    if (!s_quick) {
+        return iterations;
+    }
+    return (iterations >= 10) ? iterations / 10 : 1;
+}
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void bench_report(const char *bench, const char *metric, double value, const char *unit) {
+    printf("%-28s %-8s %14.1f %s\n", bench, metric, value, unit);
+    if (s_json != NULL) {
+        fprintf(s_json, "{\"suite\":\"%s\",\"bench\":\"%s\",\"metric\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n",
+                s_suite, bench, metric, value, unit);
+    }
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void bench_report_samples(const char *bench, double *samples, size_t count, const char *unit) {
+    if (count == 0) {
+        return;
+    }
+
+    qsort(samples, count, sizeof(double), bench_compare_double);
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+
+    // Nearest-rank percentiles
+    size_t p95 = (count * 95 + 99) / 100;
+    bench_report(bench, "min", samples[0], unit);
+    bench_report(bench, "median", samples[(count - 1) / 2], unit);
+    bench_report(bench, "p95", samples[(p95 > 0 ? p95 : 1) - 1], unit);
+    bench_report(bench, "max", samples[count - 1], unit);
+    bench_report(bench, "mean", sum / (double)count, unit);
+}
+
+void bench_run(const char *bench, bench_fn_t fn, void *ctx, uint32_t iterations) {
+    uint32_t rounds = s_quick ? BENCH_ROUNDS_QUICK : BENCH_ROUNDS;
+    double samples[BENCH_ROUNDS];
+
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(ctx);
+    }
+
+    for (uint32_t round = 0; round < rounds; round++) {
+        uint64_t start_ns = bench_now_ns();
+        for (uint32_t i = 0; i < iterations; i++) {
+            fn(ctx);
+        }
+        samples[round] = (double)(bench_now_ns() - start_ns) / iterations;
+    }
+    bench_report_samples(bench, samples, rounds, "ns");
+}
+
+void bench_check(bool condition, const char *format, ...) {
+    s_checks++;
+    if (condition) {
+        return;
+    }
+
+    s_failures++;
+    va_list args;
+    va_start(args, format);
+    printf("CHECK FAILED: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+void bench_skip(const char *bench, const char *reason) {
+    s_skipped++;
+    printf("%-28s skipped: %s\n", bench, reason);
+}
+
+int bench_finish(void) {
+    if (s_json != NULL) {
+        fclose(s_json);
+        s_json = NULL;
+    }
+    printf("== %s: %lu checks, %lu failed, %lu skipped\n", s_suite,
+           (unsigned long)s_checks, (unsigned long)s_failures, (unsigned long)s_skipped);
+    fflush(stdout);
+    return s_failures ? 1 : 0;
+}
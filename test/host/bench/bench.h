@@ -0,0 +1,98 @@
+/**
+ * @file bench.h
+ * @brief Minimal benchmark runner with machine-readable (JSON Lines) output
+ *
+ * Every result is one line on the --json file:
+ *
+ *     {"suite":"parse","bench":"ezo_fetch_ec","metric":"median","value":412.0,"unit":"ns"}
+ *
+ * Units tell check_results.py how to compare against the baseline: "ns" is
+ * host CPU time and only warns, everything else ("sim_ms", "bytes",
+ * "count", ...) is deterministic enough to fail the run.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_ROUNDS            15      // Timed rounds per benchmark (samples for the statistics)
+#define BENCH_ROUNDS_QUICK      5       // With --quick
+
+typedef void (*bench_fn_t)(void *ctx);
+
+// Benchmarks fold their results in here so the compiler cannot drop the work
+extern volatile uint32_t bench_sink;
+
+/**
+ * @brief Parse the command line and open the results file
+ *
+ * Options: --json <path> (write results there), --quick (fewer rounds and
+ * iterations).
+ *
+ * @param suite Suite name written into every record
+ * @return int 0 on success, otherwise the exit code to return from main()
+ */
+int bench_init(int argc, char **argv, const char *suite);
+
+/**
+ * @brief Whether --quick was given
+ */
+bool bench_quick(void);
+
+/**
+ * @brief Scale an iteration count down under --quick
+ */
+uint32_t bench_iterations(uint32_t iterations);
+
+/**
+ * @brief Monotonic host clock in nanoseconds (not the simulated clock)
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * @brief Emit one result record
+ */
+void bench_report(const char *bench, const char *metric, double value, const char *unit);
+
+/**
+ * @brief Emit min, median, p95, max and mean of a sample set
+ *
+ * @param samples Values (sorted in place)
+ * @param count Number of samples
+ */
+void bench_report_samples(const char *bench, double *samples, size_t count, const char *unit);
+
+/**
+ * @brief Time fn() and report nanoseconds per call
+ *
+ * One untimed warm-up round, then bench rounds of `iterations` calls each;
+ * every round gives one ns/call sample.
+ */
+void bench_run(const char *bench, bench_fn_t fn, void *ctx, uint32_t iterations);
+
+/**
+ * @brief Record a correctness check; a failed check makes the run fail
+ */
+void bench_check(bool condition, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Record a benchmark that could not run (reported, does not fail)
+ */
+void bench_skip(const char *bench, const char *reason);
+
+/**
+ * @brief Close the results file and print the summary
+ *
+ * @return int Exit code: 0 if every check passed
+ */
+int bench_finish(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file bench_parse.c
+ * @brief EZO response fetch and parse cost (ezo_sensor_fetch_read)
+ *
+ * Each circuit finishes one conversion up front, then the reading is
+ * fetched over and over; the simulated bus transfers bytes instantly, so
+ * the time is the status read, response copy and value parsing. The raw_*
+ * benchmark is the bare bus receive for comparison.
+ */
+
+#include "bench.h"
+#include "sim_i2c.h"
+#include "ezo_sensor.h"
+#include "i2c_scanner.h"
+#include "driver/i2c_master.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+    const char *bench;
+    sim_ezo_config_t device;
+    ezo_sensor_t sensor;
+    esp_err_t last;
+    uint8_t count;
+    float values[4];
+} parse_case_t;
+
+static parse_case_t s_cases[] = {
+    { .bench = "fetch_rtd", .device = { .address = 0x66, .type = EZO_TYPE_RTD,
+                                        .values = { 23.456f }, .value_count = 1 } },
+    { .bench = "fetch_ec", .device = { .address = 0x64, .type = EZO_TYPE_EC,
+                                       .values = { 1413.0f, 706.0f, 0.69f, 1.0f }, .value_count = 4 } },
+    { .bench = "fetch_hum", .device = { .address = 0x6F, .type = EZO_TYPE_HUM, .outputs = "HUM,T,Dew",
+                                        .values = { 45.2f, 21.3f, 8.6f }, .value_count = 3 } },
+};
+
+static void bench_fetch(void *ctx) {
+    parse_case_t *c = (parse_case_t *)ctx;
+    c->last = ezo_sensor_fetch_read(&c->sensor, c->values, &c->count);
+    bench_sink += c->count;
+}
+
+static void bench_raw_receive(void *ctx) {
+    uint8_t buffer[EZO_LARGEST_STRING];
+    i2c_master_receive((i2c_master_dev_handle_t)ctx, buffer, sizeof(buffer), EZO_RESPONSE_TIMEOUT_MS);
+    bench_sink += buffer[1];
+}
+
+static bool values_match(const float *expected, const float *actual, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (fabsf(expected[i] - actual[i]) > 1e-3f * fmaxf(1.0f, fabsf(expected[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int ret = bench_init(argc, argv, "parse");
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Command and conversion waits are irrelevant here, run them fast
+    host_clock_set_scale(1000);
+    sim_i2c_reset();
+    sim_i2c_set_byte_time_us(0);
+    bench_check(i2c_scanner_init() == ESP_OK, "i2c_scanner_init");
+    i2c_master_bus_handle_t bus = i2c_scanner_get_bus_handle();
+
+    const size_t case_count = sizeof(s_cases) / sizeof(s_cases[0]);
+    for (size_t i = 0; i < case_count; i++) {
+        parse_case_t *c = &s_cases[i];
+        bench_check(sim_i2c_add_ezo(&c->device) == ESP_OK, "%s: attach", c->bench);
+        bench_check(ezo_sensor_init(&c->sensor, bus, c->device.address) == ESP_OK, "%s: init", c->bench);
+        bench_check(strcmp(c->sensor.config.type, c->device.type) == 0, "%s: type '%s'",
+                    c->bench, c->sensor.config.type);
+        bench_check(ezo_sensor_start_read(&c->sensor) == ESP_OK, "%s: start read", c->bench);
+    }
+    vTaskDelay(pdMS_TO_TICKS(EZO_READ_TIME_PH_MS + 100));
+
+    for (size_t i = 0; i < case_count; i++) {
+        parse_case_t *c = &s_cases[i];
+        bench_run(c->bench, bench_fetch, c, bench_iterations(20000));
+        bench_check(c->last == ESP_OK, "%s: fetch returned %s", c->bench, esp_err_to_name(c->last));
+        bench_check(c->count == c->device.value_count, "%s: %u values, expected %u",
+                    c->bench, c->count, c->device.value_count);
+        bench_check(values_match(c->device.values, c->values, c->device.value_count),
+                    "%s: parsed values differ", c->bench);
+    }
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = s_cases[1].device.address,
+        .scl_speed_hz = I2C_MASTER_FREQ_HZ,
+    };
+    i2c_master_dev_handle_t raw = NULL;
+    bench_check(i2c_master_bus_add_device(bus, &dev_config, &raw) == ESP_OK, "raw: add device");
+    bench_run("raw_receive", bench_raw_receive, raw, bench_iterations(20000));
+    i2c_master_bus_rm_device(raw);
+
+    for (size_t i = 0; i < case_count; i++) {
+        ezo_sensor_deinit(&s_cases[i].sensor);
+    }
+    i2c_scanner_deinit();
+    return bench_finish();
+}
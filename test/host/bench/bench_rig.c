@@ -0,0 +1,55 @@
+/**
+ * @file bench_rig.c
+ * @brief The reference sensor set on the simulated bus
+ */
+
+#include "bench_rig.h"
+#include "ezo_sensor.h"
+#include "max17048.h"
+#include "i2c_scanner.h"
+#include "i2c_arbiter.h"
+#include "sensor_manager.h"
+
+// Address order: DO 0x61, ORP 0x62, pH 0x63, EC 0x64, RTD 0x66, HUM 0x6F
+const sim_ezo_config_t rig_sensors[RIG_EZO_COUNT] = {
+    { .address = 0x61, .type = EZO_TYPE_DO,  .name = "tank_do",   .outputs = "MG,%",
+      .values = { 8.21f, 94.6f }, .value_count = 2 },
+    { .address = 0x62, .type = EZO_TYPE_ORP, .name = "tank_orp",
+      .values = { 245.3f }, .value_count = 1 },
+    { .address = 0x63, .type = EZO_TYPE_PH,  .name = "tank_ph",
+      .values = { 6.02f }, .value_count = 1 },
+    { .address = 0x64, .type = EZO_TYPE_EC,  .name = "tank_ec",   .outputs = "EC,TDS,S,SG",
+      .values = { 1413.0f, 706.0f, 0.69f, 1.0f }, .value_count = 4 },
+    { .address = 0x66, .type = EZO_TYPE_RTD, .name = "tank_temp",
+      .values = { 23.45f }, .value_count = 1 },
+    { .address = 0x6F, .type = EZO_TYPE_HUM, .name = "air",       .outputs = "HUM,T,Dew",
+      .values = { 45.2f, 21.3f, 8.6f }, .value_count = 3 },
+};
+
+void rig_attach(void) {
+    sim_i2c_reset();
+    for (int i = 0; i < RIG_EZO_COUNT; i++) {
+        sim_i2c_add_ezo(&rig_sensors[i]);
+    }
+    sim_i2c_add_max17048(RIG_BATTERY_VOLTAGE, RIG_BATTERY_SOC, RIG_BATTERY_RATE);
+}
+
+esp_err_t rig_start(void) {
+    esp_err_t ret = i2c_scanner_init();
+    if (ret == ESP_OK) {
+        ret = i2c_arbiter_init();
+    }
+    if (ret == ESP_OK) {
+        ret = sensor_manager_init();
+    }
+    return ret;
+}
+
+int rig_index(uint8_t address) {
+    for (int i = 0; i < RIG_EZO_COUNT; i++) {
+        if (rig_sensors[i].address == address) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file bench_rig.h
+ * @brief The reference sensor set on the simulated bus
+ *
+ * One circuit of every EZO type at its factory-default address plus the
+ * MAX17048, i.e. a fully populated board. Discovery registers them in
+ * address order, so rig index n is sensor manager index n.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sim_i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RIG_EZO_COUNT           6
+#define RIG_BATTERY_VOLTAGE     3.92f
+#define RIG_BATTERY_SOC         81.5f
+#define RIG_BATTERY_RATE        (-1.25f)
+
+extern const sim_ezo_config_t rig_sensors[RIG_EZO_COUNT];
+
+/**
+ * @brief Reset the simulated bus and attach the reference sensors
+ */
+void rig_attach(void);
+
+/**
+ * @brief Bring up the bus, the bus owner task and the sensor manager, as app_main() does
+ *
+ * @return esp_err_t First error from the init chain
+ */
+esp_err_t rig_start(void);
+
+/**
+ * @brief Rig index of the sensor at an address, -1 if none
+ */
+int rig_index(uint8_t address);
+
+#ifdef __cplusplus
+}
+#endif
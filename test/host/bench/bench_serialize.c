@@ -0,0 +1,276 @@
+/**
+ * @file bench_serialize.c
+ * @brief Telemetry payload encoding: streaming JSON writer, CBOR and cJSON
+ *
+ * All payloads are built from the same fixed six-sensor snapshot, so the
+ * byte counts are exact regression values. With cJSON available (see
+ * CMakeLists.txt) the tree-building approach telemetry_format.c replaced is
+ * measured next to it, including heap allocations per payload, and both
+ * outputs are checked to describe the same document.
+ */
+
+#include "bench.h"
+#include "telemetry_format.h"
+#include "sensor_manager.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define DEVICE_ID           "kc-3c84279a1f20"
+#define BATCH_SAMPLES       10
+#define BATCH_BUF_LEN       (TELEMETRY_JSON_MAX_LEN * BATCH_SAMPLES)
+
+typedef struct {
+    const sensor_cache_t *cache;
+    uint8_t count;
+    int len;
+} encode_ctx_t;
+
+static char s_json_buf[BATCH_BUF_LEN];
+static uint8_t s_cbor_buf[TELEMETRY_CBOR_MAX_LEN * BATCH_SAMPLES];
+static sensor_cache_t s_snapshot;
+static sensor_cache_t s_delta;
+static sensor_cache_t s_batch[BATCH_SAMPLES];
+
+static void set_sensor(sensor_cache_t *cache, uint8_t index, sensor_kind_t kind, const float *values, uint8_t count) {
+    cached_sensor_t *sensor = &cache->sensors[index];
+    sensor->kind = (uint8_t)kind;
+    sensor->address = 0x61 + index;
+    sensor->value_count = count;
+    sensor->valid = true;
+    sensor->timestamp_us = 10000000;
+    memcpy(sensor->values, values, count * sizeof(float));
+    memcpy(sensor->raw, values, count * sizeof(float));
+    if (index >= cache->sensor_count) {
+        cache->sensor_count = index + 1;
+    }
+}
+
+/**
+ * @brief The bench_rig sensor set as it appears in a published snapshot
+ */
+static void build_snapshots(void) {
+    memset(&s_snapshot, 0, sizeof(s_snapshot));
+    set_sensor(&s_snapshot, 0, SENSOR_KIND_DO, (const float[]){ 8.21f, 94.6f }, 2);
+    set_sensor(&s_snapshot, 1, SENSOR_KIND_ORP, (const float[]){ 245.3f }, 1);
+    set_sensor(&s_snapshot, 2, SENSOR_KIND_PH, (const float[]){ 6.02f }, 1);
+    set_sensor(&s_snapshot, 3, SENSOR_KIND_EC, (const float[]){ 1413.0f, 706.0f, 0.69f, 1.0f }, 4);
+    set_sensor(&s_snapshot, 4, SENSOR_KIND_RTD, (const float[]){ 23.45f }, 1);
+    set_sensor(&s_snapshot, 5, SENSOR_KIND_HUM, (const float[]){ 45.2f, 21.3f, 8.6f }, 3);
+    s_snapshot.battery_percentage = 81.5f;
+    s_snapshot.battery_rate = -1.25f;
+    s_snapshot.battery_valid = true;
+    s_snapshot.rssi = -61;
+    s_snapshot.timestamp_us = 10000000;
+
+    // Change-only payload: pH and temperature moved
+    s_delta = s_snapshot;
+    for (uint8_t i = 0; i < s_delta.sensor_count; i++) {
+        s_delta.sensors[i].valid = (i == 2 || i == 4);
+    }
+
+    for (int n = 0; n < BATCH_SAMPLES; n++) {
+        s_batch[n] = s_snapshot;
+        s_batch[n].timestamp_us += (uint64_t)n * 10000000;
+        s_batch[n].sensors[4].values[0] += 0.01f * n;
+    }
+}
+
+static void bench_json_data(void *arg) {
+    encode_ctx_t *ctx = (encode_ctx_t *)arg;
+    ctx->len = telemetry_format_data(s_json_buf, sizeof(s_json_buf), DEVICE_ID, ctx->cache);
+}
+
+static void bench_json_delta(void *arg) {
+    encode_ctx_t *ctx = (encode_ctx_t *)arg;
+    ctx->len = telemetry_format_delta(s_json_buf, sizeof(s_json_buf), DEVICE_ID, ctx->cache);
+}
+
+static void bench_json_batch(void *arg) {
+    encode_ctx_t *ctx = (encode_ctx_t *)arg;
+    ctx->len = telemetry_format_batch(s_json_buf, sizeof(s_json_buf), DEVICE_ID, 1760000000,
+                                      ctx->cache, ctx->count);
+}
+
+static void bench_cbor_data(void *arg) {
+    encode_ctx_t *ctx = (encode_ctx_t *)arg;
+    ctx->len = telemetry_encode_cbor(s_cbor_buf, sizeof(s_cbor_buf), 1760000000, ctx->cache);
+}
+
+static void bench_cbor_batch(void *arg) {
+    encode_ctx_t *ctx = (encode_ctx_t *)arg;
+    ctx->len = telemetry_encode_cbor_batch(s_cbor_buf, sizeof(s_cbor_buf), 1760000000, ctx->cache, ctx->count);
+}
+
+/**
+ * @brief Time one encoder and report its output size
+ */
+static void run_encoder(const char *bench, bench_fn_t fn, encode_ctx_t *ctx, uint32_t iterations) {
+    bench_run(bench, fn, ctx, bench_iterations(iterations));
+    bench_check(ctx->len > 0, "%s: encoder returned %d", bench, ctx->len);
+    bench_report(bench, "size", ctx->len, "bytes");
+}
+
+#if HAVE_CJSON
+
+static uint32_t s_mallocs;
+
+static void *counting_malloc(size_t size) {
+    s_mallocs++;
+    return malloc(size);
+}
+
+static cJSON *s_layout;     // Parsed writer output: supplies the key names
+static size_t s_cjson_len;
+
+/**
+ * @brief Build the data payload as a cJSON tree, the way the firmware did before telemetry_format
+ *
+ * Key and field names are taken from the parsed writer output so both
+ * encoders describe the same document.
+ */
+static cJSON *cjson_build(const sensor_cache_t *cache) {
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "device_id", DEVICE_ID);
+    cJSON *sensors = cJSON_AddObjectToObject(root, "sensors");
+
+    const cJSON *key = cJSON_GetObjectItem(s_layout, "sensors")->child;
+    for (uint8_t i = 0; i < cache->sensor_count && key != NULL; i++) {
+        const cached_sensor_t *sensor = &cache->sensors[i];
+        if (!sensor->valid || sensor->value_count == 0) {
+            continue;
+        }
+        if (sensor->value_count == 1) {
+            cJSON_AddNumberToObject(sensors, key->string, sensor->values[0]);
+        } else {
+            cJSON *object = cJSON_AddObjectToObject(sensors, key->string);
+            const cJSON *field = key->child;
+            for (uint8_t j = 0; j < sensor->value_count && field != NULL; j++, field = field->next) {
+                cJSON_AddNumberToObject(object, field->string, sensor->values[j]);
+            }
+        }
+        key = key->next;
+    }
+
+    if (cache->battery_valid) {
+        cJSON_AddNumberToObject(root, "battery", cache->battery_percentage);
+    }
+    cJSON_AddNumberToObject(root, "rssi", cache->rssi);
+    return root;
+}
+
+static void bench_cjson_data(void *arg) {
+    encode_ctx_t *ctx = (encode_ctx_t *)arg;
+    cJSON *root = cjson_build(ctx->cache);
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    s_cjson_len = strlen(json);
+    free(json);
+    ctx->len = (int)s_cjson_len;
+}
+
+/**
+ * @brief Structural equality with a relative tolerance on numbers
+ *
+ * The writer prints floats with %.7g and cJSON with up to 17 digits of the
+ * widened double, so the texts differ while the values agree.
+ */
+static bool cjson_equal(const cJSON *a, const cJSON *b) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (cJSON_IsNumber(a) && cJSON_IsNumber(b)) {
+        double scale = fmax(1.0, fabs(a->valuedouble));
+        return fabs(a->valuedouble - b->valuedouble) <= 1e-6 * scale;
+    }
+    if (cJSON_IsString(a) && cJSON_IsString(b)) {
+        return strcmp(a->valuestring, b->valuestring) == 0;
+    }
+    if (cJSON_IsObject(a) && cJSON_IsObject(b)) {
+        const cJSON *x = a->child;
+        const cJSON *y = b->child;
+        for (; x != NULL && y != NULL; x = x->next, y = y->next) {
+            if (strcmp(x->string, y->string) != 0 || !cjson_equal(x, y)) {
+                return false;
+            }
+        }
+        return x == NULL && y == NULL;
+    }
+    return cJSON_IsBool(a) && cJSON_IsBool(b) && cJSON_IsTrue(a) == cJSON_IsTrue(b);
+}
+
+static void run_cjson(encode_ctx_t *ctx) {
+    cJSON_Hooks hooks = {
+        .malloc_fn = counting_malloc,
+        .free_fn = free,
+    };
+    cJSON_InitHooks(&hooks);
+
+    int len = telemetry_format_data(s_json_buf, sizeof(s_json_buf), DEVICE_ID, &s_snapshot);
+    s_layout = cJSON_Parse(s_json_buf);
+    bench_check(s_layout != NULL, "writer output is not valid JSON: %.*s", len, s_json_buf);
+    if (s_layout == NULL) {
+        return;
+    }
+
+    s_mallocs = 0;
+    bench_cjson_data(ctx);
+    bench_report("cjson_data", "mallocs", s_mallocs, "count");
+
+    cJSON *reparsed = cJSON_Parse(s_json_buf);
+    cJSON *mirror = cjson_build(&s_snapshot);
+    bench_check(cjson_equal(reparsed, mirror), "json_writer and cJSON payloads differ");
+    cJSON_Delete(reparsed);
+    cJSON_Delete(mirror);
+
+    run_encoder("cjson_data", bench_cjson_data, ctx, 20000);
+    cJSON_Delete(s_layout);
+}
+
+#endif
+
+int main(int argc, char **argv) {
+    int ret = bench_init(argc, argv, "serialize");
+    if (ret != 0) {
+        return ret;
+    }
+    build_snapshots();
+
+    encode_ctx_t ctx = { .cache = &s_snapshot, .count = 1 };
+    run_encoder("json_data", bench_json_data, &ctx, 20000);
+    bench_check(strstr(s_json_buf, "\"device_id\":\"" DEVICE_ID "\"") != NULL, "json_data: device_id");
+    bench_check(strstr(s_json_buf, "\"pH\":6.02") != NULL, "json_data: pH value");
+    bench_check(strstr(s_json_buf, "\"conductivity\":1413") != NULL, "json_data: EC field names");
+    bench_check(strstr(s_json_buf, "\"dew_point\":8.6") != NULL, "json_data: HUM field names");
+    bench_report("json_data", "mallocs", 0, "count");
+
+    encode_ctx_t delta = { .cache = &s_delta, .count = 1 };
+    run_encoder("json_delta", bench_json_delta, &delta, 20000);
+    bench_check(strstr(s_json_buf, "\"full\":false") != NULL, "json_delta: full flag");
+    bench_check(strstr(s_json_buf, "EC") == NULL, "json_delta: unchanged sensor written");
+
+    encode_ctx_t batch = { .cache = s_batch, .count = BATCH_SAMPLES };
+    run_encoder("json_batch_10", bench_json_batch, &batch, 2000);
+
+    run_encoder("cbor_data", bench_cbor_data, &ctx, 20000);
+    bench_check(ctx.len > 0 && s_cbor_buf[0] == 0x85, "cbor_data: 5-element array header 0x%02X", s_cbor_buf[0]);
+    run_encoder("cbor_batch_10", bench_cbor_batch, &batch, 2000);
+
+    // Size check on the JSON writer: a short buffer fails cleanly instead of truncating
+    char small[64];
+    bench_check(telemetry_format_data(small, sizeof(small), DEVICE_ID, &s_snapshot) == -1,
+                "json_data into 64 bytes did not report overflow");
+
+#if HAVE_CJSON
+    run_cjson(&ctx);
+#else
+    bench_skip("cjson_data", "built without cJSON (set HOST_CJSON_DIR)");
+#endif
+
+    return bench_finish();
+}
@@ -0,0 +1,101 @@
+/**
+ * @file bench_snapshot.c
+ * @brief Cost of reading the published sensor snapshot
+ *
+ * HTTP handlers, MQTT publishing and the scalar getters copy the whole
+ * double-buffered sensor_cache_t on every call; this measures that copy and
+ * the cached-value lookups built on it, idle and while the reading task is
+ * publishing new snapshots back to back.
+ */
+
+#include "bench.h"
+#include "bench_rig.h"
+#include "sensor_manager.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdatomic.h>
+
+typedef struct {
+    esp_err_t last;
+} snapshot_ctx_t;
+
+static atomic_bool s_churn;
+
+static void bench_get_cached_data(void *arg) {
+    snapshot_ctx_t *ctx = (snapshot_ctx_t *)arg;
+    sensor_cache_t cache;
+    ctx->last = sensor_manager_get_cached_data(&cache);
+    bench_sink += cache.sensor_count;
+}
+
+static void bench_get_cached_value(void *arg) {
+    snapshot_ctx_t *ctx = (snapshot_ctx_t *)arg;
+    float value = 0.0f;
+    uint32_t age_ms = 0;
+    ctx->last = sensor_manager_get_cached_value("pH", &value, &age_ms);
+    bench_sink += (uint32_t)value;
+}
+
+static void bench_get_cached_battery(void *arg) {
+    snapshot_ctx_t *ctx = (snapshot_ctx_t *)arg;
+    float percentage = 0.0f;
+    ctx->last = sensor_manager_get_cached_battery(&percentage, NULL);
+    bench_sink += (uint32_t)percentage;
+}
+
+/**
+ * @brief Keep the reading task publishing: one on-demand sweep after another
+ */
+static void churn_task(void *arg) {
+    while (atomic_load(&s_churn)) {
+        sensor_manager_read_now(SENSOR_READ_ALL, NULL, 10000);
+    }
+    vTaskDelete(NULL);
+}
+
+int main(int argc, char **argv) {
+    int ret = bench_init(argc, argv, "snapshot");
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Snapshot reads never touch the bus; make the sweeps behind them fast
+    host_clock_set_scale(1000);
+    rig_attach();
+    sim_i2c_set_byte_time_us(0);
+    bench_check(rig_start() == ESP_OK, "sensor manager init");
+    bench_check(sensor_manager_start_reading_task(3600) == ESP_OK, "start reading task");
+
+    sensor_cache_t cache;
+    esp_err_t read_ret = sensor_manager_read_now(SENSOR_READ_ALL, &cache, 10000);
+    bench_check(read_ret == ESP_OK, "first sweep: %s", esp_err_to_name(read_ret));
+    bench_check(cache.sensor_count == RIG_EZO_COUNT, "%u sensors in the snapshot", cache.sensor_count);
+    bench_report("sensor_cache_t", "size", sizeof(sensor_cache_t), "bytes");
+
+    snapshot_ctx_t ctx = { 0 };
+    bench_run("get_cached_data", bench_get_cached_data, &ctx, bench_iterations(200000));
+    bench_check(ctx.last == ESP_OK, "get_cached_data: %s", esp_err_to_name(ctx.last));
+
+    float ph = 0.0f;
+    bench_check(sensor_manager_get_cached_value("pH", &ph, NULL) == ESP_OK &&
+                fabsf(ph - rig_sensors[2].values[0]) < 1e-3f, "cached pH %.3f", ph);
+    bench_run("get_cached_value", bench_get_cached_value, &ctx, bench_iterations(200000));
+    bench_check(ctx.last == ESP_OK, "get_cached_value: %s", esp_err_to_name(ctx.last));
+
+    bench_run("get_cached_battery", bench_get_cached_battery, &ctx, bench_iterations(200000));
+    bench_check(ctx.last == ESP_OK, "get_cached_battery: %s", esp_err_to_name(ctx.last));
+
+    // Same copy while a writer publishes concurrently (seqlock retries)
+    atomic_store(&s_churn, true);
+    TaskHandle_t churn = NULL;
+    xTaskCreate(churn_task, "churn", 4096, NULL, 5, &churn);
+    bench_run("get_cached_data_churn", bench_get_cached_data, &ctx, bench_iterations(200000));
+    bench_check(ctx.last == ESP_OK, "get_cached_data under churn: %s", esp_err_to_name(ctx.last));
+    atomic_store(&s_churn, false);
+    vTaskDelay(pdMS_TO_TICKS(5000));
+
+    sensor_manager_stop_reading_task();
+    return bench_finish();
+}
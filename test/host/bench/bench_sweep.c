@@ -0,0 +1,234 @@
+/**
+ * @file bench_sweep.c
+ * @brief End-to-end sensor sweep latency through sensor_reading_task()
+ *
+ * Runs the real sensor manager on the simulated bus: discovery and stored
+ * inventory init, then on-demand sweeps (sensor_manager_read_now() with
+ * every sensor) under a set of fault scenarios. Latencies are simulated
+ * milliseconds, i.e. what the board would see, independent of host speed;
+ * the simulated clock runs SWEEP_TIME_SCALE times faster than real time.
+ */
+
+#include "bench.h"
+#include "bench_rig.h"
+#include "sensor_manager.h"
+#include "ezo_sensor.h"
+#include "nvs.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SWEEP_TIME_SCALE        20
+#define SWEEP_ROUNDS            10
+#define SWEEP_ROUNDS_QUICK      3
+#define SWEEP_TIMEOUT_MS        30000
+#define SWEEP_SEED              0x5EED1234u
+
+#define SWEEP_ANY_RESULT        ESP_FAIL    // Scenario result not checked (random faults)
+
+#define RIG_DO                  0
+#define RIG_PH                  2
+#define RIG_EC                  3
+
+typedef struct {
+    const char *name;
+    void (*apply)(void);
+    esp_err_t first_result;     // Expected result of the first sweep under the fault
+    esp_err_t result;           // ... and of the following ones
+    uint8_t fresh;              // Sensors expected to sample fresh on the following sweeps (0 = don't check)
+} sweep_scenario_t;
+
+static void apply_to_all(const sim_fault_t *fault) {
+    for (int i = 0; i < RIG_EZO_COUNT; i++) {
+        sim_i2c_set_fault(rig_sensors[i].address, fault);
+    }
+}
+
+static void apply_nominal(void) {
+    apply_to_all(NULL);
+}
+
+static void apply_jitter(void) {
+    sim_fault_t fault = { .jitter_ms = 200 };
+    apply_to_all(&fault);
+}
+
+static void apply_nack(void) {
+    sim_fault_t fault = { .nack_permille = 50 };
+    apply_to_all(&fault);
+}
+
+static void apply_do_stuck(void) {
+    sim_fault_t fault = { .stuck = true };
+    sim_i2c_set_fault(rig_sensors[RIG_DO].address, &fault);
+}
+
+static void apply_rt_rejected(void) {
+    sim_fault_t fault = { .reject_rt = true };
+    sim_i2c_set_fault(rig_sensors[RIG_DO].address, &fault);
+    sim_i2c_set_fault(rig_sensors[RIG_PH].address, &fault);
+    sim_i2c_set_fault(rig_sensors[RIG_EC].address, &fault);
+}
+
+static const sweep_scenario_t s_scenarios[] = {
+    { "nominal",     apply_nominal,     ESP_OK,                   ESP_OK,                   RIG_EZO_COUNT },
+    { "jitter_200",  apply_jitter,      ESP_OK,                   ESP_OK,                   RIG_EZO_COUNT },
+    { "nack_5pct",   apply_nack,        SWEEP_ANY_RESULT,         SWEEP_ANY_RESULT,         0 },
+    { "do_stuck",    apply_do_stuck,    ESP_ERR_INVALID_RESPONSE, ESP_ERR_INVALID_RESPONSE, RIG_EZO_COUNT - 1 },
+    { "rt_rejected", apply_rt_rejected, ESP_ERR_INVALID_RESPONSE, ESP_OK,                   RIG_EZO_COUNT },
+};
+
+static double sim_ms_since(int64_t start_us) {
+    return (double)(esp_timer_get_time() - start_us) / 1000.0;
+}
+
+static uint8_t count_fresh(const sensor_cache_t *cache, int64_t since_us) {
+    uint8_t fresh = 0;
+    for (uint8_t i = 0; i < cache->sensor_count; i++) {
+        if (cache->sensors[i].valid && (int64_t)cache->sensors[i].timestamp_us >= since_us) {
+            fresh++;
+        }
+    }
+    return fresh;
+}
+
+static bool values_match(const sensor_cache_t *cache) {
+    for (int i = 0; i < RIG_EZO_COUNT; i++) {
+        const cached_sensor_t *sensor = &cache->sensors[i];
+        if (sensor->value_count != rig_sensors[i].value_count) {
+            return false;
+        }
+        for (uint8_t j = 0; j < sensor->value_count; j++) {
+            float expected = rig_sensors[i].values[j];
+            if (fabsf(sensor->values[j] - expected) > 1e-3f * fmaxf(1.0f, fabsf(expected))) {
+                return false;
+            }
+        }
+    }
+    return cache->battery_valid && fabsf(cache->battery_percentage - RIG_BATTERY_SOC) < 0.01f;
+}
+
+static void report_bus(const char *bench, const sim_i2c_stats_t *stats, uint32_t sweeps) {
+    bench_report(bench, "i2c_xfers", (double)stats->transactions / sweeps, "count");
+    bench_report(bench, "busy_polls", (double)stats->busy_polls / sweeps, "count");
+    bench_report(bench, "bus_time", (double)stats->bus_time_us / 1000.0 / sweeps, "sim_ms");
+}
+
+/**
+ * @brief Cold (full discovery) and warm (stored inventory) sensor manager init
+ */
+static void bench_init_paths(void) {
+    sim_i2c_stats_t stats;
+
+    host_nvs_clear();
+    sim_i2c_clear_stats();
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = rig_start();
+    bench_report("init_cold", "time", sim_ms_since(start_us), "sim_ms");
+    sim_i2c_get_stats(&stats);
+    bench_report("init_cold", "i2c_xfers", stats.transactions, "count");
+    bench_check(ret == ESP_OK, "cold init: %s", esp_err_to_name(ret));
+    bench_check(sensor_manager_get_ezo_count() == RIG_EZO_COUNT, "cold init found %u EZO sensors",
+                sensor_manager_get_ezo_count());
+    bench_check(sensor_manager_has_battery_monitor(), "cold init: no battery monitor");
+    for (int i = 0; i < RIG_EZO_COUNT; i++) {
+        bench_check(sensor_manager_get_ezo_index(rig_sensors[i].address) == i, "sensor 0x%02X not at index %d",
+                    rig_sensors[i].address, i);
+    }
+
+    sensor_manager_deinit();
+    sim_i2c_clear_stats();
+    start_us = esp_timer_get_time();
+    ret = sensor_manager_init();
+    bench_report("init_warm", "time", sim_ms_since(start_us), "sim_ms");
+    sim_i2c_get_stats(&stats);
+    bench_report("init_warm", "i2c_xfers", stats.transactions, "count");
+    bench_check(ret == ESP_OK, "warm init: %s", esp_err_to_name(ret));
+    bench_check(sensor_manager_get_ezo_count() == RIG_EZO_COUNT, "warm init restored %u EZO sensors",
+                sensor_manager_get_ezo_count());
+}
+
+static void run_scenario(const sweep_scenario_t *scenario, uint32_t rounds) {
+    double latency[SWEEP_ROUNDS];
+    sensor_cache_t cache;
+    sim_i2c_stats_t stats;
+    uint32_t ok = 0;
+    uint32_t fresh_total = 0;
+    esp_err_t ret;
+
+    scenario->apply();
+
+    // First sweep under the fault: the manager may change course (e.g. drop RT)
+    char name[40];
+    snprintf(name, sizeof(name), "%s_first", scenario->name);
+    int64_t start_us = esp_timer_get_time();
+    ret = sensor_manager_read_now(SENSOR_READ_ALL, &cache, SWEEP_TIMEOUT_MS);
+    bench_report(name, "time", sim_ms_since(start_us), "sim_ms");
+    if (scenario->first_result != SWEEP_ANY_RESULT) {
+        bench_check(ret == scenario->first_result, "%s: first sweep returned %s, expected %s", scenario->name,
+                    esp_err_to_name(ret), esp_err_to_name(scenario->first_result));
+    }
+
+    sim_i2c_clear_stats();
+    for (uint32_t round = 0; round < rounds; round++) {
+        start_us = esp_timer_get_time();
+        ret = sensor_manager_read_now(SENSOR_READ_ALL, &cache, SWEEP_TIMEOUT_MS);
+        latency[round] = sim_ms_since(start_us);
+        bench_check(ret != ESP_ERR_TIMEOUT, "%s: sweep %lu timed out", scenario->name, (unsigned long)round);
+
+        uint8_t fresh = count_fresh(&cache, start_us);
+        fresh_total += fresh;
+        if (ret == ESP_OK) {
+            ok++;
+        }
+        if (scenario->result != SWEEP_ANY_RESULT) {
+            bench_check(ret == scenario->result, "%s: sweep %lu returned %s, expected %s", scenario->name,
+                        (unsigned long)round, esp_err_to_name(ret), esp_err_to_name(scenario->result));
+        }
+        if (scenario->fresh > 0) {
+            bench_check(fresh == scenario->fresh, "%s: sweep %lu sampled %u sensors fresh, expected %u",
+                        scenario->name, (unsigned long)round, fresh, scenario->fresh);
+        }
+        if (ret == ESP_OK) {
+            bench_check(values_match(&cache), "%s: sweep %lu values differ from the simulated ones",
+                        scenario->name, (unsigned long)round);
+        }
+    }
+    sim_i2c_get_stats(&stats);
+
+    bench_report_samples(scenario->name, latency, rounds, "sim_ms");
+    bench_report(scenario->name, "ok_pct", 100.0 * ok / rounds, "pct");
+    bench_report(scenario->name, "fresh", (double)fresh_total / rounds, "count");
+    report_bus(scenario->name, &stats, rounds);
+
+    // Clear the fault and let the next scenario start from a healthy cache
+    apply_nominal();
+    sensor_manager_read_now(SENSOR_READ_ALL, NULL, SWEEP_TIMEOUT_MS);
+}
+
+int main(int argc, char **argv) {
+    int ret = bench_init(argc, argv, "sweep");
+    if (ret != 0) {
+        return ret;
+    }
+
+    host_clock_set_scale(SWEEP_TIME_SCALE);
+    rig_attach();
+    sim_i2c_seed(SWEEP_SEED);
+    bench_init_paths();
+
+    // Long interval: every sweep below is an on-demand one
+    bench_check(sensor_manager_start_reading_task(3600) == ESP_OK, "start reading task");
+    sensor_manager_read_now(SENSOR_READ_ALL, NULL, SWEEP_TIMEOUT_MS);
+
+    uint32_t rounds = bench_quick() ? SWEEP_ROUNDS_QUICK : SWEEP_ROUNDS;
+    for (size_t i = 0; i < sizeof(s_scenarios) / sizeof(s_scenarios[0]); i++) {
+        run_scenario(&s_scenarios[i], rounds);
+    }
+
+    sensor_manager_stop_reading_task();
+    return bench_finish();
+}
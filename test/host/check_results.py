@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Compare host benchmark results against the committed baseline
+
+Reads the JSON Lines files written by the bench_* programs and checks every
+metric listed in baseline.json. Units in "warn_only" (host CPU time) only
+print a warning when they regress, since they depend on the machine; all
+other units are simulated time, byte counts or event counts and fail the
+run. Metrics without a baseline entry are reported but not checked.
+
+    check_results.py --baseline baseline.json build/results
+    check_results.py --baseline baseline.json build/results --update
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+
+
+def load_results(paths):
+    """{"suite/bench/metric": (value, unit)} from .jsonl files or directories of them"""
+    results = {}
+    for path in paths:
+        files = sorted(glob.glob(os.path.join(path, "*.jsonl"))) if os.path.isdir(path) else [path]
+        for name in files:
+            with open(name, encoding="utf-8") as f:
+                for line in f:
+                    if not line.strip():
+                        continue
+                    record = json.loads(line)
+                    key = "/".join((record["suite"], record["bench"], record["metric"]))
+                    results[key] = (record["value"], record["unit"])
+    return results
+
+
+def check(baseline, results):
+    """Yield (status, key, message) for every baseline metric"""
+    tolerances = baseline.get("tolerance", {})
+    warn_only = set(baseline.get("warn_only", []))
+
+    for key, entry in sorted(baseline["metrics"].items()):
+        if key not in results:
+            yield "missing", key, "not in the results"
+            continue
+
+        value, unit = results[key]
+        base = entry["value"]
+        tolerance = entry.get("tolerance", tolerances.get(unit, 0.0))
+        higher_is_better = entry.get("better", "lower") == "higher"
+
+        # Positive change = worse
+        change = (base - value) if higher_is_better else (value - base)
+        limit = abs(base) * tolerance
+        detail = f"{value:g} {unit} (baseline {base:g}, tolerance {tolerance:.0%})"
+
+        if change > limit:
+            yield ("warn" if unit in warn_only else "FAIL"), key, detail
+        elif -change > limit:
+            yield "better", key, detail
+        else:
+            yield "ok", key, detail
+
+
+def update(baseline, results):
+    """Take the new values of every metric already in the baseline"""
+    for key, entry in baseline["metrics"].items():
+        if key in results:
+            entry["value"] = results[key][0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("results", nargs="+", help="Results directory or .jsonl files")
+    parser.add_argument("--baseline", required=True, help="Baseline file (baseline.json)")
+    parser.add_argument("--update", action="store_true", help="Write the current values into the baseline")
+    args = parser.parse_args()
+
+    with open(args.baseline, encoding="utf-8") as f:
+        baseline = json.load(f)
+    results = load_results(args.results)
+    if not results:
+        print("No results found", file=sys.stderr)
+        return 1
+
+    if args.update:
+        update(baseline, results)
+        with open(args.baseline, "w", encoding="utf-8") as f:
+            json.dump(baseline, f, indent=2)
+            f.write("\n")
+        print(f"Updated {len(baseline['metrics'])} metrics in {args.baseline}")
+        return 0
+
+    counts = {}
+    for status, key, detail in check(baseline, results):
+        counts[status] = counts.get(status, 0) + 1
+        if status != "ok":
+            print(f"{status:8} {key}: {detail}")
+
+    unchecked = len(set(results) - set(baseline["metrics"]))
+    summary = ", ".join(f"{n} {status}" for status, n in sorted(counts.items()))
+    print(f"{len(baseline['metrics'])} baseline metrics: {summary}; {unchecked} more results not in the baseline")
+    if counts.get("better"):
+        print("Improvements beyond tolerance: rerun with --update to lock them in")
+    return 1 if counts.get("FAIL") else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,291 @@
+/**
+ * @file esp_host.c
+ * @brief Host shim: simulated clock, logging, error names, heap, CRC, NVS and Wi-Fi info
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HOST_NVS_MAX_ENTRIES    32
+#define HOST_NVS_MAX_BLOB       4096
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+int8_t host_wifi_rssi = -55;
+
+static int64_t s_clock_start_ns;
+static atomic_uint s_clock_scale = 1;
+
+static int64_t host_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+__attribute__((constructor))
+static void host_init(void) {
+    s_clock_start_ns = host_monotonic_ns();
+
+    const char *scale = getenv("HOST_TIME_SCALE");
+    if (scale != NULL && atoi(scale) > 0) {
+        atomic_store(&s_clock_scale, (unsigned)atoi(scale));
+    }
+    const char *level = getenv("HOST_LOG_LEVEL");
+    if (level != NULL && atoi(level) >= ESP_LOG_NONE && atoi(level) <= ESP_LOG_VERBOSE) {
+        host_log_level = (esp_log_level_t)atoi(level);
+    }
+}
+
+void host_clock_set_scale(uint32_t scale) {
+    if (getenv("HOST_TIME_SCALE") == NULL && scale > 0) {
+        atomic_store(&s_clock_scale, scale);
+    }
+}
+
+uint32_t host_clock_scale(void) {
+    return atomic_load(&s_clock_scale);
+}
+
+int64_t esp_timer_get_time(void) {
+    return (host_monotonic_ns() - s_clock_start_ns) * host_clock_scale() / 1000;
+}
+
+void host_sleep_us(int64_t us) {
+    if (us <= 0) {
+        return;
+    }
+    int64_t real_ns = us * 1000 / host_clock_scale();
+    struct timespec ts = {
+        .tv_sec = real_ns / 1000000000,
+        .tv_nsec = real_ns % 1000000000,
+    };
+    nanosleep(&ts, NULL);
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    char line[256];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%lu) %s: %s\n", letters[level], (unsigned long)esp_log_timestamp(), tag, line);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:      return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:       return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_FINISHED:          return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NOT_ALLOWED:           return "ESP_ERR_NOT_ALLOWED";
+        case ESP_ERR_NVS_NOT_INITIALIZED:   return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH:    return "ESP_ERR_NVS_INVALID_LENGTH";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    (void)caps;
+    return 0;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info) {
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->ssid, "host", 5);
+    ap_info->primary = 6;
+    ap_info->rssi = host_wifi_rssi;
+    return ESP_OK;
+}
+
+/**
+ * @brief One stored blob; handles are 1 + namespace index
+ */
+typedef struct {
+    char namespace_name[16];
+    char key[16];
+    uint8_t data[HOST_NVS_MAX_BLOB];
+    size_t length;
+    bool used;
+} host_nvs_entry_t;
+
+static host_nvs_entry_t s_nvs[HOST_NVS_MAX_ENTRIES];
+static char s_nvs_namespaces[HOST_NVS_MAX_ENTRIES][16];
+static pthread_mutex_t s_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static host_nvs_entry_t *host_nvs_find(nvs_handle_t handle, const char *key) {
+    for (int i = 0; i < HOST_NVS_MAX_ENTRIES; i++) {
+        if (s_nvs[i].used && strcmp(s_nvs[i].namespace_name, s_nvs_namespaces[handle - 1]) == 0 &&
+            strcmp(s_nvs[i].key, key) == 0) {
+            return &s_nvs[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    (void)open_mode;
+    if (namespace_name == NULL || out_handle == NULL || strlen(namespace_name) >= 16) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&s_nvs_lock);
+    for (int i = 0; i < HOST_NVS_MAX_ENTRIES; i++) {
+        if (s_nvs_namespaces[i][0] == '\0') {
+            strcpy(s_nvs_namespaces[i], namespace_name);
+        }
+        if (strcmp(s_nvs_namespaces[i], namespace_name) == 0) {
+            *out_handle = (nvs_handle_t)(i + 1);
+            pthread_mutex_unlock(&s_nvs_lock);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    (void)handle;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&s_nvs_lock);
+    host_nvs_entry_t *entry = host_nvs_find(handle, key);
+    if (entry == NULL) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (out_value == NULL) {
+        *length = entry->length;
+    } else if (*length < entry->length) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out_value, entry->data, entry->length);
+        *length = entry->length;
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    if (key == NULL || strlen(key) >= 16 || length > HOST_NVS_MAX_BLOB) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&s_nvs_lock);
+    host_nvs_entry_t *entry = host_nvs_find(handle, key);
+    for (int i = 0; entry == NULL && i < HOST_NVS_MAX_ENTRIES; i++) {
+        if (!s_nvs[i].used) {
+            entry = &s_nvs[i];
+            entry->used = true;
+            strcpy(entry->namespace_name, s_nvs_namespaces[handle - 1]);
+            strcpy(entry->key, key);
+        }
+    }
+    if (entry == NULL) {
+        pthread_mutex_unlock(&s_nvs_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(entry->data, value, length);
+    entry->length = length;
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value) {
+    size_t length = sizeof(*out_value);
+    esp_err_t ret = nvs_get_blob(handle, key, out_value, &length);
+    return (ret == ESP_OK && length != sizeof(*out_value)) ? ESP_ERR_NVS_INVALID_LENGTH : ret;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    pthread_mutex_lock(&s_nvs_lock);
+    host_nvs_entry_t *entry = host_nvs_find(handle, key);
+    if (entry != NULL) {
+        entry->used = false;
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return entry ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    (void)handle;
+    return ESP_OK;
+}
+
+void host_nvs_clear(void) {
+    pthread_mutex_lock(&s_nvs_lock);
+    memset(s_nvs, 0, sizeof(s_nvs));
+    pthread_mutex_unlock(&s_nvs_lock);
+}
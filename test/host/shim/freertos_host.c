@@ -0,0 +1,388 @@
+/**
+ * @file freertos_host.c
+ * @brief Host shim: FreeRTOS tasks, queues, semaphores and notifications on pthreads
+ *
+ * Priorities and core affinity are ignored; the host scheduler runs every
+ * task in parallel. Blocking calls that take ticks wait on the simulated
+ * clock (see esp_timer.h), so a 900 ms conversion wait costs 900 / scale ms.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_count;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static pthread_mutex_t s_critical_lock;
+static pthread_once_t s_critical_once = PTHREAD_ONCE_INIT;
+static _Thread_local struct host_task *s_current_task = NULL;
+static atomic_uint s_task_count = 0;
+
+static void host_critical_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void host_critical_enter(void) {
+    pthread_once(&s_critical_once, host_critical_init);
+    pthread_mutex_lock(&s_critical_lock);
+}
+
+void host_critical_exit(void) {
+    pthread_mutex_unlock(&s_critical_lock);
+}
+
+/**
+ * @brief Absolute CLOCK_MONOTONIC deadline for a wait of `ticks`, false for portMAX_DELAY
+ */
+static bool host_deadline(TickType_t ticks, struct timespec *deadline) {
+    if (ticks == portMAX_DELAY) {
+        return false;
+    }
+    int64_t real_ns = (int64_t)ticks * portTICK_PERIOD_MS * 1000000 / host_clock_scale();
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += real_ns / 1000000000;
+    deadline->tv_nsec += real_ns % 1000000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+    return true;
+}
+
+static void host_cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/**
+ * @brief Cancellation cleanup handler: release the lock a cancelled waiter held
+ */
+static void host_unlock(void *lock) {
+    pthread_mutex_unlock((pthread_mutex_t *)lock);
+}
+
+/**
+ * @brief Wait on a condition until signalled or the deadline passes
+ *
+ * @return false on timeout
+ */
+static bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, bool timed, const struct timespec *deadline) {
+    if (!timed) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static struct host_task *host_task_alloc(const char *name) {
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        return NULL;
+    }
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+static void *host_task_entry(void *arg) {
+    struct host_task *task = arg;
+    s_current_task = task;
+    task->fn(task->arg);
+    // Returning from a task function is an error on target; end the thread quietly here
+    atomic_fetch_sub(&s_task_count, 1);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id) {
+    (void)stack_depth;
+    (void)priority;
+    (void)core_id;
+
+    struct host_task *task = host_task_alloc(name);
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (handle != NULL) {
+        *handle = task;
+    }
+    atomic_fetch_add(&s_task_count, 1);
+    if (pthread_create(&task->thread, NULL, host_task_entry, task) != 0) {
+        atomic_fetch_sub(&s_task_count, 1);
+        if (handle != NULL) {
+            *handle = NULL;
+        }
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == s_current_task) {
+        atomic_fetch_sub(&s_task_count, 1);
+        pthread_exit(NULL);
+    }
+    // Cancelled at its next wait; the handle is leaked on purpose since the
+    // thread may still be inside a call that uses it
+    pthread_cancel(task->thread);
+    atomic_fetch_sub(&s_task_count, 1);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    host_sleep_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(esp_timer_get_time() / (portTICK_PERIOD_MS * 1000));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (s_current_task == NULL) {
+        // A thread that was not created through xTaskCreate (the benchmark's main)
+        s_current_task = host_task_alloc("main");
+        if (s_current_task != NULL) {
+            s_current_task->thread = pthread_self();
+        }
+    }
+    return s_current_task;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    return atomic_load(&s_task_count) + 1;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&task->lock);
+    task->notify_count++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    bool timed = host_deadline(ticks, &deadline);
+
+    pthread_mutex_lock(&task->lock);
+    pthread_cleanup_push(host_unlock, &task->lock);
+    while (task->notify_count == 0 && ticks != 0) {
+        if (!host_cond_wait(&task->cond, &task->lock, timed, &deadline)) {
+            break;
+        }
+    }
+    pthread_cleanup_pop(0);
+    uint32_t value = task->notify_count;
+    if (value > 0) {
+        task->notify_count = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue *queue = calloc(1, sizeof(*queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    queue->items = calloc(length, item_size);
+    if (queue->items == NULL) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    host_cond_init(&queue->cond);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->cond);
+    free(queue->items);
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    struct timespec deadline;
+    bool timed = host_deadline(ticks, &deadline);
+    BaseType_t ret = pdFAIL;
+
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(host_unlock, &queue->lock);
+    while (queue->count == queue->length && ticks != 0) {
+        if (!host_cond_wait(&queue->cond, &queue->lock, timed, &deadline)) {
+            break;
+        }
+    }
+    pthread_cleanup_pop(0);
+    if (queue->count < queue->length) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+        queue->count++;
+        pthread_cond_broadcast(&queue->cond);
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    struct timespec deadline;
+    bool timed = host_deadline(ticks, &deadline);
+    BaseType_t ret = pdFAIL;
+
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(host_unlock, &queue->lock);
+    while (queue->count == 0 && ticks != 0) {
+        if (!host_cond_wait(&queue->cond, &queue->lock, timed, &deadline)) {
+            break;
+        }
+    }
+    pthread_cleanup_pop(0);
+    if (queue->count > 0) {
+        memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->cond);
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ret;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+static SemaphoreHandle_t host_semaphore_init(StaticSemaphore_t *sem, uint32_t max, uint32_t initial, bool is_static) {
+    pthread_mutex_init(&sem->lock, NULL);
+    host_cond_init(&sem->cond);
+    sem->count = initial;
+    sem->max = max;
+    sem->is_static = is_static;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    StaticSemaphore_t *sem = calloc(1, sizeof(*sem));
+    if (sem == NULL) {
+        return NULL;
+    }
+    return host_semaphore_init(sem, max_count, initial_count, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+    return host_semaphore_init(buffer, 1, 0, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    if (sem == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&sem->lock);
+    pthread_cond_destroy(&sem->cond);
+    if (!sem->is_static) {
+        free(sem);
+    }
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    struct timespec deadline;
+    bool timed = host_deadline(ticks, &deadline);
+    BaseType_t ret = pdFAIL;
+
+    pthread_mutex_lock(&sem->lock);
+    pthread_cleanup_push(host_unlock, &sem->lock);
+    while (sem->count == 0 && ticks != 0) {
+        if (!host_cond_wait(&sem->cond, &sem->lock, timed, &deadline)) {
+            break;
+        }
+    }
+    pthread_cleanup_pop(0);
+    if (sem->count > 0) {
+        sem->count--;
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    BaseType_t ret = pdFAIL;
+
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count < sem->max) {
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file esp_timer.h
+ * @brief Host shim: simulated microsecond clock
+ *
+ * The host clock runs host_clock_scale() times faster than real time, so
+ * conversion waits of a real sweep take a fraction of a second. Every
+ * FreeRTOS delay and timeout in the shim uses the same clock.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Simulated microseconds since start
+ */
+int64_t esp_timer_get_time(void);
+
+/**
+ * @brief Set how much faster than real time the clock runs (call before any task starts)
+ *
+ * HOST_TIME_SCALE in the environment overrides the value passed here.
+ */
+void host_clock_set_scale(uint32_t scale);
+
+uint32_t host_clock_scale(void);
+
+/**
+ * @brief Sleep for a span of simulated time
+ */
+void host_sleep_us(int64_t us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,31 @@
+/**
+ * @file esp_wifi.h
+ * @brief Host shim: station AP info for the RSSI in each snapshot
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t rssi;
+} wifi_ap_record_t;
+
+/**
+ * @brief Reports a fixed AP with host_wifi_rssi
+ */
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info);
+
+extern int8_t host_wifi_rssi;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host shim: FreeRTOS types and critical sections on pthreads
+ *
+ * Tasks are threads, ticks come from the simulated clock in esp_timer.h and
+ * every critical section takes one process-wide recursive lock (no scheduler
+ * to disable, so this is the nearest equivalent).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)UINT32_MAX)
+#define configTICK_RATE_HZ      CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define configMAX_TASK_NAME_LEN 16
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+#ifndef BIT0
+#define BIT0    (1u << 0)
+#define BIT1    (1u << 1)
+#define BIT2    (1u << 2)
+#define BIT3    (1u << 3)
+#define BIT4    (1u << 4)
+#define BIT5    (1u << 5)
+#define BIT6    (1u << 6)
+#define BIT7    (1u << 7)
+#endif
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#define portENTER_CRITICAL(mux)         do { (void)(mux); host_critical_enter(); } while (0)
+#define portEXIT_CRITICAL(mux)          do { (void)(mux); host_critical_exit(); } while (0)
+#define portENTER_CRITICAL_ISR(mux)     portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)      portEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR(x)           do { (void)(x); } while (0)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,12 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host build configuration (the subset of config/sdkconfig.defaults the harness needs)
+ */
+
+#pragma once
+
+#define CONFIG_FREERTOS_HZ                  1000
+#define CONFIG_LOG_DEFAULT_LEVEL            3       // ESP_LOG_INFO
+#define CONFIG_LOG_MAXIMUM_LEVEL            5       // ESP_LOG_VERBOSE
+#define CONFIG_APP_LOG_TRACE_SIZE           0
+#define CONFIG_SPIRAM                       0
@@ -0,0 +1,48 @@
+/**
+ * @file mem_policy_host.c
+ * @brief Host shim: main/mem_policy.h on plain malloc()
+ *
+ * The host has one heap, so pools and PSRAM steering are pass-throughs and
+ * the statistics stay zero.
+ */
+
+#include "mem_policy.h"
+#include <stdlib.h>
+#include <string.h>
+
+esp_err_t mem_policy_init(void) {
+    return ESP_OK;
+}
+
+void *mem_policy_alloc_large(size_t size) {
+    return malloc(size);
+}
+
+void *mem_policy_realloc_large(void *ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+void *mem_policy_pool_alloc(size_t size) {
+    return malloc(size);
+}
+
+void mem_policy_pool_free(void *ptr) {
+    free(ptr);
+}
+
+void mem_policy_get_pool_stats(mem_pool_id_t pool, mem_pool_stats_t *stats) {
+    (void)pool;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void mem_policy_get_heap_stats(mem_heap_stats_t *stats) {
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+const char *mem_policy_pool_name(mem_pool_id_t pool) {
+    return (pool == MEM_POOL_SMALL) ? "small" : (pool == MEM_POOL_LARGE) ? "large" : "?";
+}
@@ -0,0 +1,485 @@
+/**
+ * @file sim_i2c.c
+ * @brief Simulated I2C bus with Atlas Scientific EZO and MAX17048 devices
+ */
+
+#include "sim_i2c.h"
+#include "driver/i2c_master.h"
+#include "esp_timer.h"
+#include "ezo_sensor.h"
+#include "max17048.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_RESPONSE_MAX    (EZO_LARGEST_STRING - 1)   // Circuit output buffer (after the status byte)
+
+typedef enum {
+    SIM_DEV_NONE = 0,
+    SIM_DEV_EZO,
+    SIM_DEV_MAX17048,
+} sim_dev_kind_t;
+
+typedef struct {
+    sim_dev_kind_t kind;
+    uint8_t address;
+    sim_fault_t fault;
+
+    // EZO
+    char type[EZO_MAX_SENSOR_TYPE];
+    char firmware[EZO_MAX_FW_VERSION];
+    char name[EZO_MAX_SENSOR_NAME + 1];
+    char outputs[SIM_RESPONSE_MAX + 1];
+    float values[4];
+    uint8_t value_count;
+    float noise;
+    uint32_t read_ms;
+    uint32_t command_ms;
+    int64_t busy_until_us;      // Processing the last command until then
+    bool converting;            // The last command was a reading
+    uint8_t status;             // Status byte once processing finished
+    char response[SIM_RESPONSE_MAX + 1];
+
+    // MAX17048
+    uint16_t vcell;
+    uint16_t soc;
+    int16_t crate;
+} sim_device_t;
+
+struct sim_i2c_bus {
+    int port;
+};
+
+struct sim_i2c_dev {
+    uint8_t address;
+};
+
+static sim_device_t s_devices[SIM_I2C_MAX_DEVICES];
+static sim_i2c_stats_t s_stats;
+static uint32_t s_byte_time_us = SIM_I2C_BYTE_TIME_US;
+static uint32_t s_rng = 0x2545F491u;
+static struct sim_i2c_bus s_bus;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief xorshift32, under s_lock
+ */
+static uint32_t sim_random(void) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static sim_device_t *sim_find(uint8_t address) {
+    for (int i = 0; i < SIM_I2C_MAX_DEVICES; i++) {
+        if (s_devices[i].kind != SIM_DEV_NONE && s_devices[i].address == address) {
+            return &s_devices[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t sim_typical_read_ms(const char *type) {
+    static const struct { const char *type; uint32_t ms; } times[] = {
+        { EZO_TYPE_RTD, EZO_READ_TIME_RTD_MS },
+        { EZO_TYPE_PH,  EZO_READ_TIME_PH_MS },
+        { EZO_TYPE_EC,  EZO_READ_TIME_EC_MS },
+        { EZO_TYPE_DO,  EZO_READ_TIME_DO_MS },
+        { EZO_TYPE_ORP, EZO_READ_TIME_ORP_MS },
+        { EZO_TYPE_HUM, EZO_READ_TIME_HUM_MS },
+    };
+    for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        if (strcmp(type, times[i].type) == 0) {
+            return times[i].ms;
+        }
+    }
+    return EZO_SHORT_WAIT_MS;
+}
+
+/**
+ * @brief Account one transaction; false if the device does not acknowledge
+ */
+static bool sim_transaction(sim_device_t *dev, size_t bytes, int64_t *bus_us) {
+    s_stats.transactions++;
+    *bus_us = (int64_t)(bytes + 1) * s_byte_time_us;
+    s_stats.bus_time_us += (uint64_t)*bus_us;
+
+    if (dev == NULL || dev->fault.absent ||
+        (dev->fault.nack_permille > 0 && sim_random() % 1000 < dev->fault.nack_permille)) {
+        s_stats.nacks++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Format one reading the way the circuits do ("1413,706,0.69,1.000"-style)
+ */
+static void sim_format_reading(sim_device_t *dev) {
+    size_t len = 0;
+    dev->response[0] = '\0';
+    for (uint8_t i = 0; i < dev->value_count && len < sizeof(dev->response); i++) {
+        float value = dev->values[i];
+        if (dev->noise > 0.0f) {
+            value += dev->noise * (2.0f * (float)(sim_random() % 10001) / 10000.0f - 1.0f);
+        }
+        // HUM prints a "Dew" label before the dew point
+        if (i == 2 && strcmp(dev->type, EZO_TYPE_HUM) == 0) {
+            len += snprintf(dev->response + len, sizeof(dev->response) - len, ",Dew");
+        }
+        const char *format = (fabsf(value) >= 1000.0f) ? "%s%.0f" : "%s%.4g";
+        len += snprintf(dev->response + len, len < sizeof(dev->response) ? sizeof(dev->response) - len : 0,
+                        format, i ? "," : "", (double)value);
+    }
+}
+
+/**
+ * @brief Answer for a "<param>,?" query
+ */
+static void sim_format_query(sim_device_t *dev, const char *param) {
+    const char *value = "0";
+    char number[16];
+
+    if (strcmp(param, "Name") == 0) {
+        value = dev->name;
+    } else if (strcmp(param, "L") == 0) {
+        value = "1";
+    } else if (strcmp(param, "S") == 0) {
+        value = "c";
+    } else if (strcmp(param, "K") == 0) {
+        value = "1.0";
+    } else if (strcmp(param, "TDS") == 0) {
+        value = "0.5";
+    } else if (strcmp(param, "O") == 0) {
+        value = dev->outputs;
+    } else if (strcmp(param, "Cal") == 0) {
+        value = "2";
+    } else if (strcmp(param, "T") == 0) {
+        snprintf(number, sizeof(number), "%.2f", 25.0);
+        value = number;
+    }
+    int len = snprintf(dev->response, sizeof(dev->response), "?%s,", param);
+    if (len > 0 && (size_t)len < sizeof(dev->response)) {
+        strncpy(dev->response + len, value, sizeof(dev->response) - len - 1);
+    }
+}
+
+/**
+ * @brief Start processing a command written to an EZO circuit
+ */
+static void sim_ezo_command(sim_device_t *dev, const char *command, int64_t now_us) {
+    size_t len = strlen(command);
+
+    dev->status = EZO_RESP_SUCCESS;
+    dev->response[0] = '\0';
+    dev->converting = false;
+    dev->busy_until_us = now_us + (int64_t)dev->command_ms * 1000;
+
+    if (strcmp(command, "R") == 0 || strncmp(command, "RT,", 3) == 0) {
+        if (command[1] == 'T' && dev->fault.reject_rt) {
+            dev->status = EZO_RESP_SYNTAX_ERROR;
+            s_stats.commands++;
+            return;
+        }
+        uint32_t read_ms = dev->read_ms + dev->fault.extra_read_ms;
+        if (dev->fault.jitter_ms > 0) {
+            read_ms += sim_random() % (dev->fault.jitter_ms + 1);
+        }
+        dev->busy_until_us = now_us + (int64_t)read_ms * 1000;
+        dev->converting = true;
+        dev->status = dev->fault.no_data ? EZO_RESP_NO_DATA : EZO_RESP_SUCCESS;
+        sim_format_reading(dev);
+        s_stats.conversions++;
+        return;
+    }
+
+    s_stats.commands++;
+    if (strcmp(command, "i") == 0) {
+        char info[sizeof(dev->response)];
+        snprintf(info, sizeof(info), "?I,%s,%s", dev->type, dev->firmware);
+        memcpy(dev->response, info, sizeof(info));
+    } else if (len >= 2 && strcmp(command + len - 2, ",?") == 0) {
+        char param[16];
+        size_t param_len = len - 2 < sizeof(param) - 1 ? len - 2 : sizeof(param) - 1;
+        memcpy(param, command, param_len);
+        param[param_len] = '\0';
+        sim_format_query(dev, param);
+    } else if (strncmp(command, "Name,", 5) == 0) {
+        size_t name_len = strnlen(command + 5, sizeof(dev->name) - 1);
+        memcpy(dev->name, command + 5, name_len);
+        dev->name[name_len] = '\0';
+    } else if (strncmp(command, "I2C,", 4) == 0) {
+        dev->address = (uint8_t)atoi(command + 4);
+    }
+}
+
+void sim_i2c_reset(void) {
+    pthread_mutex_lock(&s_lock);
+    memset(s_devices, 0, sizeof(s_devices));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_byte_time_us = SIM_I2C_BYTE_TIME_US;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_i2c_seed(uint32_t seed) {
+    pthread_mutex_lock(&s_lock);
+    s_rng = seed ? seed : 0x2545F491u;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_i2c_set_byte_time_us(uint32_t us) {
+    pthread_mutex_lock(&s_lock);
+    s_byte_time_us = us;
+    pthread_mutex_unlock(&s_lock);
+}
+
+static sim_device_t *sim_alloc(uint8_t address, esp_err_t *ret) {
+    if (sim_find(address) != NULL) {
+        *ret = ESP_ERR_INVALID_STATE;
+        return NULL;
+    }
+    for (int i = 0; i < SIM_I2C_MAX_DEVICES; i++) {
+        if (s_devices[i].kind == SIM_DEV_NONE) {
+            memset(&s_devices[i], 0, sizeof(s_devices[i]));
+            s_devices[i].address = address;
+            *ret = ESP_OK;
+            return &s_devices[i];
+        }
+    }
+    *ret = ESP_ERR_NO_MEM;
+    return NULL;
+}
+
+esp_err_t sim_i2c_add_ezo(const sim_ezo_config_t *config) {
+    if (config == NULL || config->type == NULL || config->value_count > 4) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret;
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_alloc(config->address, &ret);
+    if (dev != NULL) {
+        dev->kind = SIM_DEV_EZO;
+        snprintf(dev->type, sizeof(dev->type), "%s", config->type);
+        snprintf(dev->firmware, sizeof(dev->firmware), "%s", config->firmware ? config->firmware : "2.16");
+        snprintf(dev->name, sizeof(dev->name), "%s", config->name ? config->name : "");
+        snprintf(dev->outputs, sizeof(dev->outputs), "%s", config->outputs ? config->outputs : config->type);
+        memcpy(dev->values, config->values, sizeof(dev->values));
+        dev->value_count = config->value_count;
+        dev->noise = config->noise;
+        dev->read_ms = config->read_ms ? config->read_ms : sim_typical_read_ms(config->type);
+        dev->command_ms = config->command_ms ? config->command_ms : SIM_EZO_COMMAND_MS;
+        dev->status = EZO_RESP_NO_DATA;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t sim_i2c_add_max17048(float voltage, float soc, float rate) {
+    esp_err_t ret;
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_alloc(MAX17048_I2C_ADDR, &ret);
+    if (dev != NULL) {
+        dev->kind = SIM_DEV_MAX17048;
+        dev->vcell = (uint16_t)lroundf(voltage * 1000000.0f / 78.125f);
+        dev->soc = (uint16_t)lroundf(soc * 256.0f);
+        dev->crate = (int16_t)lroundf(rate / 0.208f);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t sim_i2c_set_fault(uint8_t address, const sim_fault_t *fault) {
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_find(address);
+    if (dev != NULL) {
+        if (fault != NULL) {
+            dev->fault = *fault;
+        } else {
+            memset(&dev->fault, 0, sizeof(dev->fault));
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return dev ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t sim_i2c_set_values(uint8_t address, const float *values, uint8_t count) {
+    if (values == NULL || count > 4) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_find(address);
+    if (dev != NULL) {
+        memcpy(dev->values, values, count * sizeof(float));
+        dev->value_count = count;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return dev ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void sim_i2c_get_stats(sim_i2c_stats_t *stats) {
+    pthread_mutex_lock(&s_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_i2c_clear_stats(void) {
+    pthread_mutex_lock(&s_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    pthread_mutex_unlock(&s_lock);
+}
+
+// ---- ESP-IDF i2c_master API ----
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle) {
+    if (bus_config == NULL || ret_bus_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_bus.port = bus_config->i2c_port;
+    *ret_bus_handle = &s_bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle) {
+    return bus_handle ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t *ret_handle) {
+    if (bus_handle == NULL || dev_config == NULL || ret_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct sim_i2c_dev *dev = calloc(1, sizeof(*dev));
+    if (dev == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->address = (uint8_t)dev_config->device_address;
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle) {
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus_handle, uint16_t address, int xfer_timeout_ms) {
+    (void)xfer_timeout_ms;
+    if (bus_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t bus_us;
+    pthread_mutex_lock(&s_lock);
+    bool ack = sim_transaction(sim_find((uint8_t)address), 0, &bus_us);
+    pthread_mutex_unlock(&s_lock);
+    host_sleep_us(bus_us);
+    return ack ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms) {
+    (void)xfer_timeout_ms;
+    if (i2c_dev == NULL || write_buffer == NULL || write_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t bus_us;
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_find(i2c_dev->address);
+    bool ack = sim_transaction(dev, write_size, &bus_us);
+    if (ack && dev->kind == SIM_DEV_EZO) {
+        char command[32];
+        size_t len = write_size < sizeof(command) - 1 ? write_size : sizeof(command) - 1;
+        memcpy(command, write_buffer, len);
+        command[len] = '\0';
+        sim_ezo_command(dev, command, esp_timer_get_time() + bus_us);
+    }
+    pthread_mutex_unlock(&s_lock);
+    host_sleep_us(bus_us);
+    return ack ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t i2c_dev, uint8_t *read_buffer, size_t read_size,
+                             int xfer_timeout_ms) {
+    (void)xfer_timeout_ms;
+    if (i2c_dev == NULL || read_buffer == NULL || read_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t bus_us;
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_find(i2c_dev->address);
+    bool ack = sim_transaction(dev, read_size, &bus_us);
+    if (ack) {
+        memset(read_buffer, 0, read_size);
+        if (dev->kind != SIM_DEV_EZO) {
+            read_buffer[0] = 0xFF;
+        } else if ((dev->converting && dev->fault.stuck) || esp_timer_get_time() < dev->busy_until_us) {
+            read_buffer[0] = EZO_RESP_NOT_READY;
+            s_stats.busy_polls++;
+        } else {
+            read_buffer[0] = dev->status;
+            if (dev->status == EZO_RESP_SUCCESS) {
+                size_t len = strlen(dev->response);
+                memcpy(read_buffer + 1, dev->response, len < read_size - 1 ? len : read_size - 1);
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    host_sleep_us(bus_us);
+    return ack ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer,
+                                      size_t write_size, uint8_t *read_buffer, size_t read_size,
+                                      int xfer_timeout_ms) {
+    (void)xfer_timeout_ms;
+    if (i2c_dev == NULL || write_buffer == NULL || write_size == 0 || read_buffer == NULL || read_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t bus_us;
+    pthread_mutex_lock(&s_lock);
+    sim_device_t *dev = sim_find(i2c_dev->address);
+    bool ack = sim_transaction(dev, write_size + read_size, &bus_us);
+    if (ack) {
+        uint16_t value = 0;
+        if (dev->kind == SIM_DEV_MAX17048) {
+            switch (write_buffer[0]) {
+                case MAX17048_REG_VCELL:
+                    value = dev->vcell;
+                    break;
+                case MAX17048_REG_SOC:
+                    value = dev->soc;
+                    break;
+                case MAX17048_REG_CRATE:
+                    value = (uint16_t)dev->crate;
+                    break;
+                case MAX17048_REG_VERSION:
+                    value = 0x0012;
+                    break;
+                case MAX17048_REG_CONFIG:
+                    value = 0x971C;
+                    break;
+                default:
+                    break;
+            }
+        }
+        memset(read_buffer, 0, read_size);
+        read_buffer[0] = (uint8_t)(value >> 8);
+        if (read_size > 1) {
+            read_buffer[1] = (uint8_t)(value & 0xFF);
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    host_sleep_us(bus_us);
+    return ack ? ESP_OK : ESP_FAIL;
+}
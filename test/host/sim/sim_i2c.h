@@ -0,0 +1,122 @@
+/**
+ * @file sim_i2c.h
+ * @brief Simulated I2C bus with Atlas Scientific EZO and MAX17048 devices
+ *
+ * Implements the ESP-IDF i2c_master API (shim/include/driver/i2c_master.h),
+ * so ezo_sensor.c, max17048.c and i2c_scanner.c run unmodified on top of it.
+ * EZO devices follow the datasheet protocol: a command starts processing,
+ * reads before it finishes return 0xFE (still processing), then 0x01 and
+ * the ASCII response. Conversion and command times run on the simulated
+ * clock; faults can be injected per device.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_I2C_MAX_DEVICES         16
+#define SIM_I2C_BYTE_TIME_US        90      // 9 clocks per byte at 100 kHz
+#define SIM_EZO_COMMAND_MS          300     // Datasheet processing time of non-read commands
+
+/**
+ * @brief One simulated EZO circuit
+ */
+typedef struct {
+    uint8_t address;
+    const char *type;           // EZO_TYPE_* as answered to "i"
+    const char *firmware;       // NULL = "2.16"
+    const char *name;           // "Name,?" answer, NULL = none
+    const char *outputs;        // "O,?" answer, e.g. "HUM,T,Dew"; NULL = "<type>"
+    float values[4];            // Reading returned by "R" / "RT,<temp>"
+    uint8_t value_count;
+    float noise;                // Uniform +-noise added to every value of every reading
+    uint32_t read_ms;           // Conversion time, 0 = the type's typical time (ezo_sensor.h)
+    uint32_t command_ms;        // Processing time of other commands, 0 = SIM_EZO_COMMAND_MS
+} sim_ezo_config_t;
+
+/**
+ * @brief Faults injected into one device (zero = healthy)
+ */
+typedef struct {
+    uint16_t nack_permille;     // Transactions that fail with a NACK, per mille
+    uint32_t extra_read_ms;     // Added to every conversion
+    uint32_t jitter_ms;         // Uniform 0..jitter_ms added to every conversion
+    bool stuck;                 // Conversions never finish (0xFE on every read)
+    bool absent;                // Device stops acknowledging its address
+    bool reject_rt;             // "RT,<temp>" answered with a syntax error (old firmware)
+    bool no_data;               // Finished conversions answer 0xFF (no data)
+} sim_fault_t;
+
+/**
+ * @brief Bus activity since sim_i2c_reset() or the last sim_i2c_clear_stats()
+ */
+typedef struct {
+    uint32_t transactions;      // Probes, writes and reads
+    uint32_t nacks;             // Injected NACKs and absent devices
+    uint32_t busy_polls;        // Reads answered with 0xFE
+    uint32_t conversions;       // "R" and "RT" commands accepted
+    uint32_t commands;          // Other commands accepted
+    uint64_t bus_time_us;       // Simulated time spent transferring bytes
+} sim_i2c_stats_t;
+
+/**
+ * @brief Remove every device, clear faults and statistics
+ */
+void sim_i2c_reset(void);
+
+/**
+ * @brief Seed the fault and noise generator (runs are reproducible per seed)
+ */
+void sim_i2c_seed(uint32_t seed);
+
+/**
+ * @brief Time per transferred byte, including the address byte
+ *
+ * @param us Simulated microseconds (SIM_I2C_BYTE_TIME_US by default, 0 = instant)
+ */
+void sim_i2c_set_byte_time_us(uint32_t us);
+
+/**
+ * @brief Attach an EZO circuit
+ *
+ * @param config Device description (strings are copied)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if the address is taken,
+ *         ESP_ERR_NO_MEM if SIM_I2C_MAX_DEVICES are attached
+ */
+esp_err_t sim_i2c_add_ezo(const sim_ezo_config_t *config);
+
+/**
+ * @brief Attach a MAX17048 fuel gauge at MAX17048_I2C_ADDR
+ *
+ * @param voltage Cell voltage in V
+ * @param soc State of charge in percent
+ * @param rate Charge rate in %/hour
+ */
+esp_err_t sim_i2c_add_max17048(float voltage, float soc, float rate);
+
+/**
+ * @brief Set the faults of one device
+ *
+ * @param address Device address
+ * @param fault Faults, NULL to clear
+ * @return esp_err_t ESP_ERR_NOT_FOUND if no device has that address
+ */
+esp_err_t sim_i2c_set_fault(uint8_t address, const sim_fault_t *fault);
+
+/**
+ * @brief Change the reading an EZO device returns
+ */
+esp_err_t sim_i2c_set_values(uint8_t address, const float *values, uint8_t count);
+
+void sim_i2c_get_stats(sim_i2c_stats_t *stats);
+void sim_i2c_clear_stats(void);
+
+#ifdef __cplusplus
+}
+#endif